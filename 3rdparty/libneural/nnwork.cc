@@ -115,6 +115,25 @@ int nnwork::get_layersize (int layer)
 	}
 }
 
+// Weights of a node, as used by run (). Useful to evaluate the network
+// outside of this class, e.g. for many inputs at once.
+
+const float *nnwork::get_weights (int layer, int node)
+{
+	switch (layer) {
+		case (HIDDEN):
+			if (node < 0 || node >= hidden_size) return 0;
+			return hidden_nodes -> nodes [node].weights;
+
+		case (OUTPUT):
+			if (node < 0 || node >= output_size) return 0;
+			return output_nodes -> nodes [node].weights;
+
+		default:
+			return 0;
+	}
+}
+
 // Training routine for the network. Uses data as input, compares output with
 // desired output, computes errors, adjusts weights attached to each node,
 // then repeats until the mean squared error at the output is less than 
@@ -59,6 +59,11 @@ public:
 
 	void run (float [], float []);
 	
+// Weights of one node of the HIDDEN or OUTPUT layer, one per node of the
+// previous layer. Returns 0 for any other layer or node.
+
+	const float *get_weights (int, int);
+
 // Arg for load and save is just the filename.
 
 	int load (char*);
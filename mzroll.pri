@@ -24,6 +24,7 @@ win32 {
 }
 
 unix: {
+    DEFINES += ZLIB
     INCLUDEPATH += /usr/local/include/ $$top_srcdir/3rdparty/obiwarp
     QMAKE_LFLAGS += -L/usr/local/lib/ -L$$top_builddir/libs/
     LIBS +=  -lboost_signals -lErrorHandling -lobiwarp
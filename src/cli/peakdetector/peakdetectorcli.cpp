@@ -17,6 +17,7 @@ PeakDetectorCLI::PeakDetectorCLI()
     _pollyIntegration = new PollyIntegration();
     _redirectTo = "gsheet_sym_polly_elmaven";
     _currentPollyApp = PollyApp::None;
+    _loadMemoryBudget = 0;
 }
 
 void PeakDetectorCLI::processOptions(int argc, char* argv[])
@@ -185,6 +186,14 @@ void PeakDetectorCLI::processOptions(int argc, char* argv[])
                 saveMzrollFile = false;
             break;
 
+        case 't':
+            mavenParameters->peakDetectionThreads = atoi(optarg);
+            break;
+
+        case 'M':
+            _loadMemoryBudget = atoi(optarg);
+            break;
+
         case 'v':
             mavenParameters->ionizationMode = atoi(optarg);
             break;
@@ -491,6 +500,13 @@ void PeakDetectorCLI::_processGeneralArgsXML(xml_node& generalArgs)
             mavenParameters->outputdir =
                 node.attribute("value").value() + string(DIR_SEPARATOR_STR);
 
+        } else if (strcmp(node.name(), "threads") == 0) {
+            mavenParameters->peakDetectionThreads =
+                atoi(node.attribute("value").value());
+
+        } else if (strcmp(node.name(), "loadMemoryBudget") == 0) {
+            _loadMemoryBudget = atoi(node.attribute("value").value());
+
         } else if (strcmp(node.name(), "savemzroll") == 0) {
             saveMzrollFile = true;
             if (atoi(node.attribute("value").value()) == 0)
@@ -555,21 +571,78 @@ void PeakDetectorCLI::loadSamples(vector<string>& filenames)
 #endif
     cout << "\nLoading samples" << endl;
 
-    for (unsigned int i = 0; i < filenames.size(); i++) {
-        mzSample* sample = new mzSample();
-        sample->loadSample(filenames[i].c_str());
-        sample->sampleName = mzUtils::cleanFilename(filenames[i]);
-        sample->isSelected = true;
-        if (sample->scans.size() >= 1) {
-            mavenParameters->samples.push_back(sample);
-            cout << endl
-                 << "Loaded Sample : " << sample->getSampleName() << endl;
-        } else {
-            if (sample != NULL) {
-                delete sample;
-                sample = NULL;
+    // samples are parsed by a pool of workers. Files are picked up in the
+    // given order, but a worker only starts on a file once the files being
+    // loaded fit into the memory budget (a single file is always allowed).
+    unsigned int workers = _sampleLoadingThreads(filenames.size());
+    unsigned long long memoryBudget =
+        static_cast<unsigned long long>(_loadMemoryBudget) * 1024 * 1024;
+
+    vector<mzSample*> loadedSamples(filenames.size(), nullptr);
+    mutex loadMutex;
+    condition_variable memoryReleased;
+    unsigned int nextFile = 0;
+    unsigned int filesLoading = 0;
+    unsigned long long memoryInUse = 0;
+
+    auto loadFiles = [&]() {
+        while (true) {
+            unsigned int i;
+            unsigned long long memoryNeeded;
+            {
+                unique_lock<mutex> lock(loadMutex);
+                if (nextFile >= filenames.size())
+                    return;
+                i = nextFile++;
+                memoryNeeded = _estimateSampleMemory(filenames[i]);
+                memoryReleased.wait(lock, [&]() {
+                    return memoryBudget == 0 || filesLoading == 0
+                           || memoryInUse + memoryNeeded <= memoryBudget;
+                });
+                filesLoading++;
+                memoryInUse += memoryNeeded;
             }
+
+            auto startTime = chrono::steady_clock::now();
+            mzSample* sample = new mzSample();
+            sample->loadSample(filenames[i].c_str());
+            sample->sampleName = mzUtils::cleanFilename(filenames[i]);
+            sample->isSelected = true;
+            chrono::duration<double> loadTime =
+                chrono::steady_clock::now() - startTime;
+
+            {
+                lock_guard<mutex> lock(loadMutex);
+                filesLoading--;
+                memoryInUse -= memoryNeeded;
+                if (sample->scans.size() >= 1) {
+                    loadedSamples[i] = sample;
+                    cout << endl
+                         << "Loaded Sample : " << sample->getSampleName()
+                         << " (" << loadTime.count() << " seconds)" << endl;
+                } else {
+                    delete sample;
+                }
+            }
+            memoryReleased.notify_all();
         }
+    };
+
+    if (workers > 1) {
+        vector<thread> pool;
+        for (unsigned int w = 0; w < workers; w++)
+            pool.push_back(thread(loadFiles));
+        for (auto& worker : pool)
+            worker.join();
+    } else {
+        loadFiles();
+    }
+
+    // samples are added in the given order and then sorted, as when they
+    // are loaded one after another
+    for (auto sample : loadedSamples) {
+        if (sample != NULL)
+            mavenParameters->samples.push_back(sample);
     }
 
     if (mavenParameters->samples.size() == 0) {
@@ -590,6 +663,28 @@ void PeakDetectorCLI::loadSamples(vector<string>& filenames)
 #endif
 }
 
+unsigned int PeakDetectorCLI::_sampleLoadingThreads(size_t fileCount)
+{
+    int threads = mavenParameters->peakDetectionThreads;
+    if (threads <= 0)
+        threads = thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    return std::max(1u, std::min(static_cast<unsigned int>(threads),
+                                 static_cast<unsigned int>(fileCount)));
+}
+
+unsigned long long PeakDetectorCLI::_estimateSampleMemory(const string& filename)
+{
+    // parsed samples take up roughly as much memory as their files, since
+    // base64 encoded (and mostly 64-bit) values are decoded to 32-bit floats
+    ifstream file(filename.c_str(), ios::binary | ios::ate);
+    if (!file.is_open())
+        return 0;
+    streamoff size = file.tellg();
+    return size > 0 ? static_cast<unsigned long long>(size) : 0;
+}
+
 void PeakDetectorCLI::_makeSampleCohortFile(QString sampleCohortFilename,
                                            QStringList loadedSamples)
 {
@@ -4,11 +4,15 @@
 #include <limits.h>
 #include <sys/time.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #ifndef __APPLE__
 #include <omp.h>
@@ -105,8 +109,11 @@ public:
     void loadCompoundsFile();
 
     /**
-     * [loadSamples description]
-     * @param filenames [description]
+     * @brief load samples from the given files
+     * @details Files are parsed concurrently by up to peakDetectionThreads
+     * workers, as long as the files being loaded fit into the memory
+     * budget. Loaded samples are sorted using mzSample::compSampleSort.
+     * @param filenames paths of the sample files
      */
     void loadSamples(vector<string>& filenames);
 
@@ -203,6 +210,8 @@ public:
             "Q?quantileQuality: Specify required percentage of peaks above quality threshold. <float>",
             "r?rtStepSize: Enter retention time window for untargeted peak detection. <float>",
             "s?savemzroll: Enter non-zero integer to save mzroll in the output folder. <int>",
+            "t?threads: Enter number of threads used to load samples and process slices, 0 to use all available cores. <int>",
+            "M?loadMemoryBudget: Enter memory (in MB) that samples being loaded at the same time may use, 0 for no limit. <int>",
             "v?ionizationMode: Enter 0, -1 or 1 ionization mode. <int>",
             "w?minPeakWidth: Enter min peak width threshold in a group. <int>",
             "x?xml: Enter full path to the config file. <string>",
@@ -230,6 +239,12 @@ private:
     bool _reduceGroupsFlag;
     PollyApp _currentPollyApp;
 
+    /**
+     * memory (in MB) that samples being loaded concurrently may take up,
+     * 0 for no limit
+     */
+    int _loadMemoryBudget;
+
     /**
      * [Load Arguments for Options Dialog]
      * @param optionsArgs [pugixml xml node]
@@ -250,6 +265,16 @@ private:
 
     void _groupReduction();
 
+    /**
+     * @brief number of workers used to load the given number of files
+     */
+    unsigned int _sampleLoadingThreads(size_t fileCount);
+
+    /**
+     * @brief expected memory (in bytes) needed to load a sample file
+     */
+    unsigned long long _estimateSampleMemory(const string& filename);
+
     QStringList _getSampleList();
 
     void _makeSampleCohortFile(QString sampleCohortFilename,
@@ -288,6 +313,8 @@ struct Arguments
         generalArgs << "int" << "saveEicJson" << "0";
         generalArgs << "string" << "outputdir" << "0";
         generalArgs << "int" << "savemzroll" << "0";
+        generalArgs << "int" << "threads" << "1";
+        generalArgs << "int" << "loadMemoryBudget" << "0";
         generalArgs << "string" << "samples" << "path/to/sample1";
         generalArgs << "string" << "samples" << "path/to/sample2";
         generalArgs << "string" << "samples" << "path/to/sample3";
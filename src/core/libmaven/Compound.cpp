@@ -91,15 +91,8 @@ Compound::Type Compound::type() const {
     return Type::UNKNOWN;
 }
 
-FragmentationMatchScore Compound::scoreCompoundHit(Fragment* expFrag,
-                                                   float productPpmTolr,
-                                                   bool searchProton)
+void Compound::buildLibraryFragment(Fragment& libFrag, bool searchProton)
 {
-    FragmentationMatchScore s;
-
-    if (fragmentMzValues.size() == 0) return s;
-
-    Fragment libFrag;
     libFrag.precursorMz = precursorMz;
     libFrag.mzValues = fragmentMzValues;
     libFrag.intensityValues = fragmentIntensities;
@@ -113,9 +106,21 @@ FragmentationMatchScore Compound::scoreCompoundHit(Fragment* expFrag,
             libFrag.intensityValues.push_back(libFrag.intensityValues[i]);
         }
     }
+    libFrag.sortByIntensity();
+}
+
+FragmentationMatchScore Compound::scoreCompoundHit(Fragment* expFrag,
+                                                   float productPpmTolr,
+                                                   bool searchProton)
+{
+    FragmentationMatchScore s;
+
+    if (fragmentMzValues.size() == 0) return s;
+
     //theory fragmentation or library fragmentation = libFrag
     //experimental data = expFrag
-    libFrag.sortByIntensity();
+    Fragment libFrag;
+    buildLibraryFragment(libFrag, searchProton);
     s = libFrag.scoreMatch(expFrag, productPpmTolr);
     return s;
 }
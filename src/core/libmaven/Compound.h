@@ -151,6 +151,15 @@ class Compound{
          */
         string note;
 
+        /**
+         * @brief Fill a fragment with the library fragmentation pattern of
+         * this compound, sorted by decreasing intensity
+         * @param libFrag Empty fragment to be filled
+         * @param searchProton Also add every fragment shifted by the gain and
+         * by the loss of a proton
+         */
+        void buildLibraryFragment(Fragment& libFrag, bool searchProton = false);
+
         FragmentationMatchScore scoreCompoundHit(Fragment* expFrag,
                                                  float productPpmTolr = 20,
                                                  bool searchProton = false);
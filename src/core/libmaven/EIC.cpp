@@ -1,4 +1,5 @@
 #include "EIC.h"
+#include "smoothingkernel.h"
 
 /**
  * @file EIC.cpp
@@ -151,104 +152,143 @@ void EIC::_computeAsLSBaseline(const float lambda,
                                const float p,
                                const int numIterations)
 {
-    // Eigen behaves better with double values compared to float
-    vector<double> intensity;
-    for(unsigned int i = 0; i < this->intensity.size(); ++i)
-        intensity.push_back(static_cast<double>(this->intensity[i]));
+    auto n = static_cast<unsigned int>(this->intensity.size());
 
-    using namespace Eigen;
-    auto n = static_cast<unsigned int>(intensity.size());
+    // with fewer than three points there is nothing to smooth and the
+    // baseline is the signal itself
+    if (n < 3) {
+        for (unsigned int i = 0; i < n; ++i)
+            baseline[i] = std::max(this->intensity[i], 0.0f);
+        return;
+    }
 
-    // Perform difference operation (pseudo-differentiation) on a sparse matrix
-    auto diff = [](Eigen::SparseMatrix<double> mat)
-    {
-        Eigen::SparseMatrix<double> E1 = mat.block(0,
-                                                   0,
-                                                   mat.rows() - 1,
-                                                   mat.cols());
-        Eigen::SparseMatrix<double> E2 = mat.block(1,
-                                                   0,
-                                                   mat.rows() - 1,
-                                                   mat.cols());
-        return Eigen::SparseMatrix<double>(E2 - E1);
-    };
-
-    // create a sparse identity matrix of size `n`
-    Eigen::SparseMatrix<double> ident(n, n);
-    ident.setIdentity();
-
-    // compute approximate second derivative of the identity matrix
-    auto D = diff(diff(ident));
-
-    // create a weights vector of length `n` initially containing only ones
-    // for coefficients
-    auto w = VectorXd(ArrayXd::Ones(n));
-
-    // instantiate a Cholesky decomposition linear solver for sparse matrices
-    SimplicialCholesky<SparseMatrix<double>> solver;
-
-    // instantiate a vector for intensity and one to store baseline
-    VectorXd intensityVec = Map<VectorXd>(intensity.data(), n);
-    VectorXd baselineVec;
-
-    // helper matrices for `select` operation used when creating binary vectors
-    auto ones = VectorXd(MatrixXd::Ones(n, 1));
-    auto zeros = VectorXd(MatrixXd::Zero(n, 1));
-
-    // TODO: ideally this should converge to a point where the baseline does
-    // not change anymnore, but since we do not have good float comparators
-    // yet we can use a decent number of iterations to get as close to the true
-    // baseline as possible
-    for (int i=0; i < numIterations; ++i) {
-        // create a square matrix 'W' with the weights as its diagonal
-        auto W = SparseMatrix<double>(w.asDiagonal());
-
-        // compute 'A' and 'b', and then solve for 'x' that satisfies the
-        // equation 'A·x = b', where x will be the iteratively estimated
-        // baseline
-        auto A = W + (lambda * (D.transpose() * D));
-        solver.compute(A);
-        auto b = VectorXd(w.array() * intensityVec.array());
-        baselineVec = solver.solve(b);
-
-        // calculate weights for the next iteration
-        auto gtBin = VectorXd(
-            ((intensityVec - baselineVec).array() > 0.0).select(ones, zeros)
-        );
-        auto ltBin = VectorXd(
-            ((intensityVec - baselineVec).array() < 0.0).select(ones, zeros)
-        );
-        w = (p * gtBin) + ((1.0f - p) * ltBin);
+    // double precision is needed for the factorization to behave well
+    vector<double> intensity(this->intensity.begin(), this->intensity.end());
+
+    // bands of λ·DᵀD, where D is the (n - 2) x n second order difference
+    // matrix having rows [1, -2, 1]; these do not change across iterations
+    vector<double> penaltyDiag(n, 0.0);
+    vector<double> penaltyOff1(n - 1, 0.0);
+    vector<double> penaltyOff2(n - 2, 0.0);
+    const double coeffs[3] = {1.0, -2.0, 1.0};
+    for (unsigned int r = 0; r < n - 2; ++r) {
+        for (unsigned int j = 0; j < 3; ++j) {
+            penaltyDiag[r + j] += lambda * coeffs[j] * coeffs[j];
+            if (j < 2)
+                penaltyOff1[r + j] += lambda * coeffs[j] * coeffs[j + 1];
+        }
+        penaltyOff2[r] += lambda * coeffs[0] * coeffs[2];
     }
 
-    // copy data from an Eigen vector to std::vector
-    vector<double> tempVector(baselineVec.data(),
-                              baselineVec.data()
-                              + baselineVec.rows()
-                              * baselineVec.cols());
-
-    // clip negative values from the vector and switch back to float
-    vector<float> clippedFloatBaseline;
-    for(unsigned int i = 0; i < tempVector.size(); ++i) {
-        auto val = static_cast<float>(tempVector[i]);
-        if (val < 0.0f)
-            clippedFloatBaseline.push_back(0.0f);
-        else
-            clippedFloatBaseline.push_back(val);
+    // weights for coefficients, initially all ones
+    vector<double> w(n, 1.0);
+    vector<double> diag(n);
+    vector<double> rhs(n);
+    vector<double> baselineVec(n);
+    vector<double> workspace(3 * n);
+
+    for (int i = 0; i < numIterations; ++i) {
+        // solve '(W + λ·DᵀD)·x = W·y' for 'x', where x will be the
+        // iteratively estimated baseline
+        for (unsigned int j = 0; j < n; ++j) {
+            diag[j] = w[j] + penaltyDiag[j];
+            rhs[j] = w[j] * intensity[j];
+        }
+        _solvePentadiagonal(diag,
+                            penaltyOff1,
+                            penaltyOff2,
+                            rhs,
+                            baselineVec,
+                            workspace);
+
+        // calculate weights for the next iteration, once they stop changing
+        // so would the baseline
+        bool converged = true;
+        for (unsigned int j = 0; j < n; ++j) {
+            double residual = intensity[j] - baselineVec[j];
+            double weight = 0.0;
+            if (residual > 0.0)
+                weight = p;
+            else if (residual < 0.0)
+                weight = 1.0f - p;
+            if (weight != w[j])
+                converged = false;
+            w[j] = weight;
+        }
+        if (converged)
+            break;
     }
 
-    // since baseline right now is an array of float, the data from clipped
-    // vector is copied to this array
-    std::copy(begin(clippedFloatBaseline), end(clippedFloatBaseline), baseline);
+    // clip negative values and switch back to float
+    for (unsigned int i = 0; i < n; ++i) {
+        auto val = static_cast<float>(baselineVec[i]);
+        baseline[i] = val < 0.0f ? 0.0f : val;
+    }
+}
+
+void EIC::_solvePentadiagonal(const vector<double> &diag,
+                              const vector<double> &off1,
+                              const vector<double> &off2,
+                              const vector<double> &rhs,
+                              vector<double> &solution,
+                              vector<double> &workspace)
+{
+    auto n = diag.size();
+    workspace.resize(3 * n);
+    solution.resize(n);
+
+    // factorize A = L·D·Lᵀ, where L is unit lower triangular with two
+    // sub-diagonals (l1, l2) and D is diagonal (d)
+    double *d = workspace.data();
+    double *l1 = d + n;
+    double *l2 = l1 + n;
+    for (size_t i = 0; i < n; ++i) {
+        double di = diag[i];
+        if (i >= 1)
+            di -= l1[i - 1] * l1[i - 1] * d[i - 1];
+        if (i >= 2)
+            di -= l2[i - 2] * l2[i - 2] * d[i - 2];
+        d[i] = di;
+
+        if (i + 1 < n) {
+            double a1 = off1[i];
+            if (i >= 1)
+                a1 -= l2[i - 1] * l1[i - 1] * d[i - 1];
+            l1[i] = a1 / di;
+        }
+        if (i + 2 < n)
+            l2[i] = off2[i] / di;
+    }
+
+    // forward substitution (L·z = b), scaling (D·y = z) and back substitution
+    // (Lᵀ·x = y), all done in place in the solution vector
+    for (size_t i = 0; i < n; ++i) {
+        double z = rhs[i];
+        if (i >= 1)
+            z -= l1[i - 1] * solution[i - 1];
+        if (i >= 2)
+            z -= l2[i - 2] * solution[i - 2];
+        solution[i] = z;
+    }
+    for (size_t i = 0; i < n; ++i)
+        solution[i] /= d[i];
+    for (size_t i = n; i-- > 0;) {
+        if (i + 1 < n)
+            solution[i] -= l1[i] * solution[i + 1];
+        if (i + 2 < n)
+            solution[i] -= l2[i] * solution[i + 2];
+    }
 }
 
 void EIC::_computeThresholdBaseline(const int smoothingWindow,
-                                    const int dropTopX)
+                                    const int dropTopX,
+                                    vector<float>& scratch)
 {
     auto n = intensity.size();
 
     //sort intensity vector
-    vector<float> tmpv = intensity;
+    vector<float>& tmpv = scratch;
+    tmpv.assign(intensity.begin(), intensity.end());
     std::sort(tmpv.begin(), tmpv.end());
 
     //compute maximum intensity of baseline, any point above this value will
@@ -277,8 +317,8 @@ void EIC::_computeThresholdBaseline(const int smoothingWindow,
         }
     }
 
-    //smooth baseline
-    gaussian1d_smoothing(n, smoothingWindow, baseline);
+    //smooth baseline, the sorted intensities are no longer needed
+    gaussian1d_smoothing(n, smoothingWindow, baseline, scratch);
 
     //count number of observation in EIC above baseline
     for (int i = 0; i < n; i++)
@@ -291,13 +331,21 @@ void EIC::_computeThresholdBaseline(const int smoothingWindow,
 }
 
 void EIC::computeBaseline()
+{
+    vector<float> scratch;
+    computeBaseline(scratch);
+}
+
+void EIC::computeBaseline(vector<float>& scratch)
 {
     if (!_clearBaseline())
         return;
 
     switch (_baselineMode) {
     case BaselineMode::Threshold:
-        _computeThresholdBaseline(baselineSmoothingWindow, baselineDropTopX);
+        _computeThresholdBaseline(baselineSmoothingWindow,
+                                  baselineDropTopX,
+                                  scratch);
         break;
     case BaselineMode::AsLSSmoothing:
         _computeAsLSBaseline(pow(10.0f, static_cast<float>(_aslsSmoothness)),
@@ -327,6 +375,12 @@ void EIC::subtractBaseLine()
 }
 
 void EIC::computeSpline(int smoothWindow)
+{
+    vector<float> scratch;
+    computeSpline(smoothWindow, scratch);
+}
+
+void EIC::computeSpline(int smoothWindow, vector<float>& scratch)
 {
     // Merged to 776
     int n = intensity.size();
@@ -342,41 +396,34 @@ void EIC::computeSpline(int smoothWindow)
     try
     {
         this->spline = new float[n];
-        for (int i = 0; i < n; i++)
-            spline[i] = 0;
     }
     catch (...)
     {
         cerr << "Exception caught while allocating memory " << n << "floats " << endl;
+        return;
     }
 
     //initalize spline, set to intensity vector
-    for (int i = 0; i < n; i++)
-        spline[i] = intensity[i];
+    std::copy(intensity.begin(), intensity.end(), spline);
 
     if (smoothWindow > n / 3)
         smoothWindow = n / 3; //smoothing window is too large
     if (smoothWindow <= 1)
         return; //nothing to smooth get out
 
+    // kernels smooth the spline in place, through the caller's scratch buffer
     if (smootherType == SAVGOL)
     { //SAVGOL SMOOTHER
-        mzUtils::SavGolSmoother smoother(smoothWindow, smoothWindow, 4);
-        vector<float> smoothed = smoother.Smooth(intensity);
-        for (int i = 0; i < n; i++)
-            spline[i] = smoothed[i];
+        mzUtils::SmoothingKernel::savitzkyGolay(smoothWindow, 4)
+            .apply(spline, spline, n, scratch);
     }
     else if (smootherType == GAUSSIAN)
     { //GAUSSIAN SMOOTHER
-        gaussian1d_smoothing(n, smoothWindow, spline);
+        gaussian1d_smoothing(n, smoothWindow, spline, scratch);
     }
     else if (smootherType == AVG)
     {
-        float *y = new float[n];
-        for (int i = 0; i < n; i++)
-            y[i] = intensity[i];
-        smoothAverage(y, spline, smoothWindow, n);
-        delete[] y;
+        smoothAverage(spline, spline, smoothWindow, n, scratch);
     }
 }
 
@@ -396,18 +443,24 @@ Peak *EIC::addPeak(int peakPos)
 }
 
 void EIC::getPeakPositions(int smoothWindow)
+{
+    vector<float> scratch;
+    getPeakPositions(smoothWindow, scratch);
+}
+
+void EIC::getPeakPositions(int smoothWindow, vector<float>& scratch)
 {
     unsigned int N = intensity.size();
     if (N == 0)
         return;
 
-    computeSpline(smoothWindow);
+    computeSpline(smoothWindow, scratch);
     if (spline == NULL)
         return;
 
     findPeaks();
 
-    computeBaseline();
+    computeBaseline(scratch);
     getPeakStatistics();
 
     filterPeaks();
@@ -899,17 +952,36 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
     m->getPeakPositions(smoothingWindow);
     sort(m->peaks.begin(), m->peaks.end(), Peak::compRt);
 
+    // a group holds about one peak per sample, so its peaks are reserved
+    // once and groups are moved into place rather than copied
+    pgroups.reserve(m->peaks.size());
     for (unsigned int i = 0; i < m->peaks.size(); i++)
     {
         PeakGroup grp;
         grp.groupId = i;
         grp.compound = compound;
         grp.setSelectedSamples(samples);
-        pgroups.push_back(grp);
+        grp.peaks.reserve(eics.size());
+        pgroups.push_back(std::move(grp));
     }
 
     //cerr << "EIC::groupPeaks() peakgroups=" << pgroups.size() << endl;
 
+    //merged peaks are sorted by RT, so only a contiguous run of them can
+    //score against a sample peak. The run is found by binary search on RT,
+    //widened by how far the RT bounds of any merged peak lie from its RT.
+    vector<float> mergedRts;
+    float maxLeftWidth = 0;
+    float maxRightWidth = 0;
+    mergedRts.reserve(m->peaks.size());
+    for (const Peak &a : m->peaks)
+    {
+        mergedRts.push_back(a.rt);
+        maxLeftWidth = max(maxLeftWidth, a.rt - min(a.rtmin, a.rtmax));
+        maxRightWidth = max(maxRightWidth, max(a.rtmin, a.rtmax) - a.rt);
+    }
+    const float rtMargin = 1e-3;
+
     for (unsigned int i = 0; i < eics.size(); i++)
     { //for every sample
         for (unsigned int j = 0; j < eics[i]->peaks.size(); j++)
@@ -918,14 +990,26 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
             b.groupNum = -1;
             b.groupOverlap = FLT_MIN;
 
-            vector<Peak>::iterator itr = lower_bound(m->peaks.begin(), m->peaks.end(), b, Peak::compRtMin);
-            int lb = (itr - (m->peaks.begin())) - 1;
-            if (lb < 0)
-                lb = 0;
-            //cerr << "\tb=" << b.rtmin << "<=>" << b.rtmax << " lb=" << lb << endl;
+            //merged peaks outside this RT range cannot overlap b, or are
+            //farther than maxRtDiff from it, and would be skipped below
+            float fromRt = b.rt - maxRtDiff;
+            float toRt = b.rt + maxRtDiff;
+            if (useOverlap)
+            {
+                fromRt = b.rtmin - maxRightWidth;
+                toRt = b.rtmax + maxLeftWidth;
+            }
+            unsigned int first = lower_bound(mergedRts.begin(),
+                                             mergedRts.end(),
+                                             fromRt - rtMargin)
+                                 - mergedRts.begin();
+            unsigned int last = upper_bound(mergedRts.begin(),
+                                            mergedRts.end(),
+                                            toRt + rtMargin)
+                                - mergedRts.begin();
 
             //Find best matching group
-            for (unsigned int k = 0; k < m->peaks.size(); k++)
+            for (unsigned int k = first; k < last; k++)
             {
                 Peak &a = m->peaks[k];
 
@@ -1067,23 +1151,72 @@ void EIC::getRTMinMaxPerScan()
  * Total intensity is calculated by adding the maxintensity from each scan.
  * @param[in] scan This is the 
  */
-bool EIC::makeEICSlice(mzSample *sample, float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, string filterline)
+bool EIC::makeEICSlice(mzSample *sample, float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, const string &filterline)
 {
-    float eicMz = 0, eicIntensity = 0;
-    int lb, scanNum;
-    vector<float>::iterator mzItr;
-    deque<Scan *>::iterator scanItr;
-    deque<Scan *> scans;
+    vector<EIC *> eics(1, this);
+    vector<pair<float, float> > mzRanges(1, make_pair(mzmin, mzmax));
+    return makeEICSlices(sample,
+                         eics,
+                         mzRanges,
+                         rtmin,
+                         rtmax,
+                         mslevel,
+                         eicType,
+                         filterline);
+}
+
+bool EIC::makeEICSlices(mzSample *sample,
+                        const vector<EIC *> &eics,
+                        const vector<pair<float, float> > &mzRanges,
+                        float rtmin,
+                        float rtmax,
+                        int mslevel,
+                        int eicType,
+                        const string &filterline)
+{
+    //read-only, RT ordered view over scans of the requested MS level
+    const vector<Scan *> &scans = sample->scansForMsLevel(mslevel);
+    const vector<unsigned int> &positions =
+        sample->scanPositionsForMsLevel(mslevel);
+
+    //MS1 observations are read from the sample's contiguous columnar store,
+    //which is parallel to the MS1 scan view
+    const SpectralColumns *columns = nullptr;
+    if (mslevel == 1)
+        columns = &sample->ms1Columns();
+
+    //scans of a single filterline are read through the sample's partition
+    //of the MS level view for that filterline, other scans are not touched
+    const vector<unsigned int> *filterIndices = nullptr;
+    if (!filterline.empty())
+    {
+        filterIndices = &sample->scanViewIndicesForFilterLine(
+            mslevel,
+            sample->filterLineId(filterline));
+    }
 
-    scans = sample->scans;
     //binary search rt domain iterator
-    Scan tmpScan(sample, 0, 1, rtmin - 0.1, 0, -1);
-    scanItr = lower_bound(scans.begin(), scans.end(), &tmpScan, Scan::compRt);
+    auto scanItr = lower_bound(scans.begin(),
+                               scans.end(),
+                               rtmin - 0.1f,
+                               [](const Scan *scan, float rt) {
+                                   return scan->rt < rt;
+                               });
     if (scanItr >= scans.end())
     {
         return false;
     }
 
+    size_t firstIdx = scanItr - scans.begin();
+    size_t scanCount = scans.size() - firstIdx;
+    if (filterIndices)
+    {
+        firstIdx = lower_bound(filterIndices->begin(),
+                               filterIndices->end(),
+                               firstIdx) - filterIndices->begin();
+        scanCount = filterIndices->size() - firstIdx;
+    }
+
     int estimatedScans = scans.size();
 
     //TODO: why is 10 added?
@@ -1093,105 +1226,127 @@ bool EIC::makeEICSlice(mzSample *sample, float mzmin, float mzmax, float rtmin,
         estimatedScans = float(rtmax - rtmin) / (sample->maxRt - sample->minRt) * scans.size() + 10;
     }
 
-    this->scannum.reserve(estimatedScans);
-    this->rt.reserve(estimatedScans);
-    this->intensity.reserve(estimatedScans);
-    this->mz.reserve(estimatedScans);
-
-    scanNum = scanItr - scans.begin() - 1;
+    for (EIC *eic : eics)
+    {
+        eic->scannum.reserve(estimatedScans);
+        eic->rt.reserve(estimatedScans);
+        eic->intensity.reserve(estimatedScans);
+        eic->mz.reserve(estimatedScans);
+    }
 
-    for (; scanItr != scans.end(); scanItr++)
+    for (size_t n = 0; n < scanCount; n++)
     {
-        Scan *scan = *(scanItr);
-        scanNum++;
+        size_t viewIdx = filterIndices ? (*filterIndices)[firstIdx + n]
+                                       : firstIdx + n;
+        Scan *scan = scans[viewIdx];
+        int scanNum = positions[viewIdx];
 
-        if (!(scan->filterLine == filterline || filterline == ""))
-            continue;
-        if (scan->mslevel != mslevel)
-            continue;
         if (scan->rt < rtmin)
             continue;
         if (scan->rt > rtmax)
             break;
 
-        eicMz = 0;
-        eicIntensity = 0;
-
-        //binary search
-        mzItr = lower_bound(scan->mz.begin(), scan->mz.end(), mzmin);
-        lb = mzItr - scan->mz.begin();
-
-        switch ((EIC::EicType)eicType)
+        //values of MS1 scans are read from the columns, others may have to
+        //be loaded again
+        ScanPeaksPin pin(columns ? nullptr : scan);
+        const float *mzs;
+        const float *intensities;
+        unsigned int nobs;
+        if (columns)
         {
-
-        //takes the maximum intensity for given m/z range in a scan
-            case EIC::MAX:
+            mzs = columns->mzBegin(viewIdx);
+            intensities = columns->intensityBegin(viewIdx);
+            nobs = columns->nobs(viewIdx);
+        }
+        else
         {
-            for (unsigned int scanIdx = lb; scanIdx < scan->nobs(); scanIdx++)
-            {
-                if (scan->mz[scanIdx] < mzmin)
-                    continue;
-                if (scan->mz[scanIdx] > mzmax)
-                    break;
+            mzs = scan->mz.data();
+            intensities = scan->intensity.data();
+            nobs = scan->nobs();
+        }
 
-                if (scan->intensity[scanIdx] > eicIntensity)
-                {
-                    eicIntensity = scan->intensity[scanIdx];
-                    eicMz = scan->mz[scanIdx];
-                }
-            }
-            break;
+        //every window is cut from the same scan while it is still hot in cache
+        for (size_t i = 0; i < eics.size(); i++)
+        {
+            float eicMz = 0, eicIntensity = 0;
+            _sliceScan(mzs,
+                       intensities,
+                       nobs,
+                       mzRanges[i].first,
+                       mzRanges[i].second,
+                       eicType,
+                       eicMz,
+                       eicIntensity);
+
+            EIC *eic = eics[i];
+            eic->scannum.push_back(scanNum);
+            eic->rt.push_back(scan->rt);
+            eic->intensity.push_back(eicIntensity);
+            eic->mz.push_back(eicMz);
+            eic->totalIntensity += eicIntensity;
+            if (eicIntensity > eic->maxIntensity)
+                eic->maxIntensity = eicIntensity;
         }
+    }
+
+    return true;
+}
 
-        //takes the sum of all intensities for given m/z range in a scan
-        //associated m/z is the weighted average(with intensities as weights)
-        case EIC::SUM:
+void EIC::_sliceScan(const float *mzs,
+                     const float *intensities,
+                     unsigned int nobs,
+                     float mzmin,
+                     float mzmax,
+                     int eicType,
+                     float &eicMz,
+                     float &eicIntensity)
+{
+    //binary search
+    unsigned int lb = lower_bound(mzs, mzs + nobs, mzmin) - mzs;
+
+    switch ((EIC::EicType)eicType)
+    {
+
+    //takes the sum of all intensities for given m/z range in a scan
+    //associated m/z is the weighted average(with intensities as weights)
+    case EIC::SUM:
+    {
+        float n = 0;
+        for (unsigned int scanIdx = lb; scanIdx < nobs; scanIdx++)
         {
-            float n = 0;
-            for (unsigned int scanIdx = lb; scanIdx < scan->nobs(); scanIdx++)
-            {
-                if (scan->mz[scanIdx] < mzmin)
-                    continue;
-                if (scan->mz[scanIdx] > mzmax)
-                    break;
+            if (mzs[scanIdx] < mzmin)
+                continue;
+            if (mzs[scanIdx] > mzmax)
+                break;
 
-                eicIntensity += scan->intensity[scanIdx];
-                eicMz += scan->mz[scanIdx] * scan->intensity[scanIdx];
-                n += scan->intensity[scanIdx];
-            }
-            eicMz /= n;
-            break;
+            eicIntensity += intensities[scanIdx];
+            eicMz += mzs[scanIdx] * intensities[scanIdx];
+            n += intensities[scanIdx];
         }
+        eicMz /= n;
+        break;
+    }
 
-        default:
+    //takes the maximum intensity for given m/z range in a scan
+    case EIC::MAX:
+    default:
+    {
+        for (unsigned int scanIdx = lb; scanIdx < nobs; scanIdx++)
         {
-            for (unsigned int scanIdx = lb; scanIdx < scan->nobs(); scanIdx++)
-            {
-                if (scan->mz[scanIdx] < mzmin)
-                    continue;
-                if (scan->mz[scanIdx] > mzmax)
-                    break;
+            if (mzs[scanIdx] < mzmin)
+                continue;
+            if (mzs[scanIdx] > mzmax)
+                break;
 
-                if (scan->intensity[scanIdx] > eicIntensity)
-                {
-                    eicIntensity = scan->intensity[scanIdx];
-                    eicMz = scan->mz[scanIdx];
-                }
+            if (intensities[scanIdx] > eicIntensity)
+            {
+                eicIntensity = intensities[scanIdx];
+                eicMz = mzs[scanIdx];
             }
-            break;
-        }
         }
-
-        this->scannum.push_back(scanNum);
-        this->rt.push_back(scan->rt);
-        this->intensity.push_back(eicIntensity);
-        this->mz.push_back(eicMz);
-        this->totalIntensity += eicIntensity;
-        if (eicIntensity > this->maxIntensity)
-            this->maxIntensity = eicIntensity;
+        break;
+    }
     }
-
-    return true;
 }
 
 void EIC::normalizeIntensityPerScan(float scale)
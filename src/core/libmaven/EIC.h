@@ -104,6 +104,14 @@ class EIC
     */
     void getPeakPositions(int smoothWindow);
 
+    /**
+    * @brief getPeakPositions smoothing through a scratch buffer that is
+    * reused between EICs
+    * @param smoothWindow number of scans used for smoothing in each iteration
+    * @param scratch buffer grown when needed, one per thread
+    */
+    void getPeakPositions(int smoothWindow, vector<float> &scratch);
+
     /**
     * @brief set values for all members of a peak object
     * @param  peak peak object
@@ -124,6 +132,11 @@ class EIC
      */
     void computeBaseline();
 
+    /**
+     * @brief computeBaseline with a scratch buffer reused between EICs.
+     */
+    void computeBaseline(vector<float> &scratch);
+
     /**
     * @brief calculate spline of the EIC
     * @details smoothen intensity data according to selected algorithm. stores it as spline
@@ -131,6 +144,11 @@ class EIC
     */
     void computeSpline(int smoothWindow);
 
+    /**
+    * @brief computeSpline with a scratch buffer reused between EICs
+    */
+    void computeSpline(int smoothWindow, vector<float> &scratch);
+
     /**
     * @brief find the first and last position of a peak
     * @param  peak peak object
@@ -214,7 +232,27 @@ class EIC
     * @param
     * @return bool true if EIC is pulled. false otherwise
     */
-    bool makeEICSlice(mzSample *sample, float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, string filterline);
+    bool makeEICSlice(mzSample *sample, float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, const string &filterline);
+
+    /**
+    * @brief fill several EICs of a sample in a single pass over its scans
+    * @details Every scan in the RT range is visited once and sliced for each
+    * of the given m/z ranges, so that pulling many nearby traces (e.g. all
+    * isotopologues of a compound) does not re-read the sample for each one.
+    * The i-th EIC receives the trace of the i-th m/z range.
+    * @param sample Sample to pull the EICs from
+    * @param eics EICs to be filled
+    * @param mzRanges Pairs of minimum and maximum m/z, one for each EIC
+    * @return bool true if EICs are pulled. false otherwise
+    */
+    static bool makeEICSlices(mzSample *sample,
+                              const vector<EIC *> &eics,
+                              const vector<pair<float, float> > &mzRanges,
+                              float rtmin,
+                              float rtmax,
+                              int mslevel,
+                              int eicType,
+                              const string &filterline);
 
     void getRTMinMaxPerScan();
 
@@ -326,9 +364,11 @@ class EIC
      * @brief Computes a baseline using naive thresholding method.
      * @param smoothingWindow is the size of window used for 1D guassian smoothing.
      * @param dropTopX percent of the highest intensities will be truncated.
+     * @param scratch Buffer for the sorted intensities and the smoothing.
      */
     void _computeThresholdBaseline(const int smoothingWindow,
-                                   const int dropTopX);
+                                   const int dropTopX,
+                                   vector<float>& scratch);
 
     /**
      * @brief Computes a baseline using Asymmetric Least Squares Smoothing techinique.
@@ -345,11 +385,44 @@ class EIC
      * passed here as integer, i.e. lambda should be within 3 to 9.
      * @param p for asymmetry. Values between 0.01 to 0.10 work reasonable well
      * for MS data.
-     * @param numIterations for the number of iterations that should be
-     * performed (since this is an iterative optimization algorithm).
+     * @param numIterations for the maximum number of iterations that should
+     * be performed (since this is an iterative optimization algorithm). The
+     * iterations stop early once the weights do not change anymore.
      */
     void _computeAsLSBaseline(const float lambda,
                               const float p,
                               const int numIterations=10);
+
+    /**
+     * @brief Solves a symmetric pentadiagonal linear system using a banded
+     * LDLᵀ factorization.
+     * @param diag Main diagonal of the system matrix (n values).
+     * @param off1 First off-diagonal of the system matrix (n - 1 values).
+     * @param off2 Second off-diagonal of the system matrix (n - 2 values).
+     * @param rhs Right hand side of the system (n values).
+     * @param solution Vector which will be filled with the solution.
+     * @param workspace Scratch space for the factorization, can be reused
+     * across calls to avoid allocations.
+     */
+    static void _solvePentadiagonal(const vector<double> &diag,
+                                    const vector<double> &off1,
+                                    const vector<double> &off2,
+                                    const vector<double> &rhs,
+                                    vector<double> &solution,
+                                    vector<double> &workspace);
+
+    /**
+     * @brief Intensity and m/z of a single scan within an m/z range.
+     * @details Uses the maximum intensity, or for EIC::SUM the summed
+     * intensity with its intensity weighted m/z.
+     */
+    static void _sliceScan(const float *mzs,
+                           const float *intensities,
+                           unsigned int nobs,
+                           float mzmin,
+                           float mzmax,
+                           int eicType,
+                           float &eicMz,
+                           float &eicIntensity);
 };
 #endif //MZEIC_H
@@ -20,6 +20,8 @@ Fragment::Fragment(Scan* scan,
                    float minSigNoiseRatio,
                    int maxFragmentSize)
 {
+    ScanPeaksPin pin(scan);
+
     this->precursorMz = scan->precursorMz;
     this->collisionEnergy = scan->collisionEnergy;
     this->polarity = scan->getPolarity();
@@ -43,35 +45,60 @@ Fragment::Fragment(Scan* scan,
 }
 
 //make a copy of Fragment.
-Fragment::Fragment(Fragment* other)
+Fragment::Fragment(Fragment* other) : Fragment(*other)
+{
+}
+
+Fragment::Fragment(const Fragment& f) : Fragment()
+{
+    *this = f;
+}
+
+Fragment::Fragment(Fragment&& f) noexcept : Fragment()
 {
-    this->precursorMz = other->precursorMz;
-    this->polarity = other->polarity;
-    this->mzValues = other->mzValues;
-    this->intensityValues = other->intensityValues;
-    this->obscount = other->obscount;
-    this->consensus = other->consensus;
-    this->scanNum = other->scanNum;
-    this->sampleName = other->sampleName;
-    this->collisionEnergy = other->collisionEnergy;
-    this->precursorCharge= other->precursorCharge;
-    this->purity = other->purity;
-    this->rt = other->rt;
+    *this = std::move(f);
 }
 
 Fragment& Fragment::operator=(const Fragment& f)  {
+    if (this == &f) return *this;
+
     this->precursorMz = f.precursorMz;
     this->polarity = f.polarity;
     this->mzValues = f.mzValues;
     this->intensityValues = f.intensityValues;
     this->obscount = f.obscount;
-    this->consensus = f.consensus;
     this->scanNum = f.scanNum;
     this->sampleName = f.sampleName;
     this->collisionEnergy = f.collisionEnergy;
     this->precursorCharge= f.precursorCharge;
     this->purity = f.purity;
     this->rt = f.rt;
+    this->annotations = f.annotations;
+
+    // the consensus is owned, so the copy gets one of its own
+    Fragment* consensus = f.consensus != NULL ? new Fragment(*f.consensus) : NULL;
+    if (this->consensus != NULL) delete(this->consensus);
+    this->consensus = consensus;
+    return *this;
+}
+
+Fragment& Fragment::operator=(Fragment&& f) noexcept {
+    this->precursorMz = f.precursorMz;
+    this->polarity = f.polarity;
+    this->mzValues = std::move(f.mzValues);
+    this->intensityValues = std::move(f.intensityValues);
+    this->obscount = std::move(f.obscount);
+    this->scanNum = f.scanNum;
+    this->sampleName = std::move(f.sampleName);
+    this->collisionEnergy = f.collisionEnergy;
+    this->precursorCharge= f.precursorCharge;
+    this->purity = f.purity;
+    this->rt = f.rt;
+    this->annotations = std::move(f.annotations);
+
+    // owned fragments are swapped, so that f deletes the ones replaced here
+    std::swap(this->brothers, f.brothers);
+    std::swap(this->consensus, f.consensus);
     return *this;
 }
 
@@ -136,15 +163,11 @@ int Fragment::findClosestHighestIntensityPos(float mz, float tolr)
 vector<int> Fragment::compareRanks(Fragment* a, Fragment* b, float productPpmTolr)
 { 
     bool verbose = false;
-    vector<int> ranks (a->mzValues.size(), -1);	//missing value == -1
-    for(unsigned int i = 0; i < a->mzValues.size(); i++) {
-        for( unsigned int j = 0; j < b->mzValues.size(); j++) {
-            if (mzUtils::ppmDist(a->mzValues[i], b->mzValues[j]) < productPpmTolr) {
-                ranks[i] = j;
-                break;
-            }
-        }
-    }
+    vector<int> ranks = compareRanks(a,
+                                     a->mzSortIncreasing(),
+                                     b,
+                                     b->mzSortIncreasing(),
+                                     productPpmTolr);
     if (verbose) {
         cerr << " compareranks: " << a->sampleName << endl;
         for(unsigned int i = 0; i < ranks.size(); i++) {
@@ -162,6 +185,36 @@ vector<int> Fragment::compareRanks(Fragment* a, Fragment* b, float productPpmTol
     return ranks;
 }
 
+vector<int> Fragment::compareRanks(Fragment* a,
+                                   const vector<int>& aMzOrder,
+                                   Fragment* b,
+                                   const vector<int>& bMzOrder,
+                                   float productPpmTolr)
+{
+    vector<int> ranks (a->mzValues.size(), -1);	//missing value == -1
+    masstolerance::Ppm tolerance(productPpmTolr);
+
+    //the window grows with m/z, so the first candidate of b only moves
+    //forward; twice the window keeps rounding on the safe side
+    unsigned int first = 0;
+    for(int i : aMzOrder) {
+        double mz = a->mzValues[i];
+        double window = tolerance.window(mz);
+        while (first < bMzOrder.size()
+               && b->mzValues[bMzOrder[first]] < mz - 2 * window)
+            first++;
+
+        for(unsigned int k = first; k < bMzOrder.size(); k++) {
+            int j = bMzOrder[k];
+            if (b->mzValues[j] > mz + 2 * window) break;
+            if (abs(b->mzValues[j] - mz) < window
+                && (ranks[i] == -1 || j < ranks[i]))
+                ranks[i] = j;
+        }
+    }
+    return ranks;
+}
+
 void Fragment::addBrotherFragment(Fragment* b) { brothers.push_back(b); }
 
 void Fragment::buildConsensus(float productPpmTolr)
@@ -444,17 +497,82 @@ double Fragment::mzErr(const vector<int>& X, Fragment* other)
     return sqrt(err);
 }
 
+vector<pair<int, float>> Fragment::asSparseVector(float mzmin, float mzmax, int nbins)
+{
+    //same binning as asDenseVector, each bin summed in fragment order
+    vector<pair<int, int>> binned;
+    double mzrange = mzmax - mzmin;
+    for (int i = 0; i < mzValues.size(); i++) {
+        if (mzValues[i] < mzmin || mzValues[i] > mzmax)
+            continue;
+
+        int bin = int(((mzValues[i] - mzmin) / mzrange ) * nbins);
+        if (bin > 0 && bin < nbins)
+            binned.push_back(make_pair(bin, i));
+    }
+    sort(binned.begin(), binned.end());
+
+    vector<pair<int, float>> v;
+    for (auto& entry : binned) {
+        if (v.empty() || v.back().first != entry.first)
+            v.push_back(make_pair(entry.first, 0.0f));
+        v.back().second += intensityValues[entry.second];
+    }
+    return v;
+}
+
+double Fragment::sparseCorrelation(const vector<pair<int, float>>& x,
+                                   const vector<pair<int, float>>& y,
+                                   int nbins)
+{
+    //empty bins add nothing to any of the sums
+    int n = nbins;
+    double sumx = 0;
+    double sumy = 0;
+    double sumxy = 0;
+    double x2 = 0;
+    double y2 = 0;
+
+    for (auto& bin : x) {
+        sumx += bin.second;
+        x2 += bin.second * bin.second;
+    }
+    for (auto& bin : y) {
+        sumy += bin.second;
+        y2 += bin.second * bin.second;
+    }
+    unsigned int j = 0;
+    for (auto& bin : x) {
+        while (j < y.size() && y[j].first < bin.first) j++;
+        if (j < y.size() && y[j].first == bin.first)
+            sumxy += bin.second * y[j].second;
+    }
+
+    if (n == 0) return 0;
+    double var1 = x2 - (sumx * sumx) / n;
+    double var2 = y2 - (sumy * sumy) / n;
+    if (var1 == 0 || var2 == 0) return 0;
+    return (float)((sumxy - (sumx * sumy) / n)
+                   / sqrt((x2 - (sumx * sumx) / n) * (y2 - (sumy * sumy) / n)));
+}
+
 double Fragment::dotProduct(Fragment* other)
+{
+    return dotProduct(other,
+                      asSparseVector(100, 2000, 2000),
+                      other->asSparseVector(100, 2000, 2000));
+}
+
+double Fragment::dotProduct(Fragment* other,
+                            const vector<pair<int, float>>& thisBins,
+                            const vector<pair<int, float>>& otherBins)
 {
     double thisTIC = totalIntensity();
     double otherTIC = other->totalIntensity();
 
     if(thisTIC == 0 or otherTIC == 0) return 0;
     //TODO: find out why min and max mzValues are not used
-    vector<float> va = asDenseVector(100, 2000, 2000);
-    vector<float> vb = other->asDenseVector(100, 2000, 2000);
-    
-    return mzUtils::correlation(va, vb);
+    return sparseCorrelation(thisBins, otherBins, 2000);
 }
 
 double Fragment::hyperGeometricScore(int k, int m, int n, int N)
@@ -537,25 +655,36 @@ FragmentationMatchScore Fragment::scoreMatch(Fragment* other, float productPpmTo
     FragmentationMatchScore s;
     if (mzValues.size() < 2 or other->mzValues.size() < 2) return s;
 
+    vector<int> ranks = compareRanks(this, other, productPpmTolr);
+
+    //annotate?
+    for(int i = 0; i < ranks.size(); i++)
+        other->annotations[ranks[i]] = annotations[i];
+
+    return scoreRanks(other, ranks, dotProduct(other));
+}
+
+FragmentationMatchScore Fragment::scoreRanks(Fragment* other,
+                                             const vector<int>& ranks,
+                                             double dotProduct)
+{
+    FragmentationMatchScore s;
+    if (mzValues.size() < 2 or other->mzValues.size() < 2) return s;
+
     //which one is smaller;
     Fragment* a = this;
     Fragment* b =  other;
 
     s.ppmError = abs((a->precursorMz - b->precursorMz) / a->precursorMz * 1e6);
-    vector<int> ranks = compareRanks(a, b, productPpmTolr);
     for(int rank: ranks) {
         if(rank != -1) s.numMatches++;
     }
 
-    //annotate?
-    for(int i = 0; i < ranks.size(); i++)
-        other->annotations[ranks[i]] = annotations[i];
-
     s.fractionMatched = s.numMatches / a->nobs();
     s.spearmanRankCorrelation = spearmanRankCorrelation(ranks);
     s.ticMatched = ticMatched(ranks);
     s.mzFragError =  mzErr(ranks,b);
-    s.dotProduct = dotProduct(b);
+    s.dotProduct = dotProduct;
     s.hypergeomScore  = hyperGeometricScore(s.numMatches, a->nobs(), b->nobs(), 100000) +
                         s.ticMatched; // ticMatch is tie breaker
     s.mvhScore = MVH(ranks, b);
@@ -3,12 +3,14 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <utility>
 
 class Scan;
 
 using std::vector;
 using std::string;
 using std::map;
+using std::pair;
 
 struct FragmentationMatchScore {
 
@@ -97,8 +99,23 @@ class Fragment {
 
         Fragment(Fragment* other);
 
+        /**
+         * @brief Copy the spectrum of a fragment, as operator= does
+         * @details The copy has its own copy of the consensus and the
+         * annotations, but no brothers.
+         */
+        Fragment(const Fragment& f);
+
+        /**
+         * @brief Take over the spectrum of a fragment, along with its
+         * brothers and consensus, leaving it empty
+         */
+        Fragment(Fragment&& f) noexcept;
+
         Fragment& operator=(const Fragment& f);
 
+        Fragment& operator=(Fragment&& f) noexcept;
+
         ~Fragment();
 
         double precursorMz;				//parent
@@ -125,6 +142,26 @@ class Fragment {
 
         static vector<int> compareRanks(Fragment* a, Fragment* b, float productAmuToll);
 
+        /**
+         * @brief Match fragments of a to fragments of b, given both in m/z
+         * order
+         * @details Both m/z orders are swept together, so the cost is linear
+         * in the number of fragments and matches. The result is identical to
+         * compareRanks(a, b, productPpmTolr).
+         * @param a Fragment whose m/z values are ranked
+         * @param aMzOrder Positions of a's m/z values, from lowest to highest
+         * @param b Fragment whose positions are returned as ranks
+         * @param bMzOrder Positions of b's m/z values, from lowest to highest
+         * @param productPpmTolr Fragment tolerance in ppm of a's m/z values
+         * @return For every m/z of a, the first position of b within
+         * tolerance, or -1
+         */
+        static vector<int> compareRanks(Fragment* a,
+                                        const vector<int>& aMzOrder,
+                                        Fragment* b,
+                                        const vector<int>& bMzOrder,
+                                        float productPpmTolr);
+
         void addBrotherFragment(Fragment* b);
 
         /**
@@ -154,6 +191,21 @@ class Fragment {
 
         vector<float> asDenseVector(float mzmin, float mzmax, int nbins = 2000);
 
+        /**
+         * @brief Non-empty bins of asDenseVector, in bin order
+         */
+        vector<pair<int, float>> asSparseVector(float mzmin, float mzmax, int nbins = 2000);
+
+        /**
+         * @brief Correlation of two binned spectra given by their non-empty
+         * bins
+         * @details Equals mzUtils::correlation of the dense vectors, without
+         * touching empty bins.
+         */
+        static double sparseCorrelation(const vector<pair<int, float>>& x,
+                                        const vector<pair<int, float>>& y,
+                                        int nbins = 2000);
+
         double logNchooseK(int N, int k);
 
         double spearmanRankCorrelation(const vector<int>& X);
@@ -164,6 +216,14 @@ class Fragment {
 
         double dotProduct(Fragment* other);
 
+        /**
+         * @brief Dot product of this and other, both already binned by
+         * asSparseVector(100, 2000, 2000)
+         */
+        double dotProduct(Fragment* other,
+                          const vector<pair<int, float>>& thisBins,
+                          const vector<pair<int, float>>& otherBins);
+
         double hyperGeometricScore(int k, int m, int n, int N = 100000);
 
         /**
@@ -175,6 +235,16 @@ class Fragment {
 
         FragmentationMatchScore scoreMatch(Fragment* other, float productPpmTolr);
 
+        /**
+         * @brief Compute all match scores of other against this fragment
+         * @param other Experimental fragment
+         * @param ranks Result of compareRanks(this, other, productPpmTolr)
+         * @param dotProduct Dot product of this and other
+         */
+        FragmentationMatchScore scoreRanks(Fragment* other,
+                                           const vector<int>& ranks,
+                                           double dotProduct);
+
         inline unsigned int nobs() { return mzValues.size(); }
 
         static bool compPrecursorMz(const Fragment* a, const Fragment* b);
@@ -18,20 +18,21 @@ vector<EIC*> PeakDetector::pullEICs(mzSlice* slice,
 {
     vector<EIC*> eics;
     vector<mzSample*> vsamples;
+    for (unsigned int i = 0; i < samples.size(); i++) {
+        if (samples[i] == NULL)
+            continue;
+        if (samples[i]->isSelected == false)
+            continue;
+        vsamples.push_back(samples[i]);
+    }
+
+    // EICs are stored at their sample's position so that their order does
+    // not depend on thread scheduling
+    vector<EIC*> sampleEics(vsamples.size(), nullptr);
 #pragma omp parallel default(shared)
     {
-#pragma omp for
-        for (unsigned int i = 0; i < samples.size(); i++) {
-            if (samples[i] == NULL)
-                continue;
-            if (samples[i]->isSelected == false)
-                continue;
-#pragma omp critical
-            vsamples.push_back(samples[i]);
-        }
-
-        // single threaded version - getting EICs of selected samples.
-        // #pragma omp parallel for ordered
+        // smoothing buffer reused by all EICs of this thread
+        vector<float> scratch;
 #pragma omp for
         for (unsigned int i = 0; i < vsamples.size(); i++) {
             // Samples been selected
@@ -78,15 +79,18 @@ vector<EIC*> PeakDetector::pullEICs(mzSlice* slice,
                     e->setBaselineDropTopX(mp->baseline_dropTopX);
                 }
                 e->setFilterSignalBaselineDiff(mp->minSignalBaselineDifference);
-                e->getPeakPositions(mp->eic_smoothingWindow);
+                e->getPeakPositions(mp->eic_smoothingWindow, scratch);
                 // smoohing over
 
-#pragma omp critical
-                // push eic to all eics vector
-                eics.push_back(e);
+                sampleEics[i] = e;
             }
         }
     }
+
+    for (auto e : sampleEics) {
+        if (e)
+            eics.push_back(e);
+    }
     return eics;
 }
 
@@ -101,42 +105,64 @@ void PeakDetector::processSlice(mzSlice& slice) {
 }
 
 void PeakDetector::pullAllIsotopes() {
-    for (unsigned int j = 0; j < mavenParameters->allgroups.size(); j++) {
+    int totalGroups = mavenParameters->allgroups.size();
+
+    // isotopes of each group are pulled independently of other groups, so
+    // groups are processed concurrently. Linking groups to their compounds
+    // is done afterwards, in group order, to keep the result deterministic.
+    if (mavenParameters->pullIsotopesFlag) {
+        int threads = _threadCount();
+        if (threads > 1)
+            _prepareSamplesForThreads();
+
+        int processedGroups = 0;
+
+        #pragma omp parallel for schedule(dynamic) num_threads(threads) if (threads > 1)
+        for (int j = 0; j < totalGroups; j++) {
+            if (mavenParameters->stop) continue;
+            PeakGroup& group = mavenParameters->allgroups[j];
+
+            if (!group.isIsotope())
+            {
+                bool C13Flag = mavenParameters->C13Labeled_BPE;
+                bool N15Flag = mavenParameters->N15Labeled_BPE;
+                bool S34Flag = mavenParameters->S34Labeled_BPE;
+                bool D2Flag = mavenParameters->D2Labeled_BPE;
+
+                IsotopeDetection::IsotopeDetectionType isoType;
+                isoType = IsotopeDetection::PeakDetection;
+
+                IsotopeDetection isotopeDetection(
+                    mavenParameters,
+                    isoType,
+                    C13Flag,
+                    N15Flag,
+                    S34Flag,
+                    D2Flag);
+                isotopeDetection.pullIsotopes(&group);
+            }
+
+            int processed;
+            #pragma omp atomic capture
+            processed = processedGroups++;
+
+            if (mavenParameters->showProgressFlag && processed % 10 == 0) {
+                #pragma omp critical(peakDetectorProgress)
+                sendBoostSignal("Calculating Isotopes", processed, totalGroups);
+            }
+        }
+    }
+
+    for (int j = 0; j < totalGroups; j++) {
         if(mavenParameters->stop) break;
         PeakGroup& group = mavenParameters->allgroups[j];
         Compound* compound = group.compound;
 
-        if (mavenParameters->pullIsotopesFlag && !group.isIsotope())
-        {
-            bool C13Flag = mavenParameters->C13Labeled_BPE;
-            bool N15Flag = mavenParameters->N15Labeled_BPE;
-            bool S34Flag = mavenParameters->S34Labeled_BPE;
-            bool D2Flag = mavenParameters->D2Labeled_BPE;
-
-            IsotopeDetection::IsotopeDetectionType isoType;
-            isoType = IsotopeDetection::PeakDetection;
-
-            IsotopeDetection isotopeDetection(
-                mavenParameters,
-                isoType,
-                C13Flag,
-                N15Flag,
-                S34Flag,
-                D2Flag);
-            isotopeDetection.pullIsotopes(&group);
-        }
-
         if (compound) {
             if (!compound->hasGroup() ||
                 group.groupRank < compound->getPeakGroup()->groupRank)
                 compound->setPeakGroup(group);
         }
-
-
-        if (mavenParameters->showProgressFlag &&
-            mavenParameters->pullIsotopesFlag && j % 10 == 0) {
-			sendBoostSignal("Calculating Isotopes", j, mavenParameters->allgroups.size());
-        }
     }
 }
 
@@ -292,161 +318,218 @@ void PeakDetector::processSlices(vector<mzSlice *> &slices, string setName)
     if (slices.size() == 0)
         return;
     mavenParameters->allgroups.clear();
+    _groupIndex.clear();
 
     sort(slices.begin(), slices.end(), mzSlice::compIntensity);
 
+    int threads = _threadCount();
+    if (threads > 1)
+        _prepareSamplesForThreads();
+
+    // slices are processed in batches; groups of a batch are detected
+    // concurrently and then merged in slice order, so that the result (and
+    // the convergence and group limit checks) are the same as in serial mode
+    unsigned int batchSize = threads > 1 ? threads * 4 : 1;
+
     int converged = 0;
     int foundGroups = 0;
+    bool finished = false;
 
-    int eicCount = 0;
-    for (unsigned int s = 0; s < slices.size(); s++)
+    for (unsigned int batchStart = 0;
+         batchStart < slices.size() && !finished;
+         batchStart += batchSize)
     {
-
         if (mavenParameters->stop)
             break;
-        mzSlice *slice = slices[s];
 
-        Compound *compound = slice->compound;
+        unsigned int batchEnd = std::min((unsigned int)slices.size(),
+                                         batchStart + batchSize);
 
-        if (compound != NULL && compound->hasGroup())
-            compound->unlinkGroup();
+        for (unsigned int s = batchStart; s < batchEnd; s++)
+        {
+            Compound *compound = slices[s]->compound;
+            if (compound != NULL && compound->hasGroup())
+                compound->unlinkGroup();
+        }
 
-        //TODO: what is this for? this is not used
-        //mavenParameters->checkConvergance is not always 0
-        if (mavenParameters->checkConvergance)
+        vector<vector<PeakGroup> > batchGroups(batchEnd - batchStart);
+#pragma omp parallel for schedule(dynamic) num_threads(threads) if (threads > 1)
+        for (int s = batchStart; s < (int)batchEnd; s++)
+            batchGroups[s - batchStart] = _detectSliceGroups(slices[s]);
+
+        for (unsigned int s = batchStart; s < batchEnd; s++)
         {
-            mavenParameters->allgroups.size() - foundGroups > 0 ? converged =
-                                                                      0
-                                                                : converged++;
-            if (converged > 1000)
+            if (mavenParameters->stop)
             {
+                finished = true;
                 break;
             }
-            foundGroups = mavenParameters->allgroups.size();
-        }
-
-        vector<EIC *> eics = pullEICs(slice,
-                                      mavenParameters->samples,
-                                      mavenParameters);
 
-        if (mavenParameters->clsf->hasModel())
-        {
-            mavenParameters->clsf->scoreEICs(eics);
-        }
+            //TODO: what is this for? this is not used
+            //mavenParameters->checkConvergance is not always 0
+            if (mavenParameters->checkConvergance)
+            {
+                mavenParameters->allgroups.size() - foundGroups > 0 ? converged =
+                                                                          0
+                                                                    : converged++;
+                if (converged > 1000)
+                {
+                    finished = true;
+                    break;
+                }
+                foundGroups = mavenParameters->allgroups.size();
+            }
 
-        float eicMaxIntensity = 0;
-        for (unsigned int j = 0; j < eics.size(); j++)
-        {
-            eicCount++;
-            float max = 0;
+            vector<PeakGroup> &peakgroups = batchGroups[s - batchStart];
+            for (unsigned int j = 0; j < peakgroups.size(); j++)
+            {
+                //check for duplicates	and append group
+                addPeakGroup(std::move(peakgroups[j]));
+            }
 
-            switch ((PeakGroup::QType)mavenParameters->peakQuantitation)
+            if (mavenParameters->allgroups.size() > mavenParameters->limitGroupCount)
             {
-            case PeakGroup::AreaTop:
-                max = eics[j]->maxAreaTopIntensity;
-                break;
-            case PeakGroup::Area:
-                max = eics[j]->maxAreaIntensity;
-                break;
-            case PeakGroup::Height:
-                max = eics[j]->maxIntensity;
-                break;
-            case PeakGroup::AreaNotCorrected:
-                max = eics[j]->maxAreaNotCorrectedIntensity;
-                break;
-            case PeakGroup::AreaTopNotCorrected:
-                max = eics[j]->maxAreaTopNotCorrectedIntensity;
-                break;
-            default:
-                max = eics[j]->maxIntensity;
+                cerr << "Group limit exceeded!" << endl;
+                finished = true;
                 break;
             }
 
-            if (max > eicMaxIntensity)
-                eicMaxIntensity = max;
-        }
-        if (eicMaxIntensity < mavenParameters->minGroupIntensity)
-        {
-            delete_all(eics);
-            continue;
-        }
+            if (zeroStatus)
+            {
+                sendBoostSignal("Status", 0, 1);
+                zeroStatus = false;
+            }
 
-        bool isIsotope = false;
-
-        PeakFiltering peakFiltering(mavenParameters, isIsotope);
-        peakFiltering.filter(eics);
-
-        vector<PeakGroup> peakgroups =
-            EIC::groupPeaks(eics,
-                            compound,
-                            mavenParameters->eic_smoothingWindow,
-                            mavenParameters->grouping_maxRtWindow,
-                            mavenParameters->minQuality,
-                            mavenParameters->distXWeight,
-                            mavenParameters->distYWeight,
-                            mavenParameters->overlapWeight,
-                            mavenParameters->useOverlap,
-                            mavenParameters->minSignalBaselineDifference,
-                            mavenParameters->fragmentTolerance,
-                            mavenParameters->scoringAlgo);
-        
-        GroupFiltering groupFiltering(mavenParameters, slice);
-        groupFiltering.filter(peakgroups);
-
-        //sort groups according to their rank
-        std::sort(peakgroups.begin(), peakgroups.end(),
-                  PeakGroup::compRank);
-
-        for (unsigned int j = 0; j < peakgroups.size(); j++)
-        {
-            //check for duplicates	and append group
-            if (j >= mavenParameters->eicMaxGroups)
-                break;
+            if (mavenParameters->showProgressFlag && s % 10 == 0)
+            {
 
-            PeakGroup group = peakgroups[j];
-            addPeakGroup(group);
+                string progressText = "Found " + to_string(mavenParameters->allgroups.size()) + " groups";
+                sendBoostSignal(progressText, s + 1, std::min((int)slices.size(), mavenParameters->limitGroupCount));
+            }
         }
+    }
+}
 
-        //cleanup
-        delete_all(eics);
+vector<PeakGroup> PeakDetector::_detectSliceGroups(mzSlice *slice)
+{
+    vector<PeakGroup> peakgroups;
+    if (mavenParameters->stop)
+        return peakgroups;
 
-        if (mavenParameters->allgroups.size() > mavenParameters->limitGroupCount)
+    Compound *compound = slice->compound;
+
+    vector<EIC *> eics = pullEICs(slice,
+                                  mavenParameters->samples,
+                                  mavenParameters);
+
+    // peaks of all EICs of the slice are scored in one batch, which leaves
+    // the model untouched and can run from several threads
+    if (mavenParameters->clsf->hasModel())
+        mavenParameters->clsf->scoreEICs(eics);
+
+    float eicMaxIntensity = 0;
+    for (unsigned int j = 0; j < eics.size(); j++)
+    {
+        float max = 0;
+
+        switch ((PeakGroup::QType)mavenParameters->peakQuantitation)
         {
-            cerr << "Group limit exceeded!" << endl;
+        case PeakGroup::AreaTop:
+            max = eics[j]->maxAreaTopIntensity;
+            break;
+        case PeakGroup::Area:
+            max = eics[j]->maxAreaIntensity;
+            break;
+        case PeakGroup::Height:
+            max = eics[j]->maxIntensity;
+            break;
+        case PeakGroup::AreaNotCorrected:
+            max = eics[j]->maxAreaNotCorrectedIntensity;
+            break;
+        case PeakGroup::AreaTopNotCorrected:
+            max = eics[j]->maxAreaTopNotCorrectedIntensity;
+            break;
+        default:
+            max = eics[j]->maxIntensity;
             break;
         }
 
-        if (zeroStatus)
-        {
-            sendBoostSignal("Status", 0, 1);
-            zeroStatus = false;
-        }
+        if (max > eicMaxIntensity)
+            eicMaxIntensity = max;
+    }
+    if (eicMaxIntensity < mavenParameters->minGroupIntensity)
+    {
+        delete_all(eics);
+        return peakgroups;
+    }
 
-        if (mavenParameters->showProgressFlag && s % 10 == 0)
-        {
+    bool isIsotope = false;
 
-            string progressText = "Found " + to_string(mavenParameters->allgroups.size()) + " groups";
-            sendBoostSignal(progressText, s + 1, std::min((int)slices.size(), mavenParameters->limitGroupCount));
-        }
+    PeakFiltering peakFiltering(mavenParameters, isIsotope);
+    peakFiltering.filter(eics);
+
+    peakgroups =
+        EIC::groupPeaks(eics,
+                        compound,
+                        mavenParameters->eic_smoothingWindow,
+                        mavenParameters->grouping_maxRtWindow,
+                        mavenParameters->minQuality,
+                        mavenParameters->distXWeight,
+                        mavenParameters->distYWeight,
+                        mavenParameters->overlapWeight,
+                        mavenParameters->useOverlap,
+                        mavenParameters->minSignalBaselineDifference,
+                        mavenParameters->fragmentTolerance,
+                        mavenParameters->scoringAlgo);
+
+    GroupFiltering groupFiltering(mavenParameters, slice);
+    groupFiltering.filter(peakgroups);
+
+    //sort groups according to their rank
+    std::sort(peakgroups.begin(), peakgroups.end(),
+              PeakGroup::compRank);
+
+    if (mavenParameters->eicMaxGroups >= 0
+        && peakgroups.size() > (unsigned int)mavenParameters->eicMaxGroups)
+        peakgroups.resize(mavenParameters->eicMaxGroups);
+
+    //cleanup
+    delete_all(eics);
+
+    return peakgroups;
+}
+
+int PeakDetector::_threadCount()
+{
+    int threads = mavenParameters->peakDetectionThreads;
+    if (threads <= 0)
+        threads = omp_get_max_threads();
+    return std::max(threads, 1);
+}
+
+void PeakDetector::_prepareSamplesForThreads()
+{
+    for (auto sample : mavenParameters->samples)
+    {
+        if (sample == NULL)
+            continue;
+        sample->ms1Columns();
+        sample->fragmentationScans();
+        if (!sample->srmScansEnumerated())
+            sample->enumerateSRMScans();
     }
 }
 
-bool PeakDetector::addPeakGroup(PeakGroup& grup1) {
-        bool noOverlap = true;
-
-        for (unsigned int i = 0; i < mavenParameters->allgroups.size(); i++) {
-                PeakGroup& grup2 = mavenParameters->allgroups[i];
-                float rtoverlap = mzUtils::checkOverlap(grup1.minRt, grup1.maxRt,
-                                                        grup2.minRt, grup2.maxRt);
-                if (rtoverlap > 0.9
-                    && massCutoffDist(grup2.meanMz, grup1.meanMz,mavenParameters->massCutoffMerge)
-                    < mavenParameters->massCutoffMerge->getMassCutoff()) {
-                        noOverlap = false;
-                break;
-                }
-        }
+bool PeakDetector::addPeakGroup(PeakGroup&& grup1) {
+        bool noOverlap = !_groupIndex.hasOverlap(grup1.meanMz,
+                                                 grup1.minRt,
+                                                 grup1.maxRt,
+                                                 mavenParameters->massCutoffMerge,
+                                                 0.9);
+
+        _groupIndex.insert(grup1.meanMz, grup1.minRt, grup1.maxRt);
 
-        //push the group to the allgroups vector
-        mavenParameters->allgroups.push_back(grup1);
+        //move the group to the allgroups vector
+        mavenParameters->allgroups.push_back(std::move(grup1));
         return noOverlap;
 }
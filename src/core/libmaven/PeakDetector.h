@@ -32,6 +32,7 @@
 #include "mavenparameters.h"
 #include "mzMassCalculator.h"
 #include "isotopeDetection.h"
+#include "datastructures/groupindex.h"
 
 /**
  * @class PeakDetector
@@ -148,12 +149,45 @@ public:
 	/**
 	 * [check overlap between RT for each group through all the samples; if a certain degree of overlap is present, do not create a new group]
 	 * @method addPeakGroup
-	 * @param  group        [pointer to PeakGroup]
+	 * @param  group        [group to add, it is moved into allgroups]
 	 * @return [True if group is added to all groups, else False]
 	 */
-	bool addPeakGroup(PeakGroup& grup1);
+	bool addPeakGroup(PeakGroup&& grup1);
+
+	/**
+	 * @brief Detect peak groups in a single slice
+	 * @details Pulls EICs for the slice, detects, groups and filters peaks
+	 * and returns the best ranked groups (at most eicMaxGroups of them).
+	 * Does not modify allgroups, so different slices may be processed
+	 * concurrently.
+	 * @param slice Slice for which groups will be detected
+	 * @return Ranked peak groups found in the slice
+	 */
+	vector<PeakGroup> _detectSliceGroups(mzSlice* slice);
+
+	/**
+	 * @brief Number of threads to be used for processing slices and
+	 * pulling isotopes
+	 * @return peakDetectionThreads, or all available cores if it is zero
+	 */
+	int _threadCount();
+
+	/**
+	 * @brief Build lazily computed scan indices of all samples
+	 * @details Scan views, MS1 columns and SRM scan maps are otherwise built
+	 * on first EIC request, which is not safe when slices (or isotopes of
+	 * groups) are processed by multiple threads at once.
+	 */
+	void _prepareSamplesForThreads();
+
 	MavenParameters* mavenParameters;
 	bool zeroStatus;
+
+	/**
+	 * @brief m/z and RT extents of groups added to allgroups by
+	 * processSlices, used for overlap checks in addPeakGroup
+	 */
+	GroupIndex _groupIndex;
 };
 
 /**
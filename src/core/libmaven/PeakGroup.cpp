@@ -79,6 +79,37 @@ PeakGroup::PeakGroup()  {
 }
 
 void PeakGroup::copyObj(const PeakGroup& o)  {
+    _copyAttributes(o);
+
+    fragmentationPattern = o.fragmentationPattern;
+    srmId=o.srmId;
+    tagString = o.tagString;
+    peaks = o.peaks;
+    samples=o.samples;
+
+    copyChildren(o);
+}
+
+void PeakGroup::_moveObj(PeakGroup& o)  {
+    _copyAttributes(o);
+
+    fragmentationPattern = std::move(o.fragmentationPattern);
+    srmId = std::move(o.srmId);
+    tagString = std::move(o.tagString);
+    peaks = std::move(o.peaks);
+    samples = std::move(o.samples);
+
+    children = std::move(o.children);
+    childrenBarPlot = std::move(o.childrenBarPlot);
+    for(unsigned int i=0; i < children.size(); i++ ) children[i].parent = this;
+    for(unsigned int i=0; i < childrenBarPlot.size(); i++ )
+        childrenBarPlot[i].parent = this;
+    o.children.clear();
+    o.childrenBarPlot.clear();
+    o.peaks.clear();
+}
+
+void PeakGroup::_copyAttributes(const PeakGroup& o)  {
     groupId= o.groupId;
     metaGroupId= o.metaGroupId;
     clusterId = o.clusterId;
@@ -99,7 +130,6 @@ void PeakGroup::copyObj(const PeakGroup& o)  {
 
     ms2EventCount = o.ms2EventCount;
     fragMatchScore = o.fragMatchScore;
-    fragmentationPattern = o.fragmentationPattern;
     adduct = o.adduct;
 
     blankMax=o.blankMax;
@@ -139,24 +169,17 @@ void PeakGroup::copyObj(const PeakGroup& o)  {
     parent = o.parent;
     compound = o.compound;
 
-    srmId=o.srmId;
     isFocused=o.isFocused;
     label=o.label;
 
     goodPeakCount=o.goodPeakCount;
     _type = o._type;
-    tagString = o.tagString;
 
     changeFoldRatio = o.changeFoldRatio;
     changePValue    = o.changePValue;
-    peaks = o.peaks;
-    samples=o.samples;
 
     markedBadByCloudModel = o.markedBadByCloudModel;
     markedGoodByCloudModel = o.markedGoodByCloudModel;
-
-
-    copyChildren(o);
 }
 
 PeakGroup::~PeakGroup() {
@@ -664,6 +687,15 @@ PeakGroup& PeakGroup::operator=(const PeakGroup& o)  {
     return *this;
 }
 
+PeakGroup::PeakGroup(PeakGroup&& o) noexcept {
+    _moveObj(o);
+}
+
+PeakGroup& PeakGroup::operator=(PeakGroup&& o) noexcept {
+    if (this != &o) _moveObj(o);
+    return *this;
+}
+
 
 bool PeakGroup::operator==(const PeakGroup* o)  {
     if ( this == o ) {
@@ -825,7 +857,7 @@ void PeakGroup::calGroupRank(bool deltaRtCheckFlag,
 
 }
 
-void PeakGroup::setSelectedSamples(vector<mzSample*> vsamples){
+void PeakGroup::setSelectedSamples(const vector<mzSample*>& vsamples){
     samples.clear();
     /**
      * @details- this method used for assigning samples to this group based on whether that samples
@@ -39,6 +39,16 @@ class PeakGroup{
         PeakGroup(const PeakGroup& o);
         PeakGroup& operator=(const PeakGroup& o);
 
+        /**
+         * @brief Take over the peaks, children and fragmentation pattern of
+         * a group instead of copying them
+         * @details The result equals a copy of the group, and children of
+         * the result point to it as their parent. The moved group is left
+         * without peaks and children.
+         */
+        PeakGroup(PeakGroup&& o) noexcept;
+        PeakGroup& operator=(PeakGroup&& o) noexcept;
+
         bool operator==(const PeakGroup* o);
         /**
          * [copyObj ]
@@ -564,6 +574,18 @@ class PeakGroup{
          * @details this method used for assigning samples to this group based on whether that samples
          * are marked as selected.
         */
-        void setSelectedSamples(vector<mzSample*> vsamples);
+        void setSelectedSamples(const vector<mzSample*>& vsamples);
+
+    private:
+        /**
+         * @brief copy the values that copyObj and the move operations share,
+         * i.e., everything but containers and strings
+         */
+        void _copyAttributes(const PeakGroup& o);
+
+        /**
+         * @brief move counterpart of copyObj
+         */
+        void _moveObj(PeakGroup& o);
 };
 #endif
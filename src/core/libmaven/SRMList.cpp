@@ -3,6 +3,11 @@
 SRMList::SRMList(vector<mzSample*>samples, deque<Compound*> compoundsDB){
     this->samples = samples;
     this->compoundsDB = compoundsDB;
+    indexCompounds();
+}
+
+void SRMList::indexCompounds() {
+    _transitionIndex.build(compoundsDB);
 }
 
 vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolarity, bool associateCompoundNames) {
@@ -12,22 +17,26 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
     vector<mzSlice*>slices;
     for(int i=0; i < samples.size(); i++ ) {
         mzSample* sample = samples[i];
-        for( int j=0; j < sample->scans.size(); j++ ) {
-            Scan* scan = sample->getScan(j);
-            if (!scan) continue;
 
-            // skipping empty scans
-            if (scan->totalIntensity() == 0) continue;
+        // walk the scans of every interned filterline of the sample
+        const vector<string>& filterLines = sample->filterLines();
+        for (unsigned int id=0; id < filterLines.size(); id++) {
+            QString filterLine(filterLines[id].c_str());
+            Scan* seenScan = seenMRMS.value(filterLine, NULL);
+            Scan* bestScan = seenScan;
 
-            QString filterLine(scan->filterLine.c_str());
+            const vector<unsigned int>& positions = sample->scanPositionsForFilterLine(id);
+            for (unsigned int position : positions) {
+                Scan* scan = sample->scans[position];
 
-            if (filterLine.isEmpty()) continue;
+                // skipping empty scans
+                if (scan->totalIntensity() == 0) continue;
 
-            if (seenMRMS.contains(filterLine)){
-                if(scan->intensity[0] <= seenMRMS.value(filterLine)->intensity[0]) continue;
+                if (bestScan && scan->intensity[0] <= bestScan->intensity[0]) continue;
+                bestScan = scan;
             }
 
-            seenMRMS.insert(filterLine, scan);
+            if (bestScan != seenScan) seenMRMS.insert(filterLine, bestScan);
         }
     }
 
@@ -76,28 +85,7 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
 }
 
 Compound *SRMList::findSpeciesByPrecursor(float precursorMz, float productMz, float rt, int polarity,double amuQ1, double amuQ3) {
-    
-    Compound* x=NULL;
-    float distMz=FLT_MAX;
-    float distRt=FLT_MAX;
-
-    for(unsigned int i=0; i < compoundsDB.size(); i++ ) {
-            if (compoundsDB[i]->precursorMz == 0 ) continue;
-            //cerr << polarity << " " << compoundsDB[i]->charge << endl;
-            if ((int) compoundsDB[i]->charge != polarity && compoundsDB[i]->charge != 0) continue;
-            float a = abs(compoundsDB[i]->precursorMz - precursorMz);
-            if ( a > amuQ1 ) continue; // q1 tolerance
-            float b = abs(compoundsDB[i]->productMz - productMz);
-            if ( b > amuQ3 ) continue; // q3 tolerance
-            float dMz = sqrt(a*a+b*b);
-            float dRt = abs(compoundsDB[i]->expectedRt - rt);
-            if (  ( dMz < distMz)  ||   ((dMz == distMz) && (dRt < distRt))  ) { 
-                x = compoundsDB[i];
-                distMz=dMz; 
-                distRt=dRt;
-            }
-    }
-    return x;
+    return _transitionIndex.nearest(precursorMz, productMz, rt, polarity, amuQ1, amuQ3);
 }
 
 double SRMList::getPrecursorOfSrm(string srmId)
@@ -162,16 +150,6 @@ deque<Compound*> SRMList::getMatchedCompounds(string srmId, double amuQ1, double
     float precursorMz = getPrecursorOfSrm(srmId);
     float productMz = getProductOfSrm(srmId);
 
-    for(unsigned int i=0; i < compoundsDB.size(); i++ ) {
-        if ((int) compoundsDB[i]->charge != polarity && compoundsDB[i]->charge != 0) continue;
-        if (compoundsDB[i]->precursorMz == 0 ) continue;
-        float a = abs(compoundsDB[i]->precursorMz - precursorMz);
-        if ( a > amuQ1 ) continue; // q1 tolerance
-        float b = abs(compoundsDB[i]->productMz - productMz);
-        if ( b > amuQ3 ) continue; // q3 tolerance
-
-        matchedCompounds.push_back(compoundsDB[i]);
-    }
-
+    matchedCompounds = _transitionIndex.matches(precursorMz, productMz, polarity, amuQ1, amuQ3);
     return matchedCompounds;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "databases.h"
 #include "mzSample.h"
 #include "Scan.h"
+#include "datastructures/transitionindex.h"
 #include <QMap>
 
 /**
@@ -43,6 +44,13 @@ class SRMList{
      */
     vector<mzSlice*> getSrmSlices(double amuQ1, double amuQ3, int userPolarity, bool associateCompoundNames);
     
+    /**
+     * @brief Index transitions of compoundsDB for annotation lookups
+     * @details Called by the constructor. Must be called again if
+     * compoundsDB is changed afterwards.
+     */
+    void indexCompounds();
+
     /**
      * @brief Get nearest compound to precursor m/z, product m/z and
      * expected rt
@@ -101,6 +109,12 @@ class SRMList{
      */
     map<string, Compound*> annotation;
 
+    /**
+     * @brief Transitions of compoundsDB indexed by precursor m/z, product
+     * m/z and polarity
+     */
+    TransitionIndex _transitionIndex;
+
   };
 
 #endif
\ No newline at end of file
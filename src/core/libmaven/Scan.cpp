@@ -16,9 +16,17 @@ Scan::Scan(mzSample* sample, int scannum, int mslevel, float rt, float precursor
 	this->precursorCharge = 0;
 	this->precursorIntensity = 0;
     this->isolationWindow = 1;
+    this->filterLineId = -1;
+    this->fileSeekStart = -1;
+    this->fileSeekEnd = -1;
+    this->_peaksReleased = false;
+    this->_peaksPins = 0;
+    this->_releasedTotalIntensity = 0;
 }
 
 void Scan::deepcopy(Scan* b) {
+    ScanPeaksPin pin(b);
+
     this->sample = b->sample;
     this->rt = b->rt;
     this->scannum = b->scannum;
@@ -34,15 +42,19 @@ void Scan::deepcopy(Scan* b) {
     this->mz    = b->mz;
     this->scanType = b->scanType;
     this->filterLine = b->filterLine;
+    this->filterLineId = b->filterLineId;
     this->setPolarity( b->getPolarity() );
     this->originalRt = b->originalRt;
     this->isolationWindow = b->isolationWindow;
+    this->fileSeekStart = b->fileSeekStart;
+    this->fileSeekEnd = b->fileSeekEnd;
 
 }
 
 int Scan::findHighestIntensityPos(float _mz, MassCutoff *massCutoff) {
-        float mzmin = _mz - massCutoff->massCutoffValue(_mz);
-        float mzmax = _mz + massCutoff->massCutoffValue(_mz);
+        float cutoff = massCutoff->massCutoffValue(_mz);
+        float mzmin = _mz - cutoff;
+        float mzmax = _mz + cutoff;
 
         vector<float>::iterator itr = lower_bound(mz.begin(), mz.end(), mzmin-1);
         int lb = itr-mz.begin();
@@ -119,6 +131,7 @@ void Scan::quantileFilter(int minQuantile) {
         vector<float>(cIntensity).swap(cIntensity);
         mz.swap(cMz);
         intensity.swap(cIntensity);
+        _peaksChanged();
 }
 
 void Scan::intensityFilter(int minIntensity) {
@@ -138,6 +151,7 @@ void Scan::intensityFilter(int minIntensity) {
         vector<float>(cIntensity).swap(cIntensity);
         mz.swap(cMz);
         intensity.swap(cIntensity);
+        _peaksChanged();
 }
 
 void Scan::simpleCentroid() {
@@ -197,11 +211,21 @@ void Scan::updateIntensityWithTheLocalMaximas(vector<float> *cMz, vector<float>
     vector<float>(*cIntensity).swap(*cIntensity);
     mz.swap(*cMz);
     intensity.swap(*cIntensity);
+    _peaksChanged();
+}
+
+void Scan::_peaksChanged() {
+    // copies made with deepcopy point to the sample without being its scans
+    if (sample != NULL && mslevel == 1
+        && (unsigned int)scannum < sample->scans.size()
+        && sample->scans[scannum] == this)
+        sample->invalidateMs1Columns();
 }
 
 bool Scan::hasMz(float _mz, MassCutoff *massCutoff) {
-    float mzmin = _mz - massCutoff->massCutoffValue(_mz);
-    float mzmax = _mz + massCutoff->massCutoffValue(_mz);
+    float cutoff = massCutoff->massCutoffValue(_mz);
+    float mzmin = _mz - cutoff;
+    float mzmax = _mz + cutoff;
 	vector<float>::iterator itr = lower_bound(mz.begin(), mz.end(), mzmin);
 	//cerr << _mz  << " k=" << lb << "/" << mz.size() << " mzk=" << mz[lb] << endl;
 	for(unsigned int k=itr-mz.begin(); k < nobs(); k++ ) {
@@ -460,6 +484,10 @@ vector<int> Scan::assignCharges(MassCutoff *massCutoffTolr) {
     vector<int>intensityOrder = intensityOrderDesc();
     double NMASS=C13_MASS-12.00;
 
+    //series members are searched for within twice the given cutoff
+    MassCutoff massCutoff=*massCutoffTolr;
+    massCutoff.setMassCutoff(2*massCutoffTolr->getMassCutoff());
+
     //a little silly, required number of peaks in a series in already to call a charge
                           //z=0,   z=1,    z=2,   z=3,    z=4,   z=5,    z=6,     z=7,   z=8,
     int minSeriesSize[9] = { 1,     2,     3,      3,      3,     4,      4,       4,     5  } ;
@@ -470,8 +498,6 @@ vector<int> Scan::assignCharges(MassCutoff *massCutoffTolr) {
         float centerMz = mz[pos];
         float centerInts = intensity[pos];
        // float ppm = (0.125/centerMz)*1e6;
-       MassCutoff massCutoff=*massCutoffTolr;
-       massCutoff.setMassCutoffAndType(2*massCutoffTolr->getMassCutoff(),massCutoffTolr->getMassCutoffType());
        // cerr << pos << " " <<  centerMz << " " << centerInts << " " << clusterNumber << endl;
         if (chargeStates[pos] != 0) continue;  //charge already assigned
 
@@ -75,6 +75,15 @@ class Scan
     */
     bool hasMz(float mz, MassCutoff *massCutoff);
 
+    /**
+    * @brief check if the m/z and intensity values of the scan were released
+    * to save memory
+    * @details Released values are read again from the sample file by
+    * mzSample::loadScanPeaks. The total intensity of a released scan is
+    * still available.
+    */
+    bool peaksReleased() const { return _peaksReleased; }
+
     /**
     * @brief check if the data is centroided
     * @return return true if data is centroided else false
@@ -108,6 +117,9 @@ class Scan
     */
     int totalIntensity() const
     {
+        if (_peaksReleased)
+            return _releasedTotalIntensity;
+
         int sum = 0;
         for (unsigned int i = 0; i < intensity.size(); i++)
             sum += intensity[i];
@@ -201,9 +213,14 @@ class Scan
     vector<float> mz; /**< m/z's found in one scan */
     string scanType;
     string filterLine;
+    int filterLineId; /**< ID of filterLine interned by the sample, -1 if empty */
     mzSample *sample; /**< sample corresponding to the scan */
     int polarity; /**< +1 for positively charged, -1 for negatively charged, 0 for neutral*/
 
+    /** byte range of the spectrum in the sample file, -1 if unknown */
+    long long fileSeekStart;
+    long long fileSeekEnd;
+
     /**
      * @brief compare total intensity of two scans
      * @return true if Scan a has a higher totalIntensity than b, else false
@@ -225,6 +242,19 @@ class Scan
     bool operator<(const Scan &b) const { return rt < b.rt; }
 
   private:
+    friend class mzSample;
+
+    //read without the sample's lock by callers checking for released values
+    atomic<bool> _peaksReleased;
+    int _releasedTotalIntensity;
+    int _peaksPins;
+
+    /**
+    * @brief Let the sample know that the m/z or intensity values of this
+    * scan changed
+    */
+    void _peaksChanged();
+
     float parentPeakIntensity;
 
     struct BrotherData
@@ -1,4 +1,7 @@
 #include "base64.h"
+
+#include <algorithm>
+
 #include "mzUtils.h"
 
 using namespace std;
@@ -33,114 +36,442 @@ namespace base64 {
         return false;
     }
 
-    char *decodeString(const string &src) {
-        // Merged to 776
-        int k, l = src.length();
-        char *buf = (char *)calloc(sizeof(char), l);
-        char *dest = (char *)calloc(sizeof(char), l);
-        char *p = dest;
-
-        /* Ignore non base64 chars as per the POSIX standard */
-        for (k = 0, l = 0; src[k]; k++) {
-            if (is_base64(src[k])) {
-                buf[l++] = src[k];
-            }
+    /**
+     * @brief Lookup table from characters to their 6-bit values
+     * @details Padding maps to 0x40 and characters outside the alphabet to
+     * 0x80, so that a whole quartet can be checked with a single mask.
+     */
+    struct DecodeTable {
+        unsigned char values[256];
+
+        DecodeTable() {
+            memset(values, 0x80, sizeof(values));
+            for (int i = 0; i < 64; i++)
+                values[(unsigned char)encode(i)] = i;
+            values[(unsigned char)'='] = 0x40;
         }
+    };
+
+    static const DecodeTable decodeTable;
+
+    size_t decodeBytes(const char *src, size_t length, unsigned char *dest) {
+        const unsigned char *table = decodeTable.values;
+        const unsigned char *in = (const unsigned char *)src;
+        const unsigned char *end = in + length;
+        unsigned char *out = dest;
+
+        uint32_t bits = 0;
+        int count = 0;
+        while (in < end) {
+            if (count == 0) {
+                // whole quartets without padding or line breaks, which is all
+                // of the text in most files
+                while (end - in >= 4) {
+                    uint32_t a = table[in[0]];
+                    uint32_t b = table[in[1]];
+                    uint32_t c = table[in[2]];
+                    uint32_t d = table[in[3]];
+                    if ((a | b | c | d) & 0xC0)
+                        break;
+
+                    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+                    out[0] = (unsigned char)(v >> 16);
+                    out[1] = (unsigned char)(v >> 8);
+                    out[2] = (unsigned char)v;
+                    out += 3;
+                    in += 4;
+                }
+                if (in >= end)
+                    break;
+            }
 
-        for (k = 0; k < l; k += 4) {
-            char c1 = 'A', c2 = 'A', c3 = 'A', c4 = 'A';
-            unsigned char b1 = 0, b2 = 0, b3 = 0, b4 = 0;
-
-            c1 = buf[k];
-            if (k + 1 < l) c2 = buf[k + 1];
-            if (k + 2 < l) c3 = buf[k + 2];
-            if (k + 3 < l) c4 = buf[k + 3];
-
-            b1 = decode(c1);
-            b2 = decode(c2);
-            b3 = decode(c3);
-            b4 = decode(c4);
-
-            *p++ = ((b1 << 2) | (b2 >> 4));
+            /* Ignore non base64 chars as per the POSIX standard */
+            unsigned char value = table[*in++];
+            if (value & 0x80)
+                continue;
+            if (value == 0x40)
+                break;
+
+            bits = (bits << 6) | value;
+            if (++count == 4) {
+                out[0] = (unsigned char)(bits >> 16);
+                out[1] = (unsigned char)(bits >> 8);
+                out[2] = (unsigned char)bits;
+                out += 3;
+                bits = 0;
+                count = 0;
+            }
+        }
 
-            if (c3 != '=') *p++ = (((b2 & 0xf) << 4) | (b3 >> 2));
-            if (c4 != '=') *p++ = (((b3 & 0x3) << 6) | b4);
+        if (count == 2) {
+            *out++ = (unsigned char)(bits >> 4);
+        } else if (count == 3) {
+            *out++ = (unsigned char)(bits >> 10);
+            *out++ = (unsigned char)(bits >> 2);
         }
-        free(buf);
+        return out - dest;
+    }
+
+    char *decodeString(const string &src) {
+        // Merged to 776
+        size_t l = src.length();
+        char *dest = (char *)calloc(sizeof(char), decodedSize(l));
+        decodeBytes(src.data(), l, (unsigned char *)dest);
         return dest;
     }
 
-    vector<float> convertDecodedDataBackToFloat(char *dest, int float_size,
-            bool neworkorder, int size) {
+    bool inflateBytes(const unsigned char *src,
+                      size_t length,
+                      vector<unsigned char> &dest,
+                      size_t sizeHint) {
+        dest.clear();
+#ifdef ZLIB
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit(&zs) != Z_OK)
+            return false;
+
+        zs.next_in = const_cast<Bytef *>(src);
+        zs.avail_in = length;
+
+        // the inflated size is not stored with the data; start from the
+        // expected size and double whenever the output runs full
+        dest.resize(std::max(sizeHint, length * 2) + 64);
+
+        size_t produced = 0;
+        int ret;
+        do {
+            if (produced == dest.size())
+                dest.resize(dest.size() * 2);
+
+            zs.next_out = dest.data() + produced;
+            zs.avail_out = dest.size() - produced;
+            ret = inflate(&zs, Z_NO_FLUSH);
+            produced = dest.size() - zs.avail_out;
+        } while (ret == Z_OK);
+
+        inflateEnd(&zs);
+        dest.resize(produced);
+        return ret == Z_STREAM_END;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Whether values stored in the given byte order have to be swapped
+     */
+    static bool swapNeeded(bool neworkorder) {
         //Merged to 776
 #if (LITTLE_ENDIAN == 1)
         neworkorder = !neworkorder;
 #endif
+        return neworkorder;
+    }
 
+    /**
+     * @brief Copy (and byte swap) raw 32 or 64-bit floats into values
+     */
+    template <typename T>
+    static void convertBytes(const unsigned char *bytes,
+                             size_t size,
+                             int float_size,
+                             bool swap,
+                             vector<T> &values) {
         // we will cast everything as a float may be this is not wise, but have not
         // found a need for double
-        // precission yet
-        vector<float> decodedArray(size);
-
-        if (float_size == 8) {
-            if (neworkorder == false) {
-                for (int i = 0; i < size; i++)
-                    decodedArray[i] = (float)((double *)dest)[i];
-            } else {
-                uint64_t *u = (uint64_t *)dest;
-                double data = 0;
-                for (int i = 0; i < size; i++) {
-                    uint64_t t = swapbytes64(u[i]);
-                    memcpy(&data, &t, 8);
-                    decodedArray[i] = (float)data;
-                }
+        // precission yet, unless the caller asks for doubles
+        size_t count = size / float_size;
+        values.resize(count);
+
+        if (float_size == sizeof(T) && !swap) {
+            memcpy(values.data(), bytes, count * sizeof(T));
+        } else if (float_size == 8) {
+            for (size_t i = 0; i < count; i++) {
+                uint64_t u;
+                double data;
+                memcpy(&u, bytes + i * 8, 8);
+                if (swap)
+                    u = swapbytes64(u);
+                memcpy(&data, &u, 8);
+                values[i] = (T)data;
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                uint32_t u;
+                float data;
+                memcpy(&u, bytes + i * 4, 4);
+                if (swap)
+                    u = swapbytes(u);
+                memcpy(&data, &u, 4);
+                values[i] = (T)data;
             }
-        } else if (float_size == 4) {
-            if (neworkorder == false) {
-                for (int i = 0; i < size; i++)
-                    decodedArray[i] = ((float *)dest)[i];
+        }
+    }
+
+    /**
+     * @brief Read the fixed point of a numpress array, stored as a big
+     * endian double by the reference encoders (unlike the integers that
+     * follow it, which are little endian)
+     */
+    static double numpressFixedPoint(const unsigned char *data) {
+        uint64_t u = 0;
+        for (int i = 0; i < 8; i++)
+            u = (u << 8) | data[i];
+
+        double fixedPoint;
+        memcpy(&fixedPoint, &u, 8);
+        return fixedPoint;
+    }
+
+    /**
+     * @brief Read a numpress half byte encoded integer
+     * @details The first half byte gives the number of leading zero (0-8) or
+     * leading 0xf (9-15) half bytes that were left out, the remaining half
+     * bytes follow with the least significant first.
+     * @param di Index of the current byte, advanced past the integer
+     * @param half Whether the low half of the current byte is next
+     * @return False if the data ends within the integer, true otherwise
+     */
+    static bool numpressInt(const unsigned char *data,
+                            size_t length,
+                            size_t &di,
+                            size_t &half,
+                            uint32_t &res) {
+        unsigned char head;
+        if (half == 0) {
+            head = data[di] >> 4;
+        } else {
+            head = data[di] & 0xf;
+            di++;
+        }
+        half = 1 - half;
+        res = 0;
+
+        size_t n;
+        if (head <= 8) {
+            n = head;
+        } else {
+            n = head - 8;
+            for (size_t i = 0; i < n; i++)
+                res |= 0xf0000000U >> (4 * i);
+        }
+
+        if (n == 8)
+            return true;
+
+        if (di + ((8 - n) - (1 - half)) / 2 >= length)
+            return false;
+
+        for (size_t i = n; i < 8; i++) {
+            unsigned char hb;
+            if (half == 0) {
+                hb = data[di] >> 4;
             } else {
-                uint32_t *u = (uint32_t *)dest;
-                float data = 0;
-                for (int i = 0; i < size; i++) {
-                    uint32_t t = swapbytes(u[i]);
-                    memcpy(&data, &t, 4);
-                    decodedArray[i] = data;
-                }
+                hb = data[di] & 0xf;
+                di++;
             }
+            res |= (uint32_t)hb << ((i - n) * 4);
+            half = 1 - half;
         }
+        return true;
+    }
 
-        free(dest);
-        return decodedArray;
+    /**
+     * @brief Whether only the zero padding of the last byte is left
+     */
+    static bool numpressPadding(const unsigned char *data,
+                                size_t length,
+                                size_t di,
+                                size_t half) {
+        return di == length - 1 && half == 1 && (data[di] & 0xf) == 0;
     }
 
-    vector<float> decode_base64(const string& src, int float_size, bool neworkorder, bool decompress) {
-        //Merged to 776
-        int size = 1 + (src.length() * 3 / 4 - 4) / float_size;
+    template <typename T>
+    static bool numpressLinear(const unsigned char *data,
+                               size_t length,
+                               vector<T> &values) {
+        if (length == 8)
+            return true;
+        if (length < 12)
+            return false;
 
-        char *dest = decodeString(src);
-        if (decompress) {
-            decompressString(&dest, size, float_size);
+        double fixedPoint = numpressFixedPoint(data);
+        int64_t ints[3];
+        ints[1] = 0;
+        for (int i = 0; i < 4; i++)
+            ints[1] |= (int64_t)data[8 + i] << (i * 8);
+        values.push_back((T)(ints[1] / fixedPoint));
+
+        if (length == 12)
+            return true;
+        if (length < 16)
+            return false;
+
+        ints[2] = 0;
+        for (int i = 0; i < 4; i++)
+            ints[2] |= (int64_t)data[12 + i] << (i * 8);
+        values.push_back((T)(ints[2] / fixedPoint));
+
+        // every following value is stored as its difference to the linear
+        // extrapolation of the previous two
+        size_t di = 16;
+        size_t half = 0;
+        while (di < length) {
+            if (numpressPadding(data, length, di, half))
+                break;
+
+            uint32_t diff;
+            if (!numpressInt(data, length, di, half, diff))
+                return false;
+
+            ints[0] = ints[1];
+            ints[1] = ints[2];
+            int64_t extrapolated = ints[1] + (ints[1] - ints[0]);
+            ints[2] = extrapolated + (int32_t)diff;
+            values.push_back((T)(ints[2] / fixedPoint));
         }
+        return true;
+    }
 
-        vector<float> decodedArray =
-            convertDecodedDataBackToFloat(dest, float_size, neworkorder, size);
+    template <typename T>
+    static bool numpressPic(const unsigned char *data,
+                            size_t length,
+                            vector<T> &values) {
+        size_t di = 0;
+        size_t half = 0;
+        while (di < length) {
+            if (numpressPadding(data, length, di, half))
+                break;
+
+            uint32_t count;
+            if (!numpressInt(data, length, di, half, count))
+                return false;
+            values.push_back((T)count);
+        }
+        return true;
+    }
 
-        return decodedArray;
+    template <typename T>
+    static bool numpressSlof(const unsigned char *data,
+                             size_t length,
+                             vector<T> &values) {
+        if (length < 8)
+            return false;
+
+        double fixedPoint = numpressFixedPoint(data);
+        values.resize((length - 8) / 2);
+        for (size_t i = 0; i < values.size(); i++) {
+            const unsigned char *x = data + 8 + 2 * i;
+            uint16_t logged = (uint16_t)(x[0] | (x[1] << 8));
+            values[i] = (T)(exp(logged / fixedPoint) - 1);
+        }
+        return true;
+    }
 
+    template <typename T>
+    static bool decodeNumpressTyped(const unsigned char *data,
+                                    size_t length,
+                                    Numpress numpress,
+                                    vector<T> &values) {
+        values.clear();
+        switch (numpress) {
+        case Numpress::Linear:
+            return numpressLinear(data, length, values);
+        case Numpress::Pic:
+            return numpressPic(data, length, values);
+        case Numpress::Slof:
+            return numpressSlof(data, length, values);
+        default:
+            return false;
+        }
     }
 
-    void decompressString(char **dest, int &size, int float_size) {
-        //Merged to 776
-        string decodedStr(*dest);
-        string uncompStr(mzUtils::decompress_string(decodedStr));
+    bool decodeNumpress(const unsigned char *data,
+                        size_t length,
+                        Numpress numpress,
+                        vector<double> &values) {
+        return decodeNumpressTyped(data, length, numpress, values);
+    }
+
+    template <typename T>
+    static bool decodeBinaryArrayTyped(const char *src,
+                                       size_t length,
+                                       const BinaryFormat &format,
+                                       vector<T> &values,
+                                       DecodeBuffer &buffer) {
+        values.clear();
+        if (length == 0)
+            return true;
 
-        free(*dest);
-        *dest = (char *)calloc(sizeof(char), uncompStr.size());
-        for (unsigned int i = 0; i < uncompStr.size(); i++)
-            *dest[i] = uncompStr[i];
+        int float_size = format.float_size;
+        if (format.numpress == Numpress::None
+            && float_size != 4 && float_size != 8)
+            return false;
+
+        bool swap = swapNeeded(format.networkorder);
+
+        // plain arrays of the requested precision are decoded straight into
+        // the values
+        if (!format.zlib && format.numpress == Numpress::None
+            && float_size == sizeof(T)) {
+            values.resize(decodedSize(length) / sizeof(T) + 1);
+            unsigned char *bytes = (unsigned char *)values.data();
+            size_t size = decodeBytes(src, length, bytes);
+            values.resize(size / sizeof(T));
+            if (swap)
+                convertBytes(bytes, size, float_size, swap, values);
+            return true;
+        }
 
-        size = 1 + (uncompStr.size() * 3 / 4 - 4) / float_size;
+        buffer.decoded.resize(decodedSize(length));
+        const unsigned char *bytes = buffer.decoded.data();
+        size_t size = decodeBytes(src, length, buffer.decoded.data());
+
+        if (format.zlib) {
+            size_t sizeHint = 0;
+            if (format.numpress == Numpress::None)
+                sizeHint = format.count * float_size;
+            if (!inflateBytes(bytes, size, buffer.inflated, sizeHint))
+                return false;
+            bytes = buffer.inflated.data();
+            size = buffer.inflated.size();
+        }
+
+        if (format.numpress != Numpress::None)
+            return decodeNumpressTyped(bytes, size, format.numpress, values);
+
+        convertBytes(bytes, size, float_size, swap, values);
+        return true;
+    }
+
+    bool decodeBinaryArray(const char *src,
+                           size_t length,
+                           const BinaryFormat &format,
+                           vector<float> &values,
+                           DecodeBuffer &buffer) {
+        return decodeBinaryArrayTyped(src, length, format, values, buffer);
+    }
+
+    bool decodeBinaryArray(const char *src,
+                           size_t length,
+                           const BinaryFormat &format,
+                           vector<double> &values,
+                           DecodeBuffer &buffer) {
+        return decodeBinaryArrayTyped(src, length, format, values, buffer);
+    }
+
+    vector<float> decode_base64(const string& src, int float_size, bool neworkorder, bool decompress) {
+        //Merged to 776
+        BinaryFormat format;
+        format.float_size = float_size;
+        format.networkorder = neworkorder;
+        format.zlib = decompress;
+
+        DecodeBuffer buffer;
+        vector<float> decodedArray;
+        decodeBinaryArray(src.data(), src.length(), format, decodedArray, buffer);
+        return decodedArray;
     }
 
     unsigned char *convertFromFloatToCharacter(float *srcF,
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 
 
 #ifndef BASE64_H
@@ -34,6 +35,118 @@ namespace base64 {
      */
     int is_base64(char c);
 
+    /**
+     * @brief MS-Numpress compression applied to a binary data array
+     * @details See Teleman et al., "Numerical compression schemes for
+     * proteomics mass spectrometry data", MCP 2014.
+     */
+    enum class Numpress {
+        None,
+        Linear, /**< linear prediction, used for m/z and time arrays */
+        Pic,    /**< positive integer, used for ion counts */
+        Slof    /**< short logged float, used for intensities */
+    };
+
+    /**
+     * @brief Describes how a binary data array was encoded
+     */
+    struct BinaryFormat {
+        BinaryFormat()
+            : float_size(4), networkorder(false), zlib(false),
+              numpress(Numpress::None), count(0) {}
+
+        int float_size;     /**< 4 for 32-bit and 8 for 64-bit values */
+        bool networkorder;  /**< values are stored in network (big endian) order */
+        bool zlib;          /**< data was zlib compressed after any numpress */
+        Numpress numpress;  /**< numpress compression applied to the values */
+        size_t count;       /**< expected number of values, 0 if unknown */
+    };
+
+    /**
+     * @brief Scratch memory reused across calls to decodeBinaryArray
+     * @details Keeping one of these around while reading a file avoids
+     * allocating new buffers for every array.
+     */
+    struct DecodeBuffer {
+        vector<unsigned char> decoded;
+        vector<unsigned char> inflated;
+    };
+
+    /**
+     * @brief Decode base64 text into a caller provided buffer
+     * @details Characters outside the base64 alphabet (e.g. whitespace) are
+     * skipped and decoding stops at the first padding character.
+     * @param src Base64 encoded text
+     * @param length Number of characters in src
+     * @param dest Output buffer, must hold at least decodedSize(length) bytes
+     * @return Number of bytes written to dest
+     */
+    size_t decodeBytes(const char *src, size_t length, unsigned char *dest);
+
+    /**
+     * @brief Upper bound of the number of bytes decoded from base64 text
+     * @param length Number of characters in the base64 text
+     */
+    inline size_t decodedSize(size_t length) { return length / 4 * 3 + 3; }
+
+    /**
+     * @brief Inflate zlib compressed data into a caller provided buffer
+     * @param src Compressed data
+     * @param length Number of bytes in src
+     * @param dest Filled with the inflated data, its capacity is reused
+     * @param sizeHint Expected size of the inflated data, 0 if unknown
+     * @return False if the data could not be inflated or zlib support was
+     * not compiled in, true otherwise
+     */
+    bool inflateBytes(const unsigned char *src,
+                      size_t length,
+                      vector<unsigned char> &dest,
+                      size_t sizeHint = 0);
+
+    /**
+     * @brief Decode MS-Numpress compressed bytes
+     * @param data Numpress encoded bytes
+     * @param length Number of bytes in data
+     * @param numpress Numpress scheme the data was encoded with
+     * @param values Filled with the decoded values
+     * @return False if the data was corrupt, true otherwise
+     */
+    bool decodeNumpress(const unsigned char *data,
+                        size_t length,
+                        Numpress numpress,
+                        vector<double> &values);
+
+    /**
+     * @brief Decode a base64 encoded binary data array (as found in mzML and
+     * mzXML files)
+     * @details Decoding, inflation and numpress decompression all work in the
+     * memory of buffer and values, so that reading many arrays does not
+     * allocate once the buffers have grown to the largest array.
+     * @param src Base64 encoded text
+     * @param length Number of characters in src
+     * @param format Encoding of the array
+     * @param values Filled with the decoded values, its capacity is reused
+     * @param buffer Scratch memory
+     * @return False if the array could not be decoded, true otherwise
+     */
+    bool decodeBinaryArray(const char *src,
+                           size_t length,
+                           const BinaryFormat &format,
+                           vector<float> &values,
+                           DecodeBuffer &buffer);
+
+    /**
+     * @brief Decode a base64 encoded binary data array keeping double
+     * precision
+     * @see decodeBinaryArray(const char*, size_t, const BinaryFormat&,
+     * vector<float>&, DecodeBuffer&)
+     */
+    bool decodeBinaryArray(const char *src,
+                           size_t length,
+                           const BinaryFormat &format,
+                           vector<double> &values,
+                           DecodeBuffer &buffer);
+
     /**
      * [Decode a base64 string]
      * @method decode
@@ -75,13 +188,7 @@ namespace base64 {
                     (uint64_t)swapbytes((uint32_t)(x >> 32))));
     }
 
-    void decompressString(char** dest, int& size, int float_size);
-
     char* decodeString(const string& src);
-    vector<float> convertDecodedDataBackToFloat(unsigned char* dest,
-            int float_size,
-            bool neworkorder,
-            int size);
     unsigned char* convertFromFloatToCharacter(
             float* srcF, const vector<float>& farray);
     unsigned char* encodeString(unsigned char* src, int size);
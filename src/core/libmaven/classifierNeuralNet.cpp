@@ -75,20 +75,23 @@ void ClassifierNeuralNet::classify(PeakGroup* grp) {
 	if (brain == NULL)
 		return;
 
-    for (unsigned int j=0; j < grp->peaks.size(); j++ ) {
-        grp->peaks[j].quality=scorePeak(grp->peaks[j]);
+	vector<Peak*> peaks;
+	for (unsigned int j=0; j < grp->peaks.size(); j++ ) {
+		peaks.push_back(&grp->peaks[j]);
 	}
+	scorePeaks(peaks);
 }
 
 void ClassifierNeuralNet::scoreEICs(vector<EIC*> &eics)
 {
-
+	vector<Peak*> peaks;
 	for (unsigned int i = 0; i < eics.size(); i++)
 	{
 		for (unsigned int j = 0; j < eics[i]->peaks.size(); j++ ) {
-			eics[i]->peaks[j].quality = scorePeak(eics[i]->peaks[j]);
+			peaks.push_back(&eics[i]->peaks[j]);
 		}
 	}
+	scorePeaks(peaks);
 }
 
 float ClassifierNeuralNet::scorePeak(Peak& p) {
@@ -105,6 +108,76 @@ float ClassifierNeuralNet::scorePeak(Peak& p) {
     return result[0];
 }
 
+void ClassifierNeuralNet::scorePeaks(const vector<Peak*> &peaks)
+{
+	if (peaks.empty())
+		return;
+
+	if (brain == NULL) {
+		for (Peak* peak : peaks)
+			peak->quality = 0.1;
+		return;
+	}
+
+	Eigen::VectorXf scores = scoreFeatureMatrix(getFeatureMatrix(peaks));
+	for (unsigned int i = 0; i < peaks.size(); i++)
+		peaks[i]->quality = scores(i);
+}
+
+Eigen::MatrixXf ClassifierNeuralNet::getFeatureMatrix(const vector<Peak*> &peaks)
+{
+	//the network reads as many inputs as it was trained with, missing
+	//features are left at zero
+	int numInputs = num_features;
+	if (brain != NULL)
+		numInputs = max(num_features, brain->get_layersize(NEUN_INPUT));
+
+	Eigen::MatrixXf features = Eigen::MatrixXf::Zero(peaks.size(), numInputs);
+	for (unsigned int i = 0; i < peaks.size(); i++) {
+		vector<float> set = getFeatures(*peaks[i]);
+		for (int k = 0; k < num_features; k++)
+			features(i, k) = set[k];
+	}
+	return features;
+}
+
+Eigen::VectorXf ClassifierNeuralNet::scoreFeatureMatrix(const Eigen::MatrixXf &features)
+{
+	int n = features.rows();
+	Eigen::VectorXf scores = Eigen::VectorXf::Constant(n, 0.1);
+	if (brain == NULL)
+		return scores;
+
+	int inputSize = brain->get_layersize(NEUN_INPUT);
+	int hiddenSize = brain->get_layersize(HIDDEN);
+	if (inputSize <= 0 || hiddenSize <= 0 || brain->get_layersize(OUTPUT) <= 0
+	    || features.cols() < inputSize)
+		return scores;
+
+	//every node sums its inputs in input order for all peaks at once, which
+	//keeps the per-peak order of nnwork::run
+	Eigen::MatrixXf hidden(n, hiddenSize);
+	Eigen::VectorXf sum(n);
+	for (int j = 0; j < hiddenSize; j++) {
+		const float* weights = brain->get_weights(HIDDEN, j);
+		sum.setZero();
+		for (int i = 0; i < inputSize; i++)
+			sum += weights[i] * features.col(i);
+		for (int p = 0; p < n; p++)
+			hidden(p, j) = sigmoid(sum(p));
+	}
+
+	//only the first output is used as the peak quality
+	const float* weights = brain->get_weights(OUTPUT, 0);
+	sum.setZero();
+	for (int j = 0; j < hiddenSize; j++)
+		sum += weights[j] * hidden.col(j);
+	for (int p = 0; p < n; p++)
+		scores(p) = sigmoid(sum(p));
+
+	return scores;
+}
+
 
 void ClassifierNeuralNet::refineModel(PeakGroup* grp) {
 	if (grp == NULL)
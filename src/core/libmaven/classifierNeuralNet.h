@@ -8,6 +8,7 @@
 #include <fstream>
 #include <math.h>
 #include <vector>
+#include <Eigen>
 #include "classifier.h"
 #include "EIC.h"
 
@@ -26,6 +27,27 @@ public:
     vector<float> getFeatures(Peak& p);
 	float scorePeak(Peak& p);
 	void scoreEICs(vector<EIC*> &eics);
+
+	/**
+	 * @brief Score many peaks with a single pass through the network
+	 * @details Features of all peaks are packed into one matrix, with a
+	 * column per feature, and every layer is evaluated for all peaks at
+	 * once. Each score is accumulated in the same order as in scorePeak,
+	 * so scores are identical to the ones of scorePeak. The network itself
+	 * is not modified, so peaks can be scored from several threads.
+	 * @param peaks Peaks whose quality is set
+	 */
+	void scorePeaks(const vector<Peak*> &peaks);
+
+	/**
+	 * @brief Pack features of peaks into a matrix, one row per peak
+	 */
+	Eigen::MatrixXf getFeatureMatrix(const vector<Peak*> &peaks);
+
+	/**
+	 * @brief First output of the network for every row of a feature matrix
+	 */
+	Eigen::VectorXf scoreFeatureMatrix(const Eigen::MatrixXf &features);
 private:
 	
 
@@ -0,0 +1,71 @@
+#include "groupindex.h"
+
+#include <cmath>
+
+#include "masscutofftype.h"
+#include "mzUtils.h"
+
+GroupIndex::GroupIndex(float bucketWidth)
+{
+    _bucketWidth = bucketWidth;
+    _size = 0;
+}
+
+void GroupIndex::clear()
+{
+    _buckets.clear();
+    _size = 0;
+}
+
+long GroupIndex::_bucketFor(float mz) const
+{
+    return static_cast<long>(floor(mz / _bucketWidth));
+}
+
+void GroupIndex::insert(float mz, float rtmin, float rtmax)
+{
+    Entry entry;
+    entry.mz = mz;
+    entry.rtmin = rtmin;
+    entry.rtmax = rtmax;
+    _buckets[_bucketFor(mz)].push_back(entry);
+    _size++;
+}
+
+bool GroupIndex::hasOverlap(float mz,
+                            float rtmin,
+                            float rtmax,
+                            MassCutoff *massCutoff,
+                            float minRtOverlap) const
+{
+    if (_size == 0)
+        return false;
+
+    // for ppm cutoffs the distance is relative to the stored m/z, which can be
+    // slightly larger than the queried m/z, so the window is widened a bit
+    double cutoff = massCutoff->getMassCutoff();
+    double window = massCutoff->massCutoffValue(mz);
+    if (massCutoff->unit() == MassCutoffUnit::Ppm && cutoff < 1e6)
+        window = cutoff * mz / (1e6 - cutoff);
+    window = window * 1.001 + 1e-6;
+
+    long firstBucket = _bucketFor(mz - window);
+    long lastBucket = _bucketFor(mz + window);
+    for (long bucket = firstBucket; bucket <= lastBucket; bucket++) {
+        auto entries = _buckets.find(bucket);
+        if (entries == _buckets.end())
+            continue;
+
+        for (const Entry &entry : entries->second) {
+            float rtoverlap = mzUtils::checkOverlap(rtmin,
+                                                    rtmax,
+                                                    entry.rtmin,
+                                                    entry.rtmax);
+            if (rtoverlap > minRtOverlap
+                && mzUtils::massCutoffDist(entry.mz, mz, massCutoff)
+                       < massCutoff->getMassCutoff())
+                return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,79 @@
+#ifndef GROUPINDEX_H
+#define GROUPINDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+class MassCutoff;
+
+using namespace std;
+
+/**
+* @brief Stores m/z and RT extents of peak groups for fast overlap queries
+*
+* @details Groups are kept in fixed width m/z buckets, so that a query only
+* has to look at groups from the few buckets that can lie within the mass
+* cutoff of the queried m/z, instead of all groups found so far.
+*/
+class GroupIndex
+{
+  public:
+    /**
+    * @brief Constructor for class GroupIndex
+    * @param bucketWidth Width (in Da) of each m/z bucket
+    */
+    GroupIndex(float bucketWidth = 0.01f);
+
+    /**
+    * @brief Remove all groups from the index
+    */
+    void clear();
+
+    /**
+    * @brief Number of groups in the index
+    */
+    size_t size() const { return _size; }
+
+    /**
+    * @brief Add a group to the index
+    * @param mz Mean m/z of the group
+    * @param rtmin Minimum RT of the group
+    * @param rtmax Maximum RT of the group
+    */
+    void insert(float mz, float rtmin, float rtmax);
+
+    /**
+    * @brief Check whether any group in the index overlaps the given extent
+    * @details A stored group overlaps if the fraction of RT overlap (as given
+    * by mzUtils::checkOverlap) is greater than minRtOverlap and its mass
+    * distance (as given by mzUtils::massCutoffDist) is less than the mass
+    * cutoff.
+    * @param mz Mean m/z of the queried group
+    * @param rtmin Minimum RT of the queried group
+    * @param rtmax Maximum RT of the queried group
+    * @param massCutoff Mass cutoff used to compare m/z values
+    * @param minRtOverlap Fraction of RT overlap above which groups overlap
+    * @return True if an overlapping group exists, false otherwise
+    */
+    bool hasOverlap(float mz,
+                    float rtmin,
+                    float rtmax,
+                    MassCutoff *massCutoff,
+                    float minRtOverlap) const;
+
+  private:
+    struct Entry
+    {
+        float mz;
+        float rtmin;
+        float rtmax;
+    };
+
+    float _bucketWidth;
+    size_t _size;
+    unordered_map<long, vector<Entry> > _buckets;
+
+    long _bucketFor(float mz) const;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "transitionindex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Compound.h"
+
+TransitionIndex::TransitionIndex()
+{
+    _size = 0;
+}
+
+void TransitionIndex::build(const deque<Compound *> &compounds)
+{
+    _partitions.clear();
+    _size = 0;
+
+    for (size_t i = 0; i < compounds.size(); i++) {
+        Compound *compound = compounds[i];
+        if (compound->precursorMz == 0)
+            continue;
+
+        Entry entry;
+        entry.precursorMz = compound->precursorMz;
+        entry.productMz = compound->productMz;
+        entry.order = i;
+        entry.compound = compound;
+        _partitions[compound->charge].push_back(entry);
+        _size++;
+    }
+
+    for (auto &partition : _partitions) {
+        sort(partition.second.begin(),
+             partition.second.end(),
+             [](const Entry &a, const Entry &b) {
+                 if (a.precursorMz != b.precursorMz)
+                     return a.precursorMz < b.precursorMz;
+                 return a.order < b.order;
+             });
+    }
+}
+
+vector<const vector<TransitionIndex::Entry> *>
+TransitionIndex::_partitionsFor(int polarity) const
+{
+    // neutral compounds match transitions of either polarity
+    vector<const vector<Entry> *> partitions;
+    auto neutral = _partitions.find(0);
+    if (neutral != _partitions.end())
+        partitions.push_back(&neutral->second);
+    if (polarity != 0) {
+        auto charged = _partitions.find(polarity);
+        if (charged != _partitions.end())
+            partitions.push_back(&charged->second);
+    }
+    return partitions;
+}
+
+vector<TransitionIndex::Entry>::const_iterator
+TransitionIndex::_windowBegin(const vector<Entry> &entries,
+                              float precursorMz,
+                              double amuQ1)
+{
+    // the window is widened a little, exact tolerance checks are left to
+    // the caller
+    float lowest = precursorMz - amuQ1 - 1e-3;
+    return lower_bound(entries.begin(),
+                       entries.end(),
+                       lowest,
+                       [](const Entry &entry, float mz) {
+                           return entry.precursorMz < mz;
+                       });
+}
+
+Compound *TransitionIndex::nearest(float precursorMz,
+                                   float productMz,
+                                   float rt,
+                                   int polarity,
+                                   double amuQ1,
+                                   double amuQ3) const
+{
+    Compound *best = NULL;
+    size_t bestOrder = 0;
+    float distMz = FLT_MAX;
+    float distRt = FLT_MAX;
+    float highest = precursorMz + amuQ1 + 1e-3;
+
+    for (auto entries : _partitionsFor(polarity)) {
+        for (auto entry = _windowBegin(*entries, precursorMz, amuQ1);
+             entry != entries->end() && entry->precursorMz <= highest;
+             entry++) {
+            float a = abs(entry->precursorMz - precursorMz);
+            if (a > amuQ1)
+                continue;
+            float b = abs(entry->productMz - productMz);
+            if (b > amuQ3)
+                continue;
+
+            float dMz = sqrt(a * a + b * b);
+            float dRt = abs(entry->compound->expectedRt - rt);
+            bool closer = dMz < distMz
+                          || (dMz == distMz && dRt < distRt)
+                          || (dMz == distMz && dRt == distRt
+                              && entry->order < bestOrder);
+            if (closer) {
+                best = entry->compound;
+                bestOrder = entry->order;
+                distMz = dMz;
+                distRt = dRt;
+            }
+        }
+    }
+    return best;
+}
+
+deque<Compound *> TransitionIndex::matches(float precursorMz,
+                                           float productMz,
+                                           int polarity,
+                                           double amuQ1,
+                                           double amuQ3) const
+{
+    vector<const Entry *> found;
+    float highest = precursorMz + amuQ1 + 1e-3;
+
+    for (auto entries : _partitionsFor(polarity)) {
+        for (auto entry = _windowBegin(*entries, precursorMz, amuQ1);
+             entry != entries->end() && entry->precursorMz <= highest;
+             entry++) {
+            float a = abs(entry->precursorMz - precursorMz);
+            if (a > amuQ1)
+                continue;
+            float b = abs(entry->productMz - productMz);
+            if (b > amuQ3)
+                continue;
+            found.push_back(&(*entry));
+        }
+    }
+
+    sort(found.begin(), found.end(), [](const Entry *a, const Entry *b) {
+        return a->order < b->order;
+    });
+
+    deque<Compound *> compounds;
+    for (const Entry *entry : found)
+        compounds.push_back(entry->compound);
+    return compounds;
+}
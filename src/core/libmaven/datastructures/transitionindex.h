@@ -0,0 +1,94 @@
+#ifndef TRANSITIONINDEX_H
+#define TRANSITIONINDEX_H
+
+#include <deque>
+#include <map>
+#include <vector>
+
+class Compound;
+
+using namespace std;
+
+/**
+* @brief Stores SRM transitions of a compound database for fast lookups by
+* precursor m/z, product m/z and polarity
+*
+* @details Transitions (compounds with a non-zero precursor m/z) are
+* partitioned by charge and sorted by precursor m/z within each partition. A
+* query only looks at the partitions of its polarity and of neutral compounds,
+* and within them only at transitions inside the Q1 window.
+*/
+class TransitionIndex
+{
+  public:
+    /**
+    * @brief Constructor for class TransitionIndex
+    */
+    TransitionIndex();
+
+    /**
+    * @brief Index all transitions of a compound database
+    * @details Previously indexed transitions are dropped.
+    * @param compounds Compounds from a reference compound database
+    */
+    void build(const deque<Compound *> &compounds);
+
+    /**
+    * @brief Number of transitions in the index
+    */
+    size_t size() const { return _size; }
+
+    /**
+    * @brief Find the transition nearest to the given precursor and product
+    * @details Transitions are compared by euclidean distance in (Q1, Q3),
+    * then by distance from their expected RT. Remaining ties go to the
+    * compound that comes first in the database.
+    * @param precursorMz Precursor m/z of the queried transition
+    * @param productMz Product m/z of the queried transition
+    * @param rt RT of the queried transition
+    * @param polarity Polarity of the queried transition
+    * @param amuQ1 Q1 mass tolerance
+    * @param amuQ3 Q3 mass tolerance
+    * @return Nearest compound or NULL if none is within tolerance
+    */
+    Compound *nearest(float precursorMz,
+                      float productMz,
+                      float rt,
+                      int polarity,
+                      double amuQ1,
+                      double amuQ3) const;
+
+    /**
+    * @brief Find all transitions within tolerance of a precursor and product
+    * @param precursorMz Precursor m/z of the queried transition
+    * @param productMz Product m/z of the queried transition
+    * @param polarity Polarity of the queried transition
+    * @param amuQ1 Q1 mass tolerance
+    * @param amuQ3 Q3 mass tolerance
+    * @return Matching compounds, in database order
+    */
+    deque<Compound *> matches(float precursorMz,
+                              float productMz,
+                              int polarity,
+                              double amuQ1,
+                              double amuQ3) const;
+
+  private:
+    struct Entry
+    {
+        float precursorMz;
+        float productMz;
+        size_t order;
+        Compound *compound;
+    };
+
+    size_t _size;
+    map<int, vector<Entry> > _partitions;
+
+    vector<const vector<Entry> *> _partitionsFor(int polarity) const;
+    static vector<Entry>::const_iterator _windowBegin(const vector<Entry> &entries,
+                                                      float precursorMz,
+                                                      double amuQ1);
+};
+
+#endif
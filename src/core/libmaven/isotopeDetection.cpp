@@ -51,70 +51,119 @@ map<string, PeakGroup> IsotopeDetection::getIsotopes(PeakGroup* parentgroup, vec
 {
     //iterate over samples to find properties for parent's isotopes.
     map<string, PeakGroup> isotopes;
+    MassCutoff* massCutoff = _mavenParameters->compoundMassCutoffWindow;
+
+    //smoothing buffer reused by the traces of all isotopes
+    vector<float> scratch;
 
     for (unsigned int s = 0; s < _mavenParameters->samples.size(); s++) {
         mzSample* sample = _mavenParameters->samples[s];
+
+        float rtmin = parentgroup->minRt;
+        float rtmax = parentgroup->maxRt;
+
+        Peak* parentPeak = parentgroup->getPeak(sample);
+        if (parentPeak == NULL) continue;
+        rtmin = parentPeak->rtmin;
+        rtmax = parentPeak->rtmax;
+        float parentPeakIntensity = parentPeak->peakIntensity;
+        Scan* scan = parentPeak->getScan();
+
+        //isotopes which have a signal near the parent peak and pass the
+        //natural abundance check, along with the RT of their highest intensity
+        vector<unsigned int> candidates;
+        vector<float> candidateRts;
+        vector<pair<float, float> > mzRanges;
+
         for (unsigned int k = 0; k < masslist.size(); k++) {
-            //			if (stopped())
-            //				break; TODO: stop
             Isotope& x = masslist[k];
-            string isotopeName = x.name;
             double isotopeMass = x.mass;
-            double expectedAbundance = x.abundance;
 
-            float mzmin = isotopeMass -_mavenParameters->compoundMassCutoffWindow->massCutoffValue(isotopeMass);
-            float mzmax = isotopeMass +_mavenParameters->compoundMassCutoffWindow->massCutoffValue(isotopeMass);
+            float mzmin = isotopeMass - massCutoff->massCutoffValue(isotopeMass);
+            float mzmax = isotopeMass + massCutoff->massCutoffValue(isotopeMass);
 
-            float rt = parentgroup->medianRt();
-            float rtmin = parentgroup->minRt;
-            float rtmax = parentgroup->maxRt;
+            std::pair<float, float> isotope = getIntensity(scan, mzmin, mzmax);
+            float isotopePeakIntensity = isotope.first;
+            float rt = isotope.second;
 
-            Peak* parentPeak = parentgroup->getPeak(sample);
-            if (parentPeak) {
-                rt = parentPeak->rt;
-                rtmin = parentPeak->rtmin;
-                rtmax = parentPeak->rtmax;
-            }
+            if (isotopePeakIntensity == 0 || rt == 0) continue;
 
-            float isotopePeakIntensity = 0;
-            float parentPeakIntensity = 0;
+            if (_filterNaturalAbundance(x, isotopePeakIntensity, parentPeakIntensity))
+                continue;
 
-            if (parentPeak) {
-                parentPeakIntensity = parentPeak->peakIntensity;
-                Scan* scan = parentPeak->getScan();
-                std::pair<float, float> isotope = getIntensity(scan, mzmin, mzmax);
-                isotopePeakIntensity = isotope.first;
-                rt = isotope.second;
-            }
+            //windows used to correlate the isotope with its parent, these are
+            //the same as the ones used by mzSample::correlation
+            float isotopeMz = x.mass;
+            float parentMz = parentgroup->meanMz;
+            float isotopeCutoff = massCutoff->massCutoffValue(isotopeMz);
+            float parentCutoff = massCutoff->massCutoffValue(parentMz);
+
+            candidates.push_back(k);
+            candidateRts.push_back(rt);
+            mzRanges.push_back(make_pair(mzmin, mzmax));
+            mzRanges.push_back(make_pair(isotopeMz - isotopeCutoff,
+                                         isotopeMz + isotopeCutoff));
+            mzRanges.push_back(make_pair(parentMz - parentCutoff,
+                                         parentMz + isotopeCutoff));
+        }
 
-            if (isotopePeakIntensity == 0 || rt == 0) continue;
+        if (candidates.empty()) continue;
+
+        //pull the traces of all candidate isotopes (and their correlation
+        //windows) in a single pass over the sample
+        vector<EIC*> eics = sample->getEICs(mzRanges,
+                                            sample->minRt,
+                                            sample->maxRt,
+                                            1,
+                                            _mavenParameters->eicType,
+                                            _mavenParameters->filterline);
+        //actually mslevel should probably be deepest MS level?
+        //TODO: decide how isotope children should even work in MS mode
+
+        //TODO: this is really an abuse of the maxIsotopeScanDiff parameter
+        //I can easily imagine you might set maxIsotopeScanDiff to something much less than the peak width
+        //here w should really be determined by the minRt and maxRt for the parent and child peaks
+        float w = _mavenParameters->maxIsotopeScanDiff
+            * _mavenParameters->avgScanTime;
 
-            if (filterIsotope(x, isotopePeakIntensity, parentPeakIntensity, sample, parentgroup))
+        for (unsigned int c = 0; c < candidates.size(); c++) {
+            //			if (stopped())
+            //				break; TODO: stop
+            Isotope& x = masslist[candidates[c]];
+            string isotopeName = x.name;
+            double isotopeMass = x.mass;
+            double expectedAbundance = x.abundance;
+            float rt = candidateRts[c];
+
+            EIC* eic = eics[3 * c];
+            float corr = _correlation(eics[3 * c + 1],
+                                      eics[3 * c + 2],
+                                      rtmin - w,
+                                      rtmax + w);
+            if (corr < _mavenParameters->minIsotopicCorrelation)
                 continue;
 
             vector<Peak> allPeaks;
 
-            EIC * eic = sample->getEIC(mzmin, mzmax, sample->minRt,sample->maxRt, 1, _mavenParameters->eicType,
-                                        _mavenParameters->filterline);
-            //actually last parameter should probably be deepest MS level?
-            //TODO: decide how isotope children should even work in MS mode
-
-            // smooth fond eic TODO: null check for found
             eic->setSmootherType(
                     (EIC::SmootherType)
                     _mavenParameters->eic_smoothingAlgorithm);
             eic->setBaselineSmoothingWindow(_mavenParameters->baseline_smoothingWindow);
             eic->setBaselineDropTopX(_mavenParameters->baseline_dropTopX);
             eic->setFilterSignalBaselineDiff(_mavenParameters->isotopicMinSignalBaselineDifference);
-            eic->getPeakPositions(_mavenParameters->eic_smoothingWindow);
+            eic->getPeakPositions(_mavenParameters->eic_smoothingWindow,
+                                  scratch);
             //TODO: this needs be optimized to not bother finding peaks outside of
             //maxIsotopeScanDiff window
             allPeaks = eic->peaks;
 
-            //Set peak quality
+            //Set peak quality, batch scoring does not touch the model so
+            //isotopes of several groups can be scored in parallel
             if (_mavenParameters->clsf->hasModel()) {
+                vector<Peak*> peaks;
                 for(Peak& peak: allPeaks)
-                    peak.quality = _mavenParameters->clsf->scorePeak(peak);
+                    peaks.push_back(&peak);
+                _mavenParameters->clsf->scorePeaks(peaks);
             }
 
             //filter isotopic peaks
@@ -122,7 +171,6 @@ map<string, PeakGroup> IsotopeDetection::getIsotopes(PeakGroup* parentgroup, vec
 			PeakFiltering peakFiltering(_mavenParameters, isIsotope);
             peakFiltering.filter(allPeaks);                               
 
-            delete(eic);
             // find nearest peak as long as it is within RT window
             float maxRtDiff=_mavenParameters->maxIsotopeScanDiff * _mavenParameters->avgScanTime;
             //why are we even doing this calculation, why not have the parameter be in units of RT?
@@ -155,12 +203,46 @@ map<string, PeakGroup> IsotopeDetection::getIsotopes(PeakGroup* parentgroup, vec
             }
             vector<Peak>().swap(allPeaks);
         }
+        delete_all(eics);
     }
     return isotopes;
 }
 
 bool IsotopeDetection::filterIsotope(Isotope x, float isotopePeakIntensity, float parentPeakIntensity, mzSample* sample, PeakGroup* parentGroup)
 {    
+    if (_filterNaturalAbundance(x, isotopePeakIntensity, parentPeakIntensity))
+        return true;
+
+    //TODO: this is really an abuse of the maxIsotopeScanDiff parameter
+    //I can easily imagine you might set maxIsotopeScanDiff to something much less than the peak width
+    //here w should really be determined by the minRt and maxRt for the parent and child peaks
+    if (parentGroup)
+    {
+        Peak* parentPeak = parentGroup->getPeak(sample);
+        float rtmin = parentGroup->minRt;
+        float rtmax = parentGroup->maxRt;
+        if (parentPeak)
+        {
+            rtmin = parentPeak->rtmin;
+            rtmax = parentPeak->rtmax;
+        }
+        float isotopeMass = x.mass;
+        float parentMass = parentGroup->meanMz;
+        float w = _mavenParameters->maxIsotopeScanDiff
+            * _mavenParameters->avgScanTime;
+        double c = sample->correlation(
+                isotopeMass, parentMass,
+                _mavenParameters->compoundMassCutoffWindow, rtmin - w,
+                rtmax + w, _mavenParameters->eicType,
+            _mavenParameters->filterline);  // find correlation for isotopes
+        if (c < _mavenParameters->minIsotopicCorrelation)
+            return true;
+    }
+    return false;
+}
+
+bool IsotopeDetection::_filterNaturalAbundance(Isotope& x, float isotopePeakIntensity, float parentPeakIntensity)
+{
     //natural abundance check
     //TODO: I think this loop will never run right? Since we're now only pulling the relevant isotopes
     //if x.C13>0 then _mavenParameters->C13Labeled_BPE must have been true
@@ -188,33 +270,22 @@ bool IsotopeDetection::filterIsotope(Isotope x, float isotopePeakIntensity, floa
                 _mavenParameters->maxNaturalAbundanceErr)
             return true;
     }
+    return false;
+}
 
-    //TODO: this is really an abuse of the maxIsotopeScanDiff parameter
-    //I can easily imagine you might set maxIsotopeScanDiff to something much less than the peak width
-    //here w should really be determined by the minRt and maxRt for the parent and child peaks
-    if (parentGroup)
-    {
-        Peak* parentPeak = parentGroup->getPeak(sample);
-        float rtmin = parentGroup->minRt;
-        float rtmax = parentGroup->maxRt;
-        if (parentPeak)
-        {
-            rtmin = parentPeak->rtmin;
-            rtmax = parentPeak->rtmax;
-        }
-        float isotopeMass = x.mass;
-        float parentMass = parentGroup->meanMz;
-        float w = _mavenParameters->maxIsotopeScanDiff
-            * _mavenParameters->avgScanTime;
-        double c = sample->correlation(
-                isotopeMass, parentMass,
-                _mavenParameters->compoundMassCutoffWindow, rtmin - w,
-                rtmax + w, _mavenParameters->eicType,
-            _mavenParameters->filterline);  // find correlation for isotopes
-        if (c < _mavenParameters->minIsotopicCorrelation)
-            return true;
+float IsotopeDetection::_correlation(EIC* isotopeEic, EIC* parentEic, float rtmin, float rtmax)
+{
+    //both traces were pulled over the same scans, so only the points within
+    //the RT window need to be picked from each of them
+    vector<float> isotopeIntensities;
+    vector<float> parentIntensities;
+    for (unsigned int i = 0; i < isotopeEic->rt.size(); i++) {
+        if (isotopeEic->rt[i] < rtmin) continue;
+        if (isotopeEic->rt[i] > rtmax) break;
+        isotopeIntensities.push_back(isotopeEic->intensity[i]);
+        parentIntensities.push_back(parentEic->intensity[i]);
     }
-    return false;
+    return mzUtils::correlation(isotopeIntensities, parentIntensities);
 }
 
 std::pair<float, float> IsotopeDetection::getIntensity(Scan* scan, float mzmin, float mzmax)
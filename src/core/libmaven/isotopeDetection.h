@@ -56,6 +56,20 @@ class IsotopeDetection
 	void addChild(PeakGroup *parentgroup, PeakGroup &child, string isotopeName);
 	bool checkChildExist(vector<PeakGroup> &children, string isotopeName);
 
+	/**
+	 * @brief checks the observed abundance of an isotope against its natural abundance
+	 * @return bool. true if isotope has to be skipped. false if it passes the check
+	 **/
+	bool _filterNaturalAbundance(Isotope& x, float isotopePeakIntensity, float parentPeakIntensity);
+
+	/**
+	 * @brief correlation between an isotope and its parent within an RT window
+	 * @details both EICs must have been pulled over the same scans (as done
+	 * by mzSample::getEICs), the result is then the same as that of
+	 * mzSample::correlation for this window
+	 **/
+	float _correlation(EIC* isotopeEic, EIC* parentEic, float rtmin, float rtmax);
+
 };
 
 #endif // ISOTOPEDETECTION_H
\ No newline at end of file
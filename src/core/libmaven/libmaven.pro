@@ -48,6 +48,7 @@ SOURCES = 	base64.cpp \
                 mzMassCalculator.cpp \
                 mzPatterns.cpp \
                 mzSample.cpp \
+                xmlStreamReader.cpp \
                 mzUtils.cpp \
                 statistics.cpp \
                 elementMass.cpp \
@@ -80,7 +81,13 @@ SOURCES = 	base64.cpp \
                 peakFiltering.cpp \
                 groupFiltering.cpp \
                 isotopeDetection.cpp \
+                spectralsearch.cpp \
+                spectrallibrary.cpp \
+                samplecache.cpp \
+                smoothingkernel.cpp \
                 datastructures/mzSlice.cpp \
+                datastructures/groupindex.cpp \
+                datastructures/transitionindex.cpp \
                 groupClassifier.cpp \
                 groupFeatures.cpp \
                 svmPredictor.cpp
@@ -93,6 +100,7 @@ HEADERS += 	constants.h \
                 mzMassSlicer.h \
 	            PeakGroup.h \
                 mzSample.h \
+                xmlStreamReader.h \
                 PeptideRecord.h \
                 Fragment.h \
                 elementMass.h \
@@ -122,7 +130,13 @@ HEADERS += 	constants.h \
                 peakFiltering.h \
                 groupFiltering.h \
                 isotopeDetection.h \
+                spectralsearch.h \
+                spectrallibrary.h \
+                samplecache.h \
+                smoothingkernel.h \
                 datastructures/mzSlice.h \
+                datastructures/groupindex.h \
+                datastructures/transitionindex.h \
                 settings.h \
                 groupClassifier.h \
                 groupFeatures.h \
@@ -3,19 +3,23 @@
 
 MassCutoff::MassCutoff(){
     _massCutoffType="";
+    _unit=MassCutoffUnit::Unknown;
     _massCutoff=0;
 }
-double MassCutoff::massCutoffValue(double mz){
-    
-    if(_massCutoffType=="ppm"){
-        //cerr<<"mass cutoff type:  "<<_massCutoffType<<"  value: "<<_massCutoff<<endl;
-        return _massCutoff*mz/1e6;
-    }
-    else if(_massCutoffType=="mDa"){
-        //cerr<<"mass cutoff type:  "<<_massCutoffType<<"  value: "<<_massCutoff<<endl;
+MassCutoffUnit MassCutoff::_unitFor(const string& massCutoffType){
+    if(massCutoffType=="ppm") return MassCutoffUnit::Ppm;
+    if(massCutoffType=="mDa") return MassCutoffUnit::MDa;
+    return MassCutoffUnit::Unknown;
+}
+
+double MassCutoff::massCutoffValue(double mz) const{
+
+    switch(_unit){
+    case MassCutoffUnit::Ppm:
+        return mz*(_massCutoff/1e6);
+    case MassCutoffUnit::MDa:
         return _massCutoff/1e3;
-    }
-    else {
+    default:
         cerr<<"mass cutoff type:  "<<"unknown"<<"  value: "<<0<<endl;
         assert(false);
         return 0;
@@ -24,5 +28,6 @@ double MassCutoff::massCutoffValue(double mz){
 
 void MassCutoff::setMassCutoffAndType(double massCutoff, string massCutoffType){
     _massCutoffType=massCutoffType;
+    _unit=_unitFor(massCutoffType);
     _massCutoff=massCutoff;
 }
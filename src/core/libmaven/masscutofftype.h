@@ -5,6 +5,11 @@
 #include<assert.h>
 using namespace std;
 
+/**
+ * @brief Unit of a mass cutoff, resolved once from the mass cutoff type string
+ */
+enum class MassCutoffUnit { Unknown, Ppm, MDa };
+
 class MassCutoff{
 	/**
 	 * this class is used for mass cutoff type. previously, mass cutoff type was ppm 
@@ -14,14 +19,46 @@ class MassCutoff{
 	 */
 private:
 	string _massCutoffType;
+	MassCutoffUnit _unit;
 	double _massCutoff;
+	static MassCutoffUnit _unitFor(const string& massCutoffType);
 public:
 	MassCutoff();
 	void setMassCutoffAndType(double massCutoff, string massCutoffType);
-	void setMassCutoffType(string massCutoffType){_massCutoffType=massCutoffType;}
+	void setMassCutoffType(string massCutoffType){_massCutoffType=massCutoffType; _unit=_unitFor(massCutoffType);}
 	string getMassCutoffType(){return _massCutoffType;}
+	MassCutoffUnit unit() const {return _unit;}
 	void setMassCutoff(double massCutoff){_massCutoff=massCutoff;}
-	double getMassCutoff(){return _massCutoff;}
-	double massCutoffValue(double mz);
+	double getMassCutoff() const {return _massCutoff;}
+	double massCutoffValue(double mz) const;
 };
-#endif
\ No newline at end of file
+
+/**
+ * @brief Mass tolerance policies for hot loops.
+ * @details Each policy gives the half width of the m/z window around an m/z
+ * through window(mz). Kernels templated on a policy are instantiated once per
+ * unit, so the per-point cost of a ppm window is one multiply and that of an
+ * mDa window a constant. Dynamic defers to MassCutoff on every call and is
+ * used when the unit is not known.
+ */
+namespace masstolerance {
+
+	struct Ppm {
+		explicit Ppm(double massCutoff): factor(massCutoff/1e6) {}
+		double window(double mz) const { return mz*factor; }
+		double factor;
+	};
+
+	struct MDa {
+		explicit MDa(double massCutoff): width(massCutoff/1e3) {}
+		double window(double) const { return width; }
+		double width;
+	};
+
+	struct Dynamic {
+		explicit Dynamic(const MassCutoff* massCutoff): massCutoff(massCutoff) {}
+		double window(double mz) const { return massCutoff->massCutoffValue(mz); }
+		const MassCutoff* massCutoff;
+	};
+}
+#endif
@@ -46,6 +46,7 @@ MavenParameters::MavenParameters(string settingsPath):lastUsedSettingsPath(setti
         avgScanTime = 0.2;
 
         limitGroupCount = INT_MAX;
+        peakDetectionThreads = 1;
 
         // peak detection
         eic_smoothingWindow = 10;
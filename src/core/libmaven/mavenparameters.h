@@ -189,6 +189,12 @@ class MavenParameters
         */
         int limitGroupCount;
 
+        /**
+        * number of threads used to process slices during peak detection,
+        * 1 processes slices serially and 0 uses all available cores
+        */
+        int peakDetectionThreads;
+
         /**
         * triple quad compound matching Q1
         */
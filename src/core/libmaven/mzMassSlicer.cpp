@@ -41,17 +41,47 @@ void MassSlices::stopSlicing() {
         cache.clear();
     }
 }
+
+void MassSlices::algorithmB( MassCutoff *massCutoff,int rtStep ) {
+    // resolve the unit once, so that the slicing loops are specialized for it
+    switch (massCutoff->unit()) {
+    case MassCutoffUnit::Ppm:
+        algorithmB(massCutoff,
+                   masstolerance::Ppm(massCutoff->getMassCutoff()),
+                   rtStep);
+        break;
+    case MassCutoffUnit::MDa:
+        algorithmB(massCutoff,
+                   masstolerance::MDa(massCutoff->getMassCutoff()),
+                   rtStep);
+        break;
+    default:
+        algorithmB(massCutoff, masstolerance::Dynamic(massCutoff), rtStep);
+        break;
+    }
+}
+
 /**
  * MassSlices::algorithmB This is the main function that does the peakdetection
  * This does not need a DB to check the peaks. The function essentially loops over
- * every observation in every scan in every sample. Every observation is checked if
- * it is already present in a slice or not. If present in a slice MZmax, MZmin, RTmin,
- * RTmax, intensity, MZ and RT are modified and the  slice then put back into cache. If 
- * not then then a new slice is created and added to the slice.
+ * every observation in every MS1 scan in every sample. Every observation is checked
+ * if it is already present in a slice or not. If present in a slice MZmax, MZmin,
+ * RTmin, RTmax, intensity, MZ and RT are modified, if not then a new slice is
+ * created. Slices are looked up in a hash grid over m/z and RT.
+ *
+ * Samples are processed in batches of one sample per thread. The observations
+ * of the samples of a batch are filtered, and their m/z windows computed, in
+ * parallel. They are then merged into the slices one sample after the other,
+ * in sample order, so that the slices do not depend on the number of threads.
+ * A slice can only be merged with an observation after all the slices before
+ * it, which is why the slices themselves are not built per thread.
  * @param userPPM      The user defined PPM for MZ range
  * @param rtStep       Minimum RT range for RT window
  */
-void MassSlices::algorithmB( MassCutoff *massCutoff,int rtStep ) {
+template<class Tolerance>
+void MassSlices::algorithmB(MassCutoff *massCutoff,
+                            const Tolerance& tolerance,
+                            int rtStep) {
     //clear all previous data
     delete_all(slices);
     slices.clear();
@@ -62,119 +92,233 @@ void MassSlices::algorithmB( MassCutoff *massCutoff,int rtStep ) {
 
     int totalScans = 0,currentScans = 0;
 
-    //Calculate the total number of scans
-    for(unsigned int i=0; i < samples.size(); i++) totalScans += samples[i]->scans.size();
+    //Calculate the total number of MS1 scans
+    for(unsigned int i=0; i < samples.size(); i++)
+        totalScans += samples[i]->scansForMsLevel(1).size();
 
     //Calculating the rt window using average distance between RTs and mutiplying it with RTstep (default 20a)
     if (samples.size() > 0 and rtStep > 0) rtWindow = (samples[0]->getAverageFullScanTime()*rtStep);
 
     sendSignal("Status", 0 , 1);
 
-    // #pragma omp parallel for ordered
-    // Looping over every sample
-    for(unsigned int i=0; i < samples.size(); i++) {
-        if (slices.size() > _maxSlices) break;
+    // observations of every sample are merged into the slices of the samples
+    // before it
+    MassSliceGrid grid(4 * rtWindow);
+    int batchSize = std::max(omp_get_max_threads(), 1);
+    vector<SamplePoints> batch(std::min((int)samples.size(), batchSize));
+    for(int first=0; first < (int)samples.size(); first += batchSize) {
+        if (mavenParameters->stop or slices.size() > _maxSlices) break;
+        int count = std::min(batchSize, (int)samples.size() - first);
+
+#pragma omp parallel for schedule(dynamic)
+        for(int i=0; i < count; i++)
+            _collectPoints(samples[first + i], tolerance, batch[i]);
+
+        for(int i=0; i < count; i++) {
+            if (mavenParameters->stop or slices.size() > _maxSlices) break;
+            _slicePoints(batch[i], rtWindow, grid, currentScans, totalScans);
+        }
+    }
+
+    if (mavenParameters->stop) stopSlicing();
+
+    cerr << "Found=" << slices.size() << " slices" << endl;
+    float threshold = 100;
+    removeDuplicateSlices(massCutoff, threshold);
+    sort(slices.begin(),slices.end(), mzSlice::compIntensity);
+    cerr << "After removing duplicate slices. Threshold : "<< threshold <<", Found="<< slices.size()<< " slices" <<endl;
+    sendSignal("Mass Slices Processed", 1 , 1);
+}
+
+template<class Tolerance>
+void MassSlices::_collectPoints(mzSample* sample,
+                                const Tolerance& tolerance,
+                                SamplePoints& samplePoints)
+{
+    // MS1 scans of this sample in RT order, with their observations
+    // packed in the sample's columnar store
+    const vector<Scan*>& ms1Scans = sample->scansForMsLevel(1);
+    const SpectralColumns& columns = sample->ms1Columns();
+
+    vector<SlicePoint>& points = samplePoints.points;
+    points.clear();
+    samplePoints.scanEnds.clear();
+    samplePoints.scanEnds.reserve(ms1Scans.size());
+
+    for(unsigned int j=0; j < ms1Scans.size(); j++ ) {
 
         // Check if Peak detection has been cancelled by the user
-        if (mavenParameters->stop) {
-            stopSlicing();
-            break;
-        }
+        if (mavenParameters->stop) break;
 
-        string num;
-        if(i==0) num = "st";
-        else if(i==1) num = "nd";
-        else if(i==2) num = "rd";
-        else num = "th ";
-
-        // updating progress on samples
-        if (mavenParameters->showProgressFlag ) {
-            string progressText = to_string(i+1) + num + " out of " + to_string(mavenParameters->samples.size()) 
-                                  + " Sample(s) Processing.....";
-            sendSignal(progressText,currentScans,totalScans);
+        Scan* scan = ms1Scans[j];
+        const float* mzs = columns.mzBegin(j);
+        const float* intensities = columns.intensityBegin(j);
+        unsigned int nobs = columns.nobs(j);
+
+        // Checking if RT is in the given min to max RT range
+        if (_maxRt and !isBetweenInclusive(scan->rt,_minRt,_maxRt)) {
+            samplePoints.scanEnds.push_back(points.size());
+            continue;
+        }
+        float rt = scan->rt;
+
+        vector<int> charges;
+        if (_minCharge > 0 or _maxCharge > 0) charges = scan->assignCharges(massCutoff);
+
+        // Looping over every observation in the scan
+        for(unsigned int k=0; k < nobs; k++ ) {
+
+            // Checking if mz, intensity and charge are within specified range
+            if (_maxMz and !isBetweenInclusive(mzs[k],_minMz,_maxMz)) continue;
+            if (_maxIntensity and !isBetweenInclusive(intensities[k],_minIntensity,_maxIntensity)) continue;
+            if ((_minCharge or _maxCharge) and !isBetweenInclusive(charges[k],_minCharge,_maxCharge)) continue;
+
+            // Define mz max and min for this slice
+            SlicePoint point;
+            point.mz = mzs[k];
+            float cutoff = tolerance.window(point.mz);
+            point.mzmax = point.mz + cutoff;
+            point.mzmin = point.mz - cutoff;
+            point.rt = rt;
+            point.intensity = intensities[k];
+            points.push_back(point);
         }
+        samplePoints.scanEnds.push_back(points.size());
+    }
+}
 
-        // #pragma omp cancel for
-        // for loop for iterating over every scan of a sample
-        for(unsigned int j=0; j < samples[i]->scans.size(); j++ ) {
+void MassSlices::_slicePoints(const SamplePoints& samplePoints,
+                              float rtWindow,
+                              MassSliceGrid& grid,
+                              int& processedScans,
+                              int totalScans)
+{
+    size_t begin = 0;
+    for(size_t end : samplePoints.scanEnds) {
+
+        // Check if Peak detection has been cancelled by the user, or if
+        // enough slices were found
+        if (mavenParameters->stop or slices.size() > _maxSlices) break;
+
+        // progress update
+        processedScans++;
+        if (mavenParameters->showProgressFlag and processedScans % 100 == 0) {
+            sendSignal("Processing " + to_string(samples.size()) + " Sample(s).....",
+                       processedScans,
+                       totalScans);
+        }
 
-            // Check if Peak detection has been cancelled by the user
-            if (mavenParameters->stop) {
-                stopSlicing();
-                break;
+        for(size_t k=begin; k < end; k++ ) {
+            const SlicePoint& point = samplePoints.points[k];
+            float mz = point.mz;
+            float rt = point.rt;
+            float mzmin = point.mzmin;
+            float mzmax = point.mzmax;
+
+            // find the best slice at this location, if any
+            int best = grid.find(mz, rt);
+
+            if (best >= 0) {
+                // If slice exists take the max of the intensity, rt and mz (max and min)
+                mzSlice* Z = grid.slice(best);
+                Z->ionCount = std::max((float) Z->ionCount, point.intensity);
+                Z->rtmax = std::max((float)Z->rtmax, rt+2*rtWindow);
+                Z->rtmin = std::min((float)Z->rtmin, rt-2*rtWindow);
+                Z->mzmax = std::max((float)Z->mzmax, mzmax);
+                Z->mzmin = std::min((float)Z->mzmin, mzmin);
+
+                //make sure that mz windown doesn't get out of control
+                if (Z->mzmin < mzmin) Z->mzmin = mzmin;
+                if (Z->mzmax > mzmax) Z->mzmax = mzmax;
+                Z->mz = (Z->mzmin + Z->mzmax) / 2; Z->rt=(Z->rtmin + Z->rtmax) / 2;
+                grid.extend(best);
+            } else {
+                //Make a new slice if no slice contains this observation
+                mzSlice* s = new mzSlice(mzmin, mzmax, rt - 2 * rtWindow, rt + 2 * rtWindow);
+                s->ionCount = point.intensity;
+                s->rt=rt;
+                s->mz=mz;
+                slices.push_back(s);
+                grid.insert(s);
             }
-            currentScans++;
-            Scan* scan = samples[i]->scans[j];
-            if (scan->mslevel != 1 ) continue;
+        }
+        begin = end;
+    }
+}
 
-            // Checking if RT is in the given min to max RT range
-            if (_maxRt and !isBetweenInclusive(scan->rt,_minRt,_maxRt)) continue;
-            float rt = scan->rt;
-
-            vector<int> charges;
-            if (_minCharge > 0 or _maxCharge > 0) charges = scan->assignCharges(massCutoff);
-
-            // Looping over every observation in the scan
-            for(unsigned int k=0; k < scan->nobs(); k++ ) {
-
-                // Checking if mz, intensity and charge are within specified range
-                if (_maxMz and !isBetweenInclusive(scan->mz[k],_minMz,_maxMz)) continue;
-                if (_maxIntensity and !isBetweenInclusive(scan->intensity[k],_minIntensity,_maxIntensity)) continue;
-                if ((_minCharge or _maxCharge) and !isBetweenInclusive(charges[k],_minCharge,_maxCharge)) continue;
-
-                // Define mz max and min for this slice
-                float mz = scan->mz[k];
-                float mzmax = mz + massCutoff->massCutoffValue(mz);
-                float mzmin = mz - massCutoff->massCutoffValue(mz);
-
-                // #pragma omp ordered
-                // sliceExists() returns a the best slice or a null based on whether a slice exists at that location or not
-                mzSlice* Z = sliceExists(mz,rt);
-
-                if (Z) {
-                    //cerr << "Merged Slice " <<  Z->mzmin << " " << Z->mzmax << " " << scan->intensity[k] << "  " << Z->ionCount << endl;
-                    // If slice exists take the max of the intensity, rt and mz (max and min)
-                    Z->ionCount = std::max((float) Z->ionCount, (float ) scan->intensity[k]);
-                    Z->rtmax = std::max((float)Z->rtmax, rt+2*rtWindow);
-                    Z->rtmin = std::min((float)Z->rtmin, rt-2*rtWindow);
-                    Z->mzmax = std::max((float)Z->mzmax, mzmax);
-                    Z->mzmin = std::min((float)Z->mzmin, mzmin);
-
-
-                    //make sure that mz windown doesn't get out of control
-                    if (Z->mzmin < mz-massCutoff->massCutoffValue(mz)) Z->mzmin =  mz-massCutoff->massCutoffValue(mz);
-                    if (Z->mzmax > mz+massCutoff->massCutoffValue(mz)) Z->mzmax =  mz+massCutoff->massCutoffValue(mz);
-                    Z->mz = (Z->mzmin + Z->mzmax) / 2; Z->rt=(Z->rtmin + Z->rtmax) / 2;
-                    //cerr << Z->mz << " " << Z->mzmin << " " << Z->mzmax << " " << ppmDist((float)Z->mzmin,mz) << endl;
-                } else {
-                    //cerr << "\t" << rt << "  " << mzmin << "  "  << mzmax << endl;
-                    //Make a new slice if no slice returned by sliceExists and push it into cache
-                    mzSlice* s = new mzSlice(mzmin, mzmax, rt - 2 * rtWindow, rt + 2 * rtWindow);
-                    s->ionCount = scan->intensity[k];
-                    s->rt=scan->rt;
-                    s->mz=mz;
-                    //cerr << "New Slice " <<  s->mzmin << " " << s->mzmax << " " << s->ionCount << endl;
-                    slices.push_back(s);
-                    int mzRange = mz * 10;
-                    cache.insert( pair<int,mzSlice*>(mzRange, s));
-                }
-            }
-            // progress update 
-            if (mavenParameters->showProgressFlag ) {
-                string progressText = to_string(i+1) + num + " out of " + to_string(mavenParameters->samples.size()) 
-                                  + " Sample(s) Processing.....\n"
-                                  + to_string(slices.size()) + " Slices Created ";
-                sendSignal(progressText,currentScans,totalScans);
-            }
+template void MassSlices::algorithmB(MassCutoff*,
+                                     const masstolerance::Ppm&,
+                                     int);
+template void MassSlices::algorithmB(MassCutoff*,
+                                     const masstolerance::MDa&,
+                                     int);
+template void MassSlices::algorithmB(MassCutoff*,
+                                     const masstolerance::Dynamic&,
+                                     int);
+
+MassSliceGrid::MassSliceGrid(float rtCellWidth)
+{
+    _rtCellWidth = rtCellWidth > 0 ? rtCellWidth : 1.0f;
+}
+
+long MassSliceGrid::_rtCell(float rt) const
+{
+    return (long) floor(rt / _rtCellWidth);
+}
 
+long long MassSliceGrid::_cellKey(int mzBin, long rtCell) const
+{
+    return ((long long) mzBin << 32) ^ (rtCell & 0xffffffffLL);
+}
+
+int MassSliceGrid::find(float mz, float rt) const
+{
+    auto cell = _cells.find(_cellKey((int) (mz * 10), _rtCell(rt)));
+    if (cell == _cells.end()) return -1;
+
+    float bestDist = FLT_MAX;
+    int best = -1;
+    for (int handle : cell->second) {
+        mzSlice* x = _entries[handle].slice;
+        if (mz > x->mzmin && mz < x->mzmax && rt > x->rtmin && rt < x->rtmax) {
+            float d = (mz - x->mzmin) + (x->mzmax - mz);
+            // of equally narrow slices, the one registered first wins
+            if (d < bestDist || (d == bestDist && handle < best)) {
+                best = handle;
+                bestDist = d;
+            }
         }
     }
-    cerr << "Found=" << slices.size() << " slices" << endl;
-    float threshold = 100;
-    removeDuplicateSlices(massCutoff, threshold);
-    sort(slices.begin(),slices.end(), mzSlice::compIntensity);
-    cerr << "After removing duplicate slices. Threshold : "<< threshold <<", Found="<< slices.size()<< " slices" <<endl;
-    sendSignal("Mass Slices Processed", 1 , 1);
+    return best;
+}
+
+int MassSliceGrid::insert(mzSlice* slice)
+{
+    Entry entry;
+    entry.slice = slice;
+    entry.mzBin = (int) (slice->mz * 10);
+    entry.rtCellMin = _rtCell(slice->rtmin);
+    entry.rtCellMax = _rtCell(slice->rtmax);
+
+    int handle = _entries.size();
+    _entries.push_back(entry);
+    for (long c = entry.rtCellMin; c <= entry.rtCellMax; c++)
+        _cells[_cellKey(entry.mzBin, c)].push_back(handle);
+    return handle;
+}
+
+void MassSliceGrid::extend(int handle)
+{
+    // RT bounds of a slice only ever grow
+    Entry& entry = _entries[handle];
+    long rtCellMin = _rtCell(entry.slice->rtmin);
+    long rtCellMax = _rtCell(entry.slice->rtmax);
+    for (long c = rtCellMin; c < entry.rtCellMin; c++)
+        _cells[_cellKey(entry.mzBin, c)].push_back(handle);
+    for (long c = entry.rtCellMax + 1; c <= rtCellMax; c++)
+        _cells[_cellKey(entry.mzBin, c)].push_back(handle);
+    entry.rtCellMin = std::min(entry.rtCellMin, rtCellMin);
+    entry.rtCellMax = std::max(entry.rtCellMax, rtCellMax);
 }
 
 void MassSlices::algorithmC(float ppm, float minIntensity, float rtWindow) {
@@ -235,44 +379,46 @@ void MassSlices::removeDuplicateSlices(MassCutoff *massCutoff, float threshold){
 
     vector<mzSlice*> returnSlices;
     mzSlice* slice;
-    multimap<int,int>vectorCache;
+    // indices of returned slices, binned by m/z in 0.1 Da bins
+    unordered_map<int, vector<int> > vectorCache;
     
    for(int i=0; i<slices.size(); i++) {
         slice = slices[i];
         float mz = slice->mz;
-        multimap<int, int>::iterator start, end;
         
-        start = vectorCache.equal_range( (int) (mz* 10 - 1) ).first;
-        end = vectorCache.equal_range( (int) (mz* 10 + 1) ).second;
         float mzOverlap =  0.0;
         float rtOverlap = 0.0;
         float overlapArea, bestOverlapArea = 0.0;
         int bestSliceNum = -1;
 
-        for(; start != end; start++) {
-            int thisSliceNum = (*start).second;
-            mzSlice *thisSlice = returnSlices[thisSliceNum];
+        // look at slices from this and the neighbouring bins, lowest bin first
+        for(int bin = (int) (mz* 10 - 1); bin <= (int) (mz* 10 + 1); bin++) {
+            auto binSlices = vectorCache.find(bin);
+            if (binSlices == vectorCache.end()) continue;
 
-            float low = thisSlice->mzmin > slice->mzmin ? thisSlice->mzmin : slice->mzmin;
-            float high = thisSlice->mzmax < slice->mzmax ? thisSlice->mzmax : slice->mzmax;
-            mzOverlap = high-low;
+            for(int thisSliceNum : binSlices->second) {
+                mzSlice *thisSlice = returnSlices[thisSliceNum];
 
-            low = thisSlice->rtmin > slice->rtmin ? thisSlice->rtmin : slice->rtmin;
-            high = thisSlice->rtmax < slice->rtmax ? thisSlice->rtmax : slice->rtmax;
-            rtOverlap = high-low;
+                float low = thisSlice->mzmin > slice->mzmin ? thisSlice->mzmin : slice->mzmin;
+                float high = thisSlice->mzmax < slice->mzmax ? thisSlice->mzmax : slice->mzmax;
+                mzOverlap = high-low;
 
-            if(mzOverlap>0 && rtOverlap>0) overlapArea = mzOverlap * rtOverlap;
-            else overlapArea = 0;
+                low = thisSlice->rtmin > slice->rtmin ? thisSlice->rtmin : slice->rtmin;
+                high = thisSlice->rtmax < slice->rtmax ? thisSlice->rtmax : slice->rtmax;
+                rtOverlap = high-low;
 
-            float area1 = (thisSlice->mzmax-thisSlice->mzmin) * (thisSlice->rtmax-thisSlice->rtmin);
-            float area2 = (slice->mzmax-slice->mzmin) * (slice->rtmax-slice->rtmin);
-            float area = area1 < area2 ? area1 : area2;
+                if(mzOverlap>0 && rtOverlap>0) overlapArea = mzOverlap * rtOverlap;
+                else overlapArea = 0;
 
-            if (overlapArea/area >= threshold/100 && overlapArea > bestOverlapArea){
-                bestOverlapArea = overlapArea;
-                bestSliceNum = thisSliceNum;
+                float area1 = (thisSlice->mzmax-thisSlice->mzmin) * (thisSlice->rtmax-thisSlice->rtmin);
+                float area2 = (slice->mzmax-slice->mzmin) * (slice->rtmax-slice->rtmin);
+                float area = area1 < area2 ? area1 : area2;
+
+                if (overlapArea/area >= threshold/100 && overlapArea > bestOverlapArea){
+                    bestOverlapArea = overlapArea;
+                    bestSliceNum = thisSliceNum;
+                }
             }
-            
         }
 
         if(bestSliceNum >= 0){
@@ -285,12 +431,13 @@ void MassSlices::removeDuplicateSlices(MassCutoff *massCutoff, float threshold){
             Z->mzmin = std::min((float)Z->mzmin, (float)slice->mzmin);
 
             //make sure that mz windown doesn't get out of control
-            if (Z->mzmin < mz-massCutoff->massCutoffValue(mz)) Z->mzmin =  mz-massCutoff->massCutoffValue(mz);
-            if (Z->mzmax > mz+massCutoff->massCutoffValue(mz)) Z->mzmax =  mz+massCutoff->massCutoffValue(mz);
+            double cutoff = massCutoff->massCutoffValue(mz);
+            if (Z->mzmin < mz-cutoff) Z->mzmin =  mz-cutoff;
+            if (Z->mzmax > mz+cutoff) Z->mzmax =  mz+cutoff;
             Z->mz = (Z->mzmin + Z->mzmax) / 2; Z->rt=(Z->rtmin + Z->rtmax) / 2;
         }
         else{
-            vectorCache.insert(pair<int,int>(int (mz*10),returnSlices.size()));
+            vectorCache[int (mz*10)].push_back(returnSlices.size());
             returnSlices.push_back(slice);
         }
     }
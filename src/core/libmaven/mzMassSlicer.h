@@ -7,6 +7,7 @@
 #include "Matrix.h"
 
 #include <omp.h>
+#include <unordered_map>
 
 
 #include <boost/signals2.hpp>
@@ -15,6 +16,69 @@
 class mzSample;
 using namespace std;
 
+/**
+ * @class MassSliceGrid
+ * @ingroup libmaven
+ * @brief Hash grid over the m/z x RT plane for finding slices containing a
+ * point.
+ * @details A slice is registered in the m/z bin (0.1 Da wide) of the m/z it
+ * was created at and in every RT cell its RT range covers. Point queries only
+ * look at slices from a single grid cell.
+ */
+class MassSliceGrid {
+
+    public:
+        /**
+         * @brief Constructor for class MassSliceGrid
+         * @param rtCellWidth Width of each RT cell
+         */
+        MassSliceGrid(float rtCellWidth);
+
+        /**
+         * @brief Find the narrowest slice containing a point
+         * @details Of equally narrow slices, the one inserted first is
+         * returned.
+         * @param mz m/z of the point
+         * @param rt RT of the point
+         * @return Handle of the slice found or -1 if none contains the point
+         */
+        int find(float mz, float rt) const;
+
+        /**
+         * @brief Register a new slice in the grid
+         * @param slice Slice to be registered
+         * @return Handle of the registered slice
+         */
+        int insert(mzSlice* slice);
+
+        /**
+         * @brief Register a slice in RT cells its RT range has grown into
+         * @param handle Handle of a slice whose RT bounds were widened
+         */
+        void extend(int handle);
+
+        /**
+         * @brief Get a registered slice
+         * @param handle Handle of the slice
+         */
+        mzSlice* slice(int handle) const { return _entries[handle].slice; }
+
+    private:
+        struct Entry {
+            mzSlice* slice;
+            int mzBin;
+            long rtCellMin;
+            long rtCellMax;
+        };
+
+        float _rtCellWidth;
+        vector<Entry> _entries;
+        unordered_map<long long, vector<int> > _cells;
+
+        long _rtCell(float rt) const;
+        long long _cellKey(int mzBin, long rtCell) const;
+};
+
 /**
  * @class MassSlices
  * @ingroup libmaven
@@ -65,6 +129,20 @@ class MassSlices {
          */
         void algorithmB( MassCutoff *massCutoff, int step);
 
+        /**
+         * @brief AlgorithmB with the m/z window computed by a tolerance policy
+         * @details Instantiated for masstolerance::Ppm, masstolerance::MDa
+         * and masstolerance::Dynamic. algorithmB(MassCutoff*, int) picks the
+         * policy matching the unit of the mass cutoff.
+         * @param massCutoff Mass cutoff used for charges and duplicate removal
+         * @param tolerance Tolerance policy expressing the same mass cutoff
+         * @param rtStep Minimum RT range for RT window
+         */
+        template<class Tolerance>
+        void algorithmB(MassCutoff *massCutoff,
+                        const Tolerance& tolerance,
+                        int rtStep);
+
 
         void algorithmC(float ppm, float minIntensity, float rtStep);
         /**
@@ -94,6 +172,59 @@ class MassSlices {
         void stopSlicing();
 
     private:
+        /**
+         * @brief An MS1 observation that passed the filters, with its m/z
+         * window
+         */
+        struct SlicePoint {
+            float mz;
+            float mzmin;
+            float mzmax;
+            float rt;
+            float intensity;
+        };
+
+        /**
+         * @brief Observations of one sample to be sliced, scan after scan
+         */
+        struct SamplePoints {
+            vector<SlicePoint> points;
+            // points of the i-th MS1 scan end at scanEnds[i]
+            vector<size_t> scanEnds;
+        };
+
+        /**
+         * @brief Collect the MS1 observations of a sample that pass the m/z,
+         * RT, intensity and charge filters
+         * @details Only reads the sample, so that samples can be collected
+         * concurrently.
+         * @param sample Sample whose observations will be collected
+         * @param tolerance Tolerance policy giving the m/z window
+         * @param samplePoints Filled with the observations, scan after scan
+         */
+        template<class Tolerance>
+        void _collectPoints(mzSample* sample,
+                            const Tolerance& tolerance,
+                            SamplePoints& samplePoints);
+
+        /**
+         * @brief Slice the observations of a sample
+         * @details Observations are merged into an existing slice if one
+         * contains them, otherwise a new slice is created around them and
+         * added to the slices. Stops once more than the maximum number of
+         * slices were created.
+         * @param samplePoints Observations collected by _collectPoints
+         * @param rtWindow Half of the RT margin around each observation
+         * @param grid Grid of the slices created so far
+         * @param processedScans Number of scans processed so far
+         * @param totalScans Number of scans to be processed in all samples
+         */
+        void _slicePoints(const SamplePoints& samplePoints,
+                          float rtWindow,
+                          MassSliceGrid& grid,
+                          int& processedScans,
+                          int totalScans);
+
         unsigned int _maxSlices;
         float _minRt;
         float _maxRt;
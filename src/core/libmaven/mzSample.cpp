@@ -1,13 +1,18 @@
 #include "mzSample.h"
+#include "samplecache.h"
 
 #include <MavenException.h>
+#include <mutex>
+#include "xmlStreamReader.h"
 
 //global options
-int mzSample::filter_minIntensity = -1;
-bool mzSample::filter_centroidScans = false;
-int mzSample::filter_intensityQuantile = 0;
-int mzSample::filter_polarity = 0;
-int mzSample::filter_mslevel = 0;
+atomic<int> mzSample::filter_minIntensity(-1);
+atomic<bool> mzSample::filter_centroidScans(false);
+atomic<int> mzSample::filter_intensityQuantile(0);
+atomic<int> mzSample::filter_polarity(0);
+atomic<int> mzSample::filter_mslevel(0);
+atomic<bool> mzSample::_lazyFragmentationScans(false);
+atomic<unsigned int> mzSample::_scanPeaksCacheSize(2000);
 
 mzSample::mzSample()
     : _setName(""),
@@ -16,6 +21,15 @@ mzSample::mzSample()
     _id = -1;
     _numMS1Scans = 0;
     _numMS2Scans = 0;
+    _indexedScanCount = 0;
+    _hasReleasedScanPeaks = false;
+    _peakFilterCentroidScans = false;
+    _peakFilterIntensityQuantile = 0;
+    _peakFilterMinIntensity = 0;
+    _streamReader = NULL;
+    _streamElementOffset = 0;
+    _ms1ColumnsBuilt = false;
+    _srmScansEnumerated = false;
         maxMz = maxRt = 0;
 	minMz = minRt = 0;
 	isBlank = false;
@@ -50,39 +64,48 @@ void mzSample::addScan(Scan *s)
 	if (!s)
 		return;
 
+	//filters are read once, they may be changed while samples are loading
+	int mslevel = mzSample::filter_mslevel;
+	int polarity = mzSample::filter_polarity;
+	bool centroidScans = mzSample::filter_centroidScans;
+	int intensityQuantile = mzSample::filter_intensityQuantile;
+	int minIntensity = mzSample::filter_minIntensity;
+
 	//skip scans that do not match mslevel
-	if (mzSample::filter_mslevel and s->mslevel != mzSample::filter_mslevel)
+	if (mslevel and s->mslevel != mslevel)
         return;
 	//skip scans that do not match polarity
-	if (mzSample::filter_polarity and s->getPolarity() != mzSample::filter_polarity)
+	if (polarity and s->getPolarity() != polarity)
         return;
 
-	//unsigned int sizeBefore = s->intensity.size();
-	if (mzSample::filter_centroidScans == true)
+	_filterScanPeaks(s, centroidScans, intensityQuantile, minIntensity);
+
+        if (s->mslevel == 1) ++_numMS1Scans;
+        if (s->mslevel == 2) ++_numMS2Scans;
+
+        scans.push_back(s);
+        s->scannum = scans.size() - 1;
+}
+
+void mzSample::_filterScanPeaks(Scan *s,
+								bool centroidScans,
+								int intensityQuantile,
+								int minIntensity)
+{
+	if (centroidScans == true)
 	{
 		s->simpleCentroid();
 	}
 
-	//unsigned int sizeAfter1 = s->intensity.size();
-
-	if (mzSample::filter_intensityQuantile > 0)
+	if (intensityQuantile > 0)
 	{
-		s->quantileFilter(mzSample::filter_intensityQuantile);
+		s->quantileFilter(intensityQuantile);
 	}
-	//unsigned int sizeAfter2 = s->intensity.size();
 
-	if (mzSample::filter_minIntensity > 0)
+	if (minIntensity > 0)
 	{
-		s->intensityFilter(mzSample::filter_minIntensity);
+		s->intensityFilter(minIntensity);
 	}
-	//unsigned int sizeAfter3 = s->intensity.size();
-        //cerr << "addScan " << sizeBefore <<  " " << sizeAfter1 << " " << sizeAfter2 << " " << sizeAfter3 << endl;
-
-        if (s->mslevel == 1) ++_numMS1Scans;
-        if (s->mslevel == 2) ++_numMS2Scans;
-
-        scans.push_back(s);
-        s->scannum = scans.size() - 1;
 }
 
 string mzSample::getFileName(const string &filename)
@@ -131,6 +154,9 @@ void mzSample::loadAnySample(const char *filename)
 	{
 		parseMzData(filename);
 	}
+
+	//decode buffers are only needed while reading the file
+	_decodeBuffer = base64::DecodeBuffer();
 }
 
 void mzSample::sampleNaming(const char *filename)
@@ -159,17 +185,36 @@ void mzSample::checkSampleBlank(const char *filename)
 void mzSample::loadSample(const char *filename)
 {
 
-	//Loading and Decoding the file
-    //catch any error while parsing
-    try {
+	//values of fragmentation scans read again later are filtered the same way
+	_peakFilterCentroidScans = mzSample::filter_centroidScans;
+	_peakFilterIntensityQuantile = mzSample::filter_intensityQuantile;
+	_peakFilterMinIntensity = mzSample::filter_minIntensity;
 
-        loadAnySample(filename);
-    }
+	//Loading from the binary cache of the file if caching is enabled and the
+	//cache is up to date, otherwise decoding the file and caching its scans
+	bool useCache = SampleCache::isEnabled();
+	if (!useCache || !SampleCache::read(this, filename))
+	{
+		//catch any error while parsing
+		bool parsed = false;
+		try {
 
-    catch(MavenException& excp) {
-        cerr << endl << "Error: " << excp.what() << endl;
-    }
+			loadAnySample(filename);
+			parsed = true;
+		}
 
+		catch(MavenException& excp) {
+			cerr << endl << "Error: " << excp.what() << endl;
+		}
+
+		if (useCache && parsed && !scans.empty())
+			SampleCache::write(this, filename);
+	}
+
+
+	//build per-MS-level scan views used for EIC extraction and intern
+	//filterlines
+	indexScans();
 
 	//getting the SRM scan type
 	enumerateSRMScans();
@@ -182,6 +227,11 @@ void mzSample::loadSample(const char *filename)
 
 	//Checking if a sample is blank or not
 	checkSampleBlank(filename);
+
+	//only metadata of fragmentation scans is kept, their values are read
+	//again when needed
+	if (_lazyFragmentationScans)
+		releaseFragmentationScanPeaks();
 }
 
 void mzSample::parseMzCSV(const char *filename)
@@ -275,6 +325,7 @@ void mzSample::writeMzCSV(const char *filename)
 	for (unsigned int i = 0; i < scans.size(); i++)
 	{
 		Scan *scan = scans[i];
+		ScanPeaksPin pin(scan);
 		for (unsigned int j = 0; j < scan->nobs(); j++)
 		{
 			mzCSV << scan->scannum + 1 << ","
@@ -296,6 +347,88 @@ int mzSample::getPolarity()
 	return 0;
 }
 void mzSample::parseMzML(const char *filename)
+{
+	XmlStreamReader reader;
+	if (!reader.open(filename))
+	{
+		throw MavenException(ErrorMsg::ParsemzMl);
+	}
+
+	if (!reader.isStreamable())
+	{
+		parseMzMLDocument(filename);
+		return;
+	}
+
+	//only one spectrum or chromatogram is loaded at a time, scans are built
+	//as soon as their element has been read
+	vector<string> elements;
+	elements.push_back("run");
+	elements.push_back("spectrumList");
+	elements.push_back("spectrum");
+	elements.push_back("chromatogramList");
+	elements.push_back("chromatogram");
+
+	xml_document doc;
+	string element;
+	bool runFound = false;
+	bool spectrumListFound = false;
+	bool chromatogramsParsed = false;
+	int scannum = 0;
+	_streamReader = &reader;
+
+	while (reader.nextElement(elements, element))
+	{
+		bool parsed = true;
+		_streamElementOffset = reader.offset();
+		if (element == "run")
+		{
+			parsed = reader.readStartTag(doc);
+			//Get injection time stamp
+			if (parsed && !runFound)
+				parseMzMLInjectionTimeStamp(doc.first_child().attribute("startTimeStamp"));
+			runFound = true;
+		}
+		else if (element == "spectrumList" || element == "chromatogramList")
+		{
+			if (element == "spectrumList")
+				spectrumListFound = true;
+			parsed = reader.readStartTag(doc);
+		}
+		else if (element == "spectrum")
+		{
+			parsed = reader.readElement(doc);
+			if (parsed)
+				parseMzMLSpectrum(doc.first_child(), scannum);
+		}
+		else if (spectrumListFound)
+		{
+			//chromatograms are only used if there are no spectra
+			parsed = reader.skipElement();
+		}
+		else
+		{
+			parsed = reader.readElement(doc);
+			if (parsed)
+			{
+				parseMzMLChromatogram(doc.first_child(), scannum);
+				chromatogramsParsed = true;
+			}
+		}
+
+		if (!parsed)
+		{
+			_streamReader = NULL;
+			throw MavenException(ErrorMsg::ParsemzMl);
+		}
+	}
+	_streamReader = NULL;
+
+	if (chromatogramsParsed)
+		renumberScansByRt();
+}
+
+void mzSample::parseMzMLDocument(const char *filename)
 {
 	xml_document doc;
 
@@ -351,66 +484,68 @@ void mzSample::parseMzMLChromatogramList(const xml_node &chromatogramList)
 	for (xml_node chromatogram = chromatogramList.child("chromatogram");
 		 chromatogram; chromatogram = chromatogram.next_sibling("chromatogram"))
 	{
+		parseMzMLChromatogram(chromatogram, scannum);
+	}
 
-		string chromatogramId = chromatogram.attribute("id").value();
-		int sampleNo = getSampleNoChromatogram(chromatogramId);
-
-        filterChromatogramId(chromatogramId);
+	renumberScansByRt();
+}
 
-		vector<float> timeVector;
-		vector<float> intsVector;
+void mzSample::parseMzMLChromatogram(const xml_node &chromatogram, int &scannum)
+{
+	string chromatogramId = chromatogram.attribute("id").value();
+	int sampleNo = getSampleNoChromatogram(chromatogramId);
 
-		xml_node binaryDataArrayList = chromatogram.child("binaryDataArrayList");
-		string precursorMzStr = chromatogram.first_element_by_path("precursor/isolationWindow/cvParam").attribute("value").value();
-		string productMzStr = chromatogram.first_element_by_path("product/isolationWindow/cvParam").attribute("value").value();
-		float precursorMz = string2float(precursorMzStr);
-		float productMz = string2float(productMzStr);
-		// int mslevel=2;
+        filterChromatogramId(chromatogramId);
 
-		for (xml_node binaryDataArray = binaryDataArrayList.child("binaryDataArray");
-			 binaryDataArray; binaryDataArray = binaryDataArray.next_sibling("binaryDataArray"))
-		{
-			map<string, string> attr = mzML_cvParams(binaryDataArray);
+	vector<float> timeVector;
+	vector<float> intsVector;
 
-			int precision = 64;
-			if (attr.count("32-bit float"))
-				precision = 32;
+	size_t arrayLength = chromatogram.attribute("defaultArrayLength").as_uint();
+	xml_node binaryDataArrayList = chromatogram.child("binaryDataArrayList");
+	string precursorMzStr = chromatogram.first_element_by_path("precursor/isolationWindow/cvParam").attribute("value").value();
+	string productMzStr = chromatogram.first_element_by_path("product/isolationWindow/cvParam").attribute("value").value();
+	float precursorMz = string2float(precursorMzStr);
+	float productMz = string2float(productMzStr);
+	// int mslevel=2;
 
-			string binaryDataStr = binaryDataArray.child("binary").child_value();
-			vector<float> binaryData = base64::decode_base64(
-				binaryDataStr, precision / 8, false, false);
+	for (xml_node binaryDataArray = binaryDataArrayList.child("binaryDataArray");
+		 binaryDataArray; binaryDataArray = binaryDataArray.next_sibling("binaryDataArray"))
+	{
+		map<string, string> attr = mzML_cvParams(binaryDataArray);
 
-			if (attr.count("time array"))
-			{
-				timeVector = binaryData;
-			}
-			if (attr.count("intensity array"))
-			{
-				intsVector = binaryData;
-			}
+		if (attr.count("time array"))
+		{
+			decodeMzMLBinaryArray(binaryDataArray, attr, arrayLength, timeVector);
 		}
+		if (attr.count("intensity array"))
+		{
+			decodeMzMLBinaryArray(binaryDataArray, attr, arrayLength, intsVector);
+		}
+	}
 
 	//	cerr << chromatogramId << endl;
 	//	cerr << timeVector.size() << " ints=" << intsVector.size() << endl;
 	//	cerr << "pre: " << precursorMz << " prod=" << productMz << endl;
 
-		// if (precursorMz and precursorMz ) {
-		if (precursorMz)
-		{					 //naman Same expression on both sides of '&&'.
-			int mslevel = 2; //naman The scope of the variable 'mslevel' can be reduced.
-			for (unsigned int i = 0; i < timeVector.size(); i++)
-			{
-				Scan *scan = new Scan(this, scannum++, mslevel, timeVector[i], precursorMz, -1);
-				scan->productMz = productMz;
-				scan->mz.push_back(productMz);
-				scan->filterLine = chromatogramId;
-				sampleNumber = sampleNo;
-				scan->intensity.push_back(intsVector[i]);
-				addScan(scan);
-			}
+	// if (precursorMz and precursorMz ) {
+	if (precursorMz)
+	{					 //naman Same expression on both sides of '&&'.
+		int mslevel = 2; //naman The scope of the variable 'mslevel' can be reduced.
+		for (unsigned int i = 0; i < timeVector.size(); i++)
+		{
+			Scan *scan = new Scan(this, scannum++, mslevel, timeVector[i], precursorMz, -1);
+			scan->productMz = productMz;
+			scan->mz.push_back(productMz);
+			scan->filterLine = chromatogramId;
+			sampleNumber = sampleNo;
+			scan->intensity.push_back(intsVector[i]);
+			addScan(scan);
 		}
 	}
+}
 
+void mzSample::renumberScansByRt()
+{
 	//renumber scans based on retention time
 	std::sort(scans.begin(), scans.end(), Scan::compRt);
 	for (unsigned int i = 0; i < scans.size(); i++)
@@ -456,102 +591,146 @@ void mzSample::parseMzMLSpectrumList(const xml_node &spectrumList)
 	for (xml_node spectrum = spectrumList.child("spectrum");
 		 spectrum; spectrum = spectrum.next_sibling("spectrum"))
 	{
-		string spectrumId = spectrum.attribute("id").value();
-		cerr << "Processing: " << spectrumId << endl;
+		parseMzMLSpectrum(spectrum, scannum);
+	}
+}
 
-		if (spectrum.empty())
-			continue;
-		map<string, string> cvParams = mzML_cvParams(spectrum);
+void mzSample::parseMzMLSpectrum(const xml_node &spectrum, int &scannum)
+{
+	string spectrumId = spectrum.attribute("id").value();
+	cerr << "Processing: " << spectrumId << endl;
 
-		int mslevel = 1;
-		int scanpolarity = 0;
-		float rt = 0;
-		vector<float> mzVector;
-		vector<float> intsVector;
+	if (spectrum.empty())
+		return;
+	map<string, string> cvParams = mzML_cvParams(spectrum);
 
-		if (cvParams.count("ms level"))
-		{
-			string msLevelStr = cvParams["ms level"];
-			mslevel = (int)string2float(msLevelStr);
-		}
+	int mslevel = 1;
+	int scanpolarity = 0;
+	float rt = 0;
+	vector<float> mzVector;
+	vector<float> intsVector;
 
-		if (cvParams.count("positive scan"))
-			scanpolarity = 1;
-		else if (cvParams.count("negative scan"))
-			scanpolarity = -1;
-		else
-			scanpolarity = 0;
+	if (cvParams.count("ms level"))
+	{
+		string msLevelStr = cvParams["ms level"];
+		mslevel = (int)string2float(msLevelStr);
+	}
 
-		xml_node scanNode = spectrum.first_element_by_path("scanList/scan");
-		map<string, string> scanAttr = mzML_cvParams(scanNode);
-		if (scanAttr.count("scan start time"))
-		{
-			string rtStr = scanAttr["scan start time"];
-			rt = string2float(rtStr);
-		}
+	if (cvParams.count("positive scan"))
+		scanpolarity = 1;
+	else if (cvParams.count("negative scan"))
+		scanpolarity = -1;
+	else
+		scanpolarity = 0;
 
-		map<string, string> isolationWindow = mzML_cvParams(spectrum.first_element_by_path("precursorList/precursor/isolationWindow"));
-		string precursorMzStr = isolationWindow["isolation window target m/z"];
-		float precursorMz = 0;
-		if (string2float(precursorMzStr) > 0)
-			precursorMz = string2float(precursorMzStr);
+	xml_node scanNode = spectrum.first_element_by_path("scanList/scan");
+	map<string, string> scanAttr = mzML_cvParams(scanNode);
+	if (scanAttr.count("scan start time"))
+	{
+		string rtStr = scanAttr["scan start time"];
+		rt = string2float(rtStr);
+	}
+
+	map<string, string> isolationWindow = mzML_cvParams(spectrum.first_element_by_path("precursorList/precursor/isolationWindow"));
+	string precursorMzStr = isolationWindow["isolation window target m/z"];
+	float precursorMz = 0;
+	if (string2float(precursorMzStr) > 0)
+		precursorMz = string2float(precursorMzStr);
 
         string precursorIsolationStrLower = isolationWindow["isolation window lower offset"];
         string precursorIsolationStrUpper = isolationWindow["isolation window upper offset"];
-		
-		float precursorIsolationWindow = 0.0f;
-		if (string2float(precursorIsolationStrLower) > 0.0f)
-			precursorIsolationWindow += string2float(precursorIsolationStrLower);
+	
+	float precursorIsolationWindow = 0.0f;
+	if (string2float(precursorIsolationStrLower) > 0.0f)
+		precursorIsolationWindow += string2float(precursorIsolationStrLower);
         if (string2float(precursorIsolationStrUpper) > 0.0f)
             precursorIsolationWindow += string2float(precursorIsolationStrUpper);
         if (precursorIsolationWindow <= 0.0f) precursorIsolationWindow = 1.0f;
 
-		string productMzStr = spectrum.first_element_by_path("product/isolationWindow/cvParam").attribute("value").value();
-		float productMz = 0;
-		if (string2float(productMzStr) > 0)
-			productMz = string2float(productMzStr);
+	string productMzStr = spectrum.first_element_by_path("product/isolationWindow/cvParam").attribute("value").value();
+	float productMz = 0;
+	if (string2float(productMzStr) > 0)
+		productMz = string2float(productMzStr);
 
-		xml_node binaryDataArrayList = spectrum.child("binaryDataArrayList");
-		if (!binaryDataArrayList or binaryDataArrayList.empty())
-			continue;
+	if (!parseMzMLSpectrumPeaks(spectrum, mzVector, intsVector))
+		return;
 
-		for (xml_node binaryDataArray = binaryDataArrayList.child("binaryDataArray");
-			 binaryDataArray; binaryDataArray = binaryDataArray.next_sibling("binaryDataArray"))
-		{
-			if (!binaryDataArray or binaryDataArray.empty())
-				continue;
+	cerr << " scan=" << scannum << "\tms=" << mslevel << "\tprecMz" << precursorMz << "\t rt=" << rt << endl;
+	Scan *scan = new Scan(this, scannum++, mslevel, rt, precursorMz, scanpolarity);
+	scan->isolationWindow = precursorIsolationWindow;
+	scan->productMz = productMz;
+	scan->filterLine = spectrumId;
+	scan->intensity.swap(intsVector);
+	scan->mz.swap(mzVector);
+	addScan(scan);
+	_recordFileSeek(spectrum, scan);
+}
 
-			map<string, string> attr = mzML_cvParams(binaryDataArray);
+bool mzSample::parseMzMLSpectrumPeaks(const xml_node &spectrum,
+									  vector<float> &mzVector,
+									  vector<float> &intsVector)
+{
+	size_t arrayLength = spectrum.attribute("defaultArrayLength").as_uint();
+	xml_node binaryDataArrayList = spectrum.child("binaryDataArrayList");
+	if (!binaryDataArrayList or binaryDataArrayList.empty())
+		return false;
 
-			int precision = 64;
-			if (attr.count("32-bit float"))
-				precision = 32;
+	for (xml_node binaryDataArray = binaryDataArrayList.child("binaryDataArray");
+		 binaryDataArray; binaryDataArray = binaryDataArray.next_sibling("binaryDataArray"))
+	{
+		if (!binaryDataArray or binaryDataArray.empty())
+			continue;
 
-			string binaryDataStr = binaryDataArray.child("binary").child_value();
-			if (!binaryDataStr.empty())
-			{
-				vector<float> binaryData = base64::decode_base64(
-					binaryDataStr, precision / 8, false, false);
-				if (attr.count("m/z array"))
-				{
-					mzVector = binaryData;
-				}
-				if (attr.count("intensity array"))
-				{
-					intsVector = binaryData;
-				}
-			}
+		map<string, string> attr = mzML_cvParams(binaryDataArray);
+
+		if (attr.count("m/z array"))
+		{
+			decodeMzMLBinaryArray(binaryDataArray, attr, arrayLength, mzVector);
 		}
+		if (attr.count("intensity array"))
+		{
+			decodeMzMLBinaryArray(binaryDataArray, attr, arrayLength, intsVector);
+		}
+	}
+	return true;
+}
 
-		cerr << " scan=" << scannum << "\tms=" << mslevel << "\tprecMz" << precursorMz << "\t rt=" << rt << endl;
-		Scan *scan = new Scan(this, scannum++, mslevel, rt, precursorMz, scanpolarity);
-		scan->isolationWindow = precursorIsolationWindow;
-		scan->productMz = productMz;
-		scan->filterLine = spectrumId;
-		scan->intensity = intsVector;
-		scan->mz = mzVector;
-		addScan(scan);
+bool mzSample::decodeMzMLBinaryArray(const xml_node &binaryDataArray,
+									 const map<string, string> &attr,
+									 size_t count,
+									 vector<float> &values)
+{
+	base64::BinaryFormat format;
+	format.count = count;
+
+	format.float_size = 8;
+	if (attr.count("32-bit float"))
+		format.float_size = 4;
+
+	//msconvert writes numpress arrays either as they are or followed by zlib
+	//compression, in which case both are named in a single term
+	const string numpress = "MS-Numpress ";
+	for (map<string, string>::const_iterator it = attr.begin(); it != attr.end(); ++it)
+	{
+		const string &name = it->first;
+		if (name == "zlib compression")
+			format.zlib = true;
+		if (name.compare(0, numpress.size(), numpress) != 0)
+			continue;
+
+		if (name.find("linear prediction") != string::npos)
+			format.numpress = base64::Numpress::Linear;
+		else if (name.find("positive integer") != string::npos)
+			format.numpress = base64::Numpress::Pic;
+		else if (name.find("short logged float") != string::npos)
+			format.numpress = base64::Numpress::Slof;
+		if (name.find("followed by zlib") != string::npos)
+			format.zlib = true;
 	}
+
+	xml_node binary = binaryDataArray.child("binary");
+	const char *text = binary.child_value();
+	return base64::decodeBinaryArray(text, strlen(text), format, values, _decodeBuffer);
 }
 
 map<string, string> mzSample::mzML_cvParams(xml_node node)
@@ -725,25 +904,99 @@ void mzSample::parseMzXMLData(const xml_node& spectrumstore)
 	int scannum = 0;
 
 	for (xml_node scan = spectrumstore.child("scan"); scan; scan = scan.next_sibling("scan"))
+	{
+		parseMzXMLScanTree(scan, scannum);
+	}
+}
+
+void mzSample::parseMzXMLScanTree(const xml_node &scan, int &scannum)
+{
+	scannum++;
+	if (strncasecmp(scan.name(), "scan", 4) == 0)
+	{
+		parseMzXMLScan(scan, scannum);
+	}
+
+	for (xml_node child = scan.first_child(); child; child = child.next_sibling())
 	{
 		scannum++;
-		if (strncasecmp(scan.name(), "scan", 4) == 0)
+		if (strncasecmp(child.name(), "scan", 4) == 0)
 		{
-			parseMzXMLScan(scan, scannum);
+			parseMzXMLScan(child, scannum);
 		}
+	}
+}
+
+void mzSample::parseMzXML(const char *filename)
+{
+	XmlStreamReader reader;
+	if (!reader.open(filename))
+	{
+		cerr << "Failed to load " << filename << endl;
+		throw MavenException(ErrorMsg::ParsemzXml);
+	}
 
-		for (xml_node child = scan.first_child(); child; child = child.next_sibling())
+	if (!reader.isStreamable())
+	{
+		parseMzXMLDocument(filename);
+		return;
+	}
+
+	//top level scans (along with the scans nested in them) are loaded one
+	//at a time, scans are built as soon as their element has been read
+	vector<string> elements;
+	elements.push_back("msRun");
+	elements.push_back("msInstrument");
+	elements.push_back("scan");
+
+	xml_document doc;
+	string element;
+	bool spectrumstoreFound = false;
+	int scannum = 0;
+	_streamReader = &reader;
+
+	while (reader.nextElement(elements, element))
+	{
+		bool parsed = true;
+		_streamElementOffset = reader.offset();
+		if (element == "msRun")
 		{
-			scannum++;
-			if (strncasecmp(child.name(), "scan", 4) == 0)
-			{
-				parseMzXMLScan(child, scannum);
-			}
+			spectrumstoreFound = true;
+			parsed = reader.readStartTag(doc);
+		}
+		else if (element == "msInstrument")
+		{
+			//Setting the instrument related information
+			parsed = reader.readElement(doc);
+			if (parsed)
+				setInstrumentSettigs(doc, doc);
+		}
+		else
+		{
+			spectrumstoreFound = true;
+			parsed = reader.readElement(doc);
+			//parse mzXML information from the scan
+			if (parsed)
+				parseMzXMLScanTree(doc.first_child(), scannum);
+		}
+
+		if (!parsed)
+		{
+			_streamReader = NULL;
+			cerr << "Failed to load " << filename << endl;
+			throw MavenException(ErrorMsg::ParsemzXml);
 		}
 	}
+	_streamReader = NULL;
+
+	if (!spectrumstoreFound)
+	{
+		cerr << "parseMzXML: can't find <msRun> or <scan> section" << endl;
+		throw MavenException(ErrorMsg::ParsemzXml);
+	}
 }
 
-void mzSample::parseMzXML(const char *filename)
+void mzSample::parseMzXMLDocument(const char *filename)
 {
 	xml_document doc;
 
@@ -831,14 +1084,13 @@ vector<float> mzSample::parsePeaksFromMzXML(const xml_node &scan)
 
 	if (!peaks.empty())
 	{
-		string b64String(peaks.child_value());
+		const char *b64String = peaks.child_value();
 
 		//no m/z intensity values
-		if (b64String.empty())
+		if (*b64String == 0)
 			return mzint;
 
 		bool decompress = false;
-#ifdef ZLIB
 		// if the data is been compressed in zlib format this part will
 		// take care.
 		if (strncasecmp(peaks.attribute("compressionType").value(), "zlib",
@@ -846,7 +1098,6 @@ vector<float> mzSample::parsePeaksFromMzXML(const xml_node &scan)
 		{
 			decompress = true;
 		}
-#endif
 
 		bool networkorder = false; // naman The scope of the variable
 								   // 'networkorder' can be reduced.
@@ -866,8 +1117,13 @@ vector<float> mzSample::parsePeaksFromMzXML(const xml_node &scan)
 		// cerr << "new scan=" << scannum << " msL=" << msLevel << " rt=" << rt << " precMz=" << precursorMz << " polar=" << scanpolarity
 		//    << " prec=" << precision << endl;
 
-		mzint = base64::decode_base64(b64String, precision / 8, networkorder,
-									  decompress);
+		base64::BinaryFormat format;
+		format.float_size = precision / 8;
+		format.networkorder = networkorder;
+		format.zlib = decompress;
+		format.count = 2 * scan.attribute("peaksCount").as_uint();
+		base64::decodeBinaryArray(b64String, strlen(b64String), format, mzint,
+								  _decodeBuffer);
 
 		return mzint;
 	}
@@ -1006,6 +1262,27 @@ void mzSample::parseMzXMLScan(const xml_node &scan, const int& scannum)
 	populateFilterline(filterLine, _scan);
 
 	addScan(_scan);
+	_recordFileSeek(scan, _scan);
+}
+
+void mzSample::_recordFileSeek(const xml_node &node, Scan *scan)
+{
+	//the scan may have been dropped by the scan filters
+	if (!_streamReader || scans.empty() || scans.back() != scan)
+		return;
+
+	//offsets of elements are the ones of their names, right after '<'
+	ptrdiff_t offset = node.offset_debug();
+	if (offset <= 0)
+		return;
+
+	uint64_t start = _streamElementOffset + offset - 1;
+	uint64_t end = _streamReader->offset();
+	if (start != _streamElementOffset && !_streamReader->elementEnd(start, end))
+		return;
+
+	scan->fileSeekStart = start;
+	scan->fileSeekEnd = end;
 }
 
 void mzSample::summary()
@@ -1135,14 +1412,172 @@ float mzSample::getAverageFullScanTime()
 
 void mzSample::enumerateSRMScans()
 {
+	_ensureScanIndex();
 	srmScans.clear();
-	for (unsigned int i = 0; i < scans.size(); i++)
+	for (unsigned int id = 0; id < _filterLines.size(); id++)
 	{
-		if (scans[i]->filterLine.length() > 0)
-		{
-			srmScans[scans[i]->filterLine].push_back(i);
-		}
+		const vector<unsigned int> &positions = _filterLineScanPositions[id];
+		srmScans[_filterLines[id]].assign(positions.begin(), positions.end());
 	}
+	_srmScansEnumerated = true;
+}
+
+void mzSample::indexScans()
+{
+    _msLevelScanViews.clear();
+    _fragmentationScanView.scans.clear();
+    _fragmentationScanView.positions.clear();
+    _filterLineIds.clear();
+    _filterLines.clear();
+    _filterLineScanPositions.clear();
+    _filterLineViewIndices.clear();
+
+    for (unsigned int i = 0; i < scans.size(); i++) {
+        Scan *scan = scans[i];
+        ScanView &view = _msLevelScanViews[scan->mslevel];
+
+        scan->filterLineId = -1;
+        if (!scan->filterLine.empty()) {
+            auto interned = _filterLineIds.insert(
+                make_pair(scan->filterLine, (int)_filterLines.size()));
+            if (interned.second) {
+                _filterLines.push_back(scan->filterLine);
+                _filterLineScanPositions.push_back(vector<unsigned int>());
+            }
+            scan->filterLineId = interned.first->second;
+            _filterLineScanPositions[scan->filterLineId].push_back(i);
+            _filterLineViewIndices[make_pair(scan->mslevel, scan->filterLineId)]
+                .push_back(view.scans.size());
+        }
+
+        view.scans.push_back(scan);
+        view.positions.push_back(i);
+
+        if (scan->mslevel > 1) {
+            _fragmentationScanView.scans.push_back(scan);
+            _fragmentationScanView.positions.push_back(i);
+        }
+    }
+    _indexedScanCount = scans.size();
+
+    invalidateMs1Columns();
+}
+
+void mzSample::_ensureScanIndex()
+{
+    if (_indexedScanCount != scans.size())
+        indexScans();
+}
+
+const vector<Scan *> &mzSample::scansForMsLevel(int mslevel)
+{
+    _ensureScanIndex();
+    auto view = _msLevelScanViews.find(mslevel);
+    if (view == _msLevelScanViews.end())
+        return _emptyScanView.scans;
+    return view->second.scans;
+}
+
+const vector<unsigned int> &mzSample::scanPositionsForMsLevel(int mslevel)
+{
+    _ensureScanIndex();
+    auto view = _msLevelScanViews.find(mslevel);
+    if (view == _msLevelScanViews.end())
+        return _emptyScanView.positions;
+    return view->second.positions;
+}
+
+const vector<Scan *> &mzSample::fragmentationScans()
+{
+    _ensureScanIndex();
+    return _fragmentationScanView.scans;
+}
+
+const vector<unsigned int> &mzSample::fragmentationScanPositions()
+{
+    _ensureScanIndex();
+    return _fragmentationScanView.positions;
+}
+
+int mzSample::filterLineId(const string &filterline)
+{
+    _ensureScanIndex();
+    auto id = _filterLineIds.find(filterline);
+    if (id == _filterLineIds.end())
+        return -1;
+    return id->second;
+}
+
+const vector<string> &mzSample::filterLines()
+{
+    _ensureScanIndex();
+    return _filterLines;
+}
+
+const vector<unsigned int> &mzSample::scanPositionsForFilterLine(int filterLineId)
+{
+    _ensureScanIndex();
+    if (filterLineId < 0 || filterLineId >= (int)_filterLines.size())
+        return _emptyScanView.positions;
+    return _filterLineScanPositions[filterLineId];
+}
+
+const vector<unsigned int> &mzSample::scanViewIndicesForFilterLine(int mslevel,
+                                                                   int filterLineId)
+{
+    _ensureScanIndex();
+    auto indices = _filterLineViewIndices.find(make_pair(mslevel, filterLineId));
+    if (indices == _filterLineViewIndices.end())
+        return _emptyScanView.positions;
+    return indices->second;
+}
+
+const SpectralColumns &mzSample::ms1Columns()
+{
+    _ensureScanIndex();
+    if (_ms1ColumnsBuilt.load(memory_order_acquire))
+        return _ms1Columns;
+
+    lock_guard<mutex> lock(_ms1ColumnsMutex);
+    if (_ms1ColumnsBuilt.load(memory_order_relaxed))
+        return _ms1Columns;
+
+    const vector<Scan *> &ms1Scans = _msLevelScanViews[1].scans;
+    size_t totalObs = 0;
+    for (auto scan : ms1Scans)
+        totalObs += scan->nobs();
+
+    _ms1Columns.mz.reserve(totalObs);
+    _ms1Columns.intensity.reserve(totalObs);
+    _ms1Columns.offsets.reserve(ms1Scans.size() + 1);
+    for (auto scan : ms1Scans)
+        _ms1Columns.append(scan);
+    if (_ms1Columns.offsets.empty())
+        _ms1Columns.offsets.push_back(0);
+
+    _ms1ColumnsBuilt.store(true, memory_order_release);
+    return _ms1Columns;
+}
+
+void mzSample::invalidateMs1Columns()
+{
+    if (!_ms1ColumnsBuilt.load(memory_order_acquire))
+        return;
+
+    lock_guard<mutex> lock(_ms1ColumnsMutex);
+    _ms1Columns.clear();
+    _ms1ColumnsBuilt.store(false, memory_order_release);
+}
+
+void SpectralColumns::append(const Scan *scan)
+{
+    if (offsets.empty())
+        offsets.push_back(0);
+    mz.insert(mz.end(), scan->mz.begin(), scan->mz.end());
+    intensity.insert(intensity.end(),
+                     scan->intensity.begin(),
+                     scan->intensity.begin() + scan->mz.size());
+    offsets.push_back(mz.size());
 }
 
 Scan *mzSample::getScan(unsigned int scanNum)
@@ -1160,7 +1595,7 @@ Scan *mzSample::getScan(unsigned int scanNum)
 	}
 }
 
-EIC *mzSample::getEIC(float precursorMz, float collisionEnergy, float productMz, int eicType, string filterline, float amuQ1 = 0.5, float amuQ3 = 0.5)
+EIC *mzSample::getEIC(float precursorMz, float collisionEnergy, float productMz, int eicType, const string &filterline, float amuQ1 = 0.5, float amuQ3 = 0.5)
 {
 	EIC *e = new EIC();
 	e->sampleName = sampleName;
@@ -1170,12 +1605,15 @@ EIC *mzSample::getEIC(float precursorMz, float collisionEnergy, float productMz,
 	e->mzmin = 0;
 	e->mzmax = 0;
 
-	for (unsigned int i = 0; i < scans.size(); i++)
+	const vector<Scan *> &msnScans = fragmentationScans();
+	int filterId = filterline.empty() ? -1 : filterLineId(filterline);
+	if (!filterline.empty() && filterId < 0)
+		return e;
+
+	for (unsigned int i = 0; i < msnScans.size(); i++)
 	{
-		Scan *scan = scans[i];
-		if (!(scan->filterLine == filterline || filterline == ""))
-			continue;
-		if (scan->mslevel < 2)
+		Scan *scan = msnScans[i];
+		if (filterId >= 0 && scan->filterLineId != filterId)
 			continue;
 		if (precursorMz && abs(scan->precursorMz - precursorMz) > amuQ1)
 			continue;
@@ -1183,6 +1621,7 @@ EIC *mzSample::getEIC(float precursorMz, float collisionEnergy, float productMz,
 		//	continue;
 		//if (collisionEnergy && abs(scan->collisionEnergy-collisionEnergy) > 0.5) continue;
 
+		ScanPeaksPin pin(scan);
 		float eicMz = 0;
 		float eicIntensity = 0;
 
@@ -1278,7 +1717,7 @@ EIC *mzSample::getEIC(float precursorMz, float collisionEnergy, float productMz,
 	return e;
 }
 
-EIC *mzSample::getEIC(string srm, int eicType)
+EIC *mzSample::getEIC(const string &srm, int eicType)
 {
 
 	EIC *e = new EIC();
@@ -1289,80 +1728,70 @@ EIC *mzSample::getEIC(string srm, int eicType)
 	e->mzmin = 0;
 	e->mzmax = 0;
 
-	// if (srmScans.size() == 0 )
-
-	// naman Checking for ‘List’ emptiness might be inefficient. Using List.empty() instead of List.size()
-	// can be faster. List.size() can take linear time but List.empty() is guaranteed to take constant time.
-	// src: https://kmdarshan.wordpress.com/2011/08/15/static-analysis-of-cc-code-using-cppcheck/
-	if (srmScans.empty())
+	//scans of this SRM transition, from the partition of its interned filterline
+	const vector<unsigned int> &srmscans =
+		scanPositionsForFilterLine(filterLineId(srm));
+	for (unsigned int i = 0; i < srmscans.size(); i++)
 	{
-		enumerateSRMScans();
-	}
+		Scan *scan = scans[srmscans[i]];
+		ScanPeaksPin pin(scan);
+		float eicMz = 0;
+		float eicIntensity = 0;
 
-	if (srmScans.count(srm) > 0)
-	{
-		vector<int> srmscans = srmScans[srm];
-		for (unsigned int i = 0; i < srmscans.size(); i++)
+		switch ((EIC::EicType)eicType)
 		{
-			Scan *scan = scans[srmscans[i]];
-			float eicMz = 0;
-			float eicIntensity = 0;
 
-			switch ((EIC::EicType)eicType)
-			{
-
-			case EIC::MAX:
+		case EIC::MAX:
+		{
+			for (unsigned int k = 0; k < scan->nobs(); k++)
 			{
-				for (unsigned int k = 0; k < scan->nobs(); k++)
+				if (scan->intensity[k] > eicIntensity)
 				{
-					if (scan->intensity[k] > eicIntensity)
-					{
-						eicIntensity = scan->intensity[k];
-						eicMz = scan->mz[k];
-					}
+					eicIntensity = scan->intensity[k];
+					eicMz = scan->mz[k];
 				}
-				break;
 			}
+			break;
+		}
 
-			//calculate the weighted average(with intensities as weights)
-			//while finding the eicMz for the whole EIC.
-			case EIC::SUM:
+		//calculate the weighted average(with intensities as weights)
+		//while finding the eicMz for the whole EIC.
+		case EIC::SUM:
+		{
+			float n = 0;
+			for (unsigned int k = 0; k < scan->nobs(); k++)
 			{
-				float n = 0;
-				for (unsigned int k = 0; k < scan->nobs(); k++)
-				{
-					eicIntensity += scan->intensity[k];
-					eicMz += (scan->mz[k]) * (scan->intensity[k]);
-					n += scan->intensity[k];
-				}
-
-				eicMz /= n;
-				break;
+				eicIntensity += scan->intensity[k];
+				eicMz += (scan->mz[k]) * (scan->intensity[k]);
+				n += scan->intensity[k];
 			}
 
-			default:
+			eicMz /= n;
+			break;
+		}
+
+		default:
+		{
+			for (unsigned int k = 0; k < scan->nobs(); k++)
 			{
-				for (unsigned int k = 0; k < scan->nobs(); k++)
+				if (scan->intensity[k] > eicIntensity)
 				{
-					if (scan->intensity[k] > eicIntensity)
-					{
-						eicIntensity = scan->intensity[k];
-						eicMz = scan->mz[k];
-					}
+					eicIntensity = scan->intensity[k];
+					eicMz = scan->mz[k];
 				}
-				break;
-			}
 			}
+			break;
+		}
+		}
 
-			e->scannum.push_back(scan->scannum);
-			e->rt.push_back(scan->rt);
-			e->intensity.push_back(eicIntensity);
-			e->mz.push_back(eicMz);
-			e->totalIntensity += eicIntensity;
+		e->scannum.push_back(scan->scannum);
+		e->rt.push_back(scan->rt);
+		e->intensity.push_back(eicIntensity);
+		e->mz.push_back(eicMz);
+		e->totalIntensity += eicIntensity;
 
-			if (eicIntensity > e->maxIntensity)
-				e->maxIntensity = eicIntensity;
-		}
+		if (eicIntensity > e->maxIntensity)
+			e->maxIntensity = eicIntensity;
 	}
 
 	if (e->rt.size() > 0)
@@ -1394,7 +1823,18 @@ EIC *mzSample::getEIC(string srm, int eicType)
  * MS/MS
  * @return         [description]
  */
-EIC *mzSample::getEIC(float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, string filterline)
+EIC *mzSample::getEIC(float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, const string &filterline)
+{
+	vector<pair<float, float> > mzRanges(1, make_pair(mzmin, mzmax));
+	return getEICs(mzRanges, rtmin, rtmax, mslevel, eicType, filterline)[0];
+}
+
+vector<EIC *> mzSample::getEICs(const vector<pair<float, float> > &mzRanges,
+								float rtmin,
+								float rtmax,
+								int mslevel,
+								int eicType,
+								const string &filterline)
 {
 
 	//Adjusting the Retension Time so that it matches with the sample
@@ -1403,46 +1843,70 @@ EIC *mzSample::getEIC(float mzmin, float mzmax, float rtmin, float rtmax, int ms
 		rtmin = this->minRt;
 	if (rtmax > this->maxRt && this->maxRt > rtmin)
 		rtmax = this->maxRt;
-	if (mzmin < this->minMz)
-		mzmin = this->minMz;
-	if (mzmax > this->maxMz && this->maxMz > mzmin)
-		mzmax = this->maxMz;
 
-	EIC *e = new EIC();
-	e->sampleName = sampleName;
-	e->sample = this;
-	e->mzmin = mzmin;
-	e->mzmax = mzmax;
-	e->totalIntensity = 0;
-	e->maxIntensity = 0;
+	vector<EIC *> eics;
+	vector<EIC *> slicedEics;
+	vector<pair<float, float> > slicedRanges;
+	eics.reserve(mzRanges.size());
+
+	for (const auto &mzRange : mzRanges)
+	{
+		float mzmin = mzRange.first;
+		float mzmax = mzRange.second;
+		if (mzmin < this->minMz)
+			mzmin = this->minMz;
+		if (mzmax > this->maxMz && this->maxMz > mzmin)
+			mzmax = this->maxMz;
+
+		EIC *e = new EIC();
+		e->sampleName = sampleName;
+		e->sample = this;
+		e->mzmin = mzmin;
+		e->mzmax = mzmax;
+		e->totalIntensity = 0;
+		e->maxIntensity = 0;
+		eics.push_back(e);
+
+		int scanCount = scans.size();
+		if (scanCount == 0)
+			continue;
 
-	int scanCount = scans.size();
-	if (scanCount == 0)
-		return e;
+		if (mzmin < minMz && mzmax < maxMz)
+		{
+			cerr << "getEIC(): mzmin and mzmax are out of range" << endl;
+			continue;
+		}
 
-	if (mzmin < minMz && mzmax < maxMz)
-	{
-		cerr << "getEIC(): mzmin and mzmax are out of range" << endl;
-		return e;
+		slicedEics.push_back(e);
+		slicedRanges.push_back(make_pair(mzmin, mzmax));
 	}
 
-	bool success = e->makeEICSlice(this, mzmin, mzmax, rtmin, rtmax, mslevel, eicType, filterline);
+	if (slicedEics.empty())
+		return eics;
+
+	bool success = EIC::makeEICSlices(this,
+									  slicedEics,
+									  slicedRanges,
+									  rtmin,
+									  rtmax,
+									  mslevel,
+									  eicType,
+									  filterline);
 
 	if (!success)
 	{
-		return e;
+		return eics;
 	}
 
-	e->getRTMinMaxPerScan();
-
-	//scale EIC by normalization constant
+	//scale EICs by normalization constant
 	float scale = getNormalizationConstant();
-	e->normalizeIntensityPerScan(scale);
-
-	//if (e->size() == 0)
-	//	cerr << "getEIC(mzrange,rtrange,mslevel): is empty" << mzmin << " " << mzmax << " " << rtmin << " " << rtmax << endl;
+	for (EIC *e : slicedEics)
+	{
+		e->getRTMinMaxPerScan();
+		e->normalizeIntensityPerScan(scale);
+	}
 
-	return (e);
+	return eics;
 }
 
 EIC *mzSample::getTIC(float rtmin, float rtmax, int mslevel)
@@ -1469,20 +1933,23 @@ EIC *mzSample::getTIC(float rtmin, float rtmax, int mslevel)
 	if (scanCount == 0)
 		return e;
 
-	for (int i = 0; i < scanCount; i++)
-	{
-		if (scans[i]->mslevel == mslevel)
-		{
-			Scan *scan = scans[i];
-			float y = scan->totalIntensity();
-			e->mz.push_back(0);
-			e->scannum.push_back(i);
-			e->rt.push_back(scan->rt);
-			e->intensity.push_back(y);
-			e->totalIntensity += y;
-			if (y > e->maxIntensity)
-				e->maxIntensity = y;
-		}
+	const vector<Scan *> &levelScans = scansForMsLevel(mslevel);
+	const vector<unsigned int> &positions = scanPositionsForMsLevel(mslevel);
+	e->mz.reserve(levelScans.size());
+	e->scannum.reserve(levelScans.size());
+	e->rt.reserve(levelScans.size());
+	e->intensity.reserve(levelScans.size());
+	for (unsigned int i = 0; i < levelScans.size(); i++)
+	{
+		Scan *scan = levelScans[i];
+		float y = scan->totalIntensity();
+		e->mz.push_back(0);
+		e->scannum.push_back(positions[i]);
+		e->rt.push_back(scan->rt);
+		e->intensity.push_back(y);
+		e->totalIntensity += y;
+		if (y > e->maxIntensity)
+			e->maxIntensity = y;
 	}
 	if (e->rt.size() > 0)
 	{
@@ -1516,29 +1983,33 @@ EIC *mzSample::getBIC(float rtmin, float rtmax, int mslevel)
 	if (scanCount == 0)
 		return e;
 
-	for (int i = 0; i < scanCount; i++)
-	{
-		if (scans[i]->mslevel == mslevel)
+	const vector<Scan *> &levelScans = scansForMsLevel(mslevel);
+	const vector<unsigned int> &positions = scanPositionsForMsLevel(mslevel);
+	e->mz.reserve(levelScans.size());
+	e->scannum.reserve(levelScans.size());
+	e->rt.reserve(levelScans.size());
+	e->intensity.reserve(levelScans.size());
+	for (unsigned int i = 0; i < levelScans.size(); i++)
+	{
+		Scan *scan = levelScans[i];
+		ScanPeaksPin pin(scan);
+		float maxMz = 0;
+		float maxIntensity = 0;
+		for (unsigned int k = 0; k < scan->intensity.size(); k++)
 		{
-			Scan *scan = scans[i];
-			float maxMz = 0;
-			float maxIntensity = 0;
-			for (unsigned int i = 0; i < scan->intensity.size(); i++)
+			if (scan->intensity[k] > maxIntensity)
 			{
-				if (scan->intensity[i] > maxIntensity)
-				{
-					maxIntensity = scan->intensity[i];
-					maxMz = scan->mz[i];
-				}
+				maxIntensity = scan->intensity[k];
+				maxMz = scan->mz[k];
 			}
-			e->mz.push_back(maxMz);
-			e->scannum.push_back(i);
-			e->rt.push_back(scan->rt);
-			e->intensity.push_back(maxIntensity);
-			e->totalIntensity += maxIntensity;
-			if (maxIntensity > e->maxIntensity)
-				e->maxIntensity = maxIntensity;
 		}
+		e->mz.push_back(maxMz);
+		e->scannum.push_back(positions[i]);
+		e->rt.push_back(scan->rt);
+		e->intensity.push_back(maxIntensity);
+		e->totalIntensity += maxIntensity;
+		if (maxIntensity > e->maxIntensity)
+			e->maxIntensity = maxIntensity;
 	}
 	if (e->rt.size() > 0)
 	{
@@ -1549,7 +2020,7 @@ EIC *mzSample::getBIC(float rtmin, float rtmax, int mslevel)
 }
 
 //compute correlation between two mzs within some retention time window
-float mzSample::correlation(float mz1, float mz2, MassCutoff *massCutoff, float rt1, float rt2, int eicType, string filterline)
+float mzSample::correlation(float mz1, float mz2, MassCutoff *massCutoff, float rt1, float rt2, int eicType, const string &filterline)
 {
 
 	float ppm1 = massCutoff->massCutoffValue(mz1);
@@ -1572,15 +2043,20 @@ int mzSample::parseCDF(const char *filename, int is_verbose)
 	long nscans = 0;
 	long ninst = 0;
 
+	//the netCDF library keeps global state, so only one CDF file is read
+	//at a time
+	static std::mutex cdfMutex;
+	std::lock_guard<std::mutex> cdfLock(cdfMutex);
+
 	extern int ncopts; /* from "netcdf.h" */
 	ncopts = 0;
 
-	static MS_Admin_Data admin_data;
-	static MS_Sample_Data sample_data;
-	static MS_Test_Data test_data;
-	// static MS_Instrument_Data inst_data; //naman unused
-	static MS_Raw_Data_Global raw_global_data;
-	static MS_Raw_Per_Scan raw_data;
+	MS_Admin_Data admin_data = MS_Admin_Data();
+	MS_Sample_Data sample_data = MS_Sample_Data();
+	MS_Test_Data test_data = MS_Test_Data();
+	// MS_Instrument_Data inst_data; //naman unused
+	MS_Raw_Data_Global raw_global_data = MS_Raw_Data_Global();
+	MS_Raw_Per_Scan raw_data = MS_Raw_Per_Scan();
 	// double mass_pt=0;
 	// double inty_pt=0;
 	// double inty=0;
@@ -1788,18 +2264,41 @@ Scan *mzSample::getAverageScan(float rtmin, float rtmax, int mslevel, int polari
 	map<float, double> mz_bin_map;
 	map<float, int> mz_count;
 
-	for (unsigned int s = 0; s < scans.size(); s++)
-	{
-		if (scans[s]->getPolarity() != polarity || scans[s]->mslevel != mslevel || scans[s]->rt < rtmin || scans[s]->rt > rtmax)
+	const vector<Scan *> &levelScans = scansForMsLevel(mslevel);
+	const SpectralColumns *columns = nullptr;
+	if (mslevel == 1)
+		columns = &ms1Columns();
+
+	auto scanItr = lower_bound(levelScans.begin(),
+							   levelScans.end(),
+							   rtmin,
+							   [](const Scan *scan, float rt) {
+								   return scan->rt < rt;
+							   });
+	for (; scanItr != levelScans.end(); scanItr++)
+	{
+		Scan *scan = *scanItr;
+		if (scan->rt > rtmax)
+			break;
+		if (scan->getPolarity() != polarity)
 			continue;
 
-		Scan *scan = scans[s];
+		//values of MS1 scans are read from the columns, others may have
+		//to be loaded again
+		ScanPeaksPin pin(columns ? nullptr : scan);
+		size_t viewIdx = scanItr - levelScans.begin();
+		const float *mzs = columns ? columns->mzBegin(viewIdx)
+								   : scan->mz.data();
+		const float *intensities = columns ? columns->intensityBegin(viewIdx)
+										   : scan->intensity.data();
+		size_t nobs = columns ? columns->nobs(viewIdx) : scan->mz.size();
+
 		scanCount++;
-		for (unsigned int i = 0; i < scan->mz.size(); i++)
+		for (size_t i = 0; i < nobs; i++)
 		{
-			float bin = FLOATROUND(scan->mz[i], sd);
-			mz_intensity_map[bin] += ((double)scan->intensity[i]);
-			mz_bin_map[bin] += ((double)(scan->intensity[i]) * (scan->mz[i]));
+			float bin = FLOATROUND(mzs[i], sd);
+			mz_intensity_map[bin] += ((double)intensities[i]);
+			mz_bin_map[bin] += ((double)(intensities[i]) * (mzs[i]));
 			mz_count[bin]++;
 		}
 	}
@@ -1857,6 +2356,200 @@ vector<Scan*> mzSample::getFragmentationEvents(mzSlice* slice)
     return matchedScans;
 }
 
+bool mzSample::_isTransitionScan(Scan *scan)
+{
+    return mystrcasestr(scan->scanType.c_str(), "SRM") != NULL
+           || mystrcasestr(scan->scanType.c_str(), "MRM") != NULL
+           || mystrcasestr(scan->filterLine.c_str(), "SRM") != NULL
+           || mystrcasestr(scan->filterLine.c_str(), "MRM") != NULL;
+}
+
+void mzSample::_releaseScanPeaks(Scan *scan)
+{
+    scan->_releasedTotalIntensity = scan->totalIntensity();
+    vector<float>().swap(scan->mz);
+    vector<float>().swap(scan->intensity);
+    scan->_peaksReleased = true;
+}
+
+void mzSample::releaseFragmentationScanPeaks()
+{
+    lock_guard<mutex> lock(_scanPeaksMutex);
+    for (Scan *scan : scans) {
+        if (scan->mslevel <= 1 || scan->fileSeekStart < 0
+            || scan->_peaksReleased || _isTransitionScan(scan))
+            continue;
+        _releaseScanPeaks(scan);
+        _hasReleasedScanPeaks = true;
+    }
+    _loadedScanPeaks.clear();
+    _loadedScanPeaksPositions.clear();
+}
+
+bool mzSample::loadScanPeaks(Scan *scan)
+{
+    if (!scan || !_hasReleasedScanPeaks)
+        return true;
+
+    unique_lock<mutex> lock(_scanPeaksMutex);
+    bool loaded = _loadScanPeaks(scan, lock);
+    _trimLoadedScanPeaks();
+    return loaded;
+}
+
+bool mzSample::pinScanPeaks(Scan *scan)
+{
+    //only fragmentation scans are ever released
+    if (!scan || !_hasReleasedScanPeaks || scan->mslevel <= 1)
+        return false;
+
+    unique_lock<mutex> lock(_scanPeaksMutex);
+    _loadScanPeaks(scan, lock);
+    bool pinned = _loadedScanPeaksPositions.count(scan) > 0;
+    if (pinned)
+        scan->_peaksPins++;
+    _trimLoadedScanPeaks();
+    return pinned;
+}
+
+void mzSample::unpinScanPeaks(Scan *scan)
+{
+    lock_guard<mutex> lock(_scanPeaksMutex);
+    if (scan->_peaksPins > 0)
+        scan->_peaksPins--;
+    _trimLoadedScanPeaks();
+}
+
+ScanPeaksPin::ScanPeaksPin(Scan *scan)
+    : _scan(scan),
+      _pinned(scan && scan->sample && scan->sample->pinScanPeaks(scan))
+{
+}
+
+ScanPeaksPin::~ScanPeaksPin()
+{
+    if (_pinned)
+        _scan->sample->unpinScanPeaks(_scan);
+}
+
+bool mzSample::_touchLoadedScanPeaks(Scan *scan)
+{
+    auto position = _loadedScanPeaksPositions.find(scan);
+    if (position != _loadedScanPeaksPositions.end()) {
+        _loadedScanPeaks.splice(_loadedScanPeaks.begin(),
+                                _loadedScanPeaks,
+                                position->second);
+        return true;
+    }
+    return !scan->_peaksReleased;
+}
+
+bool mzSample::_loadScanPeaks(Scan *scan, unique_lock<mutex> &lock)
+{
+    if (_touchLoadedScanPeaks(scan))
+        return true;
+
+    //the file is read without the lock, so that scans of the same sample
+    //can be read by several threads at once
+    vector<float> mz;
+    vector<float> intensity;
+    lock.unlock();
+    bool read = _readScanPeaks(scan, mz, intensity);
+    lock.lock();
+    if (!read)
+        return false;
+
+    //another thread may have published the values while the file was read
+    if (_touchLoadedScanPeaks(scan))
+        return true;
+
+    scan->mz.swap(mz);
+    scan->intensity.swap(intensity);
+    scan->_peaksReleased = false;
+    _loadedScanPeaks.push_front(scan);
+    _loadedScanPeaksPositions[scan] = _loadedScanPeaks.begin();
+    return true;
+}
+
+void mzSample::_trimLoadedScanPeaks()
+{
+    //pinned scans are being read and stay in memory, even if that keeps
+    //more scans than the cache size for a while
+    auto position = _loadedScanPeaks.end();
+    while (_loadedScanPeaks.size() > _scanPeaksCacheSize
+           && position != _loadedScanPeaks.begin()) {
+        --position;
+        Scan *scan = *position;
+        if (scan->_peaksPins > 0)
+            continue;
+        position = _loadedScanPeaks.erase(position);
+        _loadedScanPeaksPositions.erase(scan);
+        _releaseScanPeaks(scan);
+    }
+}
+
+bool mzSample::_isMzXMLFile() const
+{
+    size_t extension = fileName.find_last_of('.');
+    if (extension == string::npos)
+        return false;
+    return strcasecmp(fileName.c_str() + extension, ".mzxml") == 0;
+}
+
+bool mzSample::_readScanPeaks(const Scan *scan,
+                              vector<float> &mz,
+                              vector<float> &intensity)
+{
+    if (scan->fileSeekStart < 0 || scan->fileSeekEnd <= scan->fileSeekStart)
+        return false;
+
+    ifstream file(fileName.c_str(), ios::in | ios::binary);
+    if (!file.is_open())
+        return false;
+
+    string buffer(scan->fileSeekEnd - scan->fileSeekStart, '\0');
+    file.seekg(scan->fileSeekStart);
+    if (!file.read(&buffer[0], buffer.size()))
+        return false;
+
+    xml_document doc;
+    pugi::xml_parse_result result = doc.load_buffer(buffer.data(),
+                                                    buffer.size(),
+                                                    parse_minimal,
+                                                    pugi::encoding_utf8);
+    if (result.status != pugi::status_ok)
+        return false;
+
+    //values are filtered on a copy, the scan itself is only changed by
+    //the caller while holding the lock
+    Scan peaks(this,
+               scan->scannum,
+               scan->mslevel,
+               scan->rt,
+               scan->precursorMz,
+               scan->getPolarity());
+    peaks.centroided = scan->centroided;
+
+    xml_node node = doc.first_child();
+    if (_isMzXMLFile()) {
+        if (strcmp(node.name(), "scan") != 0)
+            return false;
+        populateMzAndIntensity(parsePeaksFromMzXML(node), &peaks);
+    } else {
+        if (strcmp(node.name(), "spectrum") != 0)
+            return false;
+        parseMzMLSpectrumPeaks(node, peaks.mz, peaks.intensity);
+    }
+
+    _filterScanPeaks(&peaks,
+                     _peakFilterCentroidScans,
+                     _peakFilterIntensityQuantile,
+                     _peakFilterMinIntensity);
+    mz.swap(peaks.mz);
+    intensity.swap(peaks.intensity);
+    return true;
+}
+
 vector<float> mzSample::getIntensityDistribution(int mslevel)
 {
 
@@ -1867,6 +2560,7 @@ vector<float> mzSample::getIntensityDistribution(int mslevel)
 		if (scan->mslevel != mslevel)
 			continue;
 
+		ScanPeaksPin pin(scan);
 		for (unsigned int i = 0; i < scan->mz.size(); i++)
 		{
 			allintensities.push_back(scan->intensity[i]);
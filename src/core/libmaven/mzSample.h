@@ -14,6 +14,10 @@
 #include <regex>
 #include <float.h>
 #include <iomanip>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include "assert.h"
 #include "pugixml.hpp"
 #include "base64.h"
@@ -46,6 +50,7 @@
 #endif /* Def WIN32 or Def WIN64 */
 
 class mzSample;
+class XmlStreamReader;
 class Scan;
 class Peak;
 class PeakGroup;
@@ -192,6 +197,71 @@ class mzLink
     }
 };
 
+/**
+* @brief Columnar (structure-of-arrays) store for observations of many scans
+*
+* @details m/z and intensity values of all stored scans are packed, scan after
+* scan, into two contiguous arrays. Observations of the i-th stored scan lie in
+* the half open range [offsets[i], offsets[i + 1]) of both arrays.
+*
+* The values are copied: scans keep their own vectors, which parsers, filters
+* and the GUI edit in place. A built store therefore adds the size of the MS1
+* observations to the memory of a sample. It is kept for the locality of EIC
+* extraction and slicing, not to save memory.
+*/
+class SpectralColumns
+{
+  public:
+    vector<float> mz;
+    vector<float> intensity;
+    vector<size_t> offsets;
+
+    /**
+    * @brief Release all stored observations
+    */
+    void clear()
+    {
+        vector<float>().swap(mz);
+        vector<float>().swap(intensity);
+        vector<size_t>().swap(offsets);
+    }
+
+    /**
+    * @brief Append observations of a scan at the end of the store
+    * @param scan Scan whose m/z and intensity values will be copied
+    */
+    void append(const Scan *scan);
+
+    /**
+    * @brief Number of scans stored
+    */
+    inline size_t scanCount() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    /**
+    * @brief Number of observations of the i-th stored scan
+    */
+    inline size_t nobs(size_t i) const { return offsets[i + 1] - offsets[i]; }
+
+    /**
+    * @brief Pointer to first m/z value of the i-th stored scan
+    */
+    inline const float *mzBegin(size_t i) const
+    {
+        return mz.data() + offsets[i];
+    }
+
+    /**
+    * @brief Pointer to first intensity value of the i-th stored scan
+    */
+    inline const float *intensityBegin(size_t i) const
+    {
+        return intensity.data() + offsets[i];
+    }
+};
+
 /** 
 * @brief Parses input sample files and stores related metadata
 *
@@ -234,16 +304,34 @@ class mzSample
 
     /**
     * @brief Parse mzXML file format
+    * @details The file is streamed, only one top level scan element is held
+    * in memory at a time.
     * @param char* mzXML file name
     */
     void parseMzXML(const char *);
 
+    /**
+    * @brief Parse mzXML file format by loading the whole file at once
+    * @details Used for files that can not be streamed (UTF-16/32 encoded).
+    * @param char* mzXML file name
+    */
+    void parseMzXMLDocument(const char *);
+
     /**
     * @brief Parse mzML file format
+    * @details The file is streamed, only one spectrum or chromatogram
+    * element is held in memory at a time.
     * @param char* mzML file name
     */
     void parseMzML(const char *);
 
+    /**
+    * @brief Parse mzML file format by loading the whole file at once
+    * @details Used for files that can not be streamed (UTF-16/32 encoded).
+    * @param char* mzML file name
+    */
+    void parseMzMLDocument(const char *);
+
     /**
     * @brief Parse netcdf file format
     * @param filename netcdf file name
@@ -284,6 +372,13 @@ class mzSample
     */
     void parseMzMLChromatogramList(const xml_node&);
 
+    /**
+    * @brief Parse a single mzML chromatogram
+    * @param xml_node xml_node object of pugixml library
+    * @param scannum number of the next scan, incremented for each scan added
+    */
+    void parseMzMLChromatogram(const xml_node&, int &scannum);
+
 
     int getSampleNoChromatogram(const string &chromatogramId);
 
@@ -295,6 +390,21 @@ class mzSample
     */
     void parseMzMLSpectrumList(const xml_node&);
 
+    /**
+    * @brief Parse a single mzML spectrum
+    * @param xml_node xml_node object of pugixml library
+    * @param scannum number of the next scan, incremented for each scan added
+    */
+    void parseMzMLSpectrum(const xml_node&, int &scannum);
+
+    /**
+    * @brief Decode the m/z and intensity arrays of an mzML spectrum
+    * @return False if the spectrum has no binary data arrays, true otherwise
+    */
+    bool parseMzMLSpectrumPeaks(const xml_node &spectrum,
+                                vector<float> &mzVector,
+                                vector<float> &intsVector);
+
     /**
     * @brief Print info about sample 
     * @details Print data of sample: 1. Number of observations 2. rt range
@@ -319,11 +429,151 @@ class mzSample
     /**
     * @brief Map scan numbers to filterline
     * @details Update map srmScans where key is the filterline and value is int vector.
-    * int vector contains scan numbers
+    * int vector contains scan numbers. The map is filled from the filterline
+    * partitions built by indexScans
     * @see mzSample:srmScans
     */
     void enumerateSRMScans();
 
+    /**
+    * @brief Check whether SRM scans have already been enumerated
+    * @return True if srmScans is up to date, false otherwise
+    */
+    bool srmScansEnumerated() { return _srmScansEnumerated; }
+
+    /**
+    * @brief Build read-only, RT ordered scan views for EIC extraction
+    * @details Scans of every MS level are collected into a contiguous array of
+    * pointers along with their position in `scans`. A separate view holds all
+    * fragmentation (MS level > 1) scans in acquisition order. EIC extraction
+    * can then binary search and iterate over only the relevant scans without
+    * copying the scan deque. Filterlines are interned and scans of every
+    * filterline are partitioned as well, overall and per MS level. The index
+    * is rebuilt lazily whenever the number of scans changes.
+    * @see mzSample::scansForMsLevel
+    */
+    void indexScans();
+
+    /**
+    * @brief Get RT ordered scans of a given MS level
+    * @param mslevel MS level of the required scans
+    * @return Reference to a contiguous array of scan pointers
+    */
+    const vector<Scan *> &scansForMsLevel(int mslevel);
+
+    /**
+    * @brief Get positions (in `scans`) of RT ordered scans of a given MS level
+    * @param mslevel MS level of the required scans
+    * @return Reference to an array parallel to the one returned by
+    * scansForMsLevel
+    */
+    const vector<unsigned int> &scanPositionsForMsLevel(int mslevel);
+
+    /**
+    * @brief Get all fragmentation (MS level > 1) scans in acquisition order
+    * @return Reference to a contiguous array of scan pointers
+    */
+    const vector<Scan *> &fragmentationScans();
+
+    /**
+    * @brief Get positions (in `scans`) of all fragmentation scans
+    * @return Reference to an array parallel to the one returned by
+    * fragmentationScans
+    */
+    const vector<unsigned int> &fragmentationScanPositions();
+
+    /**
+    * @brief Make sure the m/z and intensity values of a scan are in memory
+    * @details Values of released fragmentation scans are read again from the
+    * sample file, using the byte range of the spectrum recorded while
+    * parsing, and filtered as they were when the sample was loaded. At most
+    * getScanPeaksCacheSize scans read again are kept in memory, the least
+    * recently used ones are released again when more are read. Callers
+    * should not hold on to the values of a scan while many others are read,
+    * and should use ScanPeaksPin if other threads may read the same sample.
+    * @param scan Scan of this sample
+    * @return False if the values had to be read and could not be, true
+    * otherwise
+    */
+    bool loadScanPeaks(Scan *scan);
+
+    /**
+    * @brief Load the values of a scan and keep them in memory until
+    * unpinScanPeaks is called
+    * @details Unlike loadScanPeaks, the values of a pinned scan are not
+    * released while other threads read more scans of this sample. Use
+    * ScanPeaksPin rather than calling this directly.
+    * @param scan Scan of this sample
+    * @return True if the scan was pinned and unpinScanPeaks has to be
+    * called, false if its values are never released
+    */
+    bool pinScanPeaks(Scan *scan);
+
+    /**
+    * @brief Allow the values of a scan pinned by pinScanPeaks to be
+    * released again
+    */
+    void unpinScanPeaks(Scan *scan);
+
+    /**
+    * @brief Release the m/z and intensity values of all fragmentation scans
+    * that can be read again from the sample file
+    * @details SRM/MRM scans are always kept in memory since they are used
+    * to build chromatograms.
+    */
+    void releaseFragmentationScanPeaks();
+
+    /**
+    * @brief Get the ID a filterline is interned as in this sample
+    * @details Filterlines of all scans are interned into consecutive integer
+    * IDs when scans are indexed. Scans with an empty filterline are not
+    * interned and have ID -1.
+    * @param filterline Filterline to look up
+    * @return ID of the filterline or -1 if no scan of this sample has it
+    */
+    int filterLineId(const string &filterline);
+
+    /**
+    * @brief Get all distinct filterlines of this sample, indexed by their ID
+    */
+    const vector<string> &filterLines();
+
+    /**
+    * @brief Get positions (in `scans`) of all scans with a given filterline
+    * @param filterLineId ID of the filterline, as given by filterLineId()
+    * @return Reference to an array of positions in acquisition order
+    */
+    const vector<unsigned int> &scanPositionsForFilterLine(int filterLineId);
+
+    /**
+    * @brief Get scans of a given MS level having a given filterline
+    * @param mslevel MS level of the required scans
+    * @param filterLineId ID of the filterline, as given by filterLineId()
+    * @return Reference to an array of indices into the array returned by
+    * scansForMsLevel, in RT order
+    */
+    const vector<unsigned int> &scanViewIndicesForFilterLine(int mslevel,
+                                                             int filterLineId);
+
+    /**
+    * @brief Get columnar store of all MS1 observations
+    * @details The store is built on first use and is parallel to the array
+    * returned by `scansForMsLevel(1)`, i.e., the i-th stored scan is the i-th
+    * MS1 scan in RT order. Concurrent first calls build it once. It is
+    * rebuilt after the scan index changes or invalidateMs1Columns is called.
+    * @return Reference to the MS1 spectral columns of this sample
+    */
+    const SpectralColumns &ms1Columns();
+
+    /**
+    * @brief Drop the MS1 spectral columns, so that the next call to
+    * ms1Columns copies the values of the scans again
+    * @details Called whenever the m/z or intensity values of an MS1 scan of
+    * this sample change. References returned by ms1Columns become invalid,
+    * the store must not be read while scans are being modified.
+    */
+    void invalidateMs1Columns();
+
     /**
     * @brief Find correlation between two EICs
     * @param mz1 m/z for first EIC
@@ -335,7 +585,7 @@ class mzSample
     * @param filterline selected filterline
     * @return correlation
     */
-    float correlation(float mz1, float mz2, MassCutoff *massCutoff, float rt1, float rt2, int eicType, string filterline);
+    float correlation(float mz1, float mz2, MassCutoff *massCutoff, float rt1, float rt2, int eicType, const string &filterline);
 
     /**
     * @brief Get normalization constant
@@ -386,7 +636,28 @@ class mzSample
     * @return EIC class object
     * @see EIC
     */
-    EIC *getEIC(float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, string filterline);
+    EIC *getEIC(float mzmin, float mzmax, float rtmin, float rtmax, int mslevel, int eicType, const string &filterline);
+
+    /**
+    * @brief Get EICs for several m/z ranges in a single pass over the sample
+    * @details Each EIC is identical to the one getEIC would return for its
+    * m/z range, but the scans are read only once for all of them.
+    * @param mzRanges Pairs of minimum and maximum m/z
+    * @param rtmin Minimum retention time
+    * @param rtmax Maximum retention time
+    * @param mslevel MS Level. MS Level is 1 for MS data and 2 for MS/MS data
+    * @param eicType Type of EIC (max or sum)
+    * @param filterline selected filterline
+    * @return EIC objects, in the same order as the m/z ranges. The caller
+    * owns the returned EICs.
+    * @see EIC
+    */
+    vector<EIC *> getEICs(const vector<pair<float, float> > &mzRanges,
+                          float rtmin,
+                          float rtmax,
+                          int mslevel,
+                          int eicType,
+                          const string &filterline);
 
     /**
     * @brief Get EIC based on srmId
@@ -395,7 +666,7 @@ class mzSample
     * @return EIC class object
     * @see EIC
     */
-    EIC *getEIC(string srmId, int eicType);
+    EIC *getEIC(const string &srmId, int eicType);
 
     /**
     * @brief Get EIC for MS-MS dataset
@@ -408,7 +679,7 @@ class mzSample
     * @param amuQ3 delta difference in Q3
     * @return EIC class object
     */
-    EIC *getEIC(float precursorMz, float collisionEnergy, float productMz, int eicType, string filterline, float amuQ1, float amuQ3);
+    EIC *getEIC(float precursorMz, float collisionEnergy, float productMz, int eicType, const string &filterline, float amuQ1, float amuQ3);
 
     /**
     * @brief Get Total Ion Chromatogram
@@ -560,6 +831,8 @@ class mzSample
 
     /**
      * @brief find all MS2 scans within the slice
+     * @details The values of the scans may have been released, callers
+     * reading them hold a ScanPeaksPin while doing so.
      * @return vector of all matching MS2 scans
      */
     vector<Scan*> getFragmentationEvents(mzSlice* slice);
@@ -684,6 +957,23 @@ class mzSample
                           */
     static int getFilter_polarity() { return filter_polarity; }
 
+    /**
+     * @brief Keep only the metadata of fragmentation scans in memory after
+     * loading a sample, their values are read again when needed
+     * @see loadScanPeaks
+     */
+    static void setLazyFragmentationScans(bool x) { _lazyFragmentationScans = x; }
+
+    static bool getLazyFragmentationScans() { return _lazyFragmentationScans; }
+
+    /**
+     * @brief Set the number of fragmentation scans whose values are kept in
+     * memory, per sample, once they were read again
+     */
+    static void setScanPeaksCacheSize(unsigned int x) { _scanPeaksCacheSize = std::max(x, 1u); }
+
+    static unsigned int getScanPeaksCacheSize() { return _scanPeaksCacheSize; }
+
     vector<float> getIntensityDistribution(int mslevel);
 
     deque<Scan *> scans;
@@ -730,10 +1020,79 @@ class mzSample
     vector<double> polynomialAlignmentTransformation; //parameters for polynomial transform
 
   private:
+    friend class SampleCache;
+
     int _id;
     unsigned int _numMS1Scans;
     unsigned int _numMS2Scans;
 
+    /**
+     * @brief RT ordered views over `scans`, used for EIC extraction
+     */
+    struct ScanView
+    {
+        vector<Scan *> scans;
+        vector<unsigned int> positions;
+    };
+
+    map<int, ScanView> _msLevelScanViews;
+    ScanView _fragmentationScanView;
+    ScanView _emptyScanView;
+    size_t _indexedScanCount;
+
+    /**
+     * @brief Interned filterlines and the scan partitions of each of them
+     */
+    map<string, int> _filterLineIds;
+    vector<string> _filterLines;
+    vector<vector<unsigned int> > _filterLineScanPositions;
+    map<pair<int, int>, vector<unsigned int> > _filterLineViewIndices;
+
+    SpectralColumns _ms1Columns;
+    atomic<bool> _ms1ColumnsBuilt;
+    mutex _ms1ColumnsMutex;
+
+    bool _srmScansEnumerated;
+
+    /**
+     * @brief Fragmentation scans whose values were read again, most
+     * recently used first
+     */
+    list<Scan *> _loadedScanPeaks;
+    unordered_map<Scan *, list<Scan *>::iterator> _loadedScanPeaksPositions;
+    mutex _scanPeaksMutex;
+    atomic<bool> _hasReleasedScanPeaks;
+
+    //scan filters the sample was loaded with, applied to values read again
+    bool _peakFilterCentroidScans;
+    int _peakFilterIntensityQuantile;
+    int _peakFilterMinIntensity;
+
+    //reader of a streamed file and offset of the element being parsed, used
+    //to record the byte ranges of spectra
+    XmlStreamReader *_streamReader;
+    uint64_t _streamElementOffset;
+
+    void _recordFileSeek(const xml_node &node, Scan *scan);
+    void _filterScanPeaks(Scan *scan,
+                          bool centroidScans,
+                          int intensityQuantile,
+                          int minIntensity);
+    bool _loadScanPeaks(Scan *scan, unique_lock<mutex> &lock);
+    bool _touchLoadedScanPeaks(Scan *scan);
+    void _trimLoadedScanPeaks();
+    bool _readScanPeaks(const Scan *scan,
+                        vector<float> &mz,
+                        vector<float> &intensity);
+    bool _isMzXMLFile() const;
+    void _releaseScanPeaks(Scan *scan);
+    static bool _isTransitionScan(Scan *scan);
+
+    //scratch memory for binary data arrays, only used while loading
+    base64::DecodeBuffer _decodeBuffer;
+
+    void _ensureScanIndex();
+
     void sampleNaming(const char *filename);
     void checkSampleBlank(const char *filename);
 
@@ -741,6 +1100,10 @@ class mzSample
 
     void parseMzXMLData(const xml_node& spectrumstore);
 
+    void parseMzXMLScanTree(const xml_node &scan, int &scannum);
+
+    void renumberScansByRt();
+
     xml_node getmzXMLSpectrumData(xml_document &doc, const char *filename);
 
     float parseRTFromMzXML(xml_attribute &attr);
@@ -751,6 +1114,21 @@ class mzSample
 
     vector<float> parsePeaksFromMzXML(const xml_node &scan);
 
+    /**
+    * @brief Decode the binary data array of an mzML spectrum or chromatogram
+    * @details Handles 32 and 64-bit arrays that may be zlib and/or
+    * MS-Numpress compressed, as written by msconvert.
+    * @param binaryDataArray binaryDataArray node
+    * @param attr cv parameters of the binaryDataArray node
+    * @param count number of values given by defaultArrayLength, 0 if unknown
+    * @param values filled with the decoded values
+    * @return False if the array could not be decoded, true otherwise
+    */
+    bool decodeMzMLBinaryArray(const xml_node &binaryDataArray,
+                               const map<string, string> &attr,
+                               size_t count,
+                               vector<float> &values);
+
     void populateMzAndIntensity(const vector<float>& mzint, Scan *_scan);
 
     void populateFilterline(const string& filterLine, Scan *_scan);
@@ -759,11 +1137,14 @@ class mzSample
 
     //TODO: This should be moved
     static string getFileName(const string &filename);
-    static int filter_minIntensity;
-    static bool filter_centroidScans;
-    static int filter_intensityQuantile;
-    static int filter_mslevel;
-    static int filter_polarity;
+    //scan filters are atomic so that samples can be loaded concurrently
+    static atomic<int> filter_minIntensity;
+    static atomic<bool> filter_centroidScans;
+    static atomic<int> filter_intensityQuantile;
+    static atomic<int> filter_mslevel;
+    static atomic<int> filter_polarity;
+    static atomic<bool> _lazyFragmentationScans;
+    static atomic<unsigned int> _scanPeaksCacheSize;
 
     vector<string> filterChromatogram {
         "sample", 
@@ -773,6 +1154,27 @@ class mzSample
     };
 };
 
+/**
+* @brief Keeps the m/z and intensity values of a scan in memory while in scope
+*
+* @details Loads the values of a released fragmentation scan, and keeps other
+* threads reading the same sample from releasing them until the pin goes out
+* of scope. Scans whose values are never released are not locked.
+*/
+class ScanPeaksPin
+{
+  public:
+    explicit ScanPeaksPin(Scan *scan);
+    ~ScanPeaksPin();
+
+  private:
+    Scan *_scan;
+    bool _pinned;
+
+    ScanPeaksPin(const ScanPeaksPin &);
+    ScanPeaksPin &operator=(const ScanPeaksPin &);
+};
+
 class Pathway
 {
   public:
@@ -1,4 +1,5 @@
 #include "mzUtils.h"
+#include "smoothingkernel.h"
 
 
 /**
@@ -90,11 +91,18 @@ namespace mzUtils {
     }
 
     void smoothAverage(float *y, float* s, int smoothWindowLen, int ly) {
+        vector<float> scratch;
+        smoothAverage(y, s, smoothWindowLen, ly, scratch);
+    }
+
+    void smoothAverage(float *y,
+                       float* s,
+                       int smoothWindowLen,
+                       int ly,
+                       vector<float>& scratch)
+    {
         if (smoothWindowLen == 0 ) return;
-        float* x = new float[smoothWindowLen];
-        for(int i=0; i< smoothWindowLen; i++ ) x[i] = 1.0/smoothWindowLen;
-        conv(smoothWindowLen,-smoothWindowLen/2,x,ly, 0,y,ly,0,s);
-        delete[] x;
+        SmoothingKernel::movingAverage(smoothWindowLen).apply(y, s, ly, scratch);
     }
 
     void conv (int lx, int ifx, float *x, int ly, int ify, float *y, int lz, int ifz, float *z) /*****************************************************************************
@@ -151,6 +159,12 @@ namespace mzUtils {
     }
 
     void gaussian1d_smoothing (int ns, int nsr, float *data)
+    {
+        vector<float> scratch;
+        gaussian1d_smoothing(ns, nsr, data, scratch);
+    }
+
+    void gaussian1d_smoothing (int ns, int nsr, float *data, vector<float>& scratch)
     {
         //Subroutine to apply a one-dimensional gaussian smoothing
 
@@ -160,79 +174,31 @@ ns		number of samples in the input data
 nsr		width (in samples) of the gaussian for which
 amplitude > 0.5*max amplitude
 data		1-D array[ns] of data to smooth
+scratch		buffer reused between calls
 
 Output:
 data		1-D array[ns] of smoothed data
          ******************************************************************************/
-        int is;				/* loop counter */
-        float sum=0.0;
-        float fcut;
-        float r;
-        float fcutr=1.0/nsr;
-        int n=0;
-        int mean=0;
-        float fcutl=0;
-        float s[1000];		/* smoothing filter array */
-        float *temp;			/* temporary array */
 
-        /* save input fcut */
-        fcut=fcutr;
+        float fcutr=1.0/nsr;
 
         /* don't smooth if nsr equal to zero */
         if (nsr==0 || ns<=1) return;
 
-        /* if halfwidth more than 100 samples, truncate */
-        if (nsr>100) fcut=1.0/100;
-
-        /* allocate space */
-        temp=new float[ns];
-
-
-        /* initialize smoothing function if not the same as the last one used */
-        if (fcut != fcutl) {
-            fcutl=fcut;
-
-            /* set span of 3, at width of 1.5*exp(-PI*1.5**2)=1/1174 */
-            n=(int) (3.0/fcut+0.5);
-            n=2*n/2+1;		/* make it odd for symmetry */
-
-            /* mean is the index of the zero in the smoothing wavelet */
-            mean=n/2;
-
-            /* s(n) is the smoothing gaussian */
-            for (is=1; is<=n; is++) {
-                r=is-mean-1;
-                r= -r*r*fcut*fcut*3.141;
-                s[is-1]=exp(r);
-            }
-
-            /* normalize to unit area, will preserve DC frequency at full
-               amplitude. Frequency at fcut will be half amplitude */
-            for (is=0; is<n; is++) sum +=s[is];
-            for (is=0; is<n; is++) s[is] /=sum;
-            //cerr << "new gaussian " << nsr << endl;
-        }
-
         /* convolve by gaussian into buffer */
         if (1.01/fcutr>(float)ns) {
 
             /* replace drastic smoothing by averaging */
-            sum=0.0;
-            for (is=0; is<ns; is++) sum +=data[is];
+            float sum=0.0;
+            for (int is=0; is<ns; is++) sum +=data[is];
             sum /=ns;
-            for (is=0; is<ns; is++) data[is]=sum;
+            for (int is=0; is<ns; is++) data[is]=sum;
 
         } else {
 
-            /* convolve with gaussian */
-            conv (n, -mean, s, ns, -mean, data, ns, -mean, temp);
-
-            /* copy filtered data back to output array */
-            for (is=0; is<ns; is++) data[is]=temp[is];
+            /* convolve with gaussian, truncated at 100 samples halfwidth */
+            SmoothingKernel::gaussian(nsr).apply(data, data, ns, scratch);
         }
-
-        /* free allocated space */
-        delete[] temp;
     }
 
     float median(vector <float> y) {
@@ -393,27 +359,24 @@ Series:  Prentice-Hall Series in Automatic Computation
     }
 
     float massCutoffDist(const float mz1, const float mz2,MassCutoff *massCutoff) {
-        if(massCutoff->getMassCutoffType()=="ppm"){
+        switch(massCutoff->unit()){
+        case MassCutoffUnit::Ppm:
             return ( abs((mz2-mz1)/(mz1/1e6)) );
-        }
-        else if(massCutoff->getMassCutoffType()=="mDa"){
+        case MassCutoffUnit::MDa:
             return abs((mz2-mz1)*1e3) ;
-        }
-        else{
+        default:
             assert(false);
             return 0;
         }
     }
 
     double massCutoffDist(const double mz1, const double mz2,MassCutoff *massCutoff) {
-
-        if(massCutoff->getMassCutoffType()=="ppm"){
+        switch(massCutoff->unit()){
+        case MassCutoffUnit::Ppm:
             return ppmDist(mz1, mz2);
-        }
-        else if(massCutoff->getMassCutoffType()=="mDa"){
+        case MassCutoffUnit::MDa:
             return abs((mz2-mz1)*1e3) ;
-        }
-        else{
+        default:
             assert(false);
             return 0;
         }
@@ -436,7 +399,8 @@ Series:  Prentice-Hall Series in Automatic Computation
     }
 
     bool withinXMassCutoff( float mz1, float mz2, MassCutoff *massCutoff ) {
-        if ( mz2 > (mz1 - massCutoff->massCutoffValue(mz1)) && mz2 < (mz1 + massCutoff->massCutoffValue(mz1)) ) return(true);
+        double window = massCutoff->massCutoffValue(mz1);
+        if ( mz2 > (mz1 - window) && mz2 < (mz1 + window) ) return(true);
         else return(false);
     }
 
@@ -122,6 +122,15 @@ namespace mzUtils {
      */
     void gaussian1d_smoothing(int ns, int nsr, float* data);
 
+    /**
+     * @brief gaussian1d_smoothing with a scratch buffer that is reused
+     * between calls
+     */
+    void gaussian1d_smoothing(int ns,
+                              int nsr,
+                              float* data,
+                              vector<float>& scratch);
+
     /**
      * [smoothAverage ]
      * @method smoothAverage
@@ -132,6 +141,16 @@ namespace mzUtils {
      */
     void smoothAverage(float* y, float* s, int points, int n);
 
+    /**
+     * @brief smoothAverage with a scratch buffer that is reused between
+     * calls, y and s may be the same array
+     */
+    void smoothAverage(float* y,
+                       float* s,
+                       int points,
+                       int n,
+                       vector<float>& scratch);
+
     /**
      * [conv ]
      * @method conv
@@ -0,0 +1,438 @@
+#include "samplecache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sys/stat.h>
+#include <vector>
+
+#include "mzSample.h"
+
+atomic<bool> SampleCache::_enabled(false);
+mutex SampleCache::_directoryMutex;
+string SampleCache::_directory;
+
+namespace {
+
+const char cacheMagic[8] = {'M', 'Z', 'C', 'A', 'C', 'H', 'E', '\0'};
+const uint32_t byteOrderMark = 0x01020304;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+
+    // source file and scan filters the cache was written with
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    int32_t filterMsLevel;
+    int32_t filterPolarity;
+    int32_t filterCentroidScans;
+    int32_t filterIntensityQuantile;
+    int32_t filterMinIntensity;
+
+    // sample level values set by the parsers
+    int32_t sampleNumber;
+    uint64_t injectionTime;
+    uint32_t ms1ScanCount;
+    uint32_t ms2ScanCount;
+
+    // sections
+    uint64_t scanCount;
+    uint64_t pointCount;
+    uint64_t stringCount;
+    uint64_t instrumentInfoCount;
+    uint64_t scanTableOffset;
+    uint64_t mzOffset;
+    uint64_t intensityOffset;
+    uint64_t instrumentInfoOffset;
+    uint64_t stringTableOffset;
+    uint64_t fileSize;
+};
+
+struct ScanRecord
+{
+    int32_t mslevel;
+    int32_t centroided;
+    int32_t scannum;
+    int32_t precursorCharge;
+    int32_t precursorScanNum;
+    int32_t polarity;
+    float rt;
+    float originalRt;
+    float precursorMz;
+    float precursorIntensity;
+    float isolationWindow;
+    float productMz;
+    float collisionEnergy;
+    uint32_t filterLine;
+    uint32_t scanType;
+    uint32_t pointCount;
+    uint64_t pointOffset;
+    int64_t fileSeekStart;
+    int64_t fileSeekEnd;
+};
+
+static_assert(sizeof(CacheHeader) == 152, "unexpected mzcache header layout");
+static_assert(sizeof(ScanRecord) == 88, "unexpected mzcache scan layout");
+
+bool sourceStat(const string &sourceFile, uint64_t &size, int64_t &mtime)
+{
+    struct stat info;
+    if (stat(sourceFile.c_str(), &info) != 0)
+        return false;
+    size = info.st_size;
+    mtime = info.st_mtime;
+    return true;
+}
+
+void setFilters(CacheHeader &header)
+{
+    header.filterMsLevel = mzSample::getFilter_mslevel();
+    header.filterPolarity = mzSample::getFilter_polarity();
+    header.filterCentroidScans = mzSample::getFilter_centroidScans();
+    header.filterIntensityQuantile = mzSample::getFilter_intensityQuantile();
+    header.filterMinIntensity = mzSample::getFilter_minIntensity();
+}
+
+uint64_t aligned(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+/**
+ * @brief Interns strings of the string table, the empty string has id 0
+ */
+class StringTable
+{
+  public:
+    StringTable() { id(""); }
+
+    uint32_t id(const string &s)
+    {
+        auto found = _ids.find(s);
+        if (found != _ids.end())
+            return found->second;
+        uint32_t newId = _strings.size();
+        _ids[s] = newId;
+        _strings.push_back(s);
+        return newId;
+    }
+
+    const vector<string> &strings() const { return _strings; }
+
+  private:
+    map<string, uint32_t> _ids;
+    vector<string> _strings;
+};
+
+void pad(ofstream &out, uint64_t &offset)
+{
+    static const char zeros[8] = {0};
+    uint64_t next = aligned(offset);
+    out.write(zeros, next - offset);
+    offset = next;
+}
+
+} // namespace
+
+string SampleCache::cachePath(const string &sourceFile)
+{
+    string cacheDirectory = directory();
+    if (cacheDirectory.empty())
+        return sourceFile + ".mzcache";
+
+    // FNV-1a, so that names do not change between builds
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : sourceFile) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char hashText[17];
+    snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)hash);
+
+    string name = sourceFile;
+    size_t separator = name.find_last_of("/\\");
+    if (separator != string::npos)
+        name = name.substr(separator + 1);
+
+    char last = cacheDirectory[cacheDirectory.size() - 1];
+    if (last != '/' && last != '\\')
+        cacheDirectory += "/";
+    return cacheDirectory + name + "-" + hashText + ".mzcache";
+}
+
+void SampleCache::setDirectory(const string &directory)
+{
+    lock_guard<mutex> lock(_directoryMutex);
+    _directory = directory;
+}
+
+string SampleCache::directory()
+{
+    lock_guard<mutex> lock(_directoryMutex);
+    return _directory;
+}
+
+bool SampleCache::read(mzSample *sample, const string &sourceFile)
+{
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    if (!sourceStat(sourceFile, sourceSize, sourceMtime))
+        return false;
+
+    string path = cachePath(sourceFile);
+    ifstream in(path.c_str(), ios::in | ios::binary);
+    if (!in.is_open())
+        return false;
+
+    in.seekg(0, ios::end);
+    uint64_t fileSize = in.tellg();
+    in.seekg(0, ios::beg);
+
+    CacheHeader header;
+    CacheHeader expected;
+    setFilters(expected);
+    if (fileSize < sizeof(header)
+        || !in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0
+        || header.version != version
+        || header.byteOrder != byteOrderMark
+        || header.fileSize != fileSize
+        || header.sourceSize != sourceSize
+        || header.sourceMtime != sourceMtime
+        || header.filterMsLevel != expected.filterMsLevel
+        || header.filterPolarity != expected.filterPolarity
+        || header.filterCentroidScans != expected.filterCentroidScans
+        || header.filterIntensityQuantile != expected.filterIntensityQuantile
+        || header.filterMinIntensity != expected.filterMinIntensity)
+        return false;
+
+    // sections must lie within the file
+    if (header.scanTableOffset + header.scanCount * sizeof(ScanRecord) > fileSize
+        || header.mzOffset + header.pointCount * sizeof(float) > fileSize
+        || header.intensityOffset + header.pointCount * sizeof(float) > fileSize
+        || header.instrumentInfoOffset
+                   + header.instrumentInfoCount * 2 * sizeof(uint32_t)
+               > fileSize
+        || header.stringTableOffset > fileSize)
+        return false;
+
+    vector<string> strings(header.stringCount);
+    in.seekg(header.stringTableOffset);
+    for (string &s : strings) {
+        uint32_t length = 0;
+        if (!in.read(reinterpret_cast<char *>(&length), sizeof(length))
+            || length > fileSize)
+            return false;
+        s.resize(length);
+        if (length > 0 && !in.read(&s[0], length))
+            return false;
+    }
+
+    vector<uint32_t> instrumentIds(header.instrumentInfoCount * 2);
+    in.seekg(header.instrumentInfoOffset);
+    if (!instrumentIds.empty()
+        && !in.read(reinterpret_cast<char *>(instrumentIds.data()),
+                    instrumentIds.size() * sizeof(uint32_t)))
+        return false;
+    map<string, string> instrumentInfo;
+    for (unsigned int i = 0; i < instrumentIds.size(); i += 2) {
+        if (instrumentIds[i] >= strings.size()
+            || instrumentIds[i + 1] >= strings.size())
+            return false;
+        instrumentInfo[strings[instrumentIds[i]]] = strings[instrumentIds[i + 1]];
+    }
+
+    vector<ScanRecord> records(header.scanCount);
+    in.seekg(header.scanTableOffset);
+    if (!records.empty()
+        && !in.read(reinterpret_cast<char *>(records.data()),
+                    records.size() * sizeof(ScanRecord)))
+        return false;
+    for (const ScanRecord &record : records) {
+        if (record.pointOffset + record.pointCount > header.pointCount
+            || record.filterLine >= strings.size()
+            || record.scanType >= strings.size())
+            return false;
+    }
+
+    deque<Scan *> scans;
+    for (const ScanRecord &record : records) {
+        Scan *scan = new Scan(sample,
+                              record.scannum,
+                              record.mslevel,
+                              record.rt,
+                              record.precursorMz,
+                              record.polarity);
+        scan->originalRt = record.originalRt;
+        scan->centroided = record.centroided;
+        scan->precursorCharge = record.precursorCharge;
+        scan->precursorScanNum = record.precursorScanNum;
+        scan->precursorIntensity = record.precursorIntensity;
+        scan->isolationWindow = record.isolationWindow;
+        scan->productMz = record.productMz;
+        scan->collisionEnergy = record.collisionEnergy;
+        scan->fileSeekStart = record.fileSeekStart;
+        scan->fileSeekEnd = record.fileSeekEnd;
+        scan->filterLine = strings[record.filterLine];
+        scan->scanType = strings[record.scanType];
+        scan->mz.resize(record.pointCount);
+        scan->intensity.resize(record.pointCount);
+        scans.push_back(scan);
+    }
+
+    // both columns are read front to back, one scan at a time
+    bool columnsRead = true;
+    for (int column = 0; column < 2 && columnsRead; column++) {
+        uint64_t offset = column == 0 ? header.mzOffset : header.intensityOffset;
+        for (unsigned int i = 0; i < scans.size() && columnsRead; i++) {
+            vector<float> &values = column == 0 ? scans[i]->mz
+                                                : scans[i]->intensity;
+            if (values.empty())
+                continue;
+            in.seekg(offset + records[i].pointOffset * sizeof(float));
+            columnsRead = (bool)in.read(reinterpret_cast<char *>(values.data()),
+                                        values.size() * sizeof(float));
+        }
+    }
+    if (!columnsRead) {
+        mzUtils::delete_all(scans);
+        return false;
+    }
+
+    sample->scans.swap(scans);
+    sample->instrumentInfo = instrumentInfo;
+    sample->injectionTime = header.injectionTime;
+    sample->sampleNumber = header.sampleNumber;
+    sample->_numMS1Scans = header.ms1ScanCount;
+    sample->_numMS2Scans = header.ms2ScanCount;
+    return true;
+}
+
+bool SampleCache::write(mzSample *sample, const string &sourceFile)
+{
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    if (!sourceStat(sourceFile, header.sourceSize, header.sourceMtime))
+        return false;
+    setFilters(header);
+
+    header.sampleNumber = sample->sampleNumber;
+    header.injectionTime = sample->injectionTime;
+    header.ms1ScanCount = sample->_numMS1Scans;
+    header.ms2ScanCount = sample->_numMS2Scans;
+
+    StringTable strings;
+    vector<ScanRecord> records(sample->scans.size());
+    uint64_t pointCount = 0;
+    for (unsigned int i = 0; i < sample->scans.size(); i++) {
+        Scan *scan = sample->scans[i];
+        ScanRecord &record = records[i];
+        memset(&record, 0, sizeof(record));
+        record.mslevel = scan->mslevel;
+        record.centroided = scan->centroided;
+        record.scannum = scan->scannum;
+        record.precursorCharge = scan->precursorCharge;
+        record.precursorScanNum = scan->precursorScanNum;
+        record.polarity = scan->polarity;
+        record.rt = scan->rt;
+        record.originalRt = scan->originalRt;
+        record.precursorMz = scan->precursorMz;
+        record.precursorIntensity = scan->precursorIntensity;
+        record.isolationWindow = scan->isolationWindow;
+        record.productMz = scan->productMz;
+        record.collisionEnergy = scan->collisionEnergy;
+        record.fileSeekStart = scan->fileSeekStart;
+        record.fileSeekEnd = scan->fileSeekEnd;
+        record.filterLine = strings.id(scan->filterLine);
+        record.scanType = strings.id(scan->scanType);
+        record.pointCount = min(scan->mz.size(), scan->intensity.size());
+        record.pointOffset = pointCount;
+        pointCount += record.pointCount;
+    }
+
+    vector<uint32_t> instrumentIds;
+    for (auto &info : sample->instrumentInfo) {
+        instrumentIds.push_back(strings.id(info.first));
+        instrumentIds.push_back(strings.id(info.second));
+    }
+
+    header.scanCount = records.size();
+    header.pointCount = pointCount;
+    header.stringCount = strings.strings().size();
+    header.instrumentInfoCount = sample->instrumentInfo.size();
+    header.scanTableOffset = aligned(sizeof(header));
+    header.mzOffset = aligned(header.scanTableOffset
+                              + records.size() * sizeof(ScanRecord));
+    header.intensityOffset = aligned(header.mzOffset
+                                     + pointCount * sizeof(float));
+    header.instrumentInfoOffset = aligned(header.intensityOffset
+                                          + pointCount * sizeof(float));
+    header.stringTableOffset = aligned(header.instrumentInfoOffset
+                                       + instrumentIds.size() * sizeof(uint32_t));
+    header.fileSize = header.stringTableOffset;
+    for (const string &s : strings.strings())
+        header.fileSize += sizeof(uint32_t) + s.size();
+
+    string path = cachePath(sourceFile);
+    string temporaryPath = path + ".tmp";
+    ofstream out(temporaryPath.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    uint64_t offset = sizeof(header);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pad(out, offset);
+
+    if (!records.empty())
+        out.write(reinterpret_cast<const char *>(records.data()),
+                  records.size() * sizeof(ScanRecord));
+    offset += records.size() * sizeof(ScanRecord);
+    pad(out, offset);
+
+    for (int column = 0; column < 2; column++) {
+        for (unsigned int i = 0; i < records.size(); i++) {
+            const vector<float> &values = column == 0
+                                              ? sample->scans[i]->mz
+                                              : sample->scans[i]->intensity;
+            if (records[i].pointCount > 0)
+                out.write(reinterpret_cast<const char *>(values.data()),
+                          records[i].pointCount * sizeof(float));
+        }
+        offset += pointCount * sizeof(float);
+        pad(out, offset);
+    }
+
+    if (!instrumentIds.empty())
+        out.write(reinterpret_cast<const char *>(instrumentIds.data()),
+                  instrumentIds.size() * sizeof(uint32_t));
+    offset += instrumentIds.size() * sizeof(uint32_t);
+    pad(out, offset);
+
+    for (const string &s : strings.strings()) {
+        uint32_t length = s.size();
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        out.write(s.data(), length);
+    }
+
+    out.close();
+    if (out.fail()) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+
+    // rename does not replace existing files on every platform
+    remove(path.c_str());
+    if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
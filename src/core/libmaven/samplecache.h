@@ -0,0 +1,98 @@
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+class mzSample;
+
+using namespace std;
+
+/**
+ * @class SampleCache
+ * @ingroup libmaven
+ * @brief Binary sidecar cache of the scans of a sample
+ * @details The scans of a parsed sample are written to a cache file so that
+ * the sample can be reloaded without parsing and filtering the source again.
+ * A cache is only used while the size and modification time of its source,
+ * the scan filters of mzSample and the cache version are the ones it was
+ * written with.
+ *
+ * Caching is off by default, mzSample::loadSample only reads and writes
+ * caches once setEnabled(true) is called. Caches are written to the
+ * directory given to setDirectory, or next to their source file as
+ * "<source>.mzcache" if no directory is set. A cache that can not be written,
+ * for example because its directory is read only, is skipped and the sample
+ * is parsed from its source every time it is loaded.
+ *
+ * The file starts with a fixed size header followed by a table with one fixed
+ * size record per scan, the m/z and the intensity values of all scans as two
+ * contiguous float columns, and a table of strings (filterlines, scan types
+ * and instrument info). Every section starts at an 8 byte aligned offset
+ * stored in the header, so that the file can be mapped and its columns read
+ * in place. Values are stored in the byte order of the machine that wrote
+ * them, a cache written with another byte order is ignored.
+ */
+class SampleCache
+{
+  public:
+    /**
+     * @brief Version of the cache layout, caches of other versions are
+     * ignored and rewritten
+     */
+    static const uint32_t version = 2;
+
+    /**
+     * @brief Path of the cache of a source file
+     * @details Inside the cache directory, the name of the source file is
+     * followed by a hash of its path, so that samples with the same name in
+     * different folders get different caches.
+     */
+    static string cachePath(const string &sourceFile);
+
+    /**
+     * @brief Load the scans of a sample from the cache of its source file
+     * @details The sample is left untouched if there is no valid, up to date
+     * cache for the source file.
+     * @param sample Sample without scans
+     * @param sourceFile Path of the sample file
+     * @return True if the scans were loaded from the cache
+     */
+    static bool read(mzSample *sample, const string &sourceFile);
+
+    /**
+     * @brief Write the scans of a sample to the cache of its source file
+     * @details The cache is written to a temporary file that replaces the
+     * previous cache, an interrupted write never leaves a partial cache.
+     * @param sample Sample whose scans were just parsed from sourceFile
+     * @param sourceFile Path of the sample file
+     * @return True if the cache was written
+     */
+    static bool write(mzSample *sample, const string &sourceFile);
+
+    /**
+     * @brief Enable or disable reading and writing caches in
+     * mzSample::loadSample, caches are disabled by default
+     */
+    static void setEnabled(bool enabled) { _enabled = enabled; }
+
+    static bool isEnabled() { return _enabled; }
+
+    /**
+     * @brief Set the directory caches are written to
+     * @details The directory must exist. An empty directory, the default,
+     * keeps every cache next to its source file.
+     */
+    static void setDirectory(const string &directory);
+
+    static string directory();
+
+  private:
+    static atomic<bool> _enabled;
+    static mutex _directoryMutex;
+    static string _directory;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include "smoothingkernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SMOOTHING_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace mzUtils
+{
+    extern int savgol(float *c, int np, int nl, int nr, int ld, int m);
+
+    namespace {
+
+    enum KernelType
+    {
+        MovingAverage,
+        Gaussian,
+        SavitzkyGolay
+    };
+
+    // out[i] = sum of c[k] * p[i + k], for i in [0, count)
+    void convolveScalar(const float* p,
+                        const float* c,
+                        int m,
+                        float* out,
+                        int count)
+    {
+        for (int i = 0; i < count; i++) {
+            float sum = 0;
+            for (int k = 0; k < m; k++)
+                sum += c[k] * p[i + k];
+            out[i] = sum;
+        }
+    }
+
+#ifdef SMOOTHING_KERNEL_X86
+    // the vector versions compute adjacent outputs in separate lanes, every
+    // lane adds up its products in the same order as convolveScalar
+    __attribute__((target("sse2")))
+    void convolveSse2(const float* p,
+                      const float* c,
+                      int m,
+                      float* out,
+                      int count)
+    {
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128 sum0 = _mm_setzero_ps();
+            __m128 sum1 = _mm_setzero_ps();
+            for (int k = 0; k < m; k++) {
+                __m128 weight = _mm_set1_ps(c[k]);
+                sum0 = _mm_add_ps(sum0,
+                                  _mm_mul_ps(weight, _mm_loadu_ps(p + i + k)));
+                sum1 = _mm_add_ps(sum1,
+                                  _mm_mul_ps(weight,
+                                             _mm_loadu_ps(p + i + 4 + k)));
+            }
+            _mm_storeu_ps(out + i, sum0);
+            _mm_storeu_ps(out + i + 4, sum1);
+        }
+        for (; i + 4 <= count; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < m; k++) {
+                sum = _mm_add_ps(sum,
+                                 _mm_mul_ps(_mm_set1_ps(c[k]),
+                                            _mm_loadu_ps(p + i + k)));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+        convolveScalar(p + i, c, m, out + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    void convolveAvx2(const float* p,
+                      const float* c,
+                      int m,
+                      float* out,
+                      int count)
+    {
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256 sum0 = _mm256_setzero_ps();
+            __m256 sum1 = _mm256_setzero_ps();
+            for (int k = 0; k < m; k++) {
+                __m256 weight = _mm256_set1_ps(c[k]);
+                sum0 = _mm256_add_ps(sum0,
+                                     _mm256_mul_ps(weight,
+                                                   _mm256_loadu_ps(p + i + k)));
+                sum1 = _mm256_add_ps(sum1,
+                                     _mm256_mul_ps(weight,
+                                                   _mm256_loadu_ps(p + i + 8 + k)));
+            }
+            _mm256_storeu_ps(out + i, sum0);
+            _mm256_storeu_ps(out + i + 8, sum1);
+        }
+        for (; i + 8 <= count; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < m; k++) {
+                sum = _mm256_add_ps(sum,
+                                    _mm256_mul_ps(_mm256_set1_ps(c[k]),
+                                                  _mm256_loadu_ps(p + i + k)));
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+        convolveScalar(p + i, c, m, out + i, count - i);
+    }
+#endif
+
+    void convolve(const float* p, const float* c, int m, float* out, int count)
+    {
+        if (count <= 0)
+            return;
+
+#ifdef SMOOTHING_KERNEL_X86
+        switch (SmoothingKernel::instructionSet()) {
+        case SmoothingKernel::InstructionSet::AVX2:
+            convolveAvx2(p, c, m, out, count);
+            return;
+        case SmoothingKernel::InstructionSet::SSE2:
+            convolveSse2(p, c, m, out, count);
+            return;
+        default:
+            break;
+        }
+#endif
+        convolveScalar(p, c, m, out, count);
+    }
+
+    }
+
+    atomic<SmoothingKernel::InstructionSet> SmoothingKernel::_instructionSet(
+        SmoothingKernel::supportedInstructionSet());
+
+    SmoothingKernel::SmoothingKernel()
+    {
+        _coefficients.assign(1, 1.0f);
+        _origin = 0;
+        _smoothEdges = true;
+        _clampNegative = false;
+    }
+
+    SmoothingKernel::InstructionSet SmoothingKernel::supportedInstructionSet()
+    {
+#ifdef SMOOTHING_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return InstructionSet::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return InstructionSet::SSE2;
+#endif
+        return InstructionSet::Scalar;
+    }
+
+    void SmoothingKernel::setInstructionSet(InstructionSet instructionSet)
+    {
+        _instructionSet = min(instructionSet, supportedInstructionSet());
+    }
+
+    const SmoothingKernel& SmoothingKernel::movingAverage(int window)
+    {
+        return _cached(MovingAverage, window, 0);
+    }
+
+    const SmoothingKernel& SmoothingKernel::gaussian(int halfWidth)
+    {
+        return _cached(Gaussian, halfWidth, 0);
+    }
+
+    const SmoothingKernel& SmoothingKernel::savitzkyGolay(int halfWindow,
+                                                          int order)
+    {
+        return _cached(SavitzkyGolay, halfWindow, order);
+    }
+
+    const SmoothingKernel& SmoothingKernel::_cached(int type,
+                                                    int window,
+                                                    int order)
+    {
+        // each thread keeps its own kernels, so that threads smoothing EICs
+        // concurrently never wait on each other for a lookup
+        static thread_local map<tuple<int, int, int>, SmoothingKernel> cache;
+
+        auto key = make_tuple(type, window, order);
+        auto cached = cache.find(key);
+        if (cached != cache.end())
+            return cached->second;
+
+        SmoothingKernel kernel;
+        if (type == MovingAverage && window > 0) {
+            // same span as conv(window, -window / 2, ...) in smoothAverage
+            kernel._coefficients.assign(window, 1.0 / window);
+            kernel._origin = window - 1 - window / 2;
+        } else if (type == Gaussian && window > 0) {
+            // weights as computed by gaussian1d_smoothing, reversed since
+            // conv computes a convolution rather than a correlation
+            float fcut = 1.0 / window;
+            if (window > 100)
+                fcut = 1.0 / 100;
+            int n = (int)(3.0 / fcut + 0.5);
+            n = 2 * n / 2 + 1;
+            int mean = n / 2;
+
+            vector<float> s(n);
+            float sum = 0.0;
+            for (int is = 1; is <= n; is++) {
+                float r = is - mean - 1;
+                r = -r * r * fcut * fcut * 3.141;
+                s[is - 1] = exp(r);
+            }
+            for (int is = 0; is < n; is++)
+                sum += s[is];
+            for (int is = 0; is < n; is++)
+                s[is] /= sum;
+
+            kernel._coefficients.assign(s.rbegin(), s.rend());
+            kernel._origin = n - 1 - mean;
+        } else if (type == SavitzkyGolay && window > 0) {
+            // weights unwrapped as in SavGolSmoother::SetOptions
+            int np = 2 * window + 1;
+            vector<float> golay(np + 2, 0.0f);
+            savgol(golay.data(), np, window, window, 0, order);
+
+            int numCoeffs = window * 2;
+            kernel._coefficients.assign(np, 0.0f);
+            for (int i = 0; i <= window; i++)
+                kernel._coefficients[numCoeffs / 2 - i] = golay[i + 1];
+            for (int i = 1; i <= window; i++)
+                kernel._coefficients[numCoeffs / 2 + i] = golay[numCoeffs - i];
+            kernel._origin = window;
+            kernel._smoothEdges = false;
+            kernel._clampNegative = true;
+        }
+        return cache.insert(make_pair(key, kernel)).first->second;
+    }
+
+    void SmoothingKernel::apply(const float* in,
+                                float* out,
+                                int n,
+                                vector<float>& scratch) const
+    {
+        if (n <= 0)
+            return;
+
+        int m = _coefficients.size();
+        const float* c = _coefficients.data();
+
+        if (_smoothEdges) {
+            // values beyond either end are taken as zero
+            scratch.assign(n + m - 1, 0.0f);
+            copy(in, in + n, scratch.begin() + _origin);
+            convolve(scratch.data(), c, m, out, n);
+        } else {
+            // like SavGolSmoother, only points whose window lies within the
+            // values and ends before the last one are smoothed
+            if (scratch.size() < (size_t)n)
+                scratch.resize(n);
+            copy(in, in + n, scratch.begin());
+            int count = max(n - m, 0);
+            convolve(scratch.data(), c, m, out + _origin, count);
+            copy(scratch.begin(), scratch.begin() + min(_origin, n), out);
+            copy(scratch.begin() + min(_origin + count, n),
+                 scratch.begin() + n,
+                 out + min(_origin + count, n));
+
+            if (_clampNegative) {
+                for (int i = _origin; i < _origin + count; i++) {
+                    if (out[i] < 0)
+                        out[i] = 0;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef SMOOTHINGKERNEL_H
+#define SMOOTHINGKERNEL_H
+
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+namespace mzUtils
+{
+    /**
+     * @class SmoothingKernel
+     * @ingroup libmaven
+     * @brief Precomputed convolution weights of a smoothing filter
+     * @details Kernels are built once per thread for every window (and
+     * order) and then reused, so that smoothing an EIC neither recomputes the
+     * filter weights nor waits on other threads. A kernel returned by one of
+     * the factories stays valid until the thread that asked for it exits.
+     * The convolution computes several outputs at once with SSE2 or AVX2
+     * instructions, chosen at runtime from what the processor supports, and
+     * falls back to scalar code elsewhere. Every output is accumulated over
+     * the weights in the same order for all instruction sets.
+     *
+     * Kernels are immutable and can be applied concurrently, each thread
+     * with its own scratch buffer.
+     */
+    class SmoothingKernel
+    {
+      public:
+        enum class InstructionSet
+        {
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        /**
+         * @brief Moving average over a window of points, the same filter as
+         * mzUtils::smoothAverage
+         */
+        static const SmoothingKernel& movingAverage(int window);
+
+        /**
+         * @brief Gaussian filter with half amplitude at halfWidth points,
+         * the same filter as mzUtils::gaussian1d_smoothing
+         */
+        static const SmoothingKernel& gaussian(int halfWidth);
+
+        /**
+         * @brief Savitzky-Golay filter, the same filter as
+         * mzUtils::SavGolSmoother with halfWindow points on either side
+         * @details Points closer to the ends than the window are copied, and
+         * negative smoothed values are set to zero.
+         */
+        static const SmoothingKernel& savitzkyGolay(int halfWindow, int order);
+
+        /**
+         * @brief Smooth n values
+         * @param in Values to smooth
+         * @param out Smoothed values, may be the same array as in
+         * @param n Number of values
+         * @param scratch Buffer reused between calls, grown when needed
+         */
+        void apply(const float* in,
+                   float* out,
+                   int n,
+                   vector<float>& scratch) const;
+
+        const vector<float>& coefficients() const { return _coefficients; }
+
+        /**
+         * @brief Instruction set supported by this processor
+         */
+        static InstructionSet supportedInstructionSet();
+
+        /**
+         * @brief Select the instruction set used by apply, restricted to the
+         * supported one; the supported instruction set is used by default
+         */
+        static void setInstructionSet(InstructionSet instructionSet);
+
+        static InstructionSet instructionSet() { return _instructionSet; }
+
+      private:
+        SmoothingKernel();
+
+        // out[i] is the sum of _coefficients[k] * in[i - _origin + k]
+        vector<float> _coefficients;
+        int _origin;
+        bool _smoothEdges;
+        bool _clampNegative;
+
+        static atomic<InstructionSet> _instructionSet;
+
+        static const SmoothingKernel& _cached(int type, int window, int order);
+    };
+}
+
+#endif
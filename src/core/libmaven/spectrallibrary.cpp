@@ -0,0 +1,194 @@
+#include "spectrallibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <omp.h>
+
+#include "Compound.h"
+#include "masscutofftype.h"
+
+SpectralLibrary::SpectralLibrary()
+{
+    _binWidth = 0.01;
+}
+
+SpectralLibrary::~SpectralLibrary()
+{
+    _clear();
+}
+
+void SpectralLibrary::_clear()
+{
+    for (Spectrum &spectrum : _spectra)
+        delete spectrum.fragment;
+    _spectra.clear();
+    _binKeys.clear();
+    _binOffsets.clear();
+    _binSpectra.clear();
+    _binFragments.clear();
+}
+
+long SpectralLibrary::_binOf(double mz) const
+{
+    return (long)floor(mz / _binWidth);
+}
+
+void SpectralLibrary::build(const deque<Compound *> &compounds,
+                            bool searchProton,
+                            float binWidth)
+{
+    _clear();
+    _binWidth = binWidth > 0 ? binWidth : 0.01;
+
+    for (Compound *compound : compounds) {
+        if (compound->fragmentMzValues.size() < 2
+            || compound->fragmentIntensities.size()
+                   != compound->fragmentMzValues.size())
+            continue;
+
+        Spectrum spectrum;
+        spectrum.compound = compound;
+        spectrum.fragment = new Fragment();
+        compound->buildLibraryFragment(*spectrum.fragment, searchProton);
+        spectrum.mzOrder = spectrum.fragment->mzSortIncreasing();
+        spectrum.bins = spectrum.fragment->asSparseVector(100, 2000, 2000);
+        _spectra.push_back(spectrum);
+    }
+
+    // every library fragment is posted to the bin of its m/z
+    vector<pair<long, pair<unsigned int, unsigned int>>> postings;
+    for (unsigned int s = 0; s < _spectra.size(); s++) {
+        const vector<float> &mzs = _spectra[s].fragment->mzValues;
+        for (unsigned int f = 0; f < mzs.size(); f++)
+            postings.push_back(make_pair(_binOf(mzs[f]), make_pair(s, f)));
+    }
+    sort(postings.begin(), postings.end());
+
+    _binSpectra.reserve(postings.size());
+    _binFragments.reserve(postings.size());
+    for (auto &posting : postings) {
+        if (_binKeys.empty() || _binKeys.back() != posting.first) {
+            _binKeys.push_back(posting.first);
+            _binOffsets.push_back(_binSpectra.size());
+        }
+        _binSpectra.push_back(posting.second.first);
+        _binFragments.push_back(posting.second.second);
+    }
+    _binOffsets.push_back(_binSpectra.size());
+}
+
+vector<unsigned int> SpectralLibrary::candidates(Fragment *query,
+                                                 float productPpmTolr,
+                                                 int minMatches) const
+{
+    vector<unsigned int> found;
+    if (_spectra.empty())
+        return found;
+
+    // library fragments that may lie within tolerance of a query fragment,
+    // the window is measured from the library m/z so it is widened here
+    masstolerance::Ppm tolerance(productPpmTolr);
+    vector<uint64_t> hits;
+    for (float mz : query->mzValues) {
+        double window = 2 * tolerance.window(mz);
+        long lastBin = _binOf(mz + window);
+        auto bin = lower_bound(_binKeys.begin(),
+                               _binKeys.end(),
+                               _binOf(mz - window));
+        for (; bin != _binKeys.end() && *bin <= lastBin; bin++) {
+            unsigned int b = bin - _binKeys.begin();
+            for (unsigned int p = _binOffsets[b]; p < _binOffsets[b + 1]; p++) {
+                hits.push_back(((uint64_t)_binSpectra[p] << 32)
+                               | _binFragments[p]);
+            }
+        }
+    }
+    sort(hits.begin(), hits.end());
+    hits.erase(unique(hits.begin(), hits.end()), hits.end());
+
+    // a spectrum can not match more fragments than it has near the query
+    unsigned int required = max(minMatches, 1);
+    unsigned int i = 0;
+    while (i < hits.size()) {
+        unsigned int spectrum = hits[i] >> 32;
+        unsigned int count = 0;
+        while (i < hits.size() && (hits[i] >> 32) == spectrum) {
+            count++;
+            i++;
+        }
+        if (count >= required)
+            found.push_back(spectrum);
+    }
+    return found;
+}
+
+vector<SpectralLibrary::Match> SpectralLibrary::search(Fragment *query,
+                                                       float productPpmTolr,
+                                                       string scoringAlgorithm,
+                                                       int minMatches,
+                                                       float precursorPpmTolr) const
+{
+    vector<Match> matches;
+    if (query->nobs() < 2)
+        return matches;
+
+    vector<int> queryMzOrder = query->mzSortIncreasing();
+    vector<pair<int, float>> queryBins = query->asSparseVector(100, 2000, 2000);
+
+    for (unsigned int s : candidates(query, productPpmTolr, minMatches)) {
+        const Spectrum &spectrum = _spectra[s];
+        Fragment *libFrag = spectrum.fragment;
+
+        if (precursorPpmTolr > 0) {
+            double ppmError = abs((libFrag->precursorMz - query->precursorMz)
+                                  / libFrag->precursorMz * 1e6);
+            if (!(ppmError <= precursorPpmTolr))
+                continue;
+        }
+
+        vector<int> ranks = Fragment::compareRanks(libFrag,
+                                                   spectrum.mzOrder,
+                                                   query,
+                                                   queryMzOrder,
+                                                   productPpmTolr);
+        double dotProduct = libFrag->dotProduct(query, spectrum.bins, queryBins);
+        FragmentationMatchScore score = libFrag->scoreRanks(query,
+                                                            ranks,
+                                                            dotProduct);
+        if (score.numMatches < minMatches)
+            continue;
+
+        score.mergedScore = score.getScoreByName(scoringAlgorithm);
+        Match match;
+        match.compound = spectrum.compound;
+        match.score = score;
+        matches.push_back(match);
+    }
+
+    stable_sort(matches.begin(),
+                matches.end(),
+                [](const Match &a, const Match &b) {
+                    return a.score.mergedScore > b.score.mergedScore;
+                });
+    return matches;
+}
+
+vector<vector<SpectralLibrary::Match>>
+SpectralLibrary::search(const vector<Fragment *> &queries,
+                        float productPpmTolr,
+                        string scoringAlgorithm,
+                        int minMatches,
+                        float precursorPpmTolr) const
+{
+    vector<vector<Match>> matches(queries.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)queries.size(); i++) {
+        matches[i] = search(queries[i],
+                            productPpmTolr,
+                            scoringAlgorithm,
+                            minMatches,
+                            precursorPpmTolr);
+    }
+    return matches;
+}
@@ -0,0 +1,126 @@
+#ifndef SPECTRALLIBRARY_H
+#define SPECTRALLIBRARY_H
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Fragment.h"
+
+class Compound;
+
+using namespace std;
+
+/**
+ * @class SpectralLibrary
+ * @ingroup libmaven
+ * @brief Matches experimental MS2 spectra against the fragmentation spectra
+ * of a compound library
+ * @details Library spectra are built and sorted once, in the same way
+ * Compound::scoreCompoundHit builds them for every call. Every library
+ * fragment is also stored in an inverted index from its m/z bin to the
+ * spectra it belongs to. A search only scores spectra that have at least as
+ * many fragments within the product tolerance of the query as the required
+ * number of matches, and scores them over m/z sorted arrays. Scores of a
+ * scored spectrum are identical to the ones of Compound::scoreCompoundHit.
+ *
+ * Searches do not modify the library and can run concurrently.
+ */
+class SpectralLibrary
+{
+  public:
+    /**
+     * @brief A library compound matching a query spectrum
+     */
+    struct Match
+    {
+        Compound *compound;
+        FragmentationMatchScore score;
+    };
+
+    /**
+     * @brief Constructor for class SpectralLibrary
+     */
+    SpectralLibrary();
+
+    ~SpectralLibrary();
+
+    /**
+     * @brief Build the library from the fragmentation spectra of compounds
+     * @details Previously added spectra are dropped. Compounds with less
+     * than two fragments, or without an intensity for every fragment, are
+     * skipped since they can not be scored.
+     * @param compounds Compounds of a reference library
+     * @param searchProton Also match fragments shifted by the gain and loss
+     * of a proton
+     * @param binWidth Width of the m/z bins of the inverted index
+     */
+    void build(const deque<Compound *> &compounds,
+               bool searchProton = false,
+               float binWidth = 0.01);
+
+    /**
+     * @brief Number of spectra in the library
+     */
+    size_t size() const { return _spectra.size(); }
+
+    /**
+     * @brief Find library compounds whose spectra match a query spectrum
+     * @param query Experimental spectrum, e.g., a consensus fragmentation
+     * pattern of a peak group
+     * @param productPpmTolr Fragment tolerance in ppm
+     * @param scoringAlgorithm Name of the score that ranks the matches, see
+     * FragmentationMatchScore::getScoringAlgorithmNames
+     * @param minMatches Minimum number of matched library fragments
+     * @param precursorPpmTolr Precursor tolerance in ppm, 0 to match spectra
+     * regardless of their precursor
+     * @return Matches sorted by decreasing score, ties in library order
+     */
+    vector<Match> search(Fragment *query,
+                         float productPpmTolr,
+                         string scoringAlgorithm,
+                         int minMatches = 1,
+                         float precursorPpmTolr = 0) const;
+
+    /**
+     * @brief Search a batch of query spectra in parallel
+     * @return Matches of every query, in query order
+     */
+    vector<vector<Match>> search(const vector<Fragment *> &queries,
+                                 float productPpmTolr,
+                                 string scoringAlgorithm,
+                                 int minMatches = 1,
+                                 float precursorPpmTolr = 0) const;
+
+    /**
+     * @brief Positions of library spectra that are scored for a query
+     */
+    vector<unsigned int> candidates(Fragment *query,
+                                    float productPpmTolr,
+                                    int minMatches = 1) const;
+
+  private:
+    struct Spectrum
+    {
+        Compound *compound;
+        Fragment *fragment;
+        vector<int> mzOrder;
+        vector<pair<int, float>> bins;
+    };
+
+    vector<Spectrum> _spectra;
+    float _binWidth;
+
+    // inverted index, stored as sorted unique m/z bins with offsets into
+    // the spectrum and fragment positions of each bin
+    vector<long> _binKeys;
+    vector<unsigned int> _binOffsets;
+    vector<unsigned int> _binSpectra;
+    vector<unsigned int> _binFragments;
+
+    void _clear();
+    long _binOf(double mz) const;
+};
+
+#endif
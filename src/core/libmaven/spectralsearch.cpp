@@ -0,0 +1,319 @@
+#include "spectralsearch.h"
+
+#include <omp.h>
+
+#include "mzSample.h"
+#include "mzUtils.h"
+
+SpectralSearch::SpectralSearch()
+{
+    _searchType = FragmentSearch;
+    _msLevel = 0;
+    _precursorMz = 0;
+    _minMatches = 0;
+    _batchSize = 256;
+    _boundChecking = false;
+    _stopped = false;
+}
+
+void SpectralSearch::setSamples(const vector<mzSample *> &samples)
+{
+    _samples = samples;
+
+    // fragmentation scans of all samples sorted by precursor m/z, ties in
+    // sample and acquisition order
+    _precursorIndex.clear();
+    for (unsigned int s = 0; s < _samples.size(); s++) {
+        const vector<Scan *> &scans = _samples[s]->fragmentationScans();
+        const vector<unsigned int> &positions =
+            _samples[s]->fragmentationScanPositions();
+        for (unsigned int i = 0; i < scans.size(); i++) {
+            IndexedScan entry;
+            entry.precursorMz = scans[i]->precursorMz;
+            entry.sampleIndex = s;
+            entry.position = positions[i];
+            entry.scan = scans[i];
+            _precursorIndex.push_back(entry);
+        }
+    }
+    stable_sort(_precursorIndex.begin(),
+                _precursorIndex.end(),
+                [](const IndexedScan &a, const IndexedScan &b) {
+                    return a.precursorMz < b.precursorMz;
+                });
+}
+
+void SpectralSearch::setQuery(const vector<double> &mzs,
+                              const vector<double> &intensities,
+                              const vector<double> &minIntensityErr,
+                              const vector<double> &maxIntensityErr,
+                              bool boundChecking)
+{
+    _mzs = mzs;
+    _intensities = intensities;
+    _minIntensityErr = minIntensityErr;
+    _maxIntensityErr = maxIntensityErr;
+    _boundChecking = boundChecking;
+}
+
+vector<Scan *> SpectralSearch::_candidates()
+{
+    vector<Scan *> candidates;
+
+    if (_searchType == FragmentSearch && _precursorMz > 0) {
+        // only scans within the (slightly widened) precursor window can
+        // match, the exact check is still done while scoring
+        double window = _precursorMassCutoff.massCutoffValue(_precursorMz);
+        window = window * 1.01 + 1e-4;
+        auto first = lower_bound(_precursorIndex.begin(),
+                                 _precursorIndex.end(),
+                                 (float)(_precursorMz - window),
+                                 [](const IndexedScan &entry, float mz) {
+                                     return entry.precursorMz < mz;
+                                 });
+        vector<IndexedScan> inWindow;
+        for (auto entry = first;
+             entry != _precursorIndex.end()
+             && entry->precursorMz <= _precursorMz + window;
+             entry++) {
+            if (_msLevel > 0 && entry->scan->mslevel != _msLevel)
+                continue;
+            inWindow.push_back(*entry);
+        }
+
+        // candidates are scored in the order of a full scan
+        sort(inWindow.begin(),
+             inWindow.end(),
+             [](const IndexedScan &a, const IndexedScan &b) {
+                 if (a.sampleIndex != b.sampleIndex)
+                     return a.sampleIndex < b.sampleIndex;
+                 return a.position < b.position;
+             });
+        for (const IndexedScan &entry : inWindow)
+            candidates.push_back(entry.scan);
+        return candidates;
+    }
+
+    for (mzSample *sample : _samples) {
+        if (_msLevel > 0) {
+            vector<unsigned int> positions =
+                sample->scanPositionsForMsLevel(_msLevel);
+            sort(positions.begin(), positions.end());
+            for (unsigned int position : positions)
+                candidates.push_back(sample->scans[position]);
+        } else {
+            candidates.insert(candidates.end(),
+                              sample->scans.begin(),
+                              sample->scans.end());
+        }
+    }
+    return candidates;
+}
+
+size_t SpectralSearch::candidateCount()
+{
+    return _candidates().size();
+}
+
+vector<SpectralSearchHit> SpectralSearch::run()
+{
+    _patternScores.clear();
+
+    vector<SpectralSearchHit> allHits;
+    if (_mzs.empty())
+        return allHits;
+
+    vector<Scan *> candidates = _candidates();
+    unsigned int total = candidates.size();
+
+    for (unsigned int start = 0; start < total && !_stopped; start += _batchSize) {
+        unsigned int end = min(total, start + _batchSize);
+
+        // every scan is scored independently, hits are then collected in
+        // candidate order
+        vector<vector<SpectralSearchHit> > scanHits(end - start);
+        vector<vector<float> > scanScores(end - start);
+#pragma omp parallel for schedule(dynamic)
+        for (int i = start; i < (int)end; i++) {
+            Scan *scan = candidates[i];
+            if (_searchType == PatternSearch) {
+                _matchPattern(scan, scanHits[i - start], scanScores[i - start]);
+            } else {
+                _scoreScan(scan, scanHits[i - start]);
+            }
+        }
+
+        vector<SpectralSearchHit> batchHits;
+        for (unsigned int i = 0; i < scanHits.size(); i++) {
+            batchHits.insert(batchHits.end(),
+                             scanHits[i].begin(),
+                             scanHits[i].end());
+            _patternScores.insert(_patternScores.end(),
+                                  scanScores[i].begin(),
+                                  scanScores[i].end());
+        }
+
+        if (!batchHits.empty())
+            hitsFound(batchHits);
+        progress(end, total);
+        allHits.insert(allHits.end(), batchHits.begin(), batchHits.end());
+    }
+    return allHits;
+}
+
+void SpectralSearch::_scoreScan(Scan *scan, vector<SpectralSearchHit> &hits)
+{
+    if (_msLevel > 0 && scan->mslevel != _msLevel)
+        return;
+    if (_precursorMz > 0
+        && mzUtils::massCutoffDist(_precursorMz,
+                                   (double)scan->precursorMz,
+                                   &_precursorMassCutoff)
+               > _precursorMassCutoff.getMassCutoff())
+        return;
+
+    ScanPeaksPin pin(scan);
+
+    float score = 0;
+    int matchCount = 0;
+    int N = _mzs.size();
+    int Nc = _intensities.size();
+
+    float totalIntensity = scan->totalIntensity();
+
+    vector<float> x;
+    vector<float> y;
+    for (int i = 0; i < N; i++) {
+        int pos = scan->findHighestIntensityPos(_mzs[i], &_productMassCutoff);
+        if (pos >= 0) {
+            matchCount++;
+            if (Nc == 0) {
+                score += log(scan->intensity[pos]);
+            } else {
+                x.push_back(_intensities[i]);
+                y.push_back(scan->intensity[pos] / totalIntensity);
+            }
+        } else {
+            if (Nc == 0) {
+                score--;
+            } else {
+                x.push_back(_intensities[i]);
+                y.push_back(-_intensities[i]);
+            }
+        }
+    }
+
+    if (Nc)
+        score = mzUtils::correlation(x, y);
+
+    if (score > 0 and matchCount > _minMatches) {
+        SpectralSearchHit hit;
+        hit.score = score;
+        hit.precursorMz = _mzs[0];
+        hit.matchCount = matchCount;
+        hit.scan = scan;
+        hit.mzs = _mzs;
+        hit.intensities = _intensities;
+        hits.push_back(hit);
+    }
+}
+
+void SpectralSearch::_matchPattern(Scan *scan,
+                                   vector<SpectralSearchHit> &hits,
+                                   vector<float> &scores)
+{
+    if (_msLevel > 0 && scan->mslevel != _msLevel)
+        return;
+
+    ScanPeaksPin pin(scan);
+
+    //convert mzs to deltaMasses
+    unsigned int N = _mzs.size();
+
+    vector<double> patternMzsObserved(N, 0);
+    vector<double> patternIntensityObserved(N, 0);
+    vector<double> patternIntensityGiven(N, 0);
+    vector<double> deltaListGiven(N - 1, 0);
+
+    //delta mass list
+    for (unsigned int i = 1; i < N; i++)
+        deltaListGiven[i - 1] = _mzs[0] - _mzs[i];
+
+    //find largest intensity in a pattern
+    double maxGivenIntensity = 0;
+    for (unsigned int i = 0; i < _intensities.size(); i++) {
+        if (_intensities[i] > maxGivenIntensity)
+            maxGivenIntensity = _intensities[i];
+    }
+
+    //normalize patern intensities by the biggest value
+    for (unsigned int i = 0; i < _intensities.size(); i++)
+        patternIntensityGiven[i] = _intensities[i] / maxGivenIntensity * 100;
+
+    //compute max allowed difference between pattern and match
+    double maxDiff = 0;
+    for (unsigned int i = 0; i < patternIntensityGiven.size(); i++)
+        maxDiff += log(100);
+
+    //sliding window pattern search.. compare pattern to every peak in a scan
+    for (unsigned int i = 0; i < scan->nobs(); i++) {
+
+        //first value to match
+        double startMz = patternMzsObserved[0] = scan->mz[i];
+        double maxObservedIntensity = patternIntensityObserved[0] = scan->intensity[i];
+
+        int matchCount = 0;
+        for (unsigned int j = 0; j < deltaListGiven.size(); j++) {
+            double expectedMz = startMz - deltaListGiven[j];
+            int pos = scan->findHighestIntensityPos(expectedMz, &_productMassCutoff);
+
+            if (pos >= 0) {
+                matchCount++;
+                if (scan->intensity[pos] > maxObservedIntensity)
+                    maxObservedIntensity = scan->intensity[pos];
+                patternMzsObserved[j + 1] = scan->mz[pos];
+                patternIntensityObserved[j + 1] = scan->intensity[pos];
+            } else {
+                patternMzsObserved[j + 1] = expectedMz;
+                patternIntensityObserved[j + 1] = 0;
+            }
+        }
+
+        //score = 1-SUM(|log(given/observed)|) / maxDifference
+        double score = 0;
+        for (unsigned int k = 0; k < N; k++) {
+            patternIntensityObserved[k] = patternIntensityObserved[k] / maxObservedIntensity * 100;
+            double ratio = abs((patternIntensityGiven[k] + 1) / (patternIntensityObserved[k] + 1));
+
+            //bound checking if specified
+            if (_boundChecking) {
+                score += abs(log(ratio));
+                if (patternIntensityObserved[k] < _minIntensityErr[k]
+                    || patternIntensityObserved[k] > _maxIntensityErr[k]) {
+                    score = maxDiff;
+                    break;
+                }
+            } else if (k < _maxIntensityErr.size()) {
+                float weight = _maxIntensityErr[k];
+                score += weight * abs(log(ratio));
+            } else {
+                score += abs(log(ratio));
+            }
+        }
+
+        double scoreN = 1.0 - (score / maxDiff);
+        if (scoreN > -1)
+            scores.push_back(scoreN);
+
+        if (matchCount >= _minMatches and scoreN > 0) {
+            SpectralSearchHit hit;
+            hit.score = scoreN;
+            hit.precursorMz = patternMzsObserved[0];
+            hit.matchCount = matchCount;
+            hit.scan = scan;
+            hit.mzs = patternMzsObserved;
+            hit.intensities = patternIntensityObserved;
+            hits.push_back(hit);
+        }
+    }
+}
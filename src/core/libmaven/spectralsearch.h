@@ -0,0 +1,166 @@
+#ifndef SPECTRALSEARCH_H
+#define SPECTRALSEARCH_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <boost/signals2.hpp>
+
+#include "masscutofftype.h"
+#include "statistics.h"
+
+class mzSample;
+class Scan;
+
+using namespace std;
+
+/**
+ * @brief A scan matching the query of a spectral search
+ */
+struct SpectralSearchHit
+{
+    double score;
+    float precursorMz;
+    int matchCount;
+    Scan *scan;
+    vector<double> mzs;
+    vector<double> intensities;
+};
+
+/**
+ * @class SpectralSearch
+ * @ingroup libmaven
+ * @brief Searches scans of samples for a fragment list or isotopic pattern
+ * @details Fragmentation scans of all samples are indexed by precursor m/z,
+ * so that a fragment search with a precursor m/z only scores scans within
+ * the precursor mass cutoff. Candidate scans are scored in parallel, in
+ * batches. Hits of every batch are passed to the hitsFound signal, in sample
+ * and scan order, as soon as the batch is scored. The search can be stopped
+ * from another thread between batches.
+ */
+class SpectralSearch
+{
+  public:
+    enum SearchType
+    {
+        FragmentSearch,
+        PatternSearch
+    };
+
+    SpectralSearch();
+
+    /**
+     * @brief Set samples to be searched and index their fragmentation scans
+     * @param samples Samples to be searched
+     */
+    void setSamples(const vector<mzSample *> &samples);
+
+    /**
+     * @brief Set the searched m/z values and their expected intensities
+     * @param mzs m/z values of fragments or of the isotopic pattern
+     * @param intensities Expected intensities, may be empty
+     * @param minIntensityErr Lower bounds of intensities for patterns
+     * @param maxIntensityErr Upper bounds (or weights) of intensities
+     * @param boundChecking True if pattern intensities must lie within their
+     * bounds
+     */
+    void setQuery(const vector<double> &mzs,
+                  const vector<double> &intensities,
+                  const vector<double> &minIntensityErr,
+                  const vector<double> &maxIntensityErr,
+                  bool boundChecking);
+
+    void setSearchType(SearchType type) { _searchType = type; }
+    void setMsLevel(int mslevel) { _msLevel = mslevel; }
+    void setPrecursorMz(double mz) { _precursorMz = mz; }
+    void setPrecursorMassCutoff(const MassCutoff &cutoff) { _precursorMassCutoff = cutoff; }
+    void setProductMassCutoff(const MassCutoff &cutoff) { _productMassCutoff = cutoff; }
+    void setMinMatches(int matches) { _minMatches = matches; }
+    void setBatchSize(unsigned int size) { _batchSize = size > 0 ? size : 1; }
+
+    /**
+     * @brief Run the search
+     * @details Blocks until all candidate scans are scored or the search is
+     * stopped.
+     * @return All hits found, in sample and scan order
+     */
+    vector<SpectralSearchHit> run();
+
+    /**
+     * @brief Stop a running search after its current batch
+     * @details A search stopped before it runs returns without scoring
+     * any scan, until clearStop is called.
+     */
+    void stop() { _stopped = true; }
+
+    /**
+     * @brief Allow a stopped search to run again
+     * @details Called when a search is started, rather than by run, so that
+     * a stop requested before run begins is not lost.
+     */
+    void clearStop() { _stopped = false; }
+
+    /**
+     * @brief Check whether the last search was stopped
+     */
+    bool stopped() const { return _stopped; }
+
+    /**
+     * @brief Number of candidate scans for the current query
+     */
+    size_t candidateCount();
+
+    /**
+     * @brief Normalized scores of all windows compared by the last pattern
+     * search
+     */
+    const StatisticsVector<float> &patternScores() const { return _patternScores; }
+
+    /**
+     * @brief Emitted with the hits of every scored batch
+     */
+    boost::signals2::signal<void(const vector<SpectralSearchHit> &)> hitsFound;
+
+    /**
+     * @brief Emitted after every batch with scored and total candidates
+     */
+    boost::signals2::signal<void(unsigned int, unsigned int)> progress;
+
+  private:
+    struct IndexedScan
+    {
+        float precursorMz;
+        unsigned int sampleIndex;
+        unsigned int position;
+        Scan *scan;
+    };
+
+    vector<mzSample *> _samples;
+    vector<IndexedScan> _precursorIndex;
+
+    SearchType _searchType;
+    int _msLevel;
+    double _precursorMz;
+    MassCutoff _precursorMassCutoff;
+    MassCutoff _productMassCutoff;
+    int _minMatches;
+    unsigned int _batchSize;
+
+    vector<double> _mzs;
+    vector<double> _intensities;
+    vector<double> _minIntensityErr;
+    vector<double> _maxIntensityErr;
+    bool _boundChecking;
+
+    atomic<bool> _stopped;
+    StatisticsVector<float> _patternScores;
+
+    vector<Scan *> _candidates();
+    void _scoreScan(Scan *scan, vector<SpectralSearchHit> &hits);
+    void _matchPattern(Scan *scan,
+                       vector<SpectralSearchHit> &hits,
+                       vector<float> &scores);
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include "xmlStreamReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+XmlStreamReader::XmlStreamReader(size_t chunkSize)
+{
+    _pos = 0;
+    _bufferOffset = 0;
+    _chunkSize = std::max(chunkSize, (size_t)64);
+    _streamable = false;
+}
+
+bool XmlStreamReader::open(const char *filename)
+{
+    _file.close();
+    _file.clear();
+    _buffer.clear();
+    _bufferOffset = 0;
+    _pos = 0;
+    _streamable = false;
+
+    _file.open(filename, ios::in | ios::binary);
+    if (!_file.is_open())
+        return false;
+
+    //UTF-16/32 byte order marks, anything else is treated as UTF-8 (or one
+    //of its ASCII compatible relatives)
+    _fill();
+    _streamable = true;
+    if (_buffer.size() >= 2) {
+        unsigned char b0 = _buffer[0];
+        unsigned char b1 = _buffer[1];
+        if ((b0 == 0xFF && b1 == 0xFE) || (b0 == 0xFE && b1 == 0xFF))
+            _streamable = false;
+        if (b0 == 0 || b1 == 0)
+            _streamable = false;
+    }
+    return true;
+}
+
+bool XmlStreamReader::_fill()
+{
+    if (!_file.is_open() || _file.eof())
+        return false;
+
+    size_t size = _buffer.size();
+    _buffer.resize(size + _chunkSize);
+    _file.read(&_buffer[size], _chunkSize);
+    size_t count = _file.gcount();
+    _buffer.resize(size + count);
+    return count > 0;
+}
+
+bool XmlStreamReader::_available(size_t index)
+{
+    while (index >= _buffer.size()) {
+        if (!_fill())
+            return false;
+    }
+    return true;
+}
+
+bool XmlStreamReader::_find(char c, size_t from, size_t &at)
+{
+    while (true) {
+        if (from < _buffer.size()) {
+            const char *begin = _buffer.data() + from;
+            const void *found = memchr(begin, c, _buffer.size() - from);
+            if (found) {
+                at = from + (static_cast<const char *>(found) - begin);
+                return true;
+            }
+            from = _buffer.size();
+        }
+        if (!_fill())
+            return false;
+    }
+}
+
+bool XmlStreamReader::_findString(const char *str, size_t from, size_t &at)
+{
+    size_t length = strlen(str);
+    while (true) {
+        size_t found = _buffer.find(str, from, length);
+        if (found != string::npos) {
+            at = found;
+            return true;
+        }
+        //the string may straddle the end of the buffer
+        if (_buffer.size() >= length)
+            from = std::max(from, _buffer.size() - length + 1);
+        if (!_fill())
+            return false;
+    }
+}
+
+bool XmlStreamReader::_skipMarkup(size_t at, size_t &next)
+{
+    //'at' points to "<!" or "<?"
+    size_t end;
+    _available(at + 8);
+
+    if (_buffer.compare(at, 4, "<!--") == 0) {
+        if (!_findString("-->", at + 4, end))
+            return false;
+        next = end + 3;
+    } else if (_buffer.compare(at, 9, "<![CDATA[") == 0) {
+        if (!_findString("]]>", at + 9, end))
+            return false;
+        next = end + 3;
+    } else if (_buffer.compare(at, 2, "<?") == 0) {
+        if (!_findString("?>", at + 2, end))
+            return false;
+        next = end + 2;
+    } else {
+        //document type declaration
+        if (!_find('>', at + 2, end))
+            return false;
+        next = end + 1;
+    }
+    return true;
+}
+
+bool XmlStreamReader::_tagEnd(size_t at, size_t &end)
+{
+    //'>' may appear within quoted attribute values
+    char quote = 0;
+    for (size_t i = at + 1; _available(i); i++) {
+        char c = _buffer[i];
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            end = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool XmlStreamReader::_elementEnd(size_t &end)
+{
+    //'_pos' points to the start tag of the element
+    int depth = 0;
+    size_t from = _pos;
+    size_t at;
+    while (_find('<', from, at)) {
+        if (!_available(at + 1))
+            return false;
+
+        char c = _buffer[at + 1];
+        if (c == '!' || c == '?') {
+            if (!_skipMarkup(at, from))
+                return false;
+            continue;
+        }
+
+        size_t tagEnd;
+        if (!_tagEnd(at, tagEnd))
+            return false;
+        from = tagEnd + 1;
+
+        if (c == '/')
+            depth--;
+        else if (_buffer[tagEnd - 1] != '/')
+            depth++;
+
+        if (depth <= 0) {
+            end = from;
+            return true;
+        }
+    }
+    return false;
+}
+
+void XmlStreamReader::_compact()
+{
+    //drop consumed data once it outgrows a chunk, so that the buffer never
+    //holds much more than the element being read
+    if (_pos > _chunkSize) {
+        _buffer.erase(0, _pos);
+        _bufferOffset += _pos;
+        _pos = 0;
+    }
+}
+
+bool XmlStreamReader::nextElement(const vector<string> &names, string &name)
+{
+    size_t at;
+    while (true) {
+        _compact();
+        if (!_find('<', _pos, at))
+            return false;
+        if (!_available(at + 1))
+            return false;
+
+        char c = _buffer[at + 1];
+        if (c == '!' || c == '?') {
+            if (!_skipMarkup(at, _pos))
+                return false;
+            continue;
+        }
+        if (c == '/') {
+            _pos = at + 1;
+            continue;
+        }
+
+        size_t nameEnd = at + 1;
+        while (_available(nameEnd)) {
+            char n = _buffer[nameEnd];
+            if (n == ' ' || n == '\t' || n == '\n' || n == '\r' || n == '>'
+                || n == '/')
+                break;
+            nameEnd++;
+        }
+
+        string tagName = _buffer.substr(at + 1, nameEnd - at - 1);
+        if (std::find(names.begin(), names.end(), tagName) != names.end()) {
+            _pos = at;
+            name = tagName;
+            return true;
+        }
+
+        //attribute values can not contain '<', so the next one starts a new
+        //tag or markup
+        _pos = at + 1;
+    }
+}
+
+bool XmlStreamReader::readStartTag(pugi::xml_document &doc)
+{
+    size_t end;
+    if (!_tagEnd(_pos, end))
+        return false;
+
+    string tag = _buffer.substr(_pos, end - _pos + 1);
+    _pos = end + 1;
+    if (tag.size() < 2 || tag[tag.size() - 2] != '/')
+        tag.insert(tag.size() - 1, "/");
+
+    doc.reset();
+    pugi::xml_parse_result result = doc.load_buffer(tag.data(),
+                                                    tag.size(),
+                                                    pugi::parse_minimal,
+                                                    pugi::encoding_utf8);
+    return result.status == pugi::status_ok;
+}
+
+bool XmlStreamReader::readElement(pugi::xml_document &doc)
+{
+    size_t end;
+    if (!_elementEnd(end))
+        return false;
+
+    doc.reset();
+    pugi::xml_parse_result result = doc.load_buffer(_buffer.data() + _pos,
+                                                    end - _pos,
+                                                    pugi::parse_minimal,
+                                                    pugi::encoding_utf8);
+    _pos = end;
+    return result.status == pugi::status_ok;
+}
+
+bool XmlStreamReader::skipElement()
+{
+    size_t end;
+    if (!_elementEnd(end))
+        return false;
+    _pos = end;
+    return true;
+}
+
+bool XmlStreamReader::elementEnd(uint64_t start, uint64_t &end)
+{
+    if (start < _bufferOffset || start - _bufferOffset >= _buffer.size())
+        return false;
+
+    size_t pos = _pos;
+    size_t at;
+    _pos = start - _bufferOffset;
+    bool found = _elementEnd(at);
+    _pos = pos;
+    if (found)
+        end = _bufferOffset + at;
+    return found;
+}
@@ -0,0 +1,113 @@
+#ifndef XMLSTREAMREADER_H
+#define XMLSTREAMREADER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pugixml.hpp"
+
+using namespace std;
+
+/**
+* @brief Forward only reader for large XML files
+*
+* @details The file is read in fixed size chunks and scanned for start tags
+* of interest. Each element of interest can then be loaded on its own into a
+* small pugixml document, so that only one element (e.g. a single spectrum)
+* is held in memory at a time instead of the whole file. Only as much of the
+* file as has not been consumed yet is kept buffered.
+*/
+class XmlStreamReader
+{
+  public:
+    /**
+    * @brief Constructor for class XmlStreamReader
+    * @param chunkSize Number of bytes read from the file at a time
+    */
+    XmlStreamReader(size_t chunkSize = 1 << 20);
+
+    /**
+    * @brief Open a file for reading
+    * @return True if the file could be opened, false otherwise
+    */
+    bool open(const char *filename);
+
+    /**
+    * @brief Whether the opened file can be read as a stream
+    * @details Elements are located by scanning for ASCII markup, which does
+    * not work for UTF-16/32 encoded files. Such files should be loaded as a
+    * whole instead.
+    */
+    bool isStreamable() const { return _streamable; }
+
+    /**
+    * @brief Advance to the next start tag with one of the given names
+    * @details Markup in between (other tags, comments, CDATA sections and
+    * processing instructions) is skipped. After this call the element should
+    * be consumed with readStartTag, readElement or skipElement.
+    * @param names Element names of interest
+    * @param name Filled with the name of the element found
+    * @return False if the end of the file was reached, true otherwise
+    */
+    bool nextElement(const vector<string> &names, string &name);
+
+    /**
+    * @brief Load only the start tag of the current element
+    * @details The tag is loaded as an empty element, which gives access to
+    * its attributes. Reading continues with the children of the element.
+    * @param doc Document to load the element into
+    * @return True if the tag could be parsed, false otherwise
+    */
+    bool readStartTag(pugi::xml_document &doc);
+
+    /**
+    * @brief Load the current element, including all its children
+    * @param doc Document to load the element into
+    * @return True if the element could be parsed, false otherwise
+    */
+    bool readElement(pugi::xml_document &doc);
+
+    /**
+    * @brief Skip the current element, including all its children
+    * @return True if the end of the element was found, false otherwise
+    */
+    bool skipElement();
+
+    /**
+    * @brief File offset of the read position
+    * @details After nextElement this is the offset of the start tag of the
+    * current element, after an element has been read or skipped it is the
+    * offset right after its end tag.
+    */
+    uint64_t offset() const { return _bufferOffset + _pos; }
+
+    /**
+    * @brief Find the end of an element nested in the element just read
+    * @param start File offset of the start tag of the nested element
+    * @param end Filled with the file offset right after its end tag
+    * @return False if the element is not part of the data read last, true
+    * otherwise
+    */
+    bool elementEnd(uint64_t start, uint64_t &end);
+
+  private:
+    ifstream _file;
+    string _buffer;
+    uint64_t _bufferOffset;
+    size_t _pos;
+    size_t _chunkSize;
+    bool _streamable;
+
+    bool _fill();
+    bool _available(size_t index);
+    bool _find(char c, size_t from, size_t &at);
+    bool _findString(const char *str, size_t from, size_t &at);
+    bool _skipMarkup(size_t at, size_t &next);
+    bool _tagEnd(size_t at, size_t &end);
+    bool _elementEnd(size_t &end);
+    void _compact();
+};
+
+#endif
@@ -191,7 +191,7 @@ void CompareSamplesDialog::compareSets(vector<mzSample*> sset1,
 	/*
 	 TableDockWidget* peaksTable = mainwindow->addPeaksTable("Contrasts");
 	 peaksTable->setWindowTitle("Contrasts: Peaks");
-	 peaksTable->treeWidget->setSortingEnabled(true);
+	 peaksTable->treeView->setSortingEnabled(true);
 	 for(int i=0; i < goodgroups.size(); i++) {
 	 if (goodgroups[i]->changeFoldRatio > _minFoldDiff && goodgroups[i]->changePValue < alpha) { peaksTable->addPeakGroup(goodgroups[i]); }
 	 }
@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "grouprtwidget.h"
 #include <QStandardPaths>
+#include "samplecache.h"
 #include "notificator.h"
 #include "videoplayer.h"
 #include "background_peaks_update.h"
@@ -218,6 +219,17 @@ using namespace mzUtils;
 	if (QFile::exists(commonAdducts))
 		DB.loadFragments(commonAdducts.toStdString());
 
+	//parsed samples are cached in the cache directory of the application
+	//rather than next to the raw data, which may be read only or shared.
+	//Cache files are never evicted, so caching is only done when asked for.
+	QString sampleCacheDir =
+		QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+		+ QDir::separator() + "samples";
+	if (settings->value("sampleCacheEnabled").toBool()
+		&& QDir().mkpath(sampleCacheDir)) {
+		SampleCache::setDirectory(sampleCacheDir.toStdString());
+		SampleCache::setEnabled(true);
+	}
 
 	clsf = new ClassifierNeuralNet();    //clsf = new ClassifierNaiveBayes();
 		mavenParameters = new MavenParameters(QString(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QDir::separator() + "lastRun.xml").toStdString());
@@ -2523,6 +2535,9 @@ void MainWindow::readSettings() {
         settings->setValue("embeded_http_server_address", "127.0.0.1");
     }
 
+    if (!settings->contains("sampleCacheEnabled"))
+        settings->setValue("sampleCacheEnabled", false);
+
 
 	settings->setValue("uploadMultiprocessing", 2);
 
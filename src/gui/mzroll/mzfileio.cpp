@@ -18,6 +18,10 @@ mzFileIO::mzFileIO(QWidget*) {
     process = NULL;
     _currentProject = nullptr;
 
+    // MS2 peak lists are read from the sample files when they are shown or
+    // matched, only their metadata is kept in memory
+    mzSample::setLazyFragmentationScans(true);
+
     qRegisterMetaType<QList<QString>>("QList<QString>");
     qRegisterMetaType<map<string, variant>>("map<string, variant>");
     connect(this,
@@ -711,6 +715,7 @@ void mzFileIO::writeGroups(QList<PeakGroup*> groups, QString tableName)
     vector<PeakGroup*> groupVector;
     set<Compound*> compoundSet;
     if (_currentProject) {
+        _currentProject->beginBulkSave();
         _currentProject->deleteTableGroups(tableName.toStdString());
         for (auto group : groups) {
             // assuming all groups are parent groups.
@@ -720,6 +725,7 @@ void mzFileIO::writeGroups(QList<PeakGroup*> groups, QString tableName)
         }
         _currentProject->saveGroups(groupVector, tableName.toStdString());
         _currentProject->saveCompounds(compoundSet);
+        _currentProject->endBulkSave();
         Q_EMIT(updateStatusString(QString("Saved %1 groups from %2 to project")
                                   .arg(QString::number(groups.size()))
                                   .arg(tableName))
@@ -765,6 +771,7 @@ bool mzFileIO::writeSQLiteProject(QString filename)
     }
 
     if (_currentProject) {
+        _currentProject->beginBulkSave();
         _currentProject->deleteAll();  // this is crazy
         _currentProject->saveSettings(_settingsMap);
         _currentProject->saveSamples(sampleSet);
@@ -788,6 +795,7 @@ bool mzFileIO::writeSQLiteProject(QString filename)
             groupVector.clear();
         }
         _currentProject->saveCompounds(compoundSet);
+        _currentProject->endBulkSave();
         qDebug() << "finished writing to project" << filename;
         if (!_mainwindow->timestampFileExists)
             Q_EMIT(updateStatusString(
@@ -227,6 +227,7 @@ HEADERS +=  stable.h \
                     gettingstarted.h \
                     pollywaitdialog.h \
                     peaktabledeletiondialog.h \
+                    peaktablemodel.h \
                     notificator.h \
                     notificator_p.h \
                     $$top_srcdir/crashhandler/elmavexceptionhandler.h \
@@ -301,6 +302,7 @@ database.cpp \
     gettingstarted.cpp \
     pollywaitdialog.cpp \
     peaktabledeletiondialog.cpp \
+    peaktablemodel.cpp \
     notificator.cpp \
     videoplayer.cpp
 
@@ -0,0 +1,587 @@
+#include "peaktablemodel.h"
+#include "tabledockwidget.h"
+
+PeakTableModel::Node::Node(Node *parent, PeakGroup *group, int clusterId)
+{
+    this->parent = parent;
+    this->group = group;
+    this->clusterId = clusterId;
+    clusterRt = 0;
+    row = 0;
+    hasIntensities = false;
+    maxValue = 0;
+}
+
+PeakTableModel::PeakTableModel(TableDockWidget *table, QObject *parent) :
+    QAbstractItemModel(parent),
+    _table(table),
+    _root(NULL, NULL, 0),
+    _goodIcon(":/images/good.png"),
+    _badIcon(":/images/bad.png"),
+    _sortColumn(-1),
+    _sortOrder(Qt::AscendingOrder)
+{
+}
+
+PeakTableModel::~PeakTableModel()
+{
+    deleteChildren(&_root);
+}
+
+bool PeakTableModel::isShown(PeakGroup *group)
+{
+    return group != NULL && group->peakCount() > 0 && group->meanMz > 0;
+}
+
+PeakTableModel::Node *PeakTableModel::node(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return const_cast<Node *>(&_root);
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex PeakTableModel::nodeIndex(Node *node) const
+{
+    if (node == &_root)
+        return QModelIndex();
+    return createIndex(node->row, 0, node);
+}
+
+PeakTableModel::Node *PeakTableModel::createNode(Node *parent,
+                                                 PeakGroup *group,
+                                                 int clusterId)
+{
+    Node *node = new Node(parent, group, clusterId);
+    if (group != NULL) {
+        _nodes.insert(group, node);
+        for (int i = 0; i < group->childCount(); i++) {
+            PeakGroup *child = &group->children[i];
+            if (isShown(child))
+                addNode(node, child, 0);
+        }
+    }
+    return node;
+}
+
+void PeakTableModel::insertNode(Node *parent, Node *node, int row)
+{
+    parent->children.insert(parent->children.begin() + row, node);
+    for (unsigned int i = row; i < parent->children.size(); i++)
+        parent->children[i]->row = i;
+}
+
+PeakTableModel::Node *PeakTableModel::addNode(Node *parent,
+                                              PeakGroup *group,
+                                              int clusterId)
+{
+    Node *node = createNode(parent, group, clusterId);
+    insertNode(parent, node, parent->children.size());
+    return node;
+}
+
+PeakTableModel::Node *PeakTableModel::addCluster(PeakGroup *group)
+{
+    Node *cluster = addNode(&_root, NULL, group->clusterId);
+    cluster->clusterRt = group->meanRt;
+    _clusters.insert(group->clusterId, cluster);
+    return cluster;
+}
+
+void PeakTableModel::removeNode(Node *node)
+{
+    Node *parent = node->parent;
+    parent->children.erase(parent->children.begin() + node->row);
+    for (unsigned int i = node->row; i < parent->children.size(); i++)
+        parent->children[i]->row = i;
+
+    deleteChildren(node);
+    if (node->group != NULL)
+        _nodes.remove(node->group);
+    else
+        _clusters.remove(node->clusterId);
+    delete node;
+}
+
+void PeakTableModel::deleteChildren(Node *node)
+{
+    for (auto child : node->children) {
+        deleteChildren(child);
+        if (child->group != NULL)
+            _nodes.remove(child->group);
+        delete child;
+    }
+    node->children.clear();
+}
+
+void PeakTableModel::setColumns(const QStringList &names,
+                                const vector<mzSample *> &samples)
+{
+    beginResetModel();
+    _columns = names;
+    _samples = samples;
+    clearIntensities(&_root);
+    endResetModel();
+}
+
+void PeakTableModel::setGroups(QList<PeakGroup> &groups)
+{
+    beginResetModel();
+    deleteChildren(&_root);
+    _nodes.clear();
+    _clusters.clear();
+    for (int i = 0; i < groups.size(); i++) {
+        PeakGroup *group = &groups[i];
+        if (!isShown(group))
+            continue;
+
+        Node *parent = &_root;
+        if (group->clusterId) {
+            parent = _clusters.value(group->clusterId);
+            if (parent == NULL)
+                parent = addCluster(group);
+        }
+        addNode(parent, group, 0);
+    }
+    endResetModel();
+}
+
+void PeakTableModel::appendGroup(PeakGroup *group)
+{
+    if (!isShown(group) || _nodes.contains(group))
+        return;
+
+    if (group->clusterId && !_clusters.contains(group->clusterId)) {
+        Node *cluster = new Node(&_root, NULL, group->clusterId);
+        cluster->clusterRt = group->meanRt;
+        int row = sortedRow(&_root, cluster);
+        beginInsertRows(QModelIndex(), row, row);
+        insertNode(&_root, cluster, row);
+        _clusters.insert(group->clusterId, cluster);
+        addNode(cluster, group, 0);
+        if (_sortColumn >= 0)
+            sortNode(cluster, _sortColumn, _sortOrder);
+        endInsertRows();
+        return;
+    }
+
+    Node *parent = &_root;
+    if (group->clusterId)
+        parent = _clusters.value(group->clusterId);
+
+    // the rows of child groups are built before the row is placed
+    Node *added = createNode(parent, group, 0);
+    if (_sortColumn >= 0)
+        sortNode(added, _sortColumn, _sortOrder);
+    int row = sortedRow(parent, added);
+    beginInsertRows(nodeIndex(parent), row, row);
+    insertNode(parent, added, row);
+    endInsertRows();
+}
+
+void PeakTableModel::removeGroup(PeakGroup *group)
+{
+    Node *node = _nodes.value(group);
+    if (node == NULL)
+        return;
+
+    Node *parent = node->parent;
+    beginRemoveRows(nodeIndex(parent), node->row, node->row);
+    removeNode(node);
+    endRemoveRows();
+
+    if (parent != &_root && parent->group == NULL
+        && parent->children.empty()) {
+        beginRemoveRows(QModelIndex(), parent->row, parent->row);
+        removeNode(parent);
+        endRemoveRows();
+    }
+}
+
+void PeakTableModel::clear()
+{
+    beginResetModel();
+    deleteChildren(&_root);
+    _nodes.clear();
+    _clusters.clear();
+    endResetModel();
+}
+
+void PeakTableModel::updateGroup(const QModelIndex &index)
+{
+    if (!index.isValid() || _columns.isEmpty())
+        return;
+
+    Node *changed = node(index);
+    changed->hasIntensities = false;
+    QModelIndex parent = index.parent();
+    Q_EMIT dataChanged(this->index(changed->row, 0, parent),
+                       this->index(changed->row, _columns.size() - 1, parent));
+}
+
+void PeakTableModel::clearIntensities(Node *node)
+{
+    node->hasIntensities = false;
+    node->intensities.clear();
+    for (auto child : node->children)
+        clearIntensities(child);
+}
+
+void PeakTableModel::loadIntensities(Node *node) const
+{
+    if (node->hasIntensities)
+        return;
+
+    PeakGroup::QType qtype = _table->getMainWindow()->getUserQuantType();
+    vector<mzSample *> samples = _samples;
+    node->intensities = node->group->getOrderedIntensityVector(samples, qtype);
+
+    // the heatmap spans the rt column as well as the intensities
+    node->maxValue = node->group->meanRt;
+    for (auto value : node->intensities)
+        node->maxValue = max(node->maxValue, value);
+    node->hasIntensities = true;
+}
+
+PeakGroup *PeakTableModel::group(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return NULL;
+    return node(index)->group;
+}
+
+QModelIndex PeakTableModel::indexOf(PeakGroup *group) const
+{
+    Node *found = _nodes.value(group);
+    if (found == NULL)
+        return QModelIndex();
+    return nodeIndex(found);
+}
+
+bool PeakTableModel::isCluster(const QModelIndex &index) const
+{
+    return index.isValid() && node(index)->group == NULL;
+}
+
+QModelIndexList PeakTableModel::rowIndexes() const
+{
+    QModelIndexList indexes;
+    addIndexes(const_cast<Node *>(&_root), indexes);
+    return indexes;
+}
+
+void PeakTableModel::addIndexes(Node *node, QModelIndexList &indexes) const
+{
+    for (auto child : node->children) {
+        indexes.append(createIndex(child->row, 0, child));
+        addIndexes(child, indexes);
+    }
+}
+
+QModelIndex PeakTableModel::index(int row,
+                                  int column,
+                                  const QModelIndex &parent) const
+{
+    if (!hasIndex(row, column, parent))
+        return QModelIndex();
+    return createIndex(row, column, node(parent)->children[row]);
+}
+
+QModelIndex PeakTableModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return QModelIndex();
+    return nodeIndex(node(index)->parent);
+}
+
+int PeakTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return node(parent)->children.size();
+}
+
+int PeakTableModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return _columns.size();
+}
+
+QString PeakTableModel::text(Node *node, int column) const
+{
+    PeakGroup *group = node->group;
+    if (group == NULL) {
+        if (column == 0)
+            return QString("Cluster ") + QString::number(node->clusterId);
+        if (column == 5)
+            return QString::number(node->clusterRt, 'f', 2);
+        return QString();
+    }
+
+    switch (column) {
+    case 0:
+        return QString::number(group->groupId);
+    case 1:
+        return QString(group->getName().c_str());
+    case 2:
+        return QString::number(group->meanMz, 'f', 4);
+    case 3: {
+        MavenParameters *mp = _table->getMainWindow()->mavenParameters;
+        double mz = group->getExpectedMz(mp->getCharge(group->compound));
+        if (mz != -1)
+            return QString::number(mz, 'f', 4);
+        return QString("NA");
+    }
+    case 4:
+        return QString::number(group->meanRt, 'f', 2);
+    }
+
+    if (!_samples.empty()) {
+        loadIntensities(node);
+        unsigned int i = column - 5;
+        if (i < node->intensities.size())
+            return QString::number(node->intensities[i]);
+        return QString();
+    }
+
+    switch (column) {
+    case 5:
+        return QString::number(group->expectedRtDiff, 'f', 2);
+    case 6:
+        return QString::number(group->sampleCount);
+    case 7:
+        return QString::number(group->goodPeakCount);
+    case 8:
+        return QString::number(group->maxNoNoiseObs);
+    case 9:
+        return QString::number(_table->extractMaxIntensity(group), 'g', 2);
+    case 10:
+        return QString::number(group->maxSignalBaselineRatio, 'f', 0);
+    case 11:
+        return QString::number(group->maxQuality, 'f', 2);
+    case 12:
+        return QString::number(group->fragMatchScore.mergedScore, 'f', 2);
+    case 13:
+        return QString::number(group->ms2EventCount);
+    case 14:
+        return QString::number(group->groupRank, 'e', 6);
+    case 15:
+        return QString::number(group->changeFoldRatio, 'f', 3);
+    case 16:
+        return QString::number(group->changePValue, 'f', 6);
+    }
+    return QString();
+}
+
+QVariant PeakTableModel::background(Node *node, int column) const
+{
+    PeakGroup *group = node->group;
+    if (group == NULL)
+        return QVariant();
+
+    if (column == 0) {
+        // shade groups whose label disagrees with the quality of their peaks
+        float minQuality = _table->getMainWindow()->mavenParameters->minQuality;
+        int good = 0;
+        int bad = 0;
+        int total = group->peakCount();
+        for (int i = 0; i < total; i++)
+            group->peaks[i].quality > minQuality ? good++ : bad++;
+
+        if (good > 0 && group->label == 'b')
+            return QBrush(QColor::fromRgbF(0.8, 0, 0, ((float)good) / total));
+        if (bad > 0 && group->label == 'g')
+            return QBrush(QColor::fromRgbF(0.8, 0, 0, ((float)bad) / total));
+        return QVariant();
+    }
+
+    if (_samples.empty() || column < 4)
+        return QVariant();
+
+    loadIntensities(node);
+    float value = group->meanRt;
+    if (column > 4) {
+        unsigned int i = column - 5;
+        if (i >= node->intensities.size())
+            return QVariant();
+        value = node->intensities[i];
+    }
+
+    float maxValue = node->maxValue;
+    float prob = value;
+    if (maxValue != 0)
+        prob = abs((maxValue - value) / maxValue);
+    prob = min(max(prob, 0.0f), 1.0f);
+
+    QColor color = Qt::white;
+    color.setHsvF(0.0, prob, 1, 1);
+    return color;
+}
+
+QVariant PeakTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    Node *row = node(index);
+    int column = index.column();
+    switch (role) {
+    case Qt::DisplayRole:
+        return text(row, column);
+    case Qt::DecorationRole:
+        if (column == 0 && row->group != NULL) {
+            if (row->group->label == 'g')
+                return _goodIcon;
+            if (row->group->label == 'b')
+                return _badIcon;
+        }
+        break;
+    case Qt::BackgroundRole:
+        return background(row, column);
+    case Qt::UserRole:
+        if (column == 0 && row->group != NULL)
+            return QVariant::fromValue(row->group);
+        break;
+    }
+    return QVariant();
+}
+
+QVariant PeakTableModel::headerData(int section,
+                                    Qt::Orientation orientation,
+                                    int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole
+        && section >= 0 && section < _columns.size()) {
+        return _columns[section];
+    }
+    return QAbstractItemModel::headerData(section, orientation, role);
+}
+
+bool PeakTableModel::setHeaderData(int section,
+                                   Qt::Orientation orientation,
+                                   const QVariant &value,
+                                   int role)
+{
+    if (orientation != Qt::Horizontal || section < 0
+        || section >= _columns.size()) {
+        return false;
+    }
+
+    Q_UNUSED(role);
+    _columns[section] = value.toString();
+    Q_EMIT headerDataChanged(orientation, section, section);
+    return true;
+}
+
+Qt::ItemFlags PeakTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+    if (node(index)->group == NULL)
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+}
+
+void PeakTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= _columns.size())
+        return;
+
+    _sortColumn = column;
+    _sortOrder = order;
+    sortChildren(QModelIndex(), column, order);
+}
+
+void PeakTableModel::sortChildren(const QModelIndex &parent,
+                                  int column,
+                                  Qt::SortOrder order)
+{
+    if (column < 0 || column >= _columns.size())
+        return;
+
+    Q_EMIT layoutAboutToBeChanged();
+    QModelIndexList oldIndexes = persistentIndexList();
+
+    sortNode(node(parent), column, order);
+
+    QModelIndexList newIndexes;
+    for (auto &index : oldIndexes) {
+        Node *moved = node(index);
+        newIndexes.append(createIndex(moved->row, index.column(), moved));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+    Q_EMIT layoutChanged();
+}
+
+PeakTableModel::SortKey PeakTableModel::sortKey(Node *node, int column) const
+{
+    SortKey key;
+    key.node = node;
+    key.text = text(node, column);
+    key.number = key.text.toDouble(&key.isNumber);
+    return key;
+}
+
+bool PeakTableModel::sortsBefore(const SortKey &a,
+                                 const SortKey &b,
+                                 Qt::SortOrder order,
+                                 const QCollator &collator)
+{
+    if (order == Qt::DescendingOrder)
+        return sortsBefore(b, a, Qt::AscendingOrder, collator);
+
+    // numbers compare by value and come before text, which is compared the
+    // way the items of a QTreeWidget were
+    if (a.isNumber && b.isNumber)
+        return a.number < b.number;
+    if (a.isNumber != b.isNumber)
+        return a.isNumber;
+    return collator.compare(a.text, b.text) < 0;
+}
+
+void PeakTableModel::sortNode(Node *node, int column, Qt::SortOrder order)
+{
+    if (node->children.size() > 1) {
+        // every cell is formatted once, rather than once per comparison
+        vector<SortKey> keys(node->children.size());
+        for (unsigned int i = 0; i < keys.size(); i++)
+            keys[i] = sortKey(node->children[i], column);
+
+        QCollator collator;
+        collator.setNumericMode(true);
+        stable_sort(keys.begin(),
+                    keys.end(),
+                    [&](const SortKey &a, const SortKey &b) {
+                        return sortsBefore(a, b, order, collator);
+                    });
+
+        for (unsigned int i = 0; i < keys.size(); i++) {
+            node->children[i] = keys[i].node;
+            node->children[i]->row = i;
+        }
+    }
+
+    for (auto child : node->children)
+        sortNode(child, column, order);
+}
+
+int PeakTableModel::sortedRow(Node *parent, Node *node) const
+{
+    if (_sortColumn < 0)
+        return parent->children.size();
+
+    // the rows are in sorted order, so only the cells of the rows compared
+    // during the binary search are formatted
+    QCollator collator;
+    collator.setNumericMode(true);
+    SortKey key = sortKey(node, _sortColumn);
+    auto after = upper_bound(parent->children.begin(),
+                             parent->children.end(),
+                             key,
+                             [&](const SortKey &a, Node *child) {
+                                 return sortsBefore(a,
+                                                    sortKey(child, _sortColumn),
+                                                    _sortOrder,
+                                                    collator);
+                             });
+    return after - parent->children.begin();
+}
@@ -0,0 +1,176 @@
+#ifndef PEAKTABLEMODEL_H
+#define PEAKTABLEMODEL_H
+
+#include "stable.h"
+#include "PeakGroup.h"
+#include "mzSample.h"
+
+class TableDockWidget;
+
+/**
+ * @class PeakTableModel
+ * @brief Item model presenting the groups of a peak table.
+ * @details Rows refer to the groups stored in TableDockWidget::allgroups,
+ * and the text of a cell is only formatted when a view asks for it, so the
+ * cost of showing a table does not grow with the number of groups.
+ * Clustered groups are listed under a row for their cluster, and child
+ * groups (isotopes, adducts) under their parent group. Sorting reorders the
+ * rows of each parent without moving the groups. A group appended to the
+ * table is added as a single row, at its place in the order of the last
+ * sort or after the existing rows if the table was never sorted.
+ */
+class PeakTableModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit PeakTableModel(TableDockWidget *table, QObject *parent = 0);
+    ~PeakTableModel();
+
+    /**
+     * @brief Set the names of the columns.
+     * @param names Column names, starting with the columns common to both
+     * views (#, ID, Observed m/z, Expected m/z, rt).
+     * @param samples Samples whose intensities fill the columns after rt,
+     * empty for the group view.
+     */
+    void setColumns(const QStringList &names, const vector<mzSample *> &samples);
+
+    /**
+     * @brief Replace the rows with the given groups.
+     * @details Groups without peaks or with no m/z are left out, as are
+     * child groups of that kind.
+     */
+    void setGroups(QList<PeakGroup> &groups);
+
+    /**
+     * @brief Add a row for a group appended to the table.
+     * @details The row goes after the rows that sort the same way, as if the
+     * table had been sorted again.
+     */
+    void appendGroup(PeakGroup *group);
+
+    /**
+     * @brief Remove the row of a group, with the rows of its child groups.
+     * @details Must be called before the group is deleted. A cluster row
+     * left without groups is removed as well.
+     */
+    void removeGroup(PeakGroup *group);
+
+    void clear();
+
+    /**
+     * @brief Redraw the row of a group whose values changed.
+     */
+    void updateGroup(const QModelIndex &index);
+
+    /**
+     * @brief Sort the rows below parent, and the rows below those.
+     */
+    void sortChildren(const QModelIndex &parent,
+                      int column,
+                      Qt::SortOrder order);
+
+    /**
+     * @return The group of a row, NULL for a cluster row.
+     */
+    PeakGroup *group(const QModelIndex &index) const;
+
+    /**
+     * @return Index of the first column of the row of a group, invalid if
+     * the group is not shown.
+     */
+    QModelIndex indexOf(PeakGroup *group) const;
+
+    bool isCluster(const QModelIndex &index) const;
+
+    /**
+     * @return Indexes of all rows in the order they are shown, each parent
+     * before its children.
+     */
+    QModelIndexList rowIndexes() const;
+
+    QModelIndex index(int row,
+                      int column,
+                      const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &index) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section,
+                        Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const;
+    bool setHeaderData(int section,
+                       Qt::Orientation orientation,
+                       const QVariant &value,
+                       int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+private:
+    struct Node;
+
+    struct SortKey
+    {
+        Node *node;
+        bool isNumber;
+        double number;
+        QString text;
+    };
+
+    struct Node
+    {
+        Node(Node *parent, PeakGroup *group, int clusterId);
+
+        // NULL for the root and for cluster rows
+        PeakGroup *group;
+        int clusterId;
+        float clusterRt;
+        Node *parent;
+        int row;
+        vector<Node *> children;
+
+        // intensities shown in the peak view, read when the row is first
+        // drawn
+        bool hasIntensities;
+        vector<float> intensities;
+        float maxValue;
+    };
+
+    TableDockWidget *_table;
+    QStringList _columns;
+    vector<mzSample *> _samples;
+    Node _root;
+    QMap<int, Node *> _clusters;
+    QHash<PeakGroup *, Node *> _nodes;
+    QIcon _goodIcon;
+    QIcon _badIcon;
+
+    // column and order of the last sort of the whole table, -1 if unsorted
+    int _sortColumn;
+    Qt::SortOrder _sortOrder;
+
+    static bool isShown(PeakGroup *group);
+    Node *node(const QModelIndex &index) const;
+    QModelIndex nodeIndex(Node *node) const;
+    Node *createNode(Node *parent, PeakGroup *group, int clusterId);
+    void insertNode(Node *parent, Node *node, int row);
+    Node *addNode(Node *parent, PeakGroup *group, int clusterId);
+    Node *addCluster(PeakGroup *group);
+    void removeNode(Node *node);
+    void deleteChildren(Node *node);
+    void clearIntensities(Node *node);
+    void loadIntensities(Node *node) const;
+    QString text(Node *node, int column) const;
+    QVariant background(Node *node, int column) const;
+    SortKey sortKey(Node *node, int column) const;
+    static bool sortsBefore(const SortKey &a,
+                            const SortKey &b,
+                            Qt::SortOrder order,
+                            const QCollator &collator);
+    void sortNode(Node *node, int column, Qt::SortOrder order);
+    int sortedRow(Node *parent, Node *node) const;
+    void addIndexes(Node *node, QModelIndexList &indexes) const;
+};
+
+#endif // PEAKTABLEMODEL_H
@@ -711,7 +711,7 @@ QStringList PollyElmavenInterfaceDialog::_prepareFilesToUpload(QDir qdir,
         peakTable->excludeBadPeakSet();
     }
 
-    peakTable->treeWidget->selectAll();
+    peakTable->treeView->selectAll();
     peakTable->prepareDataForPolly(_writeableTempDir,
                                    "Groups Summary Matrix Format "
                                    "Comma Delimited (*.csv)",
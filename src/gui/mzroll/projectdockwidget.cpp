@@ -1049,6 +1049,9 @@ void ProjectDockWidget::keyPressEvent(QKeyEvent *e ) {
 void ProjectDockWidget::unloadSample(mzSample* sample) {
     if ( sample == NULL) return;
 
+    //a spectral search may be reading the scans of the sample
+    _mainwindow->spectraMatchingForm->releaseSamples();
+
     //mark sample as unselected
     sample->isSelected=false;
     delete_all(sample->scans);
@@ -1,16 +1,83 @@
 #include "spectramatching.h"
 
+SpectralSearchThread::SpectralSearchThread(QObject *parent): QThread(parent) {
+    productPPM = 0;
+}
+
+void SpectralSearchThread::run() {
+    boost::signals2::connection hitsConnection = search.hitsFound.connect(
+        boost::bind(&SpectralSearchThread::emitHits, this, _1));
+    boost::signals2::connection progressConnection = search.progress.connect(
+        boost::bind(&SpectralSearchThread::emitProgress, this, _1, _2));
+
+    search.run();
+
+    hitsConnection.disconnect();
+    progressConnection.disconnect();
+}
+
+void SpectralSearchThread::emitHits(const vector<SpectralSearchHit> &hits) {
+    QList<SpectralHit> spectralHits;
+    for (const SpectralSearchHit &searchHit : hits) {
+        SpectralHit hit;
+        hit.score = searchHit.score;
+        hit.precursorMz = searchHit.precursorMz;
+        hit.sampleName = QString(searchHit.scan->sample->sampleName.c_str());
+        hit.matchCount = searchHit.matchCount;
+        hit.scan = searchHit.scan;
+        hit.mzList = QVector<double>::fromStdVector(searchHit.mzs);
+        hit.intensityList = QVector<double>::fromStdVector(searchHit.intensities);
+        hit.productPPM = productPPM;
+        spectralHits << hit;
+    }
+    Q_EMIT(hitsFound(spectralHits));
+}
+
+void SpectralSearchThread::emitProgress(unsigned int done, unsigned int total) {
+    Q_EMIT(progressChanged(total > 0 ? done * 100 / total : 100));
+}
+
 SpectraMatching::SpectraMatching(MainWindow *w): QDialog(w) { 
     setupUi(this);
     mainwindow = w;
+    searchThread = new SpectralSearchThread(this);
+    qRegisterMetaType<QList<SpectralHit> >("QList<SpectralHit>");
     connect(resultTable,SIGNAL(itemSelectionChanged()), SLOT(showScan()));
     connect(findButton, SIGNAL(clicked(bool)), SLOT(findMatches()));
     connect(exportButton, SIGNAL(clicked(bool)), SLOT(exportMatches()));
+    connect(searchThread, SIGNAL(hitsFound(QList<SpectralHit>)), SLOT(addHits(QList<SpectralHit>)));
+    connect(searchThread, SIGNAL(progressChanged(int)), progressBar, SLOT(setValue(int)));
+    connect(searchThread, SIGNAL(finished()), SLOT(searchFinished()));
     resultTable->setSortingEnabled(true);
     bound_checking_pattern=false;
 }
 
+SpectraMatching::~SpectraMatching() {
+    searchThread->search.stop();
+    searchThread->wait();
+}
+
+void SpectraMatching::releaseSamples() {
+    //hits of the search point to scans of the searched samples
+    if (searchThread->isRunning()) {
+        searchThread->search.stop();
+        searchThread->wait();
+        QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
+        searchFinished();
+    }
+    resultTable->clear();
+    matches.clear();
+    exportButton->setEnabled(false);
+}
+
 void SpectraMatching::findMatches() { 
+    //the find button stops a running search
+    if (searchThread->isRunning()) {
+        searchThread->search.stop();
+        findButton->setEnabled(false);
+        return;
+    }
+
     getFormValues();
     doSearch();
     /*
@@ -37,8 +104,8 @@ void SpectraMatching::getFormValues() {
     _precursorMz = this->precursorMz->text().toDouble();
 
     //get tollerance
-    _precursorMassCutoff = this->_precursorMassCutoff;
-    _productMassCutoff   = this->_productMassCutoff;
+    _precursorMassCutoff.setMassCutoffAndType(this->precursorPPM->value(), "ppm");
+    _productMassCutoff.setMassCutoffAndType(this->productPPM->value(), "ppm");
 
     //get scan type
    _msScanType=0;
@@ -134,36 +201,45 @@ void SpectraMatching::showScan() {
 void SpectraMatching::doSearch() {
     resultTable->clear();
     matches.clear();
+    progressBar->setValue(0);
 
-    vector<mzSample*>samples = mainwindow->getVisibleSamples();
-    resultTable->setEnabled(false);
-    findButton->setEnabled(false);
-
+    SpectralSearch &search = searchThread->search;
+    search.setSamples(mainwindow->getVisibleSamples());
 
     QString _algorithm = this->algorithm->currentText();
+    if (_algorithm == "Isotopic Pattern Search") {
+        search.setSearchType(SpectralSearch::PatternSearch);
+    } else {
+        search.setSearchType(SpectralSearch::FragmentSearch);
+    }
 
-    for(int i=0; i < samples.size(); i++) {
-        int nscans = samples[i]->scanCount();
-        for(int j=0; j< nscans; j++) {
-            Scan* scan = samples[i]->scans[j];
-	    //if (scan->scannum != 7925) continue;
-            double score=0;
-            if(_algorithm == "Isotopic Pattern Search") {
-               score = matchPattern(scan);
-            } else if ( _algorithm == "Fragment Search") {
-               score = scoreScan(scan);
-            }
-
-            //update progress
-            if(j % 10 || j+1 == nscans) progressBar->setValue((j+1)/nscans*100);
-        }
+    search.setMsLevel(_msScanType);
+    search.setPrecursorMz(_precursorMz);
+    search.setPrecursorMassCutoff(_precursorMassCutoff);
+    search.setProductMassCutoff(_productMassCutoff);
+    search.setMinMatches(minPeakMatches->value());
+    search.setQuery(_mzsList.toStdVector(),
+                    _intensityList.toStdVector(),
+                    _intensityMinErr.toStdVector(),
+                    _intensityMaxErr.toStdVector(),
+                    bound_checking_pattern);
+    searchThread->productPPM = _productMassCutoff.getMassCutoff();
+
+    //hits are added to the table as they are found
+    resultTable->setSortingEnabled(false);
+    resultTable->setEnabled(false);
+    exportButton->setEnabled(false);
+    findButton->setText("Stop");
+    search.clearStop();
+    searchThread->start();
+}
 
-    }
+void SpectraMatching::addHits(QList<SpectralHit> hits) {
+    Q_FOREACH(SpectralHit hit, hits) {
+        int i = matches.size();
+        matches.push_back(hit);
 
-    for(int i=0; i <matches.size(); i++ ) {
-        SpectralHit& hit = matches[i];
         NumericTreeWidgetItem *item = new NumericTreeWidgetItem(resultTable,0);
-
         item->setData(0,Qt::UserRole,QVariant::fromValue(i));
         item->setText(0,QString::number(hit.score,'f',2));
         item->setText(1,QString::number(hit.scan->scannum));
@@ -171,12 +247,15 @@ void SpectraMatching::doSearch() {
         item->setText(3,QString::number(hit.matchCount));
 
         QString mzString;
-        for(int i=0; i < hit.mzList.size(); i++ ) {
-                mzString += tr("%1 [%2], ").arg(mzUtils::ppmround(hit.mzList[i],100000)).arg(round(hit.intensityList[i]));
+        for(int j=0; j < hit.mzList.size(); j++ ) {
+                mzString += tr("%1 [%2], ").arg(mzUtils::ppmround(hit.mzList[j],100000)).arg(round(hit.intensityList[j]));
         }
         item->setText(4,mzString);
     }
+    resultTable->setEnabled(true);
+}
 
+void SpectraMatching::searchFinished() {
     if(matches.size() > 0 ) {
 	    exportButton->setEnabled(true);
     	    resultTable->setEnabled(true);
@@ -185,193 +264,31 @@ void SpectraMatching::doSearch() {
     	   resultTable->setEnabled(false);
     }
 
-    int Nbins=100;
-    vector<unsigned int> bin(Nbins,0);
-    float minscore=allscores.minimum();
-    float maxscore=allscores.maximum();
-    float binsize = (maxscore-minscore)/Nbins;
-    allscores.histogram(bin,Nbins);
-
-    qDebug() << "Histogram";
-    for(int i=0; i <100; i++ ) {
-	    qDebug() << i << " " << minscore+(i*binsize) << "\t" <<bin[i];
+    StatisticsVector<float> allscores = searchThread->search.patternScores();
+    if (allscores.size() > 0) {
+        int Nbins=100;
+        vector<unsigned int> bin(Nbins,0);
+        float minscore=allscores.minimum();
+        float maxscore=allscores.maximum();
+        float binsize = (maxscore-minscore)/Nbins;
+        allscores.histogram(bin,Nbins);
+
+        qDebug() << "Histogram";
+        for(int i=0; i <100; i++ ) {
+            qDebug() << i << " " << minscore+(i*binsize) << "\t" <<bin[i];
+        }
     }
 
+    findButton->setText("Find Matching Spectra");
     findButton->setEnabled(true);
+    resultTable->setSortingEnabled(true);
     resultTable->sortItems(0,Qt::DescendingOrder);
-    qDebug() << "search Done";
-}
-
-void SpectraMatching::addHit(double score, float precursormz, QString samplename, int matchCount, Scan* scan,QVector<double>&mzs,QVector<double>&ints) {
-       SpectralHit hit;
-       hit.score = score;
-       hit.precursorMz=precursormz;
-       hit.sampleName=samplename;
-       hit.matchCount=matchCount;
-       hit.scan = scan;
-       hit.mzList = mzs;
-       hit.intensityList=ints;
-       hit.productPPM = _productMassCutoff->getMassCutoff();
-       matches.push_back(hit);
-}
-
-double SpectraMatching::scoreScan(Scan* scan) {
-
-    if (_msScanType  > 0 && scan->mslevel != _msScanType) return 0;
-    if (_precursorMz > 0 && mzUtils::massCutoffDist(_precursorMz,(double)scan->precursorMz,_precursorMassCutoff) > _precursorMassCutoff->getMassCutoff()) return 0;
-
-   float score=0;
-   int matchCount=0;
-   int N = _mzsList.size();
-   int Nc = _intensityList.size();
-   int minMatches = minPeakMatches->value();
-
-   float totalIntensity = scan->totalIntensity();
-
-
-   QVector<float> x;
-   QVector<float> y;
-   for(int i=0; i < N; i++ ) {
-       int pos = scan->findHighestIntensityPos(_mzsList[i],_productMassCutoff);
-       if (pos >= 0) {
-           matchCount++;
-            if(Nc==0) { score += log(scan->intensity[pos]); }
-            else { 
-                x.push_back(_intensityList[i]); 
-                y.push_back(scan->intensity[pos]/totalIntensity); 
-            }
-       } else { 
-            if(Nc==0) { score--; } 
-            else { 
-                x.push_back(_intensityList[i]); 
-                y.push_back(-_intensityList[i]);
-            }
-      }
-   }
-
-   if(Nc) score=mzUtils::correlation(x.toStdVector(),y.toStdVector());
-
-   if (score > 0 and matchCount > minMatches ) {
-       QString sampleName(scan->sample->sampleName.c_str());
-       float precursorMz = _mzsList[0];
-       addHit(score,precursorMz,sampleName,matchCount,scan,_mzsList,_intensityList);
-   }
-   return score;
-}
-
-double SpectraMatching::matchPattern(Scan* scan) {
-
-   if (_msScanType  > 0 && scan->mslevel != _msScanType) return 0;
-   int minMatches = minPeakMatches->value();
-
-   //convert mzs to deltaMasses
-   unsigned int N = _mzsList.size();
-
-   QVector<double> patternMzsObserved(N,0);
-   QVector<double> patternItensityObserved(N,0);
-   QVector<double> patternIntensityGiven(N,0);
-   QVector<double> deltaListGiven(N-1,0);
- 
-   //delta mass list
-   for(int i=1; i<N; i++) {
-	deltaListGiven[i-1]=_mzsList[0]-_mzsList[i]; 
-   }
-
-   //find largest intensity in a pattern
-   double maxGivenIntensity=0;
-   for(int i=0; i<_intensityList.size(); i++) { 
-	   if(_intensityList[i] > maxGivenIntensity) maxGivenIntensity=_intensityList[i]; 
-   }
-  
-   //normalize patern intensities by the biggest value
-   for(int i=0; i<_intensityList.size(); i++) { 
-	   patternIntensityGiven[i] = _intensityList[i]/maxGivenIntensity*100;
-   }
-
-   //compute max allowed difference between pattern and match SUM( patternIntensity**2 )
-   double maxDiff=0;
-   for(int i=0; i<patternIntensityGiven.size(); i++) { 
-        //maxDiff += pow(patternIntensityGiven[i]/2,2);
-	maxDiff += log(100);
-   }
-
-   //sliding window pattern search.. compare pattern to every peak in a scan
-   int hitCount=0;
-   for(int i=0; i<scan->nobs(); i++) {
-
-       //first value to match
-       double startMz = patternMzsObserved[0]=scan->mz[i];
-       double maxObservedIntensity =patternItensityObserved[0]=scan->intensity[i];
-
-       int matchCount=0;
-       for(int j=0; j < deltaListGiven.size(); j++ ) {
-           double expectedMz = startMz - deltaListGiven[j];
-           int   pos = scan->findHighestIntensityPos(expectedMz,_productMassCutoff);
-
-           if(pos >= 0 ) {
-               matchCount++;
-               if (scan->intensity[pos] > maxObservedIntensity) maxObservedIntensity = scan->intensity[pos];
-               patternMzsObserved[j+1]=scan->mz[pos];
-               patternItensityObserved[j+1]=scan->intensity[pos];
-           } else {
-               patternMzsObserved[j+1]=expectedMz;
-               patternItensityObserved[j+1]=0;
-           }
-       }
-
-       //score = 1-SUM((observedIntensity-givenIntsity)**2) / maxDifference
-       double score=0;
-       for(int k=0; k < N; k++ ) {
-           patternItensityObserved[k] = patternItensityObserved[k]/maxObservedIntensity*100;
-           double deltaIntensity =  abs(patternIntensityGiven[k]-patternItensityObserved[k]);
-           double ratio =  abs((patternIntensityGiven[k]+1)/(patternItensityObserved[k]+1));
-
-           //bound checking if specified
-           if ( bound_checking_pattern) {
-           	score+= abs(log(ratio));
-               if(patternItensityObserved[k] < _intensityMinErr[k] || patternItensityObserved[k] > _intensityMaxErr[k]  ) {
-                    score = maxDiff;
-                    break;
-                }
-           } else if (k < _intensityMaxErr.size()) {
-		float weight = _intensityMaxErr[k];
-		score += weight*abs(log(ratio));
-		// if (deltaIntensity/patternIntensityGiven[k] * 100 > _intensityMaxErr[k] ) {
-		//    score = maxDiff;
-		//   break;
-		//}
-           } else {
-           	score+= abs(log(ratio));
-	   }
-       }
-       //qDebug() << "b: " << patternItensityObserved;
-
-       double scoreN = 1.0-(score/maxDiff);
-
-       if( scoreN > -1 ) {
-	       allscores.push_back(scoreN);
-       }
-
-       if(matchCount >= minMatches and scoreN > 0 ) {
-           hitCount++;
-           //    cerr << "i=" << i << "startMz=" << startMz << " maxObservedIntensity=" << maxObservedIntensity << endl;
-           QString sampleName(scan->sample->sampleName.c_str());
-           float precursorMz = patternMzsObserved[0];
-           addHit(scoreN,precursorMz,sampleName,matchCount,scan,patternMzsObserved,patternItensityObserved);
-           /* for(int k=0; k < N; k++ ) {
-            fprintf(stderr, "%3.5f (%3.2f) (%3.2f)\n",
-            patternMzsObserved[k],
-            patternItensityObserved[k],
-            patternIntensityGiven[k]);
-            }
-             cerr << "scoreN=" << scoreN << " score=" << score << " maxDiff=" << maxDiff << endl;
-             */
-       }
-       //if(hitCount > 2 ) return scoreN;
-
-   }
-
-    return 0;
+    if (searchThread->search.stopped()) {
+        qDebug() << "search stopped";
+    } else {
+        progressBar->setValue(100);
+        qDebug() << "search Done";
+    }
 }
 
 void SpectraMatching::exportMatches() { 
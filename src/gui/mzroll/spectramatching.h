@@ -5,14 +5,49 @@
 #include "ui_spectramatching.h"
 #include "mainwindow.h"
 #include "numeric_treewidgetitem.h"
+#include "spectralsearch.h"
 
 class MainWindow;
 
+/**
+ * @class SpectralSearchThread
+ * @ingroup mzroll
+ * @brief Runs a SpectralSearch in the background and passes its hits and
+ * progress on as Qt signals
+ */
+class SpectralSearchThread : public QThread
+{
+    Q_OBJECT
+    public:
+        SpectralSearchThread(QObject *parent);
+
+        SpectralSearch search;
+        float productPPM;
+
+    Q_SIGNALS:
+        void hitsFound(QList<SpectralHit> hits);
+        void progressChanged(int percent);
+
+    protected:
+        void run();
+
+    private:
+        void emitHits(const vector<SpectralSearchHit> &hits);
+        void emitProgress(unsigned int done, unsigned int total);
+};
+
 class SpectraMatching : public QDialog, public Ui_SpectraMatchingForm
 {
     Q_OBJECT
     public:
         SpectraMatching(MainWindow *w);
+        ~SpectraMatching();
+
+        /**
+         * @brief Stop a running search and drop all hits, before samples
+         * they point to are deleted
+         */
+        void releaseSamples();
 
         public Q_SLOTS:
         void getFormValues();
@@ -20,26 +55,25 @@ class SpectraMatching : public QDialog, public Ui_SpectraMatchingForm
         void showScan();
         void doSearch();
         void exportMatches();
-        double scoreScan(Scan* scan);
-        double matchPattern(Scan* scan);
+        void addHits(QList<SpectralHit> hits);
+        void searchFinished();
 
 
     private:
         MainWindow *mainwindow;
+        SpectralSearchThread *searchThread;
         int _msScanType;
         double _precursorMz;
-        MassCutoff *_precursorMassCutoff;
-        MassCutoff *_productMassCutoff;
+        MassCutoff _precursorMassCutoff;
+        MassCutoff _productMassCutoff;
         QVector<double> _mzsList;
         QVector<double> _intensityList;
         QVector<double> _intensityMinErr;
         QVector<double> _intensityMaxErr;
 
         bool bound_checking_pattern;
-	StatisticsVector<float>allscores;
 
         QList<SpectralHit> matches;
-        void addHit(double score, float precursormz, QString samplename, int matchCount, Scan* scan, QVector<double>&mzs, QVector<double>&ints); //add hit to matches
 
 };
 
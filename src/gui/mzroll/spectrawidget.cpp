@@ -513,6 +513,9 @@ void SpectraWidget::setGroupTitle()
 
 void SpectraWidget::drawScan(Scan* scan, QColor sampleColor)
 {
+    //scans of a group's fragmentation events belong to their sample and
+    //their values may have been released
+    ScanPeaksPin pin(scan);
     float _focusedMz = _focusCoord.x();
 
     QPen slineColor(sampleColor, 2);
@@ -594,6 +597,7 @@ void SpectraWidget::drawScanSet(vector<Scan*>& scanset) {
 void SpectraWidget::drawMzLabels(Scan* scan)
 {
     if (!scan) return;
+    ScanPeaksPin pin(scan);
 
     unsigned int labelCount = 0;
     
@@ -30,34 +30,37 @@ TableDockWidget::TableDockWidget(MainWindow *mw) {
   viewType = groupView;
   maxPeaks = 0; //Maximum Number of Peaks in a Group
 
-  treeWidget = new QTreeWidget(this);
-  treeWidget->setSortingEnabled(false);
-  treeWidget->setDragDropMode(QAbstractItemView::DragOnly);
-  treeWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
-  treeWidget->setAcceptDrops(false);
-  treeWidget->setObjectName("PeakGroupTable");
-  treeWidget->setFocusPolicy(Qt::NoFocus);
-  treeWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
+  peakTableModel = new PeakTableModel(this, this);
+  treeView = new QTreeView(this);
+  treeView->setModel(peakTableModel);
+  treeView->setUniformRowHeights(true);
+  treeView->setSortingEnabled(false);
+  treeView->setDragDropMode(QAbstractItemView::DragOnly);
+  treeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  treeView->setAcceptDrops(false);
+  treeView->setObjectName("PeakGroupTable");
+  treeView->setFocusPolicy(Qt::NoFocus);
+  treeView->setSelectionBehavior(QAbstractItemView::SelectRows);
   this->setFocusPolicy(Qt::ClickFocus);
   tableSelectionFlagUp = false;
   tableSelectionFlagDown = false;
   this->setAcceptDrops(true);
 
-  setWidget(treeWidget);
+  setWidget(treeView);
   setupPeakTable();
 
   traindialog = new TrainDialog(this);
   connect(traindialog->saveButton, SIGNAL(clicked(bool)), SLOT(saveModel()));
   connect(traindialog->trainButton, SIGNAL(clicked(bool)), SLOT(Train()));
-  connect(treeWidget,
-          SIGNAL(itemClicked(QTreeWidgetItem *, int)),
+  connect(treeView,
+          SIGNAL(clicked(QModelIndex)),
           SLOT(showSelectedGroup()));
-  connect(treeWidget,
-          SIGNAL(itemSelectionChanged()),
+  connect(treeView->selectionModel(),
+          SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
           SLOT(showSelectedGroup()));
-  connect(treeWidget,
-          SIGNAL(itemExpanded(QTreeWidgetItem *)), this,
-          SLOT(sortChildrenAscending(QTreeWidgetItem *)));
+  connect(treeView,
+          SIGNAL(expanded(QModelIndex)), this,
+          SLOT(sortChildrenAscending(QModelIndex)));
 
   clusterDialog = new ClusterDialog(this);
   connect(clusterDialog->clusterButton,
@@ -84,7 +87,7 @@ TableDockWidget::~TableDockWidget() {
   if (clusterDialog != NULL)
     delete clusterDialog;
 
-  delete treeWidget;
+  delete treeView;
   QDir qDirS3(writableTempS3Dir);
   if(qDirS3.exists()){
     qDirS3.removeRecursively();
@@ -92,8 +95,8 @@ TableDockWidget::~TableDockWidget() {
 
 }
 
-void TableDockWidget::sortChildrenAscending(QTreeWidgetItem *item) {
-  item->sortChildren(1, Qt::AscendingOrder);
+void TableDockWidget::sortChildrenAscending(const QModelIndex &index) {
+  peakTableModel->sortChildren(index, 1, Qt::AscendingOrder);
 }
 
 void TableDockWidget::showTrainDialog() { traindialog->show(); }
@@ -101,11 +104,10 @@ void TableDockWidget::showTrainDialog() { traindialog->show(); }
 void TableDockWidget::showClusterDialog() { clusterDialog->show(); }
 
 void TableDockWidget::sortBy(int col) {
-  treeWidget->sortByColumn(col, Qt::AscendingOrder);
+  treeView->sortByColumn(col, Qt::AscendingOrder);
 }
 
 void TableDockWidget::setIntensityColName() {
-  QTreeWidgetItem *header = treeWidget->headerItem();
   QString temp;
   PeakGroup::QType qtype = _mainwindow->getUserQuantType();
   switch (qtype) {
@@ -129,7 +131,7 @@ void TableDockWidget::setIntensityColName() {
     break;
   }
   _mainwindow->currentIntensityName = temp;
-  header->setText(9, temp);
+  peakTableModel->setHeaderData(9, Qt::Horizontal, temp);
 }
 
 void TableDockWidget::setupPeakTable() {
@@ -156,8 +158,11 @@ void TableDockWidget::setupPeakTable() {
     colNames << "MS2 Score";
     colNames << "#MS2 Events";
     colNames << "Rank";
-  } else if (viewType == peakView) {
-    vector<mzSample *> vsamples = _mainwindow->getVisibleSamples();
+  }
+
+  vector<mzSample *> vsamples;
+  if (viewType == peakView) {
+    vsamples = _mainwindow->getVisibleSamples();
     sort(vsamples.begin(), vsamples.end(), mzSample::compSampleOrder);
     for (unsigned int i = 0; i < vsamples.size(); i++) {
       // Add peak view columns to the table
@@ -165,33 +170,33 @@ void TableDockWidget::setupPeakTable() {
     }
   }
 
-  treeWidget->setColumnCount(colNames.size());
-  treeWidget->setHeaderLabels(colNames);
-  treeWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
-  treeWidget->header()->adjustSize();
-  treeWidget->setSortingEnabled(true);
+  peakTableModel->setColumns(colNames, vsamples);
+  treeView->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+  treeView->header()->adjustSize();
+  treeView->setSortingEnabled(true);
 }
 
 void TableDockWidget::updateTable() {
-  QTreeWidgetItemIterator it(treeWidget);
-  while (*it) {
-    updateItem(*it);
-    ++it;
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+    updateItem(index);
   }
   updateStatus();
 }
 
-void TableDockWidget::updateItem(QTreeWidgetItem *item) {
-  QVariant v = item->data(0, Qt::UserRole);
-  PeakGroup *group = v.value<PeakGroup *>();
+void TableDockWidget::updateItem(const QModelIndex &index) {
+  PeakGroup *group = peakTableModel->group(index);
   if (group == NULL)
     return;
-  heatmapBackground(item);
 
-    if (viewType == groupView) {
-        item->setText(11, QString::number(group->maxQuality, 'f', 2));
-        item->setText(1, QString(group->getName().c_str()));
-  }
+  scoreGroup(group);
+
+  // the row is redrawn from the group
+  peakTableModel->updateGroup(index);
+
+  filterItem(index);
+}
+
+void TableDockWidget::scoreGroup(PeakGroup *group) {
   //Find maximum number of peaks
   if (maxPeaks < group->peakCount()) maxPeaks = group->peakCount();
   //score group quality
@@ -205,194 +210,32 @@ void TableDockWidget::updateItem(QTreeWidgetItem *item) {
   if (groupPred != NULL) {
       groupPred->predict(group);
   }
-  
-  // Updating the peakid
-  item->setText(0, QString::number(group->groupId));
-
-  if (viewType == groupView && fabs(group->changeFoldRatio) >= 0) {
-    item->setText(15, QString::number(group->changeFoldRatio, 'f', 3));
-    item->setText(16, QString::number(group->changePValue, 'f', 6));
-  }
-
-  int good = 0;
-  int bad = 0;
-  int total = group->peakCount();
-  for (int i = 0; i < group->peakCount(); i++) {
-    group->peaks[i].quality > _mainwindow->mavenParameters->minQuality ? good++
-                                                                       : bad++;
-  }
-
-  QBrush brush = Qt::NoBrush;
-  if (good > 0 && group->label == 'b') {
-    float incorrectFraction = ((float)good) / total;
-    brush = QBrush(QColor::fromRgbF(0.8, 0, 0, incorrectFraction));
-  } else if (bad > 0 && group->label == 'g') {
-    float incorrectFraction = ((float)bad) / total;
-    brush = QBrush(QColor::fromRgbF(0.8, 0, 0, incorrectFraction));
-  }
-  item->setBackground(0, brush);
+}
 
-  if (group->label == 'g')
-    item->setIcon(0, QIcon(":/images/good.png"));
-  if (group->label == 'b')
-    item->setIcon(0, QIcon(":/images/bad.png"));
+void TableDockWidget::filterItem(const QModelIndex &index) {
+  PeakGroup *group = peakTableModel->group(index);
+  if (group == NULL)
+    return;
 
   if (filtersDialog->isVisible()) {
     float minG = sliders["GoodPeakCount"]->minBoundValue();
     float maxG = sliders["GoodPeakCount"]->maxBoundValue();
 
     if (group->goodPeakCount < minG || group->goodPeakCount > maxG) {
-      item->setHidden(true);
+      treeView->setRowHidden(index.row(), index.parent(), true);
     } else {
-      item->setHidden(false);
+      treeView->setRowHidden(index.row(), index.parent(), false);
     }
   }
 }
 
 void TableDockWidget::updateCompoundWidget() {
   _mainwindow->ligandWidget->resetColor();
-  QTreeWidgetItemIterator itr(treeWidget);
-  while (*itr) {
-    QTreeWidgetItem *item = (*itr);
-    if (item) {
-      QVariant v = item->data(0, Qt::UserRole);
-      PeakGroup *group = v.value<PeakGroup *>();
-      if (group == nullptr)
-        continue;
-      _mainwindow->ligandWidget->markAsDone(group->compound);
-    }
-    ++itr;
-  }
-}
-
-void TableDockWidget::heatmapBackground(QTreeWidgetItem *item) {
-  if (viewType != peakView)
-    return;
-
-  int firstColumn = 4;
-  StatisticsVector<float> values;
-  float sum = 0;
-  for (unsigned int i = firstColumn; i < item->columnCount(); i++) {
-    values.push_back(item->text(i).toFloat());
-  }
-
-  if (values.size()) {
-    // normalize
-    float mean = values.mean();
-    float sd = values.stddev();
-
-    float max = values.maximum();
-    float min = values.minimum();
-    float range = max - min;
-
-    for (int i = 0; i < values.size(); i++) {
-      if (max != 0)
-        values[i] = abs((max - values[i]) / max); // Z-score
-    }
-
-    QColor color = Qt::white;
-
-    float colorramp = 0.5;
-
-    for (int i = 0; i < values.size(); i++) {
-      float value = values[i];
-      float prob = value;
-      if (prob < 0)
-        prob = 0;
-      color.setHsvF(0.0, prob, 1, 1);
-
-      item->setBackgroundColor(firstColumn + i, color);
-    }
-  }
-}
-
-void TableDockWidget::addRow(PeakGroup *group, QTreeWidgetItem *root) {
-
-  if (group == NULL)
-    return;
-  if (group->peakCount() == 0)
-    return;
-  if (group->meanMz <= 0) {
-    return;
-  }
-
-  NumericTreeWidgetItem *item = new NumericTreeWidgetItem(root, 0);
-  item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled |
-                 Qt::ItemIsDragEnabled);
-  item->setData(0, Qt::UserRole, QVariant::fromValue(group));
-
-  item->setText(0, QString::number(group->groupId));
-  item->setText(1, QString(group->getName().c_str()));
-  item->setText(2, QString::number(group->meanMz, 'f', 4));
-  int charge = _mainwindow->mavenParameters->getCharge(group->compound);
-
-  if (group->getExpectedMz(charge) != -1) {
-    float mz = group->getExpectedMz(charge);
-
-    item->setText(3, QString::number(mz, 'f', 4));
-  } else {
-    item->setText(3, "NA");
-  }
-
-  item->setText(4, QString::number(group->meanRt, 'f', 2));
-
-  if (group->label == 'g')
-    item->setIcon(0, QIcon(":/images/good.png"));
-  if (group->label == 'b')
-    item->setIcon(0, QIcon(":/images/bad.png"));
-
-  if (viewType == groupView) {
-
-    item->setText(5, QString::number(group->expectedRtDiff, 'f', 2));
-    item->setText(6, QString::number(group->sampleCount));
-    item->setText(7, QString::number(group->goodPeakCount));
-    item->setText(8, QString::number(group->maxNoNoiseObs));
-    item->setText(9, QString::number(extractMaxIntensity(group), 'g', 2));
-    item->setText(10, QString::number(group->maxSignalBaselineRatio, 'f', 0));
-    item->setText(11, QString::number(group->maxQuality, 'f', 2));
-    item->setText(12, QString::number(group->fragMatchScore.mergedScore, 'f', 2));
-    item->setText(13, QString::number(group->ms2EventCount));
-    item->setText(14, QString::number(group->groupRank, 'e', 6));
-
-    if (group->changeFoldRatio != 0) {
-
-      item->setText(15, QString::number(group->changeFoldRatio, 'f', 2));
-      item->setText(16, QString::number(group->changePValue, 'e', 4));
-    }
-
-    //Find maximum number of peaks
-    if (maxPeaks < group->peakCount())
-        maxPeaks = group->peakCount();
-
-    //TODO: Move this to peak detector or peakgroup
-    groupClassifier* groupClsf = _mainwindow->getGroupClassifier();
-    if (groupClsf != NULL) {
-        groupClsf->classify(group);
-    }
-
-    //Get prediction labels from svm
-    svmPredictor* groupPred = _mainwindow->getSVMPredictor();
-    if (groupPred != NULL) {
-        groupPred->predict(group);
-    }
-  } else if (viewType == peakView) {
-    vector<mzSample *> vsamples = _mainwindow->getVisibleSamples();
-    sort(vsamples.begin(), vsamples.end(), mzSample::compSampleOrder);
-    vector<float> yvalues = group->getOrderedIntensityVector(
-        vsamples, _mainwindow->getUserQuantType());
-    for (unsigned int i = 0; i < yvalues.size(); i++) {
-
-      item->setText(5 + i, QString::number(yvalues[i]));
-    }
-    heatmapBackground(item);
-  }
-  if (root == NULL)
-    treeWidget->addTopLevelItem(item);
-  updateItem(item);
-
-  if (group->childCount() > 0) {
-    for (int i = 0; i < group->childCount(); i++)
-      addRow(&(group->children[i]), item);
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+    PeakGroup *group = peakTableModel->group(index);
+    if (group == nullptr)
+      continue;
+    _mainwindow->ligandWidget->markAsDone(group->compound);
   }
 }
 
@@ -408,13 +251,12 @@ PeakGroup *TableDockWidget::addPeakGroup(PeakGroup *group) {
     allgroups.push_back(*group);
 	if (group->childCount() > 0)
 		labeledGroups++;
-    if (allgroups.size() > 0) {
-      PeakGroup &g = allgroups[allgroups.size() - 1];
-      for (unsigned int i = 0; i < allgroups.size(); i++) {
-        allgroups[i].groupId = i + 1;
-      }
-      return &g;
-    }
+
+    // deleteGroup keeps the ids of the other groups in sequence
+    PeakGroup &g = allgroups.last();
+    g.groupId = allgroups.size();
+    peakTableModel->appendGroup(&g);
+    return &g;
   }
 
   return NULL;
@@ -429,7 +271,7 @@ QList<PeakGroup *> TableDockWidget::getGroups() {
 }
 
 void TableDockWidget::deleteAll() {
-  treeWidget->clear();
+  peakTableModel->clear();
   allgroups.clear();
 
   _mainwindow->removePeaksTable(this);
@@ -445,56 +287,48 @@ void TableDockWidget::deleteAll() {
 }
 
 void TableDockWidget::showAllGroups() {
-  treeWidget->clear();
-
   setFocus();
   if (allgroups.size() == 0) {
+    peakTableModel->clear();
     if (viewType == groupView)
       setIntensityColName();
     setVisible(false);
     return;
   }
 
-  treeWidget->setSortingEnabled(false);
+  treeView->setSortingEnabled(false);
+
+  // groups are scored before setupPeakTable sorts the rows, so the rows are
+  // drawn from scored groups instead of being redrawn one by one
+  peakTableModel->setGroups(allgroups);
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+    PeakGroup *group = peakTableModel->group(index);
+    if (group != NULL)
+      scoreGroup(group);
+  }
 
   setupPeakTable();
   if (viewType == groupView)
     setIntensityColName();
 
-  QMap<int, QTreeWidgetItem *> parents;
-  for (int i = 0; i < allgroups.size(); i++) {
-    int clusterId = allgroups[i].clusterId;
-    if (clusterId && allgroups[i].meanMz > 0 && allgroups[i].peakCount() > 0) {
-      if (!parents.contains(clusterId)) {
-        parents[clusterId] = new QTreeWidgetItem(treeWidget);
-        parents[clusterId]->setText(0, QString("Cluster ") +
-                                           QString::number(clusterId));
-        parents[clusterId]->setText(
-            5, QString::number(allgroups[i].meanRt, 'f', 2));
-        parents[clusterId]->setExpanded(true);
-      }
-      QTreeWidgetItem *parent = parents[clusterId];
-      addRow(&allgroups[i], parent);
-    } else {
-      addRow(&allgroups[i], NULL);
-    }
+  for (int i = 0; i < peakTableModel->rowCount(); i++) {
+    QModelIndex index = peakTableModel->index(i, 0);
+    if (peakTableModel->isCluster(index))
+      treeView->setExpanded(index, true);
   }
 
-  QScrollBar *vScroll = treeWidget->verticalScrollBar();
+  QScrollBar *vScroll = treeView->verticalScrollBar();
   if (vScroll) {
     vScroll->setSliderPosition(vScroll->maximum());
   }
-  treeWidget->setSortingEnabled(true);
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+    filterItem(index);
+  }
   updateStatus();
   updateCompoundWidget();
   //@Kailash: Check and validate all groups automatically
-  QTreeWidgetItemIterator itr(treeWidget);
-  while(*itr) {
-      QTreeWidgetItem* item = (*itr);
-      QVariant v = item->data(0,Qt::UserRole);
-      PeakGroup* grp = v.value<PeakGroup*>();
-      validateGroup(grp, item);
-      itr++;
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+      validateGroup(peakTableModel->group(index));
   }
 
 }
@@ -873,39 +707,24 @@ vector<EIC *> TableDockWidget::getEICs(float rtmin,
 
 void TableDockWidget::showSelectedGroup() {
 
-  QTreeWidgetItem *item = treeWidget->currentItem();
-  if (!item)
+  QModelIndex index = treeView->currentIndex();
+  if (!index.isValid())
     return;
 
-  QVariant v = item->data(0, Qt::UserRole);
-  PeakGroup *group = v.value<PeakGroup *>();
+  PeakGroup *group = peakTableModel->group(index);
   _mainwindow->groupRtWidget->plotGraph(group);
 
   if (group != NULL && _mainwindow != NULL) {
     _mainwindow->setPeakGroup(group);
   }
-
-  if (item->childCount() > 0) {
-    vector<PeakGroup *> children;
-    for (int i = 0; i < item->childCount(); i++) {
-      QTreeWidgetItem *child = item->child(i);
-      QVariant data = child->data(0, Qt::UserRole);
-      PeakGroup *group = data.value<PeakGroup *>();
-      if (group)
-        children.push_back(group);
-    }
-  }
 }
 
 QList<PeakGroup *> TableDockWidget::getSelectedGroups() {
   QList<PeakGroup *> selectedGroups;
-  Q_FOREACH (QTreeWidgetItem *item, treeWidget->selectedItems()) {
-    if (item) {
-      QVariant v = item->data(0, Qt::UserRole);
-      PeakGroup *group = v.value<PeakGroup *>();
-      if (group != NULL) {
-        selectedGroups.append(group);
-      }
+  Q_FOREACH (QModelIndex index, treeView->selectionModel()->selectedRows()) {
+    PeakGroup *group = peakTableModel->group(index);
+    if (group != NULL) {
+      selectedGroups.append(group);
     }
   }
   return selectedGroups;
@@ -920,22 +739,19 @@ QList<PeakGroup *>
 TableDockWidget::getCustomGroups(peakTableSelectionType peakSelection) {
   QList<PeakGroup *> selectedGroups;
   peakTableSelectionType temppeakSelection = peakSelection;
-  Q_FOREACH (QTreeWidgetItem *item, treeWidget->selectedItems()) {
-    if (item) {
-      QVariant v = item->data(0, Qt::UserRole);
-      PeakGroup *group = v.value<PeakGroup *>();
-      if (group != NULL) {
-        if (temppeakSelection == peakTableSelectionType::Good) {
-          if (group->label == 'g') {
-            selectedGroups.append(group);
-          }
-        } else if (temppeakSelection == peakTableSelectionType::Bad) {
-          if (group->label == 'b') {
-            selectedGroups.append(group);
-          }
-        } else {
+  Q_FOREACH (QModelIndex index, treeView->selectionModel()->selectedRows()) {
+    PeakGroup *group = peakTableModel->group(index);
+    if (group != NULL) {
+      if (temppeakSelection == peakTableSelectionType::Good) {
+        if (group->label == 'g') {
+          selectedGroups.append(group);
+        }
+      } else if (temppeakSelection == peakTableSelectionType::Bad) {
+        if (group->label == 'b') {
           selectedGroups.append(group);
         }
+      } else {
+        selectedGroups.append(group);
       }
     }
   }
@@ -943,22 +759,12 @@ TableDockWidget::getCustomGroups(peakTableSelectionType peakSelection) {
 }
 
 PeakGroup *TableDockWidget::getSelectedGroup() {
-  QTreeWidgetItem *item = treeWidget->currentItem();
-  if (!item)
-    return NULL;
-  QVariant v = item->data(0, Qt::UserRole);
-  PeakGroup *group = v.value<PeakGroup *>();
-  if (group != NULL) {
-    return group;
-  } else
-    return NULL;
+  return peakTableModel->group(treeView->currentIndex());
 }
 
 void TableDockWidget::setGroupLabel(char label) {
-  Q_FOREACH (QTreeWidgetItem *item, treeWidget->selectedItems()) {
-    if (item) {
-      QVariant v = item->data(0, Qt::UserRole);
-      PeakGroup *group = v.value<PeakGroup *>();
+  Q_FOREACH (QModelIndex index, treeView->selectionModel()->selectedRows()) {
+      PeakGroup *group = peakTableModel->group(index);
       if (group != NULL) {
         if (!(group->label=='g'||group->label=='b')){
           numberOfGroupsMarked+=1;
@@ -973,9 +779,8 @@ void TableDockWidget::setGroupLabel(char label) {
           uploadCount+=1;
           }
       }
-      updateItem(item);
-    }
-}
+      updateItem(index);
+  }
   updateStatus();
 }
 
@@ -993,30 +798,13 @@ void TableDockWidget::deleteGroup(PeakGroup *groupX) {
   if (pos == -1)
     return;
 
-  QTreeWidgetItemIterator it(treeWidget);
-  while (*it) {
-    QTreeWidgetItem *item = (*it);
-    if (item->isHidden()) {
-      ++it;
-      continue;
-    }
-    QVariant v = item->data(0, Qt::UserRole);
-    PeakGroup *group = v.value<PeakGroup *>();
-    if (group != NULL and group == groupX) {
-      item->setHidden(true);
-
-      if (group->children.size() > 0)
-            labeledGroups--;
+  if (peakTableModel->indexOf(groupX).isValid()) {
+    if (groupX->children.size() > 0)
+      labeledGroups--;
 
-      // Deleting
-      int posTree = treeWidget->indexOfTopLevelItem(item);
-      if (posTree != -1)
-        treeWidget->takeTopLevelItem(posTree);
-
-      allgroups.erase(allgroups.begin() + pos);
-      break;
-    }
-    ++it;
+    // Deleting
+    peakTableModel->removeGroup(groupX);
+    allgroups.erase(allgroups.begin() + pos);
   }
 
   for (unsigned int i = 0; i < allgroups.size(); i++) {
@@ -1028,52 +816,32 @@ void TableDockWidget::deleteGroup(PeakGroup *groupX) {
 
 void TableDockWidget::deleteGroups() {
 
-  QList<PeakGroup *> selectedGroups;
-  QTreeWidgetItem *nextItem;
-
-  if (treeWidget->selectedItems().size() == 0) {
+  QModelIndexList selectedRows = treeView->selectionModel()->selectedRows();
+  if (selectedRows.size() == 0) {
     return;
   }
 
-  Q_FOREACH (QTreeWidgetItem *item, treeWidget->selectedItems()) {
-    if (item) {
-      nextItem = treeWidget->itemBelow(item);
-      QVariant v = item->data(0, Qt::UserRole);
-      PeakGroup *group = v.value<PeakGroup *>();
-      if (group != NULL) {
-        PeakGroup *parentGroup = group->parent;
-        int childrenNum = -1;
-        if (parentGroup == NULL) {
-            // top level item
-            if (nextItem) {
-                QVariant vc = nextItem->data(0, Qt::UserRole);
-                PeakGroup *groupc = vc.value<PeakGroup *>();
-            	if (groupc->isIsotope())
-            		nextItem = nextItem->parent();
-            }
-            deleteGroup(group);
-        } else if (parentGroup && parentGroup->childCount()) {
-            // this a child item
-            childrenNum = parentGroup->childCount();
-            if (parentGroup->deleteChild(group)) {
-                QTreeWidgetItem *parentItem = item->parent();
-                if (parentItem) {
-                	parentItem->removeChild(item);
-              		delete (item);
-            	}
-          	}
-        }
-        if (parentGroup != NULL) {
-        	if (childrenNum == parentGroup->childCount()) {
-            	deleteGroup(group);
-            	nextItem = treeWidget->itemBelow(item->parent());
-            }
-        }
-      }
+  // the row shown after the selected ones is selected once they are gone,
+  // a persistent index follows it while rows above are removed
+  QPersistentModelIndex nextIndex = treeView->indexBelow(selectedRows.last());
+
+  Q_FOREACH (PeakGroup *group, getSelectedGroups()) {
+    // skip groups removed along with a parent group selected before them
+    if (!peakTableModel->indexOf(group).isValid())
+      continue;
+
+    PeakGroup *parentGroup = group->parent;
+    if (parentGroup == NULL) {
+      // top level item
+      deleteGroup(group);
+    } else if (parentGroup->childCount()) {
+      // this a child item, it is emptied rather than erased from its parent
+      peakTableModel->removeGroup(group);
+      parentGroup->deleteChild(group);
     }
   }
-  if (nextItem)
-    treeWidget->setCurrentItem(nextItem, 0);
+  if (nextIndex.isValid())
+    treeView->setCurrentIndex(nextIndex);
   _mainwindow->getEicWidget()->replotForced();
   showSelectedGroup();
   _mainwindow->getEicWidget()->addPeakPositions();
@@ -1145,22 +913,22 @@ void TableDockWidget::markGroupIgnored() {
 }
 
 void TableDockWidget::showLastGroup() {
-  QTreeWidgetItem *item = treeWidget->currentItem();
-  if (item != NULL) {
-    treeWidget->setCurrentItem(treeWidget->itemAbove(item));
+  QModelIndex index = treeView->currentIndex();
+  if (index.isValid()) {
+    treeView->setCurrentIndex(treeView->indexAbove(index));
   }
 }
 
 void TableDockWidget::showNextGroup() {
 
-  QTreeWidgetItem *item = treeWidget->currentItem();
-  if (item == NULL)
+  QModelIndex index = treeView->currentIndex();
+  if (!index.isValid())
     return;
 
   // get next item
-  QTreeWidgetItem *nextitem = treeWidget->itemBelow(item);
-  if (nextitem != NULL)
-    treeWidget->setCurrentItem(nextitem);
+  QModelIndex nextIndex = treeView->indexBelow(index);
+  if (nextIndex.isValid())
+    treeView->setCurrentIndex(nextIndex);
 }
 
 void TableDockWidget::Train() {
@@ -1206,94 +974,94 @@ void TableDockWidget::Train() {
 
 void TableDockWidget::keyPressEvent(QKeyEvent *e) {
 
-  QTreeWidgetItem *item = treeWidget->currentItem();
+  QModelIndex index = treeView->currentIndex();
   if (e->key() == Qt::Key_Delete) {
-    QList<QTreeWidgetItem *> items = treeWidget->selectedItems();
-    if (items.size() > 0) {
-      cerr << items.size() << endl;
+    QModelIndexList rows = treeView->selectionModel()->selectedRows();
+    if (rows.size() > 0) {
+      cerr << rows.size() << endl;
       deleteGroups();
     }
   } else if (e->key() == Qt::Key_T) {
-    if (item) {
+    if (index.isValid()) {
       Train();
     }
   } else if (e->key() == Qt::Key_G) {
 
-    if (item) {
+    if (index.isValid()) {
       markGroupGood();
     }
   } else if (e->key() == Qt::Key_B) {
 
-    if (item) {
+    if (index.isValid()) {
       markGroupBad();
     }
   } else if (e->key() == Qt::Key_Left) {
 
-    if (treeWidget->currentItem()) {
-      if (treeWidget->currentItem()->parent()) {
-        treeWidget->collapseItem(treeWidget->currentItem()->parent());
-        treeWidget->setCurrentItem(treeWidget->currentItem()->parent());
+    if (index.isValid()) {
+      if (index.parent().isValid()) {
+        treeView->collapse(index.parent());
+        treeView->setCurrentIndex(index.parent());
       } else {
-        treeWidget->collapseItem(treeWidget->currentItem());
+        treeView->collapse(index);
       }
     }
   } else if (e->key() == Qt::Key_Right) {
 
-    if (treeWidget->currentItem()) {
-      if (!treeWidget->currentItem()->isExpanded()) {
-        treeWidget->expandItem(treeWidget->currentItem());
+    if (index.isValid()) {
+      if (!treeView->isExpanded(index)) {
+        treeView->expand(index);
       }
     }
   } else if (e->key() == Qt::Key_O) {
-    if (treeWidget->currentItem()) {
-      if (treeWidget->currentItem()->isExpanded()) {
-        if (treeWidget->currentItem()->parent()) {
-          treeWidget->collapseItem(treeWidget->currentItem()->parent());
-          treeWidget->setCurrentItem(treeWidget->currentItem()->parent());
+    if (index.isValid()) {
+      if (treeView->isExpanded(index)) {
+        if (index.parent().isValid()) {
+          treeView->collapse(index.parent());
+          treeView->setCurrentIndex(index.parent());
         } else {
-          treeWidget->collapseItem(treeWidget->currentItem());
+          treeView->collapse(index);
         }
       } else {
-        treeWidget->expandItem(treeWidget->currentItem());
+        treeView->expand(index);
       }
     }
   } else if (e->key() == Qt::Key_Down && e->modifiers() == Qt::ShiftModifier) {
-    if (treeWidget->itemBelow(item)) {
+    if (treeView->indexBelow(index).isValid()) {
       if (tableSelectionFlagDown) {
-        treeWidget->selectionModel()->setCurrentIndex(
-            treeWidget->currentIndex(),
+        treeView->selectionModel()->setCurrentIndex(
+            treeView->currentIndex(),
             QItemSelectionModel::Toggle | QItemSelectionModel::Rows);
         tableSelectionFlagDown = false;
       } else {
-        treeWidget->selectionModel()->setCurrentIndex(
-            treeWidget->indexBelow(treeWidget->currentIndex()),
+        treeView->selectionModel()->setCurrentIndex(
+            treeView->indexBelow(treeView->currentIndex()),
             QItemSelectionModel::Toggle | QItemSelectionModel::Rows);
       }
       tableSelectionFlagUp = true;
     }
   } else if (e->key() == Qt::Key_Up && e->modifiers() == Qt::ShiftModifier) {
-    if (treeWidget->itemAbove(item)) {
+    if (treeView->indexAbove(index).isValid()) {
       if (tableSelectionFlagUp) {
-        treeWidget->selectionModel()->setCurrentIndex(
-            treeWidget->currentIndex(),
+        treeView->selectionModel()->setCurrentIndex(
+            treeView->currentIndex(),
             QItemSelectionModel::Toggle | QItemSelectionModel::Rows);
         tableSelectionFlagUp = false;
       } else {
-        treeWidget->selectionModel()->setCurrentIndex(
-            treeWidget->indexAbove(treeWidget->currentIndex()),
+        treeView->selectionModel()->setCurrentIndex(
+            treeView->indexAbove(treeView->currentIndex()),
             QItemSelectionModel::Toggle | QItemSelectionModel::Rows);
       }
       tableSelectionFlagDown = true;
     }
   } else if (e->key() == Qt::Key_Down) {
 
-    if (treeWidget->itemBelow(item)) {
-      treeWidget->setCurrentItem(treeWidget->itemBelow(item));
+    if (treeView->indexBelow(index).isValid()) {
+      treeView->setCurrentIndex(treeView->indexBelow(index));
     }
   } else if (e->key() == Qt::Key_Up) {
 
-    if (treeWidget->itemAbove(item)) {
-      treeWidget->setCurrentItem(treeWidget->itemAbove(item));
+    if (treeView->indexAbove(index).isValid()) {
+      treeView->setCurrentIndex(treeView->indexAbove(index));
     }
   }
   QDockWidget::keyPressEvent(e);
@@ -1743,30 +1511,21 @@ void TableDockWidget::showFiltersDialog() {
 void TableDockWidget::filterPeakTable() { updateTable(); }
 
 void TableDockWidget::showFocusedGroups() {
-  int N = treeWidget->topLevelItemCount();
+  int N = peakTableModel->rowCount();
   for (int i = 0; i < N; i++) {
-    QTreeWidgetItem *item = treeWidget->topLevelItem(i);
-    QVariant v = item->data(0, Qt::UserRole);
-    PeakGroup *group = v.value<PeakGroup *>();
-    if (group && group->isFocused)
-      item->setHidden(false);
-    else
-      item->setHidden(true);
-
-    if (item->text(0).startsWith("Cluster")) {
-      bool showParentFlag = false;
-      for (int j = 0; j < item->childCount(); j++) {
-        QVariant v = (item->child(j))->data(0, Qt::UserRole);
-        PeakGroup *group = v.value<PeakGroup *>();
-        if (group && group->isFocused) {
-          item->setHidden(false);
-          showParentFlag = true;
-        } else
-          item->setHidden(true);
+    QModelIndex index = peakTableModel->index(i, 0);
+    PeakGroup *group = peakTableModel->group(index);
+    bool hidden = !(group && group->isFocused);
+
+    if (peakTableModel->isCluster(index)) {
+      // a cluster is shown when any of its groups is focused
+      for (int j = 0; j < peakTableModel->rowCount(index); j++) {
+        PeakGroup *group = peakTableModel->group(peakTableModel->index(j, 0, index));
+        if (group && group->isFocused)
+          hidden = false;
       }
-      if (showParentFlag)
-        item->setHidden(false);
     }
+    treeView->setRowHidden(i, QModelIndex(), hidden);
   }
 }
 
@@ -1778,10 +1537,8 @@ void TableDockWidget::clearFocusedGroups() {
 
 void TableDockWidget::unhideFocusedGroups() {
   clearFocusedGroups();
-  QTreeWidgetItemIterator it(treeWidget);
-  while (*it) {
-    (*it)->setHidden(false);
-    ++it;
+  Q_FOREACH (QModelIndex index, peakTableModel->rowIndexes()) {
+    treeView->setRowHidden(index.row(), index.parent(), false);
   }
 }
 
@@ -1903,9 +1660,7 @@ int TableDockWidget::loadCSVFile(QString filename, QString sep = "\t") {
 
 void TableDockWidget::switchTableView() {
   viewType == groupView ? viewType = peakView : viewType = groupView;
-  setupPeakTable();
   showAllGroups();
-  updateTable();
 }
 
 QWidget *TableToolBarWidgetAction::createWidget(QWidget *parent) {
@@ -1957,7 +1712,7 @@ QWidget *TableToolBarWidgetAction::createWidget(QWidget *parent) {
     connect(exportSelected, SIGNAL(triggered()), td, SLOT(showNotification()));
 
     connect(exportAll, SIGNAL(triggered()), td, SLOT(wholePeakSet()));
-    connect(exportAll, SIGNAL(triggered()), td->treeWidget, SLOT(selectAll()));
+    connect(exportAll, SIGNAL(triggered()), td->treeView, SLOT(selectAll()));
     connect(exportAll,
             SIGNAL(triggered()),
             td,
@@ -1965,7 +1720,7 @@ QWidget *TableToolBarWidgetAction::createWidget(QWidget *parent) {
     connect(exportAll, SIGNAL(triggered()), td, SLOT(showNotification()));
 
     connect(exportGood, SIGNAL(triggered()), td, SLOT(goodPeakSet()));
-    connect(exportGood, SIGNAL(triggered()), td->treeWidget, SLOT(selectAll()));
+    connect(exportGood, SIGNAL(triggered()), td->treeView, SLOT(selectAll()));
     connect(exportGood,
             SIGNAL(triggered()),
             td,
@@ -1973,7 +1728,7 @@ QWidget *TableToolBarWidgetAction::createWidget(QWidget *parent) {
     connect(exportGood, SIGNAL(triggered()), td, SLOT(showNotification()));
 
     connect(exportBad, SIGNAL(triggered()), td, SLOT(badPeakSet()));
-    connect(exportBad, SIGNAL(triggered()), td->treeWidget, SLOT(selectAll()));
+    connect(exportBad, SIGNAL(triggered()), td->treeView, SLOT(selectAll()));
     connect(exportBad,
             SIGNAL(triggered()),
             td,
@@ -2135,8 +1890,8 @@ void PeakTableDockWidget::destroy() {
 
 void PeakTableDockWidget::cleanUp()
 {
-  if (treeWidget->currentItem())
-    emit unSetFromEicWidget(treeWidget->currentItem()->data(0, Qt::UserRole).value<PeakGroup*>());
+  if (treeView->currentIndex().isValid())
+    emit unSetFromEicWidget(peakTableModel->group(treeView->currentIndex()));
   _mainwindow->ligandWidget->resetColor();
 }
 
@@ -2440,49 +2195,31 @@ void BookmarkTableDockWidget::deleteGroup(PeakGroup *groupX) {
   if (pos == -1)
     return;
 
-  QTreeWidgetItemIterator it(treeWidget);
-  while (*it) {
-    QTreeWidgetItem *item = (*it);
-    if (item->isHidden()) {
-      ++it;
-      continue;
-    }
-    QVariant v = item->data(0, Qt::UserRole);
-    PeakGroup *group = v.value<PeakGroup *>();
-    if (group != NULL and group == groupX) {
-        item->setHidden(true);
-
-	    if (group->children.size() > 0)
-            	labeledGroups--;
+  if (peakTableModel->indexOf(groupX).isValid()) {
+    if (groupX->children.size() > 0)
+      labeledGroups--;
 
-      	// Deleting
-        int posTree = treeWidget->indexOfTopLevelItem(item);
-        if (posTree != -1)
-    		treeWidget->takeTopLevelItem(posTree);
+    // Deleting
+    peakTableModel->removeGroup(groupX);
 
-        /**
-         * delete name of compound associated with this group stored in
-         * <sameMzRtGroups> with given mz and rt
-        */
-        int intMz = group->meanMz * 1e5;
-        int intRt = group->meanRt * 1e5;
-        QPair<int, int> sameMzRtGroupIndexHash(intMz, intRt);
-        QString compoundName = QString::fromStdString(groupX->getName());
-        if (sameMzRtGroups[sameMzRtGroupIndexHash].contains(compoundName)) {
-        	for (int i = 0; i < sameMzRtGroups[sameMzRtGroupIndexHash].size();
-            	 ++i)
-			{
-            	if (sameMzRtGroups[sameMzRtGroupIndexHash][i] == compoundName) {
-            	sameMzRtGroups[sameMzRtGroupIndexHash].removeAt(i);
-            	break;
-          	}
+    /**
+     * delete name of compound associated with this group stored in
+     * <sameMzRtGroups> with given mz and rt
+    */
+    int intMz = groupX->meanMz * 1e5;
+    int intRt = groupX->meanRt * 1e5;
+    QPair<int, int> sameMzRtGroupIndexHash(intMz, intRt);
+    QString compoundName = QString::fromStdString(groupX->getName());
+    if (sameMzRtGroups[sameMzRtGroupIndexHash].contains(compoundName)) {
+      for (int i = 0; i < sameMzRtGroups[sameMzRtGroupIndexHash].size(); ++i) {
+        if (sameMzRtGroups[sameMzRtGroupIndexHash][i] == compoundName) {
+          sameMzRtGroups[sameMzRtGroupIndexHash].removeAt(i);
+          break;
         }
       }
-
-      allgroups.erase(allgroups.begin() + pos);
-      break;
     }
-    ++it;
+
+    allgroups.erase(allgroups.begin() + pos);
   }
 
   for (unsigned int i = 0; i < allgroups.size(); i++) {
@@ -2596,8 +2333,11 @@ void ScatterplotTableDockWidget::setupPeakTable() {
     // add scatterplot table columns
     colNames << "Ratio Change";
     colNames << "P-value";
-  } else if (viewType == peakView) {
-    vector<mzSample *> vsamples = _mainwindow->getVisibleSamples();
+  }
+
+  vector<mzSample *> vsamples;
+  if (viewType == peakView) {
+    vsamples = _mainwindow->getVisibleSamples();
     sort(vsamples.begin(), vsamples.end(), mzSample::compSampleOrder);
     for (unsigned int i = 0; i < vsamples.size(); i++) {
       // Add peak view columns to the table
@@ -2605,15 +2345,14 @@ void ScatterplotTableDockWidget::setupPeakTable() {
     }
   }
 
-  treeWidget->setColumnCount(colNames.size());
-  treeWidget->setHeaderLabels(colNames);
-  treeWidget->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
-  treeWidget->header()->adjustSize();
-  treeWidget->setSortingEnabled(true);
+  peakTableModel->setColumns(colNames, vsamples);
+  treeView->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+  treeView->header()->adjustSize();
+  treeView->setSortingEnabled(true);
 }
 
 //@Kailash: Put decision sequence/tree for automatic validation here
-void TableDockWidget::validateGroup(PeakGroup* grp, QTreeWidgetItem* item)
+void TableDockWidget::validateGroup(PeakGroup* grp)
 {
     int mark=0;
     bool decisionConflict=false;
@@ -8,6 +8,7 @@
 #include "jsonReports.h";
 #include "mainwindow.h"
 #include "numeric_treewidgetitem.h"
+#include "peaktablemodel.h"
 #include "saveJson.h"
 #include "stable.h"
 #include "traindialog.h"
@@ -28,7 +29,8 @@ class TableDockWidget : public QDockWidget {
 public:
   QWidget *dockWidgetContents;
   QHBoxLayout *horizontalLayout;
-  QTreeWidget *treeWidget;
+  QTreeView *treeView;
+  PeakTableModel *peakTableModel;
   QLabel *titlePeakTable;
   JSONReports *jsonReports;
   int labeledGroups = 0;
@@ -59,7 +61,7 @@ public:
 
   /**
    * @brief Construct and initialize a TableDockWidget.
-   * @detail Sets up widgets (treewidget, dialogs, etc.) and connects
+   * @detail Sets up widgets (tree view, dialogs, etc.) and connects
    * any necessary signals.
    * 
    * @param mw A QMainWindow to which the dock belongs.
@@ -101,7 +103,7 @@ public:
 public Q_SLOTS:
   void updateCompoundWidget();
   PeakGroup *addPeakGroup(PeakGroup *group);
-  void sortChildrenAscending(QTreeWidgetItem *item);
+  void sortChildrenAscending(const QModelIndex &index);
   virtual void setupPeakTable();
   PeakGroup *getSelectedGroup();
   QList<PeakGroup *> getSelectedGroups();
@@ -157,11 +159,11 @@ public Q_SLOTS:
   void printPdfReport();
 
   void updateTable();
-  void updateItem(QTreeWidgetItem *item);
+  void updateItem(const QModelIndex &index);
   void updateStatus();
 
   //Group validation functions
-  void validateGroup(PeakGroup* grp, QTreeWidgetItem* item);
+  void validateGroup(PeakGroup* grp);
 
   virtual void markGroupBad();
   virtual void markGroupGood();
@@ -215,12 +217,21 @@ protected Q_SLOTS:
 
 private:
   QPalette pal;
-  void addRow(PeakGroup *group, QTreeWidgetItem *root);
-  void heatmapBackground(QTreeWidgetItem *item);
 
   // TODO: investigate and remove this dialog if not being used
   void setupFiltersDialog();
 
+  /**
+   * @brief Classify a group and track the largest number of peaks, without
+   * redrawing its row.
+   */
+  void scoreGroup(PeakGroup *group);
+
+  /**
+   * @brief Hide or show a row according to the filters dialog.
+   */
+  void filterItem(const QModelIndex &index);
+
   TrainDialog *traindialog;
   ClusterDialog *clusterDialog;
   QDialog *filtersDialog;
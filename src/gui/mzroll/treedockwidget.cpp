@@ -288,6 +288,7 @@ void TreeDockWidget::setupScanListHeader()
 void TreeDockWidget::addScanItem(Scan* scan) {
         if (scan == NULL) return;
         _scansList.append(scan);
+        ScanPeaksPin pin(scan);
 
         QIcon icon = _mainWindow->projectDockWidget->getSampleIcon(scan->sample);
 
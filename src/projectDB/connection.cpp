@@ -3,6 +3,7 @@
 
 Connection::Connection(const std::string& dbPath)
 {
+    _transactionDepth = 0;
     int errCode = sqlite3_open(dbPath.c_str(), &_database);
     if (errCode) {
         std::cerr << "Cannot open database at location \""
@@ -27,19 +28,54 @@ Connection::~Connection()
 
 bool Connection::begin()
 {
-    return prepare("BEGIN TRANSACTION")->execute();
+    // nested transactions are savepoints of the one already open
+    if (_transactionDepth > 0) {
+        if (!prepare("SAVEPOINT " + _savepointName(_transactionDepth))
+                 ->execute())
+            return false;
+        ++_transactionDepth;
+        return true;
+    }
+
+    if (!prepare("BEGIN TRANSACTION")->execute())
+        return false;
+
+    _transactionDepth = 1;
+    return true;
 }
 
 bool Connection::commit()
 {
+    if (_transactionDepth > 1) {
+        --_transactionDepth;
+        return prepare("RELEASE " + _savepointName(_transactionDepth))
+            ->execute();
+    }
+
+    _transactionDepth = 0;
     return prepare("COMMIT")->execute();
 }
 
 bool Connection::rollback()
 {
+    // only undo the changes of the nested transaction, the outer one stays
+    // open
+    if (_transactionDepth > 1) {
+        --_transactionDepth;
+        auto savepoint = _savepointName(_transactionDepth);
+        auto rolledBack = prepare("ROLLBACK TO " + savepoint)->execute();
+        return prepare("RELEASE " + savepoint)->execute() && rolledBack;
+    }
+
+    _transactionDepth = 0;
     return prepare("ROLLBACK")->execute();
 }
 
+std::string Connection::_savepointName(int depth)
+{
+    return "nested_transaction_" + std::to_string(depth);
+}
+
 bool Connection::executeMulti(const std::string sql_string)
 {
     int res_code = sqlite3_exec(_database,
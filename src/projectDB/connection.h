@@ -41,9 +41,12 @@ public:
      * @brief Start an explicit SQLite transaction.
      * @details Transactions are automatically started whenever a user attempts
      * to execute a database modification statement. However, if required, this
-     * method can be used to explicitly start one. It should be noted that this
-     * method does not allow the user to have nested transactions, for which
-     * they will need to use appropriate checkpoints using SQLite commands.
+     * method can be used to explicitly start one. Transactions begun while
+     * another is open are savepoints of the outer one: only the outermost
+     * `commit` writes the changes, so that a series of operations that each
+     * use a transaction can be saved together, while a `rollback` of a nested
+     * transaction only undoes the changes made since it was begun. Every
+     * `begin` has to be paired with one `commit` or `rollback`.
      * @return True if a transaction was started successfully.
      */
     bool begin();
@@ -147,6 +150,18 @@ private:
      * connection and therefore should be deleted when this object is destroyed.
      */
     std::vector<Cursor*> _cursors;
+
+    /**
+     * @brief Number of transactions begun and not yet committed, including
+     * the ones nested in the outermost transaction.
+     */
+    int _transactionDepth;
+
+    /**
+     * @brief Name of the savepoint a transaction begun at the given depth is
+     * nested in.
+     */
+    static std::string _savepointName(int depth);
 };
 
 #endif // CONNECTION_H
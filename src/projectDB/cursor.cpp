@@ -4,6 +4,7 @@
 Cursor::Cursor(sqlite3_stmt* statement)
 {
     _statement = statement;
+    _columnsResolved = false;
 }
 
 Cursor::~Cursor()
@@ -22,7 +23,6 @@ bool Cursor::execute()
 bool Cursor::next()
 {
     int status = sqlite3_step(_statement);
-    _extractValues();
     return status == SQLITE_ROW;
 }
 
@@ -32,6 +32,12 @@ bool Cursor::bind(const std::string& param, int value)
     return sqlite3_bind_int(_statement, index, value) == SQLITE_OK;
 }
 
+bool Cursor::bind(const std::string& param, long long value)
+{
+    int index = sqlite3_bind_parameter_index(_statement, param.c_str());
+    return sqlite3_bind_int64(_statement, index, value) == SQLITE_OK;
+}
+
 bool Cursor::bind(const std::string& param, double value)
 {
     int index = sqlite3_bind_parameter_index(_statement, param.c_str());
@@ -56,54 +62,112 @@ bool Cursor::bind(const std::string& param, const std::string value)
 
 int Cursor::integerValue(const std::string& param)
 {
-    auto val = _currentResult[param];
-    if (val.empty())
-        return 0;
-    return std::stoi(val);
+    return integerValue(columnIndex(param));
 }
 
 double Cursor::doubleValue(const std::string& param)
 {
-    auto val = _currentResult[param];
-    if (val.empty())
-        return 0.0;
-    return std::stod(_currentResult[param]);
+    return doubleValue(columnIndex(param));
 }
 
 float Cursor::floatValue(const std::string& param)
 {
-    double dval = doubleValue(param);
-    return static_cast<float>(dval);
+    return floatValue(columnIndex(param));
 }
 
 std::string Cursor::stringValue(const std::string& param)
 {
-    return _currentResult[param];
+    return stringValue(columnIndex(param));
 }
 
-void Cursor::_extractValues()
+int Cursor::columnIndex(const std::string& column)
 {
-    _currentResult.clear();
-    int valueCount = sqlite3_data_count(_statement);
+    if (!_columnsResolved) {
+        int columnCount = _statement ? sqlite3_column_count(_statement) : 0;
+        for (int i = 0; i < columnCount; ++i) {
+            auto name = sqlite3_column_name(_statement, i);
+            // if name was pointing to NULL
+            if (!name)
+                name = "";
+
+            // insert keeps the first of several columns with the same name
+            _columnIndices.insert(std::make_pair(std::string(name), i));
+        }
+        _columnsResolved = true;
+    }
 
-    while (valueCount) {
-        // column indexing goes from 0 to (valueCount - 1), so decrement first
-        --valueCount;
+    auto found = _columnIndices.find(column);
+    if (found == _columnIndices.end())
+        return -1;
+    return found->second;
+}
 
-        auto param =
-            reinterpret_cast<const char*>(sqlite3_column_name(_statement,
-                                                              valueCount));
-        // if param was pointing to NULL
-        if (!param)
-            param = "";
+int Cursor::integerValue(int column)
+{
+    if (!_isReadable(column))
+        return 0;
+    return sqlite3_column_int(_statement, column);
+}
 
-        auto value =
-            reinterpret_cast<const char*>(sqlite3_column_text(_statement,
-                                                              valueCount));
-        // if value was pointing to NULL
-        if (!value)
-            value = "";
+long long Cursor::int64Value(int column)
+{
+    if (!_isReadable(column))
+        return 0;
+    return sqlite3_column_int64(_statement, column);
+}
 
-        _currentResult[param] = value;
-    }
+double Cursor::doubleValue(int column)
+{
+    if (!_isReadable(column))
+        return 0.0;
+    return sqlite3_column_double(_statement, column);
+}
+
+float Cursor::floatValue(int column)
+{
+    double dval = doubleValue(column);
+    return static_cast<float>(dval);
+}
+
+std::string Cursor::stringValue(int column)
+{
+    return std::string(textValue(column));
+}
+
+const char* Cursor::textValue(int column)
+{
+    if (!_isReadable(column))
+        return "";
+
+    auto value =
+        reinterpret_cast<const char*>(sqlite3_column_text(_statement, column));
+    // if value was pointing to NULL
+    if (!value)
+        return "";
+    return value;
+}
+
+const void* Cursor::blobValue(int column, int& size)
+{
+    size = 0;
+    if (!_isReadable(column))
+        return nullptr;
+
+    // the pointer has to be obtained before the size, see sqlite3_column_blob
+    const void* value = sqlite3_column_blob(_statement, column);
+    size = sqlite3_column_bytes(_statement, column);
+    return value;
+}
+
+bool Cursor::isNull(int column)
+{
+    if (!_isReadable(column))
+        return true;
+    return sqlite3_column_type(_statement, column) == SQLITE_NULL;
+}
+
+bool Cursor::_isReadable(int column)
+{
+    // no columns can be read unless the statement is on a row
+    return column >= 0 && column < sqlite3_data_count(_statement);
 }
@@ -40,8 +40,8 @@ public:
      * @details While this method, like `execute` also uses the "step" SQLite
      * function, its semantically meant to be used for iterating over rows
      * returned from a suitable SQL operation (most commonly SELECT statements).
-     * Moreover, the `_extracValues` method is called to extract values stored
-     * in current row of the result set.
+     * Values of the current row are read directly from the statement by the
+     * value methods, nothing is copied when stepping.
      * @return True if the `next` method can be further called upon this Cursor.
      */
     bool next();
@@ -54,6 +54,14 @@ public:
      */
     bool bind(const std::string& param, int value);
 
+    /**
+     * @brief Bind 64-bit integer value for statement with named parameter.
+     * @param param Name of the parameter to be bound.
+     * @param value Value as a 64-bit integer to be bound for the parameter.
+     * @return True if value was successfully bound.
+     */
+    bool bind(const std::string& param, long long value);
+
     /**
      * @brief Bind double precision value for statement with named parameter.
      * @param param Name of the parameter to be bound.
@@ -106,6 +114,83 @@ public:
      */
     std::string stringValue(const std::string& param);
 
+    /**
+     * @brief Obtain the index of a column in the result set.
+     * @details Column names are resolved once per statement. Loops over large
+     * result sets should look up the indices of their columns before
+     * iterating and read values by index, which skips the name lookup and
+     * reads values in their stored type without converting them to text.
+     * If several columns share a name, the first one is used.
+     * @param column Name of the column.
+     * @return Index of the column, or -1 if the result has no such column.
+     */
+    int columnIndex(const std::string& column);
+
+    /**
+     * @brief Obtain the value of a column of the current row as an int.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Value of the column, 0 if it is NULL or does not exist.
+     */
+    int integerValue(int column);
+
+    /**
+     * @brief Obtain the value of a column of the current row as a 64-bit
+     * integer.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Value of the column, 0 if it is NULL or does not exist.
+     */
+    long long int64Value(int column);
+
+    /**
+     * @brief Obtain the value of a column of the current row as a double.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Value of the column, 0 if it is NULL or does not exist.
+     */
+    double doubleValue(int column);
+
+    /**
+     * @brief Obtain the value of a column of the current row as a float.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Value of the column, 0 if it is NULL or does not exist.
+     */
+    float floatValue(int column);
+
+    /**
+     * @brief Obtain the value of a column of the current row as a string.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Value of the column, empty if it is NULL or does not exist.
+     */
+    std::string stringValue(int column);
+
+    /**
+     * @brief Obtain the text of a column of the current row without copying.
+     * @details The text is owned by the statement and is only valid until
+     * the cursor moves to another row.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return Null terminated text, empty if the value is NULL or the column
+     * does not exist.
+     */
+    const char* textValue(int column);
+
+    /**
+     * @brief Obtain the bytes of a blob column of the current row without
+     * copying.
+     * @details The bytes are owned by the statement and are only valid until
+     * the cursor moves to another row.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @param size Set to the number of bytes of the blob.
+     * @return Pointer to the bytes, nullptr if the blob is empty, NULL or the
+     * column does not exist.
+     */
+    const void* blobValue(int column, int& size);
+
+    /**
+     * @brief Check whether a column of the current row is NULL.
+     * @param column Index of the column, as given by `columnIndex`.
+     * @return True if the value is NULL or the column does not exist.
+     */
+    bool isNull(int column);
+
 private:
     /**
      * @brief A pointer to the sqlite3_stmt construct represented by the class.
@@ -113,10 +198,15 @@ private:
     sqlite3_stmt* _statement;
 
     /**
-     * @brief A map storing values for the current result, in case the query
-     * is of a row returning type (i.e., "SELECT" statements).
+     * @brief Indices of the result columns by their names, resolved on the
+     * first lookup.
+     */
+    std::map<std::string, int> _columnIndices;
+
+    /**
+     * @brief Whether `_columnIndices` has been filled for the statement.
      */
-    std::map<std::string, std::string> _currentResult;
+    bool _columnsResolved;
 
     /**
      * @brief Constructor that can only be accessed by friend classes.
@@ -138,13 +228,11 @@ private:
     ~Cursor();
 
     /**
-     * @brief Extract values from the current iteration of result set and store
-     * it in `_currentResult` as a mapping of parameter names to their values
-     * as strings. These values are converted to the corresponding type when
-     * any of the `integerValue`, `doubleValue`, `floatValue` or `stringValue`
-     * methods are called.
+     * @brief Check whether a column of the current row can be read.
+     * @param column Index of the column.
+     * @return True if the cursor is on a row and the result has the column.
      */
-    void _extractValues();
+    bool _isReadable(int column);
 };
 
 #endif // CURSOR_H
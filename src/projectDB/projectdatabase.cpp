@@ -1,5 +1,6 @@
 #include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/filesystem.hpp>
 #include "projectdatabase.h"
 #include "Compound.h"
@@ -18,6 +19,9 @@ ProjectDatabase::ProjectDatabase(const string& dbFilename,
                                  const string& version)
 {
     _connection = new Connection(dbFilename);
+    _defaultCacheSize = -2000;
+    _signatureStream.imbue(locale::classic());
+    _signatureStream.precision(9);
 
     // figure out whether this database needs upgrade
     using namespace ProjectVersioning;
@@ -64,6 +68,27 @@ ProjectDatabase::~ProjectDatabase()
     delete _connection;
 }
 
+void ProjectDatabase::beginBulkSave()
+{
+    auto cacheSizeQuery = _connection->prepare("PRAGMA cache_size");
+    while (cacheSizeQuery->next())
+        _defaultCacheSize = cacheSizeQuery->integerValue(0);
+
+    // a large page cache keeps the transaction from spilling changed pages
+    // to the journal before it commits, temporary b-trees stay in memory
+    _connection->prepare("PRAGMA cache_size = -131072")->execute();
+    _connection->prepare("PRAGMA temp_store = MEMORY")->execute();
+    _connection->begin();
+}
+
+void ProjectDatabase::endBulkSave()
+{
+    _connection->commit();
+    _connection->prepare("PRAGMA temp_store = DEFAULT")->execute();
+    _connection->prepare("PRAGMA cache_size = "
+                         + to_string(_defaultCacheSize))->execute();
+}
+
 void ProjectDatabase::saveSamples(const vector<mzSample*>& samples)
 {
     if (!_connection->prepare(CREATE_SAMPLES_TABLE)->execute()) {
@@ -129,10 +154,16 @@ void ProjectDatabase::saveSamples(const vector<mzSample*>& samples)
 void ProjectDatabase::saveGroups(const vector<PeakGroup*>& groups,
                                  const string& tableName)
 {
+    // the insert statements are prepared once and reused for every group
+    auto groupsQuery = _prepareGroupsInsert();
+    auto peaksQuery = _preparePeaksInsert();
+    if (!groupsQuery || !peaksQuery)
+        return;
+
     _connection->begin();
 
     for (const auto group : groups)
-        saveGroupAndPeaks(group, 0, tableName);
+        _saveGroupAndPeaks(group, 0, tableName, groupsQuery, peaksQuery);
 
     _connection->commit();
 }
@@ -148,12 +179,33 @@ int ProjectDatabase::saveGroupAndPeaks(PeakGroup* group,
     if (group->deletedFlag)
         return -1;
 
+    auto groupsQuery = _prepareGroupsInsert();
+    auto peaksQuery = _preparePeaksInsert();
+    if (!groupsQuery || !peaksQuery)
+        return -1;
+
+    return _saveGroupAndPeaks(group,
+                              parentGroupId,
+                              tableName,
+                              groupsQuery,
+                              peaksQuery);
+}
+
+void ProjectDatabase::saveGroupPeaks(PeakGroup* group, const int groupId)
+{
+    auto peaksQuery = _preparePeaksInsert();
+    if (peaksQuery)
+        _saveGroupPeaks(group, groupId, peaksQuery);
+}
+
+Cursor* ProjectDatabase::_prepareGroupsInsert()
+{
     if (!_connection->prepare(CREATE_PEAK_GROUPS_TABLE)->execute()) {
         cerr << "Error: failed to create peakgroups table" << endl;
-        return -1;
+        return nullptr;
     }
 
-    auto groupsQuery = _connection->prepare(
+    return _connection->prepare(
         "INSERT INTO peakgroups                            \
               VALUES ( :group_id                           \
                      , :parent_group_id                    \
@@ -184,6 +236,70 @@ int ProjectDatabase::saveGroupAndPeaks(PeakGroup* group,
                      , :fragmentation_tic_matched          \
                      , :fragmentation_num_matches          \
                      , :sample_ids                         )");
+}
+
+Cursor* ProjectDatabase::_preparePeaksInsert()
+{
+    if (!_connection->prepare(CREATE_PEAKS_TABLE)->execute()) {
+        cerr << "Error: failed to create peaks table" << endl;
+        return nullptr;
+    }
+
+    return _connection->prepare(
+        "INSERT INTO peaks                      \
+              VALUES ( :peak_id                 \
+                     , :group_id                \
+                     , :sample_id               \
+                     , :pos                     \
+                     , :minpos                  \
+                     , :maxpos                  \
+                     , :rt                      \
+                     , :rtmin                   \
+                     , :rtmax                   \
+                     , :mzmin                   \
+                     , :mzmax                   \
+                     , :scan                    \
+                     , :minscan                 \
+                     , :maxscan                 \
+                     , :peak_area               \
+                     , :peak_area_corrected     \
+                     , :peak_area_top           \
+                     , :peak_area_top_corrected \
+                     , :peak_area_fractional    \
+                     , :peak_rank               \
+                     , :peak_intensity          \
+                     , :peak_baseline_level     \
+                     , :peak_mz                 \
+                     , :median_mz               \
+                     , :base_mz                 \
+                     , :quality                 \
+                     , :width                   \
+                     , :gauss_fit_sigma         \
+                     , :gauss_fit_r2            \
+                     , :no_noise_obs            \
+                     , :no_noise_fraction       \
+                     , :symmetry                \
+                     , :signal_baseline_ratio   \
+                     , :group_overlap           \
+                     , :group_overlap_frac      \
+                     , :local_max_flag          \
+                     , :from_blank_sample       \
+                     , :label                   \
+                     , :peak_spline_area        )");
+}
+
+int ProjectDatabase::_saveGroupAndPeaks(PeakGroup* group,
+                                        const int parentGroupId,
+                                        const string& tableName,
+                                        Cursor* groupsQuery,
+                                        Cursor* peaksQuery)
+{
+    if (!group)
+        return -1;
+
+    // skip deleted groups
+    if (group->deletedFlag)
+        return -1;
 
     groupsQuery->bind(":parent_group_id", parentGroupId);
     groupsQuery->bind(":meta_group_id", group->metaGroupId);
@@ -247,64 +363,24 @@ int ProjectDatabase::saveGroupAndPeaks(PeakGroup* group,
         cerr << "Error: failed to save peak group" << endl;
 
     int lastInsertedGroupId = _connection->lastInsertId();
-    saveGroupPeaks(group, lastInsertedGroupId);
-
-    for (auto child: group->children)
-        saveGroupAndPeaks(&child, lastInsertedGroupId, tableName);
+    _saveGroupPeaks(group, lastInsertedGroupId, peaksQuery);
+
+    for (auto& child: group->children) {
+        _saveGroupAndPeaks(&child,
+                           lastInsertedGroupId,
+                           tableName,
+                           groupsQuery,
+                           peaksQuery);
+    }
 
     return lastInsertedGroupId;
 }
 
-void ProjectDatabase::saveGroupPeaks(PeakGroup* group, const int groupId)
+void ProjectDatabase::_saveGroupPeaks(PeakGroup* group,
+                                      const int groupId,
+                                      Cursor* peaksQuery)
 {
-    if (!_connection->prepare(CREATE_PEAKS_TABLE)->execute()) {
-        cerr << "Error: failed to create peaks table" << endl;
-        return;
-    }
-
-    auto peaksQuery = _connection->prepare(
-        "INSERT INTO peaks                      \
-              VALUES ( :peak_id                 \
-                     , :group_id                \
-                     , :sample_id               \
-                     , :pos                     \
-                     , :minpos                  \
-                     , :maxpos                  \
-                     , :rt                      \
-                     , :rtmin                   \
-                     , :rtmax                   \
-                     , :mzmin                   \
-                     , :mzmax                   \
-                     , :scan                    \
-                     , :minscan                 \
-                     , :maxscan                 \
-                     , :peak_area               \
-                     , :peak_area_corrected     \
-                     , :peak_area_top           \
-                     , :peak_area_top_corrected \
-                     , :peak_area_fractional    \
-                     , :peak_rank               \
-                     , :peak_intensity          \
-                     , :peak_baseline_level     \
-                     , :peak_mz                 \
-                     , :median_mz               \
-                     , :base_mz                 \
-                     , :quality                 \
-                     , :width                   \
-                     , :gauss_fit_sigma         \
-                     , :gauss_fit_r2            \
-                     , :no_noise_obs            \
-                     , :no_noise_fraction       \
-                     , :symmetry                \
-                     , :signal_baseline_ratio   \
-                     , :group_overlap           \
-                     , :group_overlap_frac      \
-                     , :local_max_flag          \
-                     , :from_blank_sample       \
-                     , :label                   \
-                     , :peak_spline_area        )");
-
-    for (Peak p : group->peaks) {
+    for (Peak& p : group->peaks) {
         peaksQuery->bind(":group_id", groupId);
         peaksQuery->bind(":sample_id", p.getSample()->getSampleId());
         peaksQuery->bind(":pos", static_cast<int>(p.pos));
@@ -513,7 +589,19 @@ void ProjectDatabase::saveScans(const vector<mzSample*>& sampleSet)
     }
 
     auto scansQuery = _connection->prepare(
-        "INSERT INTO scans               \
+        "INSERT INTO scans ( sample_id        \
+                           , scan             \
+                           , file_seek_start  \
+                           , file_seek_end    \
+                           , mslevel          \
+                           , rt               \
+                           , precursor_mz     \
+                           , precursor_charge \
+                           , precursor_ic     \
+                           , precursor_purity \
+                           , minmz            \
+                           , maxmz            \
+                           , data             )\
               VALUES ( :sample_id        \
                      , :scan             \
                      , :file_seek_start  \
@@ -536,12 +624,13 @@ void ProjectDatabase::saveScans(const vector<mzSample*>& sampleSet)
             if (scan->mslevel == 1)
                 continue;
 
+            ScanPeaksPin pin(scan);
             string scanData = _getScanSignature(scan, 2000);
 
             scansQuery->bind(":sample_id", s->getSampleId());
             scansQuery->bind(":scan", scan->scannum);
-            scansQuery->bind(":file_seek_start", -1);
-            scansQuery->bind(":file_seek_end", -1);
+            scansQuery->bind(":file_seek_start", scan->fileSeekStart);
+            scansQuery->bind(":file_seek_end", scan->fileSeekEnd);
             scansQuery->bind(":mslevel", scan->mslevel);
             scansQuery->bind(":rt", scan->rt);
             scansQuery->bind(":precursor_mz", scan->precursorMz);
@@ -870,55 +959,97 @@ void ProjectDatabase::updateSamples(const vector<mzSample*> freshlyLoaded)
 vector<PeakGroup*> ProjectDatabase::loadGroups(const vector<mzSample*>& loaded)
 {
     _connection->prepare(CREATE_PEAKS_GROUP_INDEX)->execute();
-    auto groupsQuery = _connection->prepare("SELECT *         \
-                                               FROM peakgroups");
-
-    vector<PeakGroup*> groups;
-    map<PeakGroup*, int> childParentMap;
+    auto groupsQuery = _connection->prepare("SELECT *              \
+                                               FROM peakgroups      \
+                                           ORDER BY group_id        ");
+
+    // columns are looked up once, values are then read by index
+    int groupIdColumn = groupsQuery->columnIndex("group_id");
+    int parentGroupIdColumn = groupsQuery->columnIndex("parent_group_id");
+    int tagStringColumn = groupsQuery->columnIndex("tag_string");
+    int metaGroupIdColumn = groupsQuery->columnIndex("meta_group_id");
+    int expectedMzColumn = groupsQuery->columnIndex("expected_mz");
+    int expectedRtDiffColumn = groupsQuery->columnIndex("expected_rt_diff");
+    int expectedAbundanceColumn =
+        groupsQuery->columnIndex("expected_abundance");
+    int groupRankColumn = groupsQuery->columnIndex("group_rank");
+    int labelColumn = groupsQuery->columnIndex("label");
+    int ms2EventCountColumn = groupsQuery->columnIndex("ms2_event_count");
+    int ms2ScoreColumn = groupsQuery->columnIndex("ms2_score");
+    int fractionMatchedColumn =
+        groupsQuery->columnIndex("fragmentation_fraction_matched");
+    int mzFragErrorColumn =
+        groupsQuery->columnIndex("fragmentation_mz_frag_error");
+    int hypergeomScoreColumn =
+        groupsQuery->columnIndex("fragmentation_hypergeom_score");
+    int mvhScoreColumn = groupsQuery->columnIndex("fragmentation_mvh_score");
+    int dotProductColumn =
+        groupsQuery->columnIndex("fragmentation_dot_product");
+    int weightedDotProductColumn =
+        groupsQuery->columnIndex("fragmentation_weighted_dot_product");
+    int spearmanRankCorrelationColumn =
+        groupsQuery->columnIndex("fragmentation_spearman_rank_corr");
+    int ticMatchedColumn =
+        groupsQuery->columnIndex("fragmentation_tic_matched");
+    int numMatchesColumn =
+        groupsQuery->columnIndex("fragmentation_num_matches");
+    int typeColumn = groupsQuery->columnIndex("type");
+    int tableNameColumn = groupsQuery->columnIndex("table_name");
+    int minQualityColumn = groupsQuery->columnIndex("min_quality");
+    int compoundIdColumn = groupsQuery->columnIndex("compound_id");
+    int compoundDBColumn = groupsQuery->columnIndex("compound_db");
+    int compoundNameColumn = groupsQuery->columnIndex("compound_name");
+    int adductNameColumn = groupsQuery->columnIndex("adduct_name");
+    int srmIdColumn = groupsQuery->columnIndex("srm_id");
+    int sampleIdsColumn = groupsQuery->columnIndex("sample_ids");
+
+    vector<PeakGroup*> loadedGroups;
+    vector<int> parentGroupIds;
     while (groupsQuery->next()) {
         PeakGroup* group = new PeakGroup();
-        group->groupId = groupsQuery->integerValue("group_id");
-        int parentGroupId = groupsQuery->integerValue("parent_group_id");
-        group->tagString = groupsQuery->stringValue("tag_string");
-        group->metaGroupId = groupsQuery->integerValue("meta_group_id");
-        group->expectedMz = groupsQuery->floatValue("expected_mz");
-        group->expectedRtDiff = groupsQuery->floatValue("expected_rt_diff");
+        group->groupId = groupsQuery->integerValue(groupIdColumn);
+        int parentGroupId = groupsQuery->integerValue(parentGroupIdColumn);
+        group->tagString = groupsQuery->textValue(tagStringColumn);
+        group->metaGroupId = groupsQuery->integerValue(metaGroupIdColumn);
+        group->expectedMz = groupsQuery->floatValue(expectedMzColumn);
+        group->expectedRtDiff = groupsQuery->floatValue(expectedRtDiffColumn);
         group->expectedAbundance =
-            groupsQuery->floatValue("expected_abundance");
-        group->groupRank = groupsQuery->floatValue("group_rank");
-        group->label = groupsQuery->stringValue("label")[0];
-        group->ms2EventCount = groupsQuery->integerValue("ms2_event_count");
+            groupsQuery->floatValue(expectedAbundanceColumn);
+        group->groupRank = groupsQuery->floatValue(groupRankColumn);
+        group->label = groupsQuery->textValue(labelColumn)[0];
+        group->ms2EventCount = groupsQuery->integerValue(ms2EventCountColumn);
         group->fragMatchScore.mergedScore =
-            groupsQuery->doubleValue("ms2_score");
+            groupsQuery->doubleValue(ms2ScoreColumn);
         group->fragMatchScore.fractionMatched =
-            groupsQuery->doubleValue("fragmentation_fraction_matched");
+            groupsQuery->doubleValue(fractionMatchedColumn);
         group->fragMatchScore.mzFragError =
-            groupsQuery->doubleValue("fragmentation_mz_frag_error");
+            groupsQuery->doubleValue(mzFragErrorColumn);
         group->fragMatchScore.hypergeomScore =
-            groupsQuery->doubleValue("fragmentation_hypergeom_score");
+            groupsQuery->doubleValue(hypergeomScoreColumn);
         group->fragMatchScore.mvhScore =
-            groupsQuery->doubleValue("fragmentation_mvh_score");
+            groupsQuery->doubleValue(mvhScoreColumn);
         group->fragMatchScore.dotProduct =
-            groupsQuery->doubleValue("fragmentation_dot_product");
+            groupsQuery->doubleValue(dotProductColumn);
         group->fragMatchScore.weightedDotProduct =
-            groupsQuery->doubleValue("fragmentation_weighted_dot_product");
+            groupsQuery->doubleValue(weightedDotProductColumn);
         group->fragMatchScore.spearmanRankCorrelation =
-            groupsQuery->doubleValue("fragmentation_spearman_rank_corr");
+            groupsQuery->doubleValue(spearmanRankCorrelationColumn);
         group->fragMatchScore.ticMatched =
-            groupsQuery->doubleValue("fragmentation_tic_matched");
+            groupsQuery->doubleValue(ticMatchedColumn);
         group->fragMatchScore.numMatches =
-            groupsQuery->doubleValue("fragmentation_num_matches");
+            groupsQuery->doubleValue(numMatchesColumn);
 
-        group->setType(PeakGroup::GroupType(groupsQuery->integerValue("type")));
-        group->searchTableName = groupsQuery->stringValue("table_name");
-        group->minQuality = groupsQuery->doubleValue("min_quality");
+        int type = groupsQuery->integerValue(typeColumn);
+        group->setType(PeakGroup::GroupType(type));
+        group->searchTableName = groupsQuery->textValue(tableNameColumn);
+        group->minQuality = groupsQuery->doubleValue(minQualityColumn);
 
-        string compoundId = groupsQuery->stringValue("compound_id");
-        string compoundDB = groupsQuery->stringValue("compound_db");
-        string compoundName = groupsQuery->stringValue("compound_name");
-        string adductName = groupsQuery->stringValue("adduct_name");
+        string compoundId = groupsQuery->textValue(compoundIdColumn);
+        string compoundDB = groupsQuery->textValue(compoundDBColumn);
+        string compoundName = groupsQuery->textValue(compoundNameColumn);
+        string adductName = groupsQuery->textValue(adductNameColumn);
 
-        string srmId = groupsQuery->stringValue("srm_id");
+        string srmId = groupsQuery->textValue(srmIdColumn);
         if (!srmId.empty())
             group->setSrmId(srmId);
 
@@ -946,7 +1077,9 @@ vector<PeakGroup*> ProjectDatabase::loadGroups(const vector<mzSample*>& loaded)
         }
 
         vector<string> sample_ids;
-        mzUtils::split(groupsQuery->stringValue("sample_ids"), ';', sample_ids);
+        mzUtils::split(groupsQuery->stringValue(sampleIdsColumn),
+                       ';',
+                       sample_ids);
         for (auto idString : sample_ids) {
             if (idString.empty())
                 continue;
@@ -962,30 +1095,47 @@ vector<PeakGroup*> ProjectDatabase::loadGroups(const vector<mzSample*>& loaded)
             }
         }
 
-        loadGroupPeaks(group, loaded);
-        group->groupStatistics();
+        loadedGroups.push_back(group);
+        parentGroupIds.push_back(parentGroupId);
+    }
+
+    // peaks of all groups are read in a single pass, ordered by their group
+    auto peaksQuery = _connection->prepare(
+                "SELECT peaks.*                             \
+                      , samples.name AS sample_name         \
+                   FROM peaks                               \
+                      , samples                             \
+                  WHERE peaks.sample_id = samples.sample_id \
+               ORDER BY peaks.group_id                      \
+                      , peaks.peak_id                       ");
+    _loadPeaks(peaksQuery, loadedGroups, loaded);
 
-        if (parentGroupId == 0) {
+    vector<PeakGroup*> groups;
+    unordered_map<int, PeakGroup*> parentGroups;
+    for (size_t i = 0; i < loadedGroups.size(); ++i) {
+        PeakGroup* group = loadedGroups[i];
+        group->groupStatistics();
+        if (parentGroupIds[i] == 0) {
             groups.push_back(group);
-        } else {
-            childParentMap[group] = parentGroupId;
+            parentGroups[group->groupId] = group;
         }
     }
 
     // assign parents for child groups
-    for (auto pair : childParentMap) {
-        bool foundParent = false;
-        auto child = pair.first;
-        for (auto parent : groups) {
-            if (parent->groupId == pair.second) {
-                parent->addChild(*child);
-                foundParent = true;
-                break;
-            }
-        }
-        // failed to find a parent group, become a parent
-        if (!foundParent)
+    for (size_t i = 0; i < loadedGroups.size(); ++i) {
+        if (parentGroupIds[i] == 0)
+            continue;
+
+        PeakGroup* child = loadedGroups[i];
+        auto parent = parentGroups.find(parentGroupIds[i]);
+        if (parent != end(parentGroups)) {
+            parent->second->addChild(*child);
+            delete child;
+        } else {
+            // failed to find a parent group, become a parent
             groups.push_back(child);
+            parentGroups[child->groupId] = child;
+        }
     }
 
 
@@ -1002,67 +1152,137 @@ void ProjectDatabase::loadGroupPeaks(PeakGroup* parentGroup,
                    FROM peaks                               \
                       , samples                             \
                   WHERE peaks.sample_id = samples.sample_id \
-                    AND peaks.group_id = :parent_group_id   ");
+                    AND peaks.group_id = :parent_group_id   \
+               ORDER BY peaks.peak_id                       ");
     peaksQuery->bind(":parent_group_id", parentGroup->groupId);
+    _loadPeaks(peaksQuery, {parentGroup}, loaded);
+}
 
+void ProjectDatabase::_loadPeaks(Cursor* peaksQuery,
+                                 const vector<PeakGroup*>& groups,
+                                 const vector<mzSample*>& loaded)
+{
+    // columns are looked up once, values are then read by index
+    int posColumn = peaksQuery->columnIndex("pos");
+    int minposColumn = peaksQuery->columnIndex("minpos");
+    int maxposColumn = peaksQuery->columnIndex("maxpos");
+    int rtColumn = peaksQuery->columnIndex("rt");
+    int rtminColumn = peaksQuery->columnIndex("rtmin");
+    int rtmaxColumn = peaksQuery->columnIndex("rtmax");
+    int mzminColumn = peaksQuery->columnIndex("mzmin");
+    int mzmaxColumn = peaksQuery->columnIndex("mzmax");
+    int scanColumn = peaksQuery->columnIndex("scan");
+    int minscanColumn = peaksQuery->columnIndex("minscan");
+    int maxscanColumn = peaksQuery->columnIndex("maxscan");
+    int peakAreaColumn = peaksQuery->columnIndex("peak_area");
+    int peakSplineAreaColumn = peaksQuery->columnIndex("peak_spline_area");
+    int peakAreaCorrectedColumn =
+        peaksQuery->columnIndex("peak_area_corrected");
+    int peakAreaTopColumn = peaksQuery->columnIndex("peak_area_top");
+    int peakAreaTopCorrectedColumn =
+        peaksQuery->columnIndex("peak_area_top_corrected");
+    int peakAreaFractionalColumn =
+        peaksQuery->columnIndex("peak_area_fractional");
+    int peakRankColumn = peaksQuery->columnIndex("peak_rank");
+    int peakIntensityColumn = peaksQuery->columnIndex("peak_intensity");
+    int peakBaseLineLevelColumn =
+        peaksQuery->columnIndex("peak_baseline_level");
+    int peakMzColumn = peaksQuery->columnIndex("peak_mz");
+    int medianMzColumn = peaksQuery->columnIndex("median_mz");
+    int baseMzColumn = peaksQuery->columnIndex("base_mz");
+    int qualityColumn = peaksQuery->columnIndex("quality");
+    int widthColumn = peaksQuery->columnIndex("width");
+    int gaussFitSigmaColumn = peaksQuery->columnIndex("gauss_fit_sigma");
+    int gaussFitR2Column = peaksQuery->columnIndex("gauss_fit_r2");
+    int groupNumColumn = peaksQuery->columnIndex("group_id");
+    int noNoiseObsColumn = peaksQuery->columnIndex("no_noise_obs");
+    int noNoiseFractionColumn = peaksQuery->columnIndex("no_noise_fraction");
+    int symmetryColumn = peaksQuery->columnIndex("symmetry");
+    int signalBaselineRatioColumn =
+        peaksQuery->columnIndex("signal_baseline_ratio");
+    int groupOverlapColumn = peaksQuery->columnIndex("group_overlap");
+    int groupOverlapFracColumn = peaksQuery->columnIndex("group_overlap_frac");
+    int localMaxFlagColumn = peaksQuery->columnIndex("local_max_flag");
+    int fromBlankSampleColumn = peaksQuery->columnIndex("from_blank_sample");
+    int labelColumn = peaksQuery->columnIndex("label");
+    int sampleNameColumn = peaksQuery->columnIndex("sample_name");
+
+    // if several loaded samples share a name, the first one is used
+    unordered_map<string, mzSample*> samplesByName;
+    for (auto sample : loaded)
+        samplesByName.insert(make_pair(sample->sampleName, sample));
+
+    // groups and peaks are both ordered by group ID, peaks are attached to
+    // their groups while stepping through the two in a merge
+    auto group = begin(groups);
     while (peaksQuery->next()) {
+        int groupId = peaksQuery->integerValue(groupNumColumn);
+        while (group != end(groups) && (*group)->groupId < groupId)
+            ++group;
+        if (group == end(groups))
+            break;
+        if ((*group)->groupId != groupId)
+            continue;
+
         Peak peak;
-        peak.pos = static_cast<unsigned int>(peaksQuery->integerValue("pos"));
+        peak.pos =
+            static_cast<unsigned int>(peaksQuery->integerValue(posColumn));
         peak.minpos =
-            static_cast<unsigned int>(peaksQuery->integerValue("minpos"));
+            static_cast<unsigned int>(peaksQuery->integerValue(minposColumn));
         peak.maxpos =
-            static_cast<unsigned int>(peaksQuery->integerValue("maxpos"));
-        peak.rt = peaksQuery->floatValue("rt");
-        peak.rtmin = peaksQuery->floatValue("rtmin");
-        peak.rtmax = peaksQuery->floatValue("rtmax");
-        peak.mzmin = peaksQuery->floatValue("mzmin");
-        peak.mzmax = peaksQuery->floatValue("mzmax");
-        peak.scan = static_cast<unsigned int>(peaksQuery->integerValue("scan"));
+            static_cast<unsigned int>(peaksQuery->integerValue(maxposColumn));
+        peak.rt = peaksQuery->floatValue(rtColumn);
+        peak.rtmin = peaksQuery->floatValue(rtminColumn);
+        peak.rtmax = peaksQuery->floatValue(rtmaxColumn);
+        peak.mzmin = peaksQuery->floatValue(mzminColumn);
+        peak.mzmax = peaksQuery->floatValue(mzmaxColumn);
+        peak.scan =
+            static_cast<unsigned int>(peaksQuery->integerValue(scanColumn));
         peak.minscan =
-            static_cast<unsigned int>(peaksQuery->integerValue("minscan"));
+            static_cast<unsigned int>(peaksQuery->integerValue(minscanColumn));
         peak.maxscan =
-            static_cast<unsigned int>(peaksQuery->integerValue("maxscan"));
-        peak.peakArea = peaksQuery->floatValue("peak_area");
-        peak.peakSplineArea = peaksQuery->floatValue("peak_spline_area");
-        peak.peakAreaCorrected = peaksQuery->floatValue("peak_area_corrected");
-        peak.peakAreaTop = peaksQuery->floatValue("peak_area_top");
+            static_cast<unsigned int>(peaksQuery->integerValue(maxscanColumn));
+        peak.peakArea = peaksQuery->floatValue(peakAreaColumn);
+        peak.peakSplineArea = peaksQuery->floatValue(peakSplineAreaColumn);
+        peak.peakAreaCorrected =
+            peaksQuery->floatValue(peakAreaCorrectedColumn);
+        peak.peakAreaTop = peaksQuery->floatValue(peakAreaTopColumn);
         peak.peakAreaTopCorrected =
-            peaksQuery->floatValue("peak_area_top_corrected");
+            peaksQuery->floatValue(peakAreaTopCorrectedColumn);
         peak.peakAreaFractional =
-            peaksQuery->floatValue("peak_area_fractional");
-        peak.peakRank = peaksQuery->floatValue("peak_rank");
-        peak.peakIntensity = peaksQuery->floatValue("peak_intensity");
-        peak.peakBaseLineLevel = peaksQuery->floatValue("peak_baseline_level");
-        peak.peakMz = peaksQuery->floatValue("peak_mz");
-        peak.medianMz = peaksQuery->floatValue("median_mz");
-        peak.baseMz = peaksQuery->floatValue("base_mz");
-        peak.quality = peaksQuery->floatValue("quality");
+            peaksQuery->floatValue(peakAreaFractionalColumn);
+        peak.peakRank = peaksQuery->floatValue(peakRankColumn);
+        peak.peakIntensity = peaksQuery->floatValue(peakIntensityColumn);
+        peak.peakBaseLineLevel =
+            peaksQuery->floatValue(peakBaseLineLevelColumn);
+        peak.peakMz = peaksQuery->floatValue(peakMzColumn);
+        peak.medianMz = peaksQuery->floatValue(medianMzColumn);
+        peak.baseMz = peaksQuery->floatValue(baseMzColumn);
+        peak.quality = peaksQuery->floatValue(qualityColumn);
         peak.width =
-            static_cast<unsigned int>(peaksQuery->integerValue("width"));
-        peak.gaussFitSigma = peaksQuery->floatValue("gauss_fit_sigma");
-        peak.gaussFitR2 = peaksQuery->floatValue("gauss_fit_r2");
-        peak.groupNum = peaksQuery->integerValue("group_id");
+            static_cast<unsigned int>(peaksQuery->integerValue(widthColumn));
+        peak.gaussFitSigma = peaksQuery->floatValue(gaussFitSigmaColumn);
+        peak.gaussFitR2 = peaksQuery->floatValue(gaussFitR2Column);
+        peak.groupNum = groupId;
         peak.noNoiseObs =
-            static_cast<unsigned int>(peaksQuery->integerValue("no_noise_obs"));
-        peak.noNoiseFraction = peaksQuery->floatValue("no_noise_fraction");
-        peak.symmetry = peaksQuery->floatValue("symmetry");
+            static_cast<unsigned int>(
+                peaksQuery->integerValue(noNoiseObsColumn));
+        peak.noNoiseFraction = peaksQuery->floatValue(noNoiseFractionColumn);
+        peak.symmetry = peaksQuery->floatValue(symmetryColumn);
         peak.signalBaselineRatio =
-            peaksQuery->floatValue("signal_baseline_ratio");
-        peak.groupOverlap = peaksQuery->floatValue("group_overlap");
-        peak.groupOverlapFrac = peaksQuery->floatValue("group_overlap_frac");
-        peak.localMaxFlag = peaksQuery->integerValue("local_max_flag");
-        peak.fromBlankSample = peaksQuery->integerValue("from_blank_sample");
-        peak.label = peaksQuery->stringValue("label")[0];
-
-        string sampleName = peaksQuery->stringValue("sample_name");
-
-        for (auto sample : loaded) {
-            if (sample->sampleName == sampleName) {
-                peak.setSample(sample);
-                break;
-            }
-        }
-        parentGroup->addPeak(peak);
+            peaksQuery->floatValue(signalBaselineRatioColumn);
+        peak.groupOverlap = peaksQuery->floatValue(groupOverlapColumn);
+        peak.groupOverlapFrac = peaksQuery->floatValue(groupOverlapFracColumn);
+        peak.localMaxFlag = peaksQuery->integerValue(localMaxFlagColumn);
+        peak.fromBlankSample = peaksQuery->integerValue(fromBlankSampleColumn);
+        peak.label = peaksQuery->textValue(labelColumn)[0];
+
+        auto sample = samplesByName.find(
+            peaksQuery->textValue(sampleNameColumn));
+        if (sample != end(samplesByName))
+            peak.setSample(sample->second);
+
+        (*group)->addPeak(peak);
     }
 }
 
@@ -1082,16 +1302,38 @@ vector<Compound*> ProjectDatabase::loadCompounds(const string databaseName)
     auto compoundsQuery = _connection->prepare(selectStatement);
     compoundsQuery->bind(":database_name", databaseName);
 
+    // columns are looked up once, values are then read by index
+    int idColumn = compoundsQuery->columnIndex("compound_id");
+    int nameColumn = compoundsQuery->columnIndex("name");
+    int formulaColumn = compoundsQuery->columnIndex("formula");
+    int chargeColumn = compoundsQuery->columnIndex("charge");
+    int massColumn = compoundsQuery->columnIndex("mass");
+    int dbColumn = compoundsQuery->columnIndex("db_name");
+    int expectedRtColumn = compoundsQuery->columnIndex("expected_rt");
+    int precursorMzColumn = compoundsQuery->columnIndex("precursor_mz");
+    int productMzColumn = compoundsQuery->columnIndex("product_mz");
+    int collisionEnergyColumn = compoundsQuery->columnIndex("collision_energy");
+    int smileStringColumn = compoundsQuery->columnIndex("smile_string");
+    int logPColumn = compoundsQuery->columnIndex("log_p");
+    int ionizationModeColumn = compoundsQuery->columnIndex("ionization_mode");
+    int noteColumn = compoundsQuery->columnIndex("note");
+    int categoryColumn = compoundsQuery->columnIndex("category");
+    int fragmentMzsColumn = compoundsQuery->columnIndex("fragment_mzs");
+    int fragmentIntensityColumn =
+        compoundsQuery->columnIndex("fragment_intensity");
+    int fragmentIonTypesColumn =
+        compoundsQuery->columnIndex("fragment_ion_types");
+
     MassCalculator mcalc;
     int loadCount = 0;
     while (compoundsQuery->next()) {
-        string id = compoundsQuery->stringValue("compound_id");
-        string name = compoundsQuery->stringValue("name");
-        string formula = compoundsQuery->stringValue("formula");
-        int charge = compoundsQuery->integerValue("charge");
-        float mass = compoundsQuery->floatValue("mass");
-        string db = compoundsQuery->stringValue("db_name");
-        float expectedRt = compoundsQuery->floatValue("expected_rt");
+        string id = compoundsQuery->stringValue(idColumn);
+        string name = compoundsQuery->stringValue(nameColumn);
+        string formula = compoundsQuery->stringValue(formulaColumn);
+        int charge = compoundsQuery->integerValue(chargeColumn);
+        float mass = compoundsQuery->floatValue(massColumn);
+        string db = compoundsQuery->stringValue(dbColumn);
+        float expectedRt = compoundsQuery->floatValue(expectedRtColumn);
 
         // skip if compound already exists in internal database
         if (_compoundIdMap.find(id + name + db) != end(_compoundIdMap))
@@ -1110,14 +1352,15 @@ vector<Compound*> ProjectDatabase::loadCompounds(const string databaseName)
                     static_cast<float>(mcalc.computeNeutralMass(formula));
         }
 
-        compound->precursorMz = compoundsQuery->floatValue("precursor_mz");
-        compound->productMz = compoundsQuery->floatValue("product_mz");
+        compound->precursorMz = compoundsQuery->floatValue(precursorMzColumn);
+        compound->productMz = compoundsQuery->floatValue(productMzColumn);
         compound->collisionEnergy =
-                compoundsQuery->floatValue("collision_energy");
-        compound->smileString = compoundsQuery->stringValue("smile_string");
-        compound->logP = compoundsQuery->floatValue("log_p");
-        compound->ionizationMode = compoundsQuery->floatValue("ionization_mode");
-        compound->note = compoundsQuery->stringValue("note");
+                compoundsQuery->floatValue(collisionEnergyColumn);
+        compound->smileString = compoundsQuery->stringValue(smileStringColumn);
+        compound->logP = compoundsQuery->floatValue(logPColumn);
+        compound->ionizationMode =
+                compoundsQuery->floatValue(ionizationModeColumn);
+        compound->note = compoundsQuery->stringValue(noteColumn);
 
         // mark compound as decoy if names contains DECOY string
         if (compound->name.find("DECOY") != string::npos)
@@ -1133,27 +1376,28 @@ vector<Compound*> ProjectDatabase::loadCompounds(const string databaseName)
             return separated;
         };
 
-        string categories = compoundsQuery->stringValue("category");
+        string categories = compoundsQuery->stringValue(categoryColumn);
         for (auto category : split(categories, ';')) {
             if (!category.empty())
                 compound->category.push_back(category);
         }
 
-        string fragmentMzValues = compoundsQuery->stringValue("fragment_mzs");
+        string fragmentMzValues =
+                compoundsQuery->stringValue(fragmentMzsColumn);
         for (string fragMz : split(fragmentMzValues, ';')) {
             if (!fragMz.empty())
                 compound->fragmentMzValues.push_back(stof(fragMz));
         }
 
         string fragmentIntensities =
-                compoundsQuery->stringValue("fragment_intensity");
+                compoundsQuery->stringValue(fragmentIntensityColumn);
         for (string fragIntensity : split(fragmentIntensities, ';')) {
             if (!fragIntensity.empty())
                 compound->fragmentIntensities.push_back(stof(fragIntensity));
         }
 
         vector<string> fragmentIonTypes =
-            split(compoundsQuery->stringValue("fragment_ion_types"), ';');
+            split(compoundsQuery->stringValue(fragmentIonTypesColumn), ';');
         for (size_t i = 0; i < fragmentIonTypes.size(); ++i) {
             string fragIonType = fragmentIonTypes[i];
             if (!fragIonType.empty())
@@ -1161,13 +1405,16 @@ vector<Compound*> ProjectDatabase::loadCompounds(const string databaseName)
         }
 
         _compoundIdMap[compound->id  + compound->name + compound->db] = compound;
+        _indexCompoundByName(compound);
         compounds.push_back(compound);
         loadCount++;
     }
 
     sort(compounds.begin(), compounds.end(), Compound::compMass);
     cerr << "Loaded: " << loadCount << " compounds" << endl;
-    if (loadCount > 0 and !databaseName.empty())
+    // compounds already known are skipped above, the database is complete
+    // either way and need not be queried again
+    if (!databaseName.empty())
         _loadedCompoundDatabases.push_back(databaseName);
 
     return compounds;
@@ -1332,28 +1579,33 @@ map<string, variant> ProjectDatabase::loadSettings()
 
 void ProjectDatabase::deleteAll()
 {
+    _connection->begin();
     deleteAllSamples();
     deleteAllCompounds();
     deleteAllGroupsAndPeaks();
     deleteAllScans();
     deleteAllAlignmentData();
     deleteSettings();
+    _connection->commit();
 }
 
 void ProjectDatabase::deleteAllSamples()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE samples")->execute();
     _connection->commit();
 }
 
 void ProjectDatabase::deleteAllCompounds()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE compounds")->execute();
     _connection->commit();
 }
 
 void ProjectDatabase::deleteAllGroupsAndPeaks()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE peaks")->execute();
     _connection->prepare("DROP TABLE peakgroups")->execute();
     _connection->commit();
@@ -1361,24 +1613,29 @@ void ProjectDatabase::deleteAllGroupsAndPeaks()
 
 void ProjectDatabase::deleteAllScans()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE scans")->execute();
     _connection->commit();
 }
 
 void ProjectDatabase::deleteAllAlignmentData()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE alignment_rts")->execute();
     _connection->commit();
 }
 
 void ProjectDatabase::deleteSettings()
 {
+    _connection->begin();
     _connection->prepare("DROP TABLE user_settings")->execute();
     _connection->commit();
 }
 
 void ProjectDatabase::deleteCompoundsForDB(const string& dbName)
 {
+    _connection->begin();
+
     // create index based on database name.
     _connection->prepare(CREATE_COMPOUNDS_DB_INDEX)->execute();
 
@@ -1394,6 +1651,8 @@ void ProjectDatabase::deleteCompoundsForDB(const string& dbName)
 
 void ProjectDatabase::deleteTableGroups(const string& tableName)
 {
+    _connection->begin();
+
     auto failure = false;
     auto peaksQuery = _connection->prepare(
         "DELETE FROM peaks                                        \
@@ -1439,6 +1698,8 @@ void ProjectDatabase::deletePeakGroup(PeakGroup* group)
     if (selectedGroups.size() == 0)
         return;
 
+    _connection->begin();
+
     auto peakgroupsQuery = _connection->prepare(
                 "DELETE FROM peakgroups          \
                        WHERE group_id = :group_id");
@@ -1567,8 +1828,9 @@ Compound* ProjectDatabase::_findSpeciesByIdAndName(string id,
     if (!databaseName.empty() && !_compoundDatabaseLoaded(databaseName))
         loadCompounds(databaseName);
 
-    if (_compoundIdMap.count(id + name + databaseName))
-        return _compoundIdMap[id + name + databaseName];
+    auto compound = _compoundIdMap.find(id + name + databaseName);
+    if (compound != end(_compoundIdMap))
+        return compound->second;
 
     return nullptr;
 }
@@ -1580,14 +1842,33 @@ vector<Compound*> ProjectDatabase::_findSpeciesByName(string name,
         loadCompounds(databaseName);
 
     vector<Compound*> similarlyNamedCompounds;
-    for (const auto& key : _compoundIdMap) {
-        Compound* compound = key.second;
+    auto named = _compoundNameMap.find(name + databaseName);
+    if (named == end(_compoundNameMap))
+        return similarlyNamedCompounds;
+
+    for (auto compound : named->second) {
         if (compound->name == name && compound->db == databaseName)
             similarlyNamedCompounds.push_back(compound);
     }
     return similarlyNamedCompounds;
 }
 
+void ProjectDatabase::_indexCompoundByName(Compound* compound)
+{
+    // compounds sharing a name are kept in the order of their unique keys,
+    // the order in which a scan over all compounds used to find them
+    auto uniqueKey = [](Compound* c) { return c->id + c->name + c->db; };
+    string key = uniqueKey(compound);
+    auto& named = _compoundNameMap[compound->name + compound->db];
+    auto position = lower_bound(begin(named),
+                                end(named),
+                                key,
+                                [&](Compound* c, const string& k) {
+                                    return uniqueKey(c) < k;
+                                });
+    named.insert(position, compound);
+}
+
 bool ProjectDatabase::_compoundDatabaseLoaded(string databaseName)
 {
     auto beginning = begin(_loadedCompoundDatabases);
@@ -1599,23 +1880,21 @@ bool ProjectDatabase::_compoundDatabaseLoaded(string databaseName)
 
 string ProjectDatabase::_getScanSignature(Scan* scan, int limitSize)
 {
-    stringstream signature;
-    map<int, bool> seen;
+    _signatureStream.str("");
+    unordered_set<int> seen;
     int mz_count = 0;
     for (auto posIndex : scan->intensityOrderDesc()) {
         size_t pos = static_cast<unsigned int>(posIndex);
         int mzround = static_cast<int>(scan->mz[pos]);
-        if (!seen.count(mzround)) {
-            signature << "[" << setprecision(9)
-                      << scan->mz[pos] << ","
-                      << scan->intensity[pos] << "]";
-            seen[mzround] = true;
+        if (seen.insert(mzround).second) {
+            _signatureStream << "[" << scan->mz[pos]
+                             << "," << scan->intensity[pos] << "]";
         }
 
         if (mz_count++ >= limitSize)
             break;
     }
-    return signature.str();
+    return _signatureStream.str();
 }
 
 string ProjectDatabase::_locateSample(const string filepath,
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <sstream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -12,6 +14,7 @@
 class Adduct;
 class Compound;
 class Connection;
+class Cursor;
 class mzSample;
 class PeakGroup;
 class Scan;
@@ -57,6 +60,22 @@ public:
      */
     ~ProjectDatabase();
 
+    /**
+     * @brief Start saving a large amount of data.
+     * @details Everything saved until `endBulkSave` is called is written in
+     * a single transaction, which the transactions of the individual save
+     * and delete methods become part of. The page cache of the connection is
+     * enlarged and temporary data is kept in memory for the duration of the
+     * save.
+     */
+    void beginBulkSave();
+
+    /**
+     * @brief Commit everything saved since `beginBulkSave` and restore the
+     * default cache settings of the connection.
+     */
+    void endBulkSave();
+
     /**
      * @brief Save information for a given set of samples.
      * @details Consequently, each sample saved is also assigned a unique ID.
@@ -385,7 +404,26 @@ private:
      * This map is used to determine whether a compound has already been loaded
      * and need not be loaded again.
      */
-    map<string, Compound*> _compoundIdMap;
+    unordered_map<string, Compound*> _compoundIdMap;
+
+    /**
+     * @brief _compoundNameMap A map of compound names, joined with their
+     * database names, to the loaded compounds of that name.
+     */
+    unordered_map<string, vector<Compound*>> _compoundNameMap;
+
+    /**
+     * @brief _defaultCacheSize The page cache size of the connection before
+     * a bulk save, restored when the save ends.
+     */
+    int _defaultCacheSize;
+
+    /**
+     * @brief _signatureStream Stream reused to format scan signatures. It
+     * uses the classic locale, so that signatures are written with a
+     * decimal point whatever the locale of the application.
+     */
+    ostringstream _signatureStream;
 
     /**
      * @brief Assign each sample in the given vector with a unique ID.
@@ -423,6 +461,12 @@ private:
      */
     vector<Compound*> _findSpeciesByName(string name, string databaseName);
 
+    /**
+     * @brief Add a newly loaded compound to the index of compound names.
+     * @param compound The loaded Compound object.
+     */
+    void _indexCompoundByName(Compound* compound);
+
     /**
      * @brief Checks whether compound database of the given name has already
      * been loaded or not.
@@ -431,6 +475,64 @@ private:
      */
     bool _compoundDatabaseLoaded(string databaseName);
 
+    /**
+     * @brief Create the peakgroups table if needed and prepare a statement
+     * inserting a peak group into it.
+     * @return The prepared statement, nullptr if the table could not be
+     * created.
+     */
+    Cursor* _prepareGroupsInsert();
+
+    /**
+     * @brief Create the peaks table if needed and prepare a statement
+     * inserting a peak into it.
+     * @return The prepared statement, nullptr if the table could not be
+     * created.
+     */
+    Cursor* _preparePeaksInsert();
+
+    /**
+     * @brief Save a peak group, its sub-groups and their peaks using the
+     * given prepared statements, see `saveGroupAndPeaks`.
+     * @param group The PeakGroup which has to be saved.
+     * @param parentGroupId The group ID of the parent group, 0 for top-level
+     * groups.
+     * @param tableName Table name saved for the group.
+     * @param groupsQuery Statement prepared by `_prepareGroupsInsert`.
+     * @param peaksQuery Statement prepared by `_preparePeaksInsert`.
+     * @return An integer ID for the group saved.
+     */
+    int _saveGroupAndPeaks(PeakGroup* group,
+                           const int parentGroupId,
+                           const string& tableName,
+                           Cursor* groupsQuery,
+                           Cursor* peaksQuery);
+
+    /**
+     * @brief Save the peaks of a group using the given prepared statement.
+     * @param group The peak group whose peaks need to be saved.
+     * @param groupId The group ID for the group (as saved in the database).
+     * @param peaksQuery Statement prepared by `_preparePeaksInsert`.
+     */
+    void _saveGroupPeaks(PeakGroup* group,
+                         const int groupId,
+                         Cursor* peaksQuery);
+
+    /**
+     * @brief Read peaks from a query and add them to their groups.
+     * @details The query must select rows of the peaks table along with the
+     * name of their sample as "sample_name", ordered by group ID. Peaks are
+     * attached to their groups in a single merge pass over the two, peaks
+     * of groups that are not given are skipped.
+     * @param peaksQuery A prepared query for the peaks to be loaded.
+     * @param groups Peak groups ordered by their group ID.
+     * @param loaded A vector of loaded mzSample objects that will be
+     * associated with the peaks by name.
+     */
+    void _loadPeaks(Cursor* peaksQuery,
+                    const vector<PeakGroup*>& groups,
+                    const vector<mzSample*>& loaded);
+
     /**
      * @brief Attempt to create a unique scan signature for a given Scan object.
      * @param scan A Scan object for which signature needs to be created.
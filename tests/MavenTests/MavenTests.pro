@@ -20,7 +20,7 @@ QMAKE_CXXFLAGS += -fopenmp
 
 INCLUDEPATH +=  $$top_srcdir/src/core/libmaven  $$top_srcdir/3rdparty/pugixml/src $$top_srcdir/3rdparty/libneural $$top_srcdir/3rdparty/libpls \
 				$$top_srcdir/3rdparty/libcsvparser $$top_srcdir/src/cli/peakdetector $$top_srcdir/3rdparty/libdate $$top_srcdir/3rdparty/libcdfread \
-                $$top_srcdir/3rdparty/obiwarp $$top_srcdir/src/pollyCLI \
+                $$top_srcdir/3rdparty/obiwarp $$top_srcdir/src/pollyCLI $$top_srcdir/src/projectDB \
                 $$top_srcdir/3rdparty/Eigen
 macx {
 
@@ -33,7 +33,7 @@ macx {
 }
 QMAKE_LFLAGS += -L$$top_builddir/libs/
 
-LIBS += -lmaven -lpugixml -lneural -lcsvparser -lpls -lErrorHandling -lLogger -lcdfread -lz -lnetcdf -lobiwarp -lpollyCLI
+LIBS += -lmaven -lpugixml -lneural -lcsvparser -lpls -lErrorHandling -lLogger -lcdfread -lz -lnetcdf -lobiwarp -lpollyCLI -lprojectDB
 !macx: LIBS += -fopenmp
 
 macx {
@@ -41,6 +41,14 @@ macx {
     LIBS -= -lnetcdf -lcdfread
 }
 
+unix {
+    LIBS += -lboost_system -lboost_filesystem -lsqlite3
+}
+
+win32 {
+    LIBS += -lboost_system-mt -lboost_filesystem-mt -lsqlite3
+}
+
 
 # Input
 HEADERS += \
@@ -61,6 +69,7 @@ HEADERS += \
     testSRMList.h \
     testGroupFiltering.h \
     testIsotopeLogic.h \
+    testProjectDB.h \
     $$top_srcdir/src/cli/peakdetector/peakdetectorcli.h \
     $$top_srcdir/src/core/libmaven/classifier.h \
     $$top_srcdir/src/core/libmaven/classifierNeuralNet.h \
@@ -86,6 +95,7 @@ SOURCES += \
     testSRMList.cpp \
     testGroupFiltering.cpp \
     testIsotopeLogic.cpp \
+    testProjectDB.cpp \
     main.cpp \
     $$top_srcdir/src/cli/peakdetector/peakdetectorcli.cpp  \
     $$top_srcdir/src/cli/peakdetector/options.cpp \
@@ -16,6 +16,7 @@
 #include "testCharge.h"
 #include "testSRMList.h"
 #include "testIsotopeLogic.h"
+#include "testProjectDB.h"
 
 int readLog(QString);
 
@@ -84,6 +85,10 @@ int main(int argc, char** argv) {
         result |= QTest::qExec(new TestIsotopeLogic, argc, argv);
     result|=readLog("testIsotopeLogic.xml");
 
+    if (freopen("testProjectDB.xml", "w", stdout))
+        result |= QTest::qExec(new TestProjectDB, argc, argv);
+    result|=readLog("testProjectDB.xml");
+
 
     if (freopen("testMzAligner.xml", "w", stdout)) {
         result |= QTest::qExec(new TestMzAligner, argc, argv);
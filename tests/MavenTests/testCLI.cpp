@@ -49,6 +49,41 @@ void TestCLI::testLoadSamples() {
 
 }
 
+void TestCLI::testLoadSamplesParallel() {
+
+    PeakDetectorCLI* serialCLI = new PeakDetectorCLI();
+    serialCLI->filenames.push_back(normalSample);
+    serialCLI->filenames.push_back(blankSample);
+    serialCLI->loadSamples(serialCLI->filenames);
+
+    // parallel loading, with and without a memory budget small enough to
+    // allow only one file at a time
+    vector<string> budgets = {"0", "1"};
+    for (const string& budget : budgets) {
+        PeakDetectorCLI* parallelCLI = new PeakDetectorCLI();
+        parallelCLI->filenames.push_back(normalSample);
+        parallelCLI->filenames.push_back(blankSample);
+
+        const char* argv[] = {"peakdetector",
+                              "-t",
+                              "2",
+                              "-M",
+                              budget.c_str()};
+        parallelCLI->processOptions(5, const_cast<char**>(argv));
+        QVERIFY(parallelCLI->mavenParameters->peakDetectionThreads == 2);
+
+        parallelCLI->loadSamples(parallelCLI->filenames);
+
+        vector<mzSample*>& serial = serialCLI->mavenParameters->samples;
+        vector<mzSample*>& parallel = parallelCLI->mavenParameters->samples;
+        QVERIFY(parallel.size() == serial.size());
+        for (unsigned int i = 0; i < serial.size(); i++) {
+            QVERIFY(parallel[i]->sampleName == serial[i]->sampleName);
+            QVERIFY(parallel[i]->scanCount() == serial[i]->scanCount());
+        }
+    }
+}
+
 void TestCLI::testProcessXml() {
 
     PeakDetectorCLI* peakdetectorCLI = new PeakDetectorCLI();
@@ -39,6 +39,7 @@ class TestCLI : public QObject {
         void testLoadClassificationModel();
         void testLoadCompoundsFile();
         void testLoadSamples();
+        void testLoadSamplesParallel();
         void testProcessXml();
         void testCreateXMLFile();
         void testReduceGroups();
@@ -1,4 +1,5 @@
 #include "testEIC.h"
+#include <thread>
 
 TestEIC::TestEIC() {}
 
@@ -53,6 +54,156 @@ void TestEIC::testgetEICms2() {
     QVERIFY(e3->maxIntensity == 49400);
 }
 
+void TestEIC::testScanIndex() {
+    mzSample* mzsample = maventests::samples.ms2TestSamples[0];
+
+    const vector<Scan*>& ms1Scans = mzsample->scansForMsLevel(1);
+    const vector<unsigned int>& ms1Positions =
+        mzsample->scanPositionsForMsLevel(1);
+    QVERIFY(ms1Scans.size() == mzsample->ms1ScanCount());
+    QVERIFY(ms1Scans.size() == ms1Positions.size());
+    QVERIFY(std::is_sorted(ms1Scans.begin(), ms1Scans.end(), Scan::compRt));
+    for (unsigned int i = 0; i < ms1Scans.size(); i++)
+        QVERIFY(mzsample->scans[ms1Positions[i]] == ms1Scans[i]);
+
+    const vector<Scan*>& msnScans = mzsample->fragmentationScans();
+    for (auto scan : msnScans)
+        QVERIFY(scan->mslevel > 1);
+    QVERIFY(msnScans.size() + ms1Scans.size() <= mzsample->scanCount());
+    QVERIFY(mzsample->scansForMsLevel(7).empty());
+}
+
+void TestEIC::testFilterLinePartitions() {
+    mzSample* mzsample = maventests::samples.ms2TestSamples[0];
+
+    const vector<string>& filterLines = mzsample->filterLines();
+    Scan* filteredScan = NULL;
+    for (unsigned int i = 0; i < mzsample->scans.size(); i++) {
+        Scan* scan = mzsample->scans[i];
+        if (scan->filterLine.empty()) {
+            QVERIFY(scan->filterLineId == -1);
+            continue;
+        }
+        QVERIFY(filterLines[scan->filterLineId] == scan->filterLine);
+        QVERIFY(mzsample->filterLineId(scan->filterLine) == scan->filterLineId);
+        if (filteredScan == NULL and scan->mslevel > 1) filteredScan = scan;
+    }
+    QVERIFY(mzsample->filterLineId("not a filterline") == -1);
+    QVERIFY(filteredScan != NULL);
+
+    // an EIC of one filterline must hold exactly the scans of its partition
+    int mslevel = filteredScan->mslevel;
+    const vector<Scan*>& levelScans = mzsample->scansForMsLevel(mslevel);
+    const vector<unsigned int>& indices =
+        mzsample->scanViewIndicesForFilterLine(mslevel,
+                                               filteredScan->filterLineId);
+    unsigned int expectedScans = 0;
+    for (auto scan : levelScans) {
+        if (scan->filterLine == filteredScan->filterLine) expectedScans++;
+    }
+    QVERIFY(indices.size() == expectedScans);
+    for (auto index : indices)
+        QVERIFY(levelScans[index]->filterLine == filteredScan->filterLine);
+
+    EIC e;
+    e.makeEICSlice(mzsample,
+                   0,
+                   2000,
+                   0,
+                   levelScans.back()->rt,
+                   mslevel,
+                   0,
+                   filteredScan->filterLine);
+    QVERIFY(e.scannum.size() == expectedScans);
+}
+
+void TestEIC::testMs1Columns() {
+    mzSample* mzsample = maventests::samples.ms1TestSamples[0];
+
+    const vector<Scan*>& ms1Scans = mzsample->scansForMsLevel(1);
+    const SpectralColumns& columns = mzsample->ms1Columns();
+    QVERIFY(columns.scanCount() == ms1Scans.size());
+    QVERIFY(columns.mz.size() == columns.intensity.size());
+    for (unsigned int i = 0; i < ms1Scans.size(); i++) {
+        Scan* scan = ms1Scans[i];
+        QVERIFY(columns.nobs(i) == scan->nobs());
+        QVERIFY(std::equal(scan->mz.begin(),
+                           scan->mz.end(),
+                           columns.mzBegin(i)));
+        QVERIFY(std::equal(scan->intensity.begin(),
+                           scan->intensity.begin() + scan->nobs(),
+                           columns.intensityBegin(i)));
+    }
+
+    // concurrent first calls build the store once
+    mzSample sample;
+    sample.loadSample("bin/methods/testsample_1.mzxml");
+    vector<const SpectralColumns*> built(4, nullptr);
+    vector<std::thread> threads;
+    for (unsigned int i = 0; i < built.size(); i++) {
+        threads.push_back(std::thread([&sample, &built, i]() {
+            built[i] = &sample.ms1Columns();
+        }));
+    }
+    for (auto& t : threads)
+        t.join();
+    Scan* first = sample.scansForMsLevel(1)[0];
+    QVERIFY(built[0]->scanCount() == sample.scansForMsLevel(1).size());
+    QVERIFY(built[0]->nobs(0) == first->nobs());
+
+    // filtering a scan in place drops the stale copy of its values
+    unsigned int nobs = first->nobs();
+    first->quantileFilter(50);
+    QVERIFY(first->nobs() < nobs);
+    const SpectralColumns& rebuilt = sample.ms1Columns();
+    QVERIFY(rebuilt.nobs(0) == first->nobs());
+    QVERIFY(std::equal(first->mz.begin(), first->mz.end(), rebuilt.mzBegin(0)));
+}
+
+void TestEIC::testgetEICs() {
+    mzSample* mzsample = maventests::samples.ms1TestSamples[0];
+
+    vector<pair<float, float> > mzRanges;
+    mzRanges.push_back(make_pair(402.9929f, 402.9969f));
+    mzRanges.push_back(make_pair(403.9960f, 404.0000f));
+    mzRanges.push_back(make_pair(210.0000f, 210.1000f));
+    mzRanges.push_back(make_pair(0.0f, 1.0f));
+
+    for (int eicType = 0; eicType < 2; eicType++) {
+        vector<EIC*> eics = mzsample->getEICs(mzRanges, 12.0, 16.0, 1, eicType, "");
+        QVERIFY(eics.size() == mzRanges.size());
+
+        for (unsigned int i = 0; i < mzRanges.size(); i++) {
+            EIC* e = mzsample->getEIC(mzRanges[i].first,
+                                      mzRanges[i].second,
+                                      12.0,
+                                      16.0,
+                                      1,
+                                      eicType,
+                                      "");
+            QVERIFY(eics[i]->mzmin == e->mzmin);
+            QVERIFY(eics[i]->mzmax == e->mzmax);
+            QVERIFY(eics[i]->scannum == e->scannum);
+            QVERIFY(eics[i]->rt == e->rt);
+            QVERIFY(eics[i]->intensity == e->intensity);
+            QVERIFY(eics[i]->maxIntensity == e->maxIntensity);
+            QVERIFY(eics[i]->rtmin == e->rtmin);
+            QVERIFY(eics[i]->rtmax == e->rtmax);
+            delete e;
+        }
+        delete_all(eics);
+    }
+}
+
+void TestEIC::benchmarkMakeEICSlice() {
+    SKIP_UNLESS_BENCHMARKING();
+    mzSample* mzsample = maventests::samples.ms1TestSamples[0];
+    QBENCHMARK {
+        EIC e;
+        e.makeEICSlice(mzsample, 402.9929f, 402.9969f, 12.0, 16.0, 1, 0, "");
+    }
+}
+
 void TestEIC::testcomputeSpline()
 {
     EIC* e = maventests::samples.ms1TestSamples[0]->getEIC(402.9929f,
@@ -71,6 +222,143 @@ void TestEIC::testcomputeSpline()
     QVERIFY(true);
 }
 
+EIC* TestEIC::syntheticEIC(int length)
+{
+    // gaussian peaks every 50 scans over a noisy baseline
+    EIC* e = new EIC();
+    srand(length);
+    for (int i = 0; i < length; i++) {
+        float offset = (i % 50) - 25;
+        float peak = 1e5 * exp(-offset * offset / 20.0);
+        e->scannum.push_back(i);
+        e->rt.push_back(i * 0.01);
+        e->mz.push_back(180.0);
+        e->intensity.push_back(peak + rand() % 1000);
+    }
+    return e;
+}
+
+void TestEIC::testSmoothingInstructionSets()
+{
+    typedef mzUtils::SmoothingKernel::InstructionSet InstructionSet;
+    InstructionSet supported =
+        mzUtils::SmoothingKernel::supportedInstructionSet();
+
+    EIC* e = syntheticEIC(1001);
+    for (auto smootherType : {EIC::SAVGOL, EIC::GAUSSIAN, EIC::AVG}) {
+        e->setSmootherType(smootherType);
+
+        mzUtils::SmoothingKernel::setInstructionSet(InstructionSet::Scalar);
+        e->computeSpline(10);
+        vector<float> scalar(e->spline, e->spline + e->intensity.size());
+
+        // every instruction set smooths to the same spline
+        for (auto instructionSet : {InstructionSet::SSE2, InstructionSet::AVX2}) {
+            mzUtils::SmoothingKernel::setInstructionSet(instructionSet);
+            e->computeSpline(10);
+            for (unsigned int i = 0; i < scalar.size(); i++) {
+                QVERIFY(fabs(e->spline[i] - scalar[i])
+                        <= 1e-4 * max(1.0f, fabs(scalar[i])));
+            }
+        }
+    }
+    mzUtils::SmoothingKernel::setInstructionSet(supported);
+    delete e;
+}
+
+vector<float> TestEIC::legacySmoothing(const vector<float>& intensity,
+                                       EIC::SmootherType smootherType,
+                                       int smoothWindow)
+{
+    // the conv and SavGolSmoother based smoothing computeSpline used to do
+    int n = intensity.size();
+    vector<float> y(intensity);
+    vector<float> smoothed(n);
+
+    if (smootherType == EIC::SAVGOL) {
+        mzUtils::SavGolSmoother smoother(smoothWindow, smoothWindow, 4);
+        smoothed = smoother.Smooth(y);
+    } else if (smootherType == EIC::GAUSSIAN) {
+        float fcut = 1.0 / smoothWindow;
+        if (smoothWindow > 100) fcut = 1.0 / 100;
+        int len = (int) (3.0 / fcut + 0.5);
+        len = 2 * len / 2 + 1;
+        int mean = len / 2;
+        vector<float> s(len);
+        float sum = 0.0;
+        for (int i = 1; i <= len; i++) {
+            float r = i - mean - 1;
+            s[i - 1] = exp(-r * r * fcut * fcut * 3.141);
+            sum += s[i - 1];
+        }
+        for (int i = 0; i < len; i++) s[i] /= sum;
+        mzUtils::conv(len, -mean, s.data(), n, -mean, y.data(), n, -mean,
+                      smoothed.data());
+    } else if (smootherType == EIC::AVG) {
+        vector<float> x(smoothWindow, 1.0 / smoothWindow);
+        mzUtils::conv(smoothWindow, -smoothWindow / 2, x.data(), n, 0,
+                      y.data(), n, 0, smoothed.data());
+    }
+    return smoothed;
+}
+
+void TestEIC::testSmoothingMatchesLegacy()
+{
+    typedef mzUtils::SmoothingKernel::InstructionSet InstructionSet;
+    InstructionSet supported =
+        mzUtils::SmoothingKernel::supportedInstructionSet();
+
+    EIC* e = syntheticEIC(1001);
+    for (auto smootherType : {EIC::SAVGOL, EIC::GAUSSIAN, EIC::AVG}) {
+        e->setSmootherType(smootherType);
+        vector<float> legacy = legacySmoothing(e->intensity, smootherType, 10);
+
+        // kernels only change the summation order of the old convolutions
+        for (auto instructionSet : {InstructionSet::Scalar,
+                                    InstructionSet::SSE2,
+                                    InstructionSet::AVX2}) {
+            mzUtils::SmoothingKernel::setInstructionSet(instructionSet);
+            e->computeSpline(10);
+            for (unsigned int i = 0; i < legacy.size(); i++) {
+                QVERIFY(fabs(e->spline[i] - legacy[i])
+                        <= 1e-4 * max(1.0f, fabs(legacy[i])));
+            }
+        }
+    }
+    mzUtils::SmoothingKernel::setInstructionSet(supported);
+    delete e;
+}
+
+void TestEIC::benchmarkComputeSpline_data()
+{
+    QTest::addColumn<int>("smootherType");
+    QTest::addColumn<int>("length");
+
+    vector<pair<string, int>> smoothers = {{"SAVGOL", EIC::SAVGOL},
+                                           {"GAUSSIAN", EIC::GAUSSIAN},
+                                           {"AVG", EIC::AVG}};
+    for (auto& smoother : smoothers) {
+        for (int length : {100, 1000, 10000}) {
+            string row = smoother.first + " " + to_string(length);
+            QTest::newRow(row.c_str()) << smoother.second << length;
+        }
+    }
+}
+
+void TestEIC::benchmarkComputeSpline()
+{
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, smootherType);
+    QFETCH(int, length);
+
+    EIC* e = syntheticEIC(length);
+    e->setSmootherType(static_cast<EIC::SmootherType>(smootherType));
+    QBENCHMARK {
+        e->computeSpline(10);
+    }
+    delete e;
+}
+
 void TestEIC::testgetPeakPositions()
 {
     EIC* e = maventests::samples.ms1TestSamples[0]->getEIC(402.9929f,
@@ -346,6 +634,132 @@ void TestEIC:: testgroupPeaks() {
 }
 
 
+MavenParameters* TestEIC::groupingParameters(bool useOverlap) {
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->compoundMassCutoffWindow->setMassCutoffAndType(10,"ppm");
+    for (auto mzsample: maventests::samples.ms1TestSamples)
+        mavenparameters->samples.push_back(mzsample);
+    mavenparameters->eic_smoothingWindow = 10;
+    mavenparameters->eic_smoothingAlgorithm = 1;
+    mavenparameters->aslsBaselineMode = false;
+    mavenparameters->baseline_smoothingWindow = 5;
+    mavenparameters->baseline_dropTopX = 80;
+    mavenparameters->grouping_maxRtWindow = 0.5;
+    mavenparameters->distXWeight = 1;
+    mavenparameters->distYWeight = 5;
+    mavenparameters->overlapWeight = 2;
+    mavenparameters->useOverlap = useOverlap;
+    return mavenparameters;
+}
+
+vector<EIC*> TestEIC::pullFullRangeEICs(MavenParameters* mavenparameters) {
+    vector<Compound*> compounds = TestUtils::getCompoudDataBaseWithRT();
+    mzSlice* slice = new mzSlice();
+    slice->compound = compounds[4];
+    slice->calculateRTMinMax(false, 0);
+    slice->calculateMzMinMax(mavenparameters->compoundMassCutoffWindow, +1);
+    return PeakDetector::pullEICs(slice,
+                                  mavenparameters->samples,
+                                  mavenparameters);
+}
+
+void TestEIC::testgroupPeaksSweep() {
+    for (int useOverlap = 0; useOverlap <= 1; useOverlap++) {
+        MavenParameters* mavenparameters = groupingParameters(useOverlap);
+        vector<EIC*> eics = pullFullRangeEICs(mavenparameters);
+
+        EIC::groupPeaks(eics,
+                        NULL,
+                        mavenparameters->eic_smoothingWindow,
+                        mavenparameters->grouping_maxRtWindow,
+                        mavenparameters->minQuality,
+                        mavenparameters->distXWeight,
+                        mavenparameters->distYWeight,
+                        mavenparameters->overlapWeight,
+                        mavenparameters->useOverlap,
+                        mavenparameters->minSignalBaselineDifference,
+                        mavenparameters->fragmentTolerance,
+                        mavenparameters->scoringAlgo);
+
+        // every peak must be assigned to the group an exhaustive scan over
+        // all merged peaks picks
+        EIC* m = EIC::eicMerge(eics);
+        m->setFilterSignalBaselineDiff(mavenparameters->minSignalBaselineDifference);
+        m->getPeakPositions(mavenparameters->eic_smoothingWindow);
+        sort(m->peaks.begin(), m->peaks.end(), Peak::compRt);
+
+        for (auto eic : eics) {
+            for (const Peak& b : eic->peaks) {
+                int groupNum = -1;
+                float groupOverlap = FLT_MIN;
+                for (unsigned int k = 0; k < m->peaks.size(); k++) {
+                    Peak& a = m->peaks[k];
+                    float overlap = mzUtils::checkOverlap(a.rtmin, a.rtmax, b.rtmin, b.rtmax);
+                    float distx = abs(b.rt - a.rt);
+                    float disty = abs(b.peakIntensity - a.peakIntensity);
+                    float score;
+                    if (useOverlap) {
+                        if (overlap == 0 and a.rtmax < b.rtmin) continue;
+                        if (overlap == 0 and a.rtmin > b.rtmax) break;
+                        if (distx > mavenparameters->grouping_maxRtWindow && overlap < 0.2) continue;
+                        score = 1.0 / (mavenparameters->distXWeight * distx + 0.01)
+                                / (mavenparameters->distYWeight * disty + 0.01)
+                                * (mavenparameters->overlapWeight * overlap);
+                    } else {
+                        if (distx > mavenparameters->grouping_maxRtWindow) continue;
+                        score = 1.0 / (mavenparameters->distXWeight * distx + 0.01)
+                                / (mavenparameters->distYWeight * disty + 0.01);
+                    }
+                    if (score > groupOverlap) {
+                        groupNum = k;
+                        groupOverlap = score;
+                    }
+                }
+                QVERIFY(b.groupNum == groupNum);
+            }
+        }
+        delete m;
+        delete_all(eics);
+    }
+}
+
+void TestEIC::benchmarkGroupPeaks_data() {
+    QTest::addColumn<bool>("grouping");
+
+    QTest::newRow("extraction") << false;
+    QTest::newRow("grouping") << true;
+}
+
+void TestEIC::benchmarkGroupPeaks() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(bool, grouping);
+
+    MavenParameters* mavenparameters = groupingParameters(false);
+    vector<EIC*> eics = pullFullRangeEICs(mavenparameters);
+
+    // EICs of a full RT range slice are pulled, or grouped, in every pass
+    QBENCHMARK {
+        if (grouping) {
+            EIC::groupPeaks(eics,
+                            NULL,
+                            mavenparameters->eic_smoothingWindow,
+                            mavenparameters->grouping_maxRtWindow,
+                            mavenparameters->minQuality,
+                            mavenparameters->distXWeight,
+                            mavenparameters->distYWeight,
+                            mavenparameters->overlapWeight,
+                            mavenparameters->useOverlap,
+                            mavenparameters->minSignalBaselineDifference,
+                            mavenparameters->fragmentTolerance,
+                            mavenparameters->scoringAlgo);
+        } else {
+            vector<EIC*> pulled = pullFullRangeEICs(mavenparameters);
+            delete_all(pulled);
+        }
+    }
+    delete_all(eics);
+}
+
 void TestEIC:: testeicMerge() {
     bool matchRtFlag = true;
     float compoundRTWindow = 2;
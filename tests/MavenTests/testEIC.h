@@ -11,6 +11,7 @@
 #include "mavenparameters.h"
 #include "mzMassCalculator.h"
 #include "mzSample.h"
+#include "smoothingkernel.h"
 
 class TestEIC : public QObject {
     Q_OBJECT
@@ -31,7 +32,16 @@ class TestEIC : public QObject {
         // this is automatically detected thanks to Qt's meta-information about QObjects
         void testgetEIC();
         void testgetEICms2();
+        void testScanIndex();
+        void testFilterLinePartitions();
+        void testMs1Columns();
+        void testgetEICs();
+        void benchmarkMakeEICSlice();
         void testcomputeSpline();
+        void testSmoothingInstructionSets();
+        void testSmoothingMatchesLegacy();
+        void benchmarkComputeSpline_data();
+        void benchmarkComputeSpline();
         void testgetPeakPositions();
         void testcomputeBaselineThreshold();
         void testcomputeBaselineAsLSSmoothing();
@@ -40,7 +50,18 @@ class TestEIC : public QObject {
         void testfindPeakBounds();
         void testGetPeakDetails();
         void testgroupPeaks();
+        void testgroupPeaksSweep();
+        void benchmarkGroupPeaks_data();
+        void benchmarkGroupPeaks();
         void testeicMerge();
+
+    private:
+        MavenParameters* groupingParameters(bool useOverlap);
+        vector<EIC*> pullFullRangeEICs(MavenParameters* mavenparameters);
+        EIC* syntheticEIC(int length);
+        vector<float> legacySmoothing(const vector<float>& intensity,
+                                      EIC::SmootherType smootherType,
+                                      int smoothWindow);
 };
 
 #endif // TESTEIC_H
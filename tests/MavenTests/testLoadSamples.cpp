@@ -1,6 +1,111 @@
 #include "testLoadSamples.h"
 #include "mavenparameters.h"
 #include "mzSample.h"
+#include "samplecache.h"
+
+namespace {
+    // bytes held by pugixml, to compare the memory needed by the streaming
+    // and whole document parsers
+    size_t xmlMemory = 0;
+    size_t peakXmlMemory = 0;
+    const size_t headerSize = 16;
+
+    void* trackedAllocate(size_t size) {
+        size_t* block = static_cast<size_t*>(malloc(size + headerSize));
+        if (!block)
+            return NULL;
+        *block = size;
+        xmlMemory += size;
+        peakXmlMemory = std::max(peakXmlMemory, xmlMemory);
+        return reinterpret_cast<char*>(block) + headerSize;
+    }
+
+    void trackedDeallocate(void* ptr) {
+        if (!ptr)
+            return;
+        size_t* block = reinterpret_cast<size_t*>(
+            static_cast<char*>(ptr) - headerSize);
+        xmlMemory -= *block;
+        free(block);
+    }
+
+    bool sameScans(mzSample& a, mzSample& b) {
+        if (a.scans.size() != b.scans.size())
+            return false;
+        for (unsigned int i = 0; i < a.scans.size(); i++) {
+            Scan* x = a.scans[i];
+            Scan* y = b.scans[i];
+            if (x->scannum != y->scannum
+                || x->mslevel != y->mslevel
+                || x->rt != y->rt
+                || x->polarity != y->polarity
+                || x->precursorMz != y->precursorMz
+                || x->productMz != y->productMz
+                || x->filterLine != y->filterLine
+                || x->mz != y->mz
+                || x->intensity != y->intensity)
+                return false;
+        }
+        return true;
+    }
+
+    QString binaryArray(const vector<float>& values, const char* name) {
+        QByteArray bytes(reinterpret_cast<const char*>(values.data()),
+                         values.size() * sizeof(float));
+        return QString("<binaryDataArray>"
+                       "<cvParam accession=\"MS:1000521\" name=\"32-bit float\"/>"
+                       "<cvParam accession=\"MS:1000576\" name=\"no compression\"/>"
+                       "<cvParam name=\"%1\"/>"
+                       "<binary>%2</binary></binaryDataArray>")
+            .arg(name)
+            .arg(QString(bytes.toBase64()));
+    }
+
+    // writes a small data dependent acquisition: every MS1 scan is followed
+    // by fragmentation scans of three precursors, so that each precursor has
+    // more scans than the fragmentation scans kept in memory while testing
+    void writeDdaSample(const QString& fileName) {
+        const float precursors[] = {300.1f, 400.2f, 500.3f};
+        QFile file(fileName);
+        file.open(QIODevice::WriteOnly | QIODevice::Text);
+        QTextStream out(&file);
+        out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+            << "<mzML><run id=\"dda\"><spectrumList count=\"80\">\n";
+        for (int i = 0; i < 80; i++) {
+            int mslevel = i % 4 == 0 ? 1 : 2;
+            float precursorMz = mslevel == 1 ? 0 : precursors[i % 4 - 1];
+            vector<float> mzs;
+            vector<float> intensities;
+            for (int j = 0; j < 20; j++) {
+                float maxMz = mslevel == 1 ? 1000 : precursorMz;
+                mzs.push_back(100 + j * (maxMz - 100) / 20 + (i % 7) * 0.001f);
+                intensities.push_back(1000 + ((i * 31 + j * 17) % 97) * 100);
+            }
+            out << QString("<spectrum index=\"%1\" id=\"scan=%1\" "
+                           "defaultArrayLength=\"20\">").arg(i)
+                << QString("<cvParam accession=\"MS:1000511\" "
+                           "name=\"ms level\" value=\"%1\"/>").arg(mslevel)
+                << "<cvParam accession=\"MS:1000130\" name=\"positive scan\"/>"
+                << QString("<scanList><scan><cvParam accession=\"MS:1000016\" "
+                           "name=\"scan start time\" value=\"%1\" "
+                           "unitName=\"minute\"/></scan></scanList>")
+                       .arg(i * 0.01, 0, 'f', 2);
+            if (mslevel == 2) {
+                out << QString("<precursorList><precursor><isolationWindow>"
+                               "<cvParam accession=\"MS:1000827\" "
+                               "name=\"isolation window target m/z\" "
+                               "value=\"%1\"/></isolationWindow></precursor>"
+                               "</precursorList>")
+                           .arg(precursorMz, 0, 'f', 4);
+            }
+            out << "<binaryDataArrayList>"
+                << binaryArray(mzs, "m/z array")
+                << binaryArray(intensities, "intensity array")
+                << "</binaryDataArrayList></spectrum>\n";
+        }
+        out << "</spectrumList></run></mzML>\n";
+    }
+}
 
 TestLoadSamples::TestLoadSamples() {
     loadFile = "bin/methods/testsample_1.mzxml";
@@ -190,3 +295,322 @@ void TestLoadSamples::testParseMzMLInjectionTimeStamp() {
     }
 
 }
+
+void TestLoadSamples::testStreamingParser() {
+    mzSample streamedMzXML;
+    mzSample loadedMzXML;
+    streamedMzXML.parseMzXML(loadFile);
+    loadedMzXML.parseMzXMLDocument(loadFile);
+    QVERIFY(streamedMzXML.scanCount() > 0);
+    QVERIFY(sameScans(streamedMzXML, loadedMzXML));
+    QVERIFY(streamedMzXML.instrumentInfo == loadedMzXML.instrumentInfo);
+
+    const char* mzMLFile = "bin/methods/ms2test1.mzML";
+    mzSample streamedMzML;
+    mzSample loadedMzML;
+    streamedMzML.parseMzML(mzMLFile);
+    loadedMzML.parseMzMLDocument(mzMLFile);
+    QVERIFY(streamedMzML.scanCount() > 0);
+    QVERIFY(sameScans(streamedMzML, loadedMzML));
+    QVERIFY(streamedMzML.injectionTime == loadedMzML.injectionTime);
+}
+
+void TestLoadSamples::testSampleCache() {
+    string cacheFile = SampleCache::cachePath(loadFile);
+    remove(cacheFile.c_str());
+
+    SampleCache::setEnabled(false);
+    mzSample parsed;
+    parsed.loadSample(loadFile);
+    QVERIFY(!mzUtils::fileExists(cacheFile));
+
+    // the first load writes the cache, the second one reads it
+    SampleCache::setEnabled(true);
+    mzSample written;
+    written.loadSample(loadFile);
+    QVERIFY(mzUtils::fileExists(cacheFile));
+    mzSample cached;
+    QVERIFY(SampleCache::read(&cached, loadFile));
+    QVERIFY(sameScans(parsed, cached));
+    QVERIFY(parsed.instrumentInfo == cached.instrumentInfo);
+    QVERIFY(parsed.ms1ScanCount() == cached.ms1ScanCount());
+    QVERIFY(parsed.ms2ScanCount() == cached.ms2ScanCount());
+
+    mzSample reloaded;
+    reloaded.loadSample(loadFile);
+    QVERIFY(sameScans(parsed, reloaded));
+    QVERIFY(parsed.minMz == reloaded.minMz && parsed.maxMz == reloaded.maxMz);
+    QVERIFY(parsed.minRt == reloaded.minRt && parsed.maxRt == reloaded.maxRt);
+
+    // scans filtered with other settings can not be reused
+    int minIntensity = mzSample::getFilter_minIntensity();
+    mzSample::setFilter_minIntensity(1000);
+    mzSample filtered;
+    QVERIFY(!SampleCache::read(&filtered, loadFile));
+    mzSample::setFilter_minIntensity(minIntensity);
+
+    SampleCache::setEnabled(false);
+    remove(cacheFile.c_str());
+}
+
+void TestLoadSamples::testSampleCacheDirectory() {
+    QVERIFY(!SampleCache::isEnabled());
+    mzSample parsed;
+    parsed.loadSample(loadFile);
+
+    // caches are written to the directory instead of next to the sample
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    SampleCache::setDirectory(cacheDir.path().toStdString());
+    SampleCache::setEnabled(true);
+    string cacheFile = SampleCache::cachePath(loadFile);
+    QVERIFY(QFileInfo(QString::fromStdString(cacheFile)).absolutePath()
+            == QDir(cacheDir.path()).absolutePath());
+    QVERIFY(cacheFile != SampleCache::cachePath("other/"
+                                                + QFileInfo(loadFile)
+                                                      .fileName()
+                                                      .toStdString()));
+    mzSample written;
+    written.loadSample(loadFile);
+    QVERIFY(mzUtils::fileExists(cacheFile));
+    QVERIFY(!mzUtils::fileExists(string(loadFile) + ".mzcache"));
+    mzSample cached;
+    QVERIFY(SampleCache::read(&cached, loadFile));
+    QVERIFY(sameScans(parsed, cached));
+
+    // a directory that can not be written to, even by root, since its
+    // parent is a file: samples are parsed and nothing is written
+    QTemporaryFile parentFile;
+    QVERIFY(parentFile.open());
+    string unwritable = parentFile.fileName().toStdString() + "/cache";
+    SampleCache::setDirectory(unwritable);
+    string unwritableCache = SampleCache::cachePath(loadFile);
+    for (int i = 0; i < 2; i++) {
+        mzSample loaded;
+        loaded.loadSample(loadFile);
+        QVERIFY(sameScans(parsed, loaded));
+        QVERIFY(!mzUtils::fileExists(unwritableCache));
+        QVERIFY(!mzUtils::fileExists(unwritableCache + ".tmp"));
+    }
+
+    SampleCache::setDirectory("");
+    SampleCache::setEnabled(false);
+    QVERIFY(SampleCache::cachePath(loadFile) == string(loadFile) + ".mzcache");
+}
+
+void TestLoadSamples::testLazyFragmentationScans() {
+    bool wasLazy = mzSample::getLazyFragmentationScans();
+    unsigned int cacheSize = mzSample::getScanPeaksCacheSize();
+
+    QStringList files = QStringList() << loadFile << "bin/methods/ms2test1.mzML";
+    for (QString file : files) {
+        mzSample::setLazyFragmentationScans(false);
+        mzSample loaded;
+        loaded.loadSample(file.toLatin1().data());
+
+        mzSample::setLazyFragmentationScans(true);
+        mzSample::setScanPeaksCacheSize(4);
+        mzSample lazy;
+        lazy.loadSample(file.toLatin1().data());
+        QVERIFY(lazy.scans.size() == loaded.scans.size());
+
+        vector<bool> released(lazy.scans.size(), false);
+        for (unsigned int i = 0; i < lazy.scans.size(); i++) {
+            Scan* scan = lazy.scans[i];
+            if (!scan->peaksReleased())
+                continue;
+            released[i] = true;
+            QVERIFY(scan->mslevel > 1);
+            QVERIFY(scan->fileSeekStart >= 0);
+            QVERIFY(scan->totalIntensity() == loaded.scans[i]->totalIntensity());
+        }
+
+        // peaks read again are the ones parsed, at most 4 of them are kept
+        for (unsigned int i = 0; i < lazy.scans.size(); i++) {
+            Scan* scan = lazy.scans[i];
+            QVERIFY(lazy.loadScanPeaks(scan));
+            QVERIFY(scan->mz == loaded.scans[i]->mz);
+            QVERIFY(scan->intensity == loaded.scans[i]->intensity);
+        }
+        unsigned int resident = 0;
+        for (unsigned int i = 0; i < lazy.scans.size(); i++) {
+            if (released[i] && !lazy.scans[i]->peaksReleased())
+                resident++;
+        }
+        QVERIFY(resident <= 4);
+    }
+
+    mzSample::setLazyFragmentationScans(wasLazy);
+    mzSample::setScanPeaksCacheSize(cacheSize);
+}
+
+void TestLoadSamples::testLazyFragmentationReaders() {
+    bool wasLazy = mzSample::getLazyFragmentationScans();
+    unsigned int cacheSize = mzSample::getScanPeaksCacheSize();
+
+    string file = QDir::temp().filePath("lazy_dda.mzML").toStdString();
+    writeDdaSample(QString::fromStdString(file));
+
+    mzSample::setLazyFragmentationScans(false);
+    mzSample loaded;
+    loaded.loadSample(file.c_str());
+
+    mzSample::setLazyFragmentationScans(true);
+    mzSample::setScanPeaksCacheSize(4);
+    mzSample lazy;
+    lazy.loadSample(file.c_str());
+    QVERIFY(lazy.fragmentationScans().size() == 60);
+    for (Scan* scan : lazy.fragmentationScans())
+        QVERIFY(scan->peaksReleased());
+
+    // each EIC reads the 20 fragmentation scans of its precursor, many more
+    // than the scans kept in memory
+    const vector<Scan*>& fragmentationScans = loaded.fragmentationScans();
+    for (unsigned int i = 0; i < 3; i++) {
+        Scan* scan = fragmentationScans[i];
+        vector<int> positions = scan->intensityOrderDesc();
+        float productMz = scan->mz[positions[0]];
+        for (int eicType : {EIC::MAX, EIC::SUM}) {
+            EIC* expected = loaded.getEIC(scan->precursorMz,
+                                          scan->collisionEnergy,
+                                          productMz,
+                                          eicType,
+                                          "",
+                                          0.5,
+                                          0.5);
+            EIC* eic = lazy.getEIC(scan->precursorMz,
+                                   scan->collisionEnergy,
+                                   productMz,
+                                   eicType,
+                                   "",
+                                   0.5,
+                                   0.5);
+            QVERIFY(eic->size() == 20);
+            QVERIFY(eic->rt == expected->rt);
+            QVERIFY(eic->mz == expected->mz);
+            QVERIFY(eic->intensity == expected->intensity);
+            delete expected;
+            delete eic;
+        }
+    }
+
+    // averaged and base peak spectra of all fragmentation scans
+    Scan* expected = loaded.getAverageScan(loaded.minRt,
+                                           loaded.maxRt,
+                                           2,
+                                           1,
+                                           100);
+    Scan* average = lazy.getAverageScan(lazy.minRt, lazy.maxRt, 2, 1, 100);
+    QVERIFY(average->nobs() > 0);
+    QVERIFY(average->mz == expected->mz);
+    QVERIFY(average->intensity == expected->intensity);
+    delete expected;
+    delete average;
+
+    EIC* expectedBic = loaded.getBIC(loaded.minRt, loaded.maxRt, 2);
+    EIC* bic = lazy.getBIC(lazy.minRt, lazy.maxRt, 2);
+    QVERIFY(bic->size() == 60);
+    QVERIFY(bic->mz == expectedBic->mz);
+    QVERIFY(bic->intensity == expectedBic->intensity);
+    delete expectedBic;
+    delete bic;
+
+    unsigned int resident = 0;
+    for (Scan* scan : lazy.fragmentationScans()) {
+        if (!scan->peaksReleased())
+            resident++;
+    }
+    QVERIFY(resident <= 4);
+
+    QFile::remove(QString::fromStdString(file));
+    mzSample::setLazyFragmentationScans(wasLazy);
+    mzSample::setScanPeaksCacheSize(cacheSize);
+}
+
+void TestLoadSamples::benchmarkSampleLoading_data() {
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("streamed");
+
+    QStringList files = QStringList() << "bin/methods/testsample_1.mzxml"
+                                      << "bin/methods/ms2test1.mzML";
+    for (QString file : files) {
+        QTest::newRow(qPrintable(QString("stream %1").arg(file)))
+            << file << true;
+        QTest::newRow(qPrintable(QString("document %1").arg(file)))
+            << file << false;
+    }
+}
+
+void TestLoadSamples::benchmarkCachedSampleLoading_data() {
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("cached");
+
+    QStringList files = QStringList() << "bin/methods/testsample_1.mzxml"
+                                      << "bin/methods/ms2test1.mzML";
+    for (QString file : files) {
+        QTest::newRow(qPrintable(QString("parsed %1").arg(file)))
+            << file << false;
+        QTest::newRow(qPrintable(QString("cached %1").arg(file)))
+            << file << true;
+    }
+}
+
+void TestLoadSamples::benchmarkCachedSampleLoading() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(QString, fileName);
+    QFETCH(bool, cached);
+
+    string file = fileName.toStdString();
+    remove(SampleCache::cachePath(file).c_str());
+    SampleCache::setEnabled(cached);
+    if (cached) {
+        mzSample sample;
+        sample.loadSample(file.c_str());
+    }
+
+    SampleCache::setEnabled(cached);
+    unsigned int scanCount = 0;
+    QBENCHMARK {
+        mzSample sample;
+        sample.loadSample(file.c_str());
+        scanCount = sample.scanCount();
+    }
+    SampleCache::setEnabled(false);
+
+    remove(SampleCache::cachePath(file).c_str());
+    QVERIFY(scanCount > 0);
+}
+
+void TestLoadSamples::benchmarkSampleLoading() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(QString, fileName);
+    QFETCH(bool, streamed);
+
+    string file = fileName.toStdString();
+    bool mzML = file.find("mzML") != string::npos;
+
+    pugi::allocation_function allocate = pugi::get_memory_allocation_function();
+    pugi::deallocation_function deallocate =
+        pugi::get_memory_deallocation_function();
+    pugi::set_memory_management_functions(trackedAllocate, trackedDeallocate);
+    xmlMemory = 0;
+    peakXmlMemory = 0;
+
+    unsigned int scanCount = 0;
+    QBENCHMARK {
+        mzSample sample;
+        if (mzML && streamed)
+            sample.parseMzML(file.c_str());
+        else if (mzML)
+            sample.parseMzMLDocument(file.c_str());
+        else if (streamed)
+            sample.parseMzXML(file.c_str());
+        else
+            sample.parseMzXMLDocument(file.c_str());
+        scanCount = sample.scanCount();
+    }
+
+    pugi::set_memory_management_functions(allocate, deallocate);
+    qDebug() << "peak XML memory (KB):" << peakXmlMemory / 1024;
+    QVERIFY(scanCount > 0);
+}
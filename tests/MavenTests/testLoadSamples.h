@@ -35,6 +35,15 @@ class TestLoadSamples : public QObject {
         void testSampleName();
         void testBlankSample();
         void testParseMzMLInjectionTimeStamp();
+        void testStreamingParser();
+        void testSampleCache();
+        void testSampleCacheDirectory();
+        void testLazyFragmentationScans();
+        void testLazyFragmentationReaders();
+        void benchmarkSampleLoading_data();
+        void benchmarkSampleLoading();
+        void benchmarkCachedSampleLoading_data();
+        void benchmarkCachedSampleLoading();
 };
 
 #endif // TESTLOADSAMPLES_H
\ No newline at end of file
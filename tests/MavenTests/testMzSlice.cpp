@@ -1,5 +1,85 @@
 #include "testMzSlice.h"
 
+namespace {
+    // slices made the way algorithmB made them before slicing on a grid:
+    // every observation is looked up among the slices created in its 0.1 Da
+    // m/z bin, using the default filters of MassSlices
+    vector<mzSlice*> baselineSlices(const vector<mzSample*>& samples,
+                                    MassCutoff* massCutoff,
+                                    int rtStep) {
+        float rtWindow = 2.0;
+        if (samples.size() > 0 && rtStep > 0)
+            rtWindow = samples[0]->getAverageFullScanTime() * rtStep;
+
+        vector<mzSlice*> slices;
+        multimap<int, mzSlice*> cache;
+        for (auto sample : samples) {
+            for (auto scan : sample->scansForMsLevel(1)) {
+                float rt = scan->rt;
+                if (!isBetweenInclusive(rt, FLT_MIN, FLT_MAX))
+                    continue;
+                for (unsigned int k = 0; k < scan->nobs(); k++) {
+                    float mz = scan->mz[k];
+                    float intensity = scan->intensity[k];
+                    if (!isBetweenInclusive(mz, FLT_MIN, FLT_MAX)
+                        || !isBetweenInclusive(intensity,
+                                                        FLT_MIN,
+                                                        FLT_MAX))
+                        continue;
+
+                    float cutoff = massCutoff->massCutoffValue(mz);
+                    float mzmin = mz - cutoff;
+                    float mzmax = mz + cutoff;
+
+                    mzSlice* Z = nullptr;
+                    float bestDist = FLT_MAX;
+                    auto range = cache.equal_range((int) (mz * 10));
+                    for (auto it = range.first; it != range.second; ++it) {
+                        mzSlice* x = it->second;
+                        if (mz > x->mzmin && mz < x->mzmax
+                            && rt > x->rtmin && rt < x->rtmax) {
+                            float d = (mz - x->mzmin) + (x->mzmax - mz);
+                            if (d < bestDist) {
+                                Z = x;
+                                bestDist = d;
+                            }
+                        }
+                    }
+
+                    if (Z) {
+                        Z->ionCount = std::max((float) Z->ionCount, intensity);
+                        Z->rtmax = std::max((float) Z->rtmax, rt + 2 * rtWindow);
+                        Z->rtmin = std::min((float) Z->rtmin, rt - 2 * rtWindow);
+                        Z->mzmax = std::max((float) Z->mzmax, mzmax);
+                        Z->mzmin = std::min((float) Z->mzmin, mzmin);
+                        if (Z->mzmin < mzmin) Z->mzmin = mzmin;
+                        if (Z->mzmax > mzmax) Z->mzmax = mzmax;
+                        Z->mz = (Z->mzmin + Z->mzmax) / 2;
+                        Z->rt = (Z->rtmin + Z->rtmax) / 2;
+                    } else {
+                        mzSlice* s = new mzSlice(mzmin,
+                                                 mzmax,
+                                                 rt - 2 * rtWindow,
+                                                 rt + 2 * rtWindow);
+                        s->ionCount = intensity;
+                        s->rt = rt;
+                        s->mz = mz;
+                        slices.push_back(s);
+                        cache.insert(make_pair((int) (mz * 10), s));
+                    }
+                }
+            }
+        }
+        return slices;
+    }
+
+    bool compBounds(const mzSlice* a, const mzSlice* b) {
+        if (a->mzmin != b->mzmin)
+            return a->mzmin < b->mzmin;
+        return a->rtmin < b->rtmin;
+    }
+}
+
 TestMzSlice::TestMzSlice() {
 
 }
@@ -135,5 +215,205 @@ void TestMzSlice::testcalculateRTMinMaxWithRTandDisabled() {
     TestUtils::floatCompare(slice->rtmax,1e9));
 }
 
+void TestMzSlice::testMassSliceGrid() {
+    srand(1);
+    MassSliceGrid grid(2.0f);
+    vector<mzSlice*> slices;
+    for (int i = 0; i < 2000; i++) {
+        float mz = 100.0f + 5.0f * rand() / RAND_MAX;
+        float rt = 20.0f * rand() / RAND_MAX;
+        mzSlice* slice = new mzSlice(mz - 0.005f, mz + 0.005f, rt - 1.0f, rt + 1.0f);
+        slice->mz = mz;
+        grid.insert(slice);
+        slices.push_back(slice);
+    }
+
+    // widen a few slices in RT after they were registered
+    for (int i = 0; i < 2000; i += 10) {
+        slices[i]->rtmax += 3.0f;
+        grid.extend(i);
+    }
+
+    for (int i = 0; i < 5000; i++) {
+        float mz = 100.0f + 5.0f * rand() / RAND_MAX;
+        float rt = 25.0f * rand() / RAND_MAX;
+
+        // the narrowest enclosing slice, the first registered of equals
+        float bestDist = FLT_MAX;
+        int best = -1;
+        for (unsigned int j = 0; j < slices.size(); j++) {
+            mzSlice* x = slices[j];
+            if ((int) (x->mz * 10) != (int) (mz * 10))
+                continue;
+            if (mz > x->mzmin && mz < x->mzmax && rt > x->rtmin && rt < x->rtmax) {
+                float d = (mz - x->mzmin) + (x->mzmax - mz);
+                if (d < bestDist) { best = j; bestDist = d; }
+            }
+        }
+
+        int found = grid.find(mz, rt);
+        QCOMPARE(found, best);
+        if (best >= 0)
+            QVERIFY(grid.slice(found) == slices[best]);
+    }
+    delete_all(slices);
+}
+
+void TestMzSlice::testAlgorithmB() {
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->samples = maventests::samples.ms1TestSamples;
+
+    MassSlices massSlices;
+    massSlices.setSamples(mavenparameters->samples);
+    massSlices.setMavenParameters(mavenparameters);
+    massSlices.algorithmB(mavenparameters->massCutoffMerge,
+                          mavenparameters->rtStepSize);
+    QVERIFY(massSlices.slices.size() > 0);
+
+    vector<mzSlice> firstRun;
+    for (auto slice : massSlices.slices) {
+        float cutoff = mavenparameters->massCutoffMerge->massCutoffValue(slice->mz);
+        QVERIFY(slice->mzmin <= slice->mz && slice->mz <= slice->mzmax);
+        QVERIFY(slice->rtmin < slice->rtmax);
+        QVERIFY(slice->mzmax - slice->mzmin <= 2 * cutoff * 1.01);
+        firstRun.push_back(*slice);
+    }
+
+    // slicing again gives the same slices
+    massSlices.algorithmB(mavenparameters->massCutoffMerge,
+                          mavenparameters->rtStepSize);
+    QVERIFY(massSlices.slices.size() == firstRun.size());
+    for (unsigned int i = 0; i < firstRun.size(); i++) {
+        QVERIFY(massSlices.slices[i]->mzmin == firstRun[i].mzmin);
+        QVERIFY(massSlices.slices[i]->mzmax == firstRun[i].mzmax);
+        QVERIFY(massSlices.slices[i]->rtmin == firstRun[i].rtmin);
+        QVERIFY(massSlices.slices[i]->rtmax == firstRun[i].rtmax);
+    }
+}
+
+void TestMzSlice::testAlgorithmBMatchesBaseline() {
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->samples = maventests::samples.ms1TestSamples;
+
+    // samples are filtered in parallel and merged in order, so the slices
+    // are the same whatever the number of threads
+    int maxThreads = omp_get_max_threads();
+    QStringList types = QStringList() << "ppm" << "mDa";
+    for (int threads : {1, 4}) {
+        for (QString type : types) {
+            MassCutoff massCutoff;
+            massCutoff.setMassCutoffAndType(type == "ppm" ? 20 : 10,
+                                            type.toStdString());
+
+            omp_set_num_threads(threads);
+            MassSlices massSlices;
+            massSlices.setSamples(mavenparameters->samples);
+            massSlices.setMavenParameters(mavenparameters);
+            massSlices.algorithmB(&massCutoff, mavenparameters->rtStepSize);
+            omp_set_num_threads(maxThreads);
+
+            MassSlices baseline;
+            baseline.setSamples(mavenparameters->samples);
+            baseline.setMavenParameters(mavenparameters);
+            baseline.slices = baselineSlices(mavenparameters->samples,
+                                             &massCutoff,
+                                             mavenparameters->rtStepSize);
+            baseline.removeDuplicateSlices(&massCutoff, 100);
+
+            vector<mzSlice*> slices = massSlices.slices;
+            vector<mzSlice*> expected = baseline.slices;
+            sort(slices.begin(), slices.end(), compBounds);
+            sort(expected.begin(), expected.end(), compBounds);
+            QVERIFY(slices.size() > 0);
+            QVERIFY(slices.size() == expected.size());
+            for (unsigned int i = 0; i < slices.size(); i++) {
+                mzSlice* a = slices[i];
+                mzSlice* b = expected[i];
+                QVERIFY(abs(a->mzmin - b->mzmin) <= 1e-6 * b->mz);
+                QVERIFY(abs(a->mzmax - b->mzmax) <= 1e-6 * b->mz);
+                QVERIFY(a->rtmin == b->rtmin);
+                QVERIFY(a->rtmax == b->rtmax);
+                QVERIFY(a->ionCount == b->ionCount);
+            }
+        }
+    }
+}
+
+void TestMzSlice::testTypedAlgorithmB() {
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->samples = maventests::samples.ms1TestSamples;
+
+    // slices from the ppm and mDa specialized kernels must match slices from
+    // the kernel asking the mass cutoff for every window
+    QStringList types = QStringList() << "ppm" << "mDa";
+    for (QString type : types) {
+        MassCutoff massCutoff;
+        massCutoff.setMassCutoffAndType(type == "ppm" ? 20 : 10,
+                                        type.toStdString());
+
+        MassSlices typedSlices;
+        typedSlices.setSamples(mavenparameters->samples);
+        typedSlices.setMavenParameters(mavenparameters);
+        typedSlices.algorithmB(&massCutoff, mavenparameters->rtStepSize);
+
+        MassSlices dynamicSlices;
+        dynamicSlices.setSamples(mavenparameters->samples);
+        dynamicSlices.setMavenParameters(mavenparameters);
+        dynamicSlices.algorithmB(&massCutoff,
+                                 masstolerance::Dynamic(&massCutoff),
+                                 mavenparameters->rtStepSize);
+
+        QVERIFY(typedSlices.slices.size() > 0);
+        QVERIFY(typedSlices.slices.size() == dynamicSlices.slices.size());
+        for (unsigned int i = 0; i < typedSlices.slices.size(); i++) {
+            mzSlice* a = typedSlices.slices[i];
+            mzSlice* b = dynamicSlices.slices[i];
+            QVERIFY(abs(a->mzmin - b->mzmin) < 1e-4);
+            QVERIFY(abs(a->mzmax - b->mzmax) < 1e-4);
+            QVERIFY(a->rtmin == b->rtmin);
+            QVERIFY(a->rtmax == b->rtmax);
+        }
+    }
+}
+
+void TestMzSlice::benchmarkAlgorithmB_data() {
+    QTest::addColumn<QString>("massCutoffType");
+    QTest::addColumn<bool>("typed");
+
+    QStringList types = QStringList() << "ppm" << "mDa";
+    for (QString type : types) {
+        QTest::newRow(qPrintable(QString("dynamic %1").arg(type)))
+            << type << false;
+        QTest::newRow(qPrintable(QString("typed %1").arg(type)))
+            << type << true;
+    }
+}
 
+void TestMzSlice::benchmarkAlgorithmB() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(QString, massCutoffType);
+    QFETCH(bool, typed);
 
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->samples = maventests::samples.ms1TestSamples;
+    MassCutoff massCutoff;
+    massCutoff.setMassCutoffAndType(massCutoffType == "ppm" ? 20 : 10,
+                                    massCutoffType.toStdString());
+
+    MassSlices massSlices;
+    massSlices.setSamples(mavenparameters->samples);
+    massSlices.setMavenParameters(mavenparameters);
+
+    // the dynamic kernel asks the mass cutoff for the window of every
+    // observation, the typed kernel computes it inline
+    QBENCHMARK {
+        if (typed) {
+            massSlices.algorithmB(&massCutoff, mavenparameters->rtStepSize);
+        } else {
+            massSlices.algorithmB(&massCutoff,
+                                  masstolerance::Dynamic(&massCutoff),
+                                  mavenparameters->rtStepSize);
+        }
+    }
+    QVERIFY(massSlices.slices.size() > 0);
+}
@@ -7,6 +7,7 @@
 #include "utilities.h"
 #include "mzSample.h"
 #include "mavenparameters.h"
+#include "mzMassSlicer.h"
 
 class TestMzSlice : public QObject {
     Q_OBJECT
@@ -33,6 +34,12 @@ class TestMzSlice : public QObject {
         void testcalculateRTMinMaxWithNORTandEnabled();
         void testcalculateRTMinMaxWithNORTandDisabled();
         void testcalculateRTMinMaxWithRTandDisabled();
+        void testMassSliceGrid();
+        void testAlgorithmB();
+        void testAlgorithmBMatchesBaseline();
+        void testTypedAlgorithmB();
+        void benchmarkAlgorithmB_data();
+        void benchmarkAlgorithmB();
 };
 
 #endif // TESTMZSLICE_H
@@ -87,3 +87,351 @@ void TestPeakDetection::testprocessSlices() {
     QVERIFY(allgroups.size() > 0);
 
 }
+
+void TestPeakDetection::testProcessSlicesParallel() {
+    maventests::database.loadCompoundCSVFile(loadCompoundDB);
+    vector<Compound*> compounds =
+        maventests::database.getCompoundsSubset("qe3_v11_2016_04_29");
+
+    vector<mzSample*> samplesToLoad;
+    MavenParameters* mavenparameters = new MavenParameters();
+    TestUtils::loadSamplesAndParameters(samplesToLoad, mavenparameters);
+
+    PeakDetector peakDetector;
+    peakDetector.setMavenParameters(mavenparameters);
+    vector<mzSlice*> slices =
+        peakDetector.processCompounds(compounds, "compounds");
+
+    mavenparameters->peakDetectionThreads = 1;
+    peakDetector.processSlices(slices, "compounds");
+    vector<PeakGroup> serialGroups = mavenparameters->allgroups;
+
+    mavenparameters->peakDetectionThreads = 4;
+    peakDetector.processSlices(slices, "compounds");
+    vector<PeakGroup> parallelGroups = mavenparameters->allgroups;
+
+    QVERIFY(serialGroups.size() > 0);
+    QVERIFY(serialGroups.size() == parallelGroups.size());
+    for (unsigned int i = 0; i < serialGroups.size(); i++) {
+        QVERIFY(serialGroups[i].compound == parallelGroups[i].compound);
+        QVERIFY(serialGroups[i].meanMz == parallelGroups[i].meanMz);
+        QVERIFY(serialGroups[i].meanRt == parallelGroups[i].meanRt);
+        QVERIFY(serialGroups[i].peakCount() == parallelGroups[i].peakCount());
+        for (unsigned int j = 0; j < serialGroups[i].peakCount(); j++) {
+            QVERIFY(serialGroups[i].peaks[j].getSample()
+                    == parallelGroups[i].peaks[j].getSample());
+            QVERIFY(serialGroups[i].peaks[j].peakAreaCorrected
+                    == parallelGroups[i].peaks[j].peakAreaCorrected);
+        }
+    }
+}
+
+vector<TestPeakDetection::GroupExtent>
+TestPeakDetection::makeGroupExtents(int count, unsigned int seed) {
+    srand(seed);
+    vector<GroupExtent> groups;
+    groups.reserve(count);
+    for (int i = 0; i < count; i++) {
+        GroupExtent group;
+        group.mz = 100.0f + 1100.0f * rand() / RAND_MAX;
+        group.rtmin = 30.0f * rand() / RAND_MAX;
+        group.rtmax = group.rtmin + 0.05f + 0.5f * rand() / RAND_MAX;
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+bool TestPeakDetection::linearOverlap(const vector<GroupExtent>& groups,
+                                      const GroupExtent& query,
+                                      MassCutoff* massCutoff) {
+    for (const GroupExtent& group : groups) {
+        float rtoverlap = mzUtils::checkOverlap(query.rtmin,
+                                                query.rtmax,
+                                                group.rtmin,
+                                                group.rtmax);
+        if (rtoverlap > 0.9
+            && mzUtils::massCutoffDist(group.mz, query.mz, massCutoff)
+                   < massCutoff->getMassCutoff())
+            return true;
+    }
+    return false;
+}
+
+void TestPeakDetection::testGroupIndex() {
+    MassCutoff ppmCutoff;
+    ppmCutoff.setMassCutoffAndType(30, "ppm");
+    MassCutoff mDaCutoff;
+    mDaCutoff.setMassCutoffAndType(25, "mDa");
+
+    vector<GroupExtent> groups = makeGroupExtents(20000, 1);
+    GroupIndex index;
+    for (const GroupExtent& group : groups)
+        index.insert(group.mz, group.rtmin, group.rtmax);
+    QVERIFY(index.size() == groups.size());
+
+    vector<GroupExtent> queries = makeGroupExtents(2000, 2);
+    // queries at the very edge of the mass window of stored groups
+    for (unsigned int i = 0; i < 500; i++) {
+        GroupExtent query = groups[i];
+        query.mz += ppmCutoff.massCutoffValue(query.mz) * (i % 2 ? 0.999 : 1.001);
+        queries.push_back(query);
+    }
+
+    for (const GroupExtent& query : queries) {
+        QVERIFY(index.hasOverlap(query.mz, query.rtmin, query.rtmax, &ppmCutoff, 0.9)
+                == linearOverlap(groups, query, &ppmCutoff));
+        QVERIFY(index.hasOverlap(query.mz, query.rtmin, query.rtmax, &mDaCutoff, 0.9)
+                == linearOverlap(groups, query, &mDaCutoff));
+    }
+
+    index.clear();
+    QVERIFY(index.size() == 0);
+    QVERIFY(!index.hasOverlap(groups[0].mz,
+                              groups[0].rtmin,
+                              groups[0].rtmax,
+                              &ppmCutoff,
+                              0.9));
+}
+
+void TestPeakDetection::benchmarkGroupOverlap_data() {
+    QTest::addColumn<int>("groupCount");
+    QTest::addColumn<bool>("indexed");
+
+    QList<int> counts = QList<int>() << 10000 << 100000 << 1000000;
+    for (int count : counts) {
+        QTest::newRow(qPrintable(QString("linear %1").arg(count)))
+            << count << false;
+        QTest::newRow(qPrintable(QString("indexed %1").arg(count)))
+            << count << true;
+    }
+}
+
+void TestPeakDetection::benchmarkGroupOverlap() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, groupCount);
+    QFETCH(bool, indexed);
+
+    MassCutoff massCutoff;
+    massCutoff.setMassCutoffAndType(30, "ppm");
+
+    // the cost of adding N groups is N times the cost of one overlap query
+    // against the groups found so far, so a fixed number of queries against
+    // N stored groups is timed for both paths
+    vector<GroupExtent> groups = makeGroupExtents(groupCount, 1);
+    vector<GroupExtent> queries = makeGroupExtents(100, 2);
+    GroupIndex index;
+    for (const GroupExtent& group : groups)
+        index.insert(group.mz, group.rtmin, group.rtmax);
+
+    int overlaps = 0;
+    QBENCHMARK {
+        for (const GroupExtent& query : queries) {
+            if (indexed) {
+                overlaps += index.hasOverlap(query.mz,
+                                             query.rtmin,
+                                             query.rtmax,
+                                             &massCutoff,
+                                             0.9);
+            } else {
+                overlaps += linearOverlap(groups, query, &massCutoff);
+            }
+        }
+    }
+    QVERIFY(overlaps >= 0);
+}
+
+vector<EIC*> TestPeakDetection::pullTestEICs(MavenParameters* mavenparameters)
+{
+    vector<mzSample*> samplesToLoad;
+    for (int i = 0; i <  files.size(); ++i) {
+        mzSample* mzsample = new mzSample();
+        mzsample->loadSample(files.at(i).toLatin1().data());
+        samplesToLoad.push_back(mzsample);
+    }
+
+    mavenparameters->compoundMassCutoffWindow->setMassCutoffAndType(10,"ppm");
+    mavenparameters->samples = samplesToLoad;
+    mavenparameters->eic_smoothingWindow = 10;
+    mavenparameters->eic_smoothingAlgorithm = 1;
+    mavenparameters->amuQ1 = 0.25;
+    mavenparameters->amuQ3 = 0.30;
+    mavenparameters->aslsBaselineMode = false;
+    mavenparameters->baseline_smoothingWindow = 5;
+    mavenparameters->baseline_dropTopX = 80;
+
+    vector<EIC*> eics;
+    vector<Compound*> compounds = TestUtils::getCompoudDataBaseWithRT();
+    for (Compound* compound : compounds) {
+        mzSlice* slice = new mzSlice();
+        slice->compound = compound;
+        slice->calculateRTMinMax(true, 2);
+        slice->calculateMzMinMax(mavenparameters->compoundMassCutoffWindow, +1);
+        vector<EIC*> sliceEics = PeakDetector::pullEICs(slice,
+                                                        mavenparameters->samples,
+                                                        mavenparameters);
+        eics.insert(eics.end(), sliceEics.begin(), sliceEics.end());
+        delete slice;
+    }
+    return eics;
+}
+
+void TestPeakDetection::testScorePeaksBatch() {
+    MavenParameters* mavenparameters = new MavenParameters();
+    vector<EIC*> eics = pullTestEICs(mavenparameters);
+
+    ClassifierNeuralNet clsf;
+    clsf.loadModel("bin/default.model");
+    QVERIFY(clsf.hasModel());
+
+    vector<float> expected;
+    for (EIC* eic : eics) {
+        for (Peak& peak : eic->peaks)
+            expected.push_back(clsf.scorePeak(peak));
+    }
+    QVERIFY(expected.size() > 0);
+
+    //batched scores are identical to the per-peak ones
+    clsf.scoreEICs(eics);
+    unsigned int i = 0;
+    for (EIC* eic : eics) {
+        for (Peak& peak : eic->peaks)
+            QVERIFY(peak.quality == expected[i++]);
+    }
+
+    //without a model every peak gets the default score
+    ClassifierNeuralNet empty;
+    empty.scoreEICs(eics);
+    for (EIC* eic : eics) {
+        for (Peak& peak : eic->peaks)
+            QVERIFY(TestUtils::floatCompare(peak.quality, 0.1));
+    }
+
+    delete_all(eics);
+    delete_all(mavenparameters->samples);
+    delete mavenparameters;
+}
+
+void TestPeakDetection::benchmarkScorePeaks_data() {
+    QTest::addColumn<int>("peakCount");
+    QTest::addColumn<bool>("batched");
+
+    QList<int> counts = QList<int>() << 1000 << 100000;
+    for (int count : counts) {
+        QTest::newRow(qPrintable(QString("per-peak %1").arg(count)))
+            << count << false;
+        QTest::newRow(qPrintable(QString("batched %1").arg(count)))
+            << count << true;
+    }
+}
+
+void TestPeakDetection::benchmarkScorePeaks() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, peakCount);
+    QFETCH(bool, batched);
+
+    ClassifierNeuralNet clsf;
+    clsf.loadModel("bin/default.model");
+
+    //synthetic peaks spanning the range of every feature
+    vector<Peak> peaks(peakCount);
+    for (int i = 0; i < peakCount; i++) {
+        Peak& peak = peaks[i];
+        peak.width = 1 + i % 20;
+        peak.peakAreaFractional = (i % 100) / 100.0;
+        peak.noNoiseFraction = (i % 50) / 50.0;
+        peak.symmetry = i % 10;
+        peak.groupOverlapFrac = (i % 7) / 7.0;
+        peak.gaussFitR2 = (i % 11) / 11.0;
+        peak.signalBaselineRatio = 1 + i % 30;
+        peak.peakRank = i % 15;
+        peak.peakIntensity = 1000 + 37 * i;
+    }
+    vector<Peak*> peakPointers;
+    for (Peak& peak : peaks)
+        peakPointers.push_back(&peak);
+
+    QBENCHMARK {
+        if (batched) {
+            clsf.scorePeaks(peakPointers);
+        } else {
+            for (Peak& peak : peaks)
+                peak.quality = clsf.scorePeak(peak);
+        }
+    }
+    QVERIFY(peaks[0].quality > 0);
+}
+
+void TestPeakDetection::testMovePeakGroup() {
+    vector<PeakGroup> groups = TestUtils::getGroupsFromProcessCompounds();
+    QVERIFY(groups.size() > 0);
+
+    PeakGroup group = groups[0];
+    PeakGroup child;
+    child.meanMz = group.meanMz + 1.00335;
+    group.addChild(child);
+    PeakGroup copy = group;
+
+    // a moved group equals its copy and owns the children it took over
+    PeakGroup moved(std::move(group));
+    QVERIFY(moved.meanMz == copy.meanMz);
+    QVERIFY(moved.compound == copy.compound);
+    QVERIFY(moved.peakCount() == copy.peakCount());
+    QVERIFY(moved.peakCount() > 0);
+    for (unsigned int i = 0; i < moved.peakCount(); i++) {
+        QVERIFY(moved.peaks[i].getSample() == copy.peaks[i].getSample());
+        QVERIFY(moved.peaks[i].peakAreaCorrected
+                == copy.peaks[i].peakAreaCorrected);
+    }
+    QVERIFY(moved.childCount() == 1);
+    QVERIFY(moved.children[0].parent == &moved);
+    QVERIFY(group.peakCount() == 0);
+    QVERIFY(group.childCount() == 0);
+
+    PeakGroup assigned;
+    assigned = std::move(moved);
+    QVERIFY(assigned.peakCount() == copy.peakCount());
+    QVERIFY(assigned.children[0].parent == &assigned);
+
+    // groups moved by a growing vector keep their children linked
+    vector<PeakGroup> grown;
+    for (int i = 0; i < 100; i++)
+        grown.push_back(copy);
+    for (PeakGroup& g : grown)
+        QVERIFY(g.children[0].parent == &g);
+
+    // copied fragments own their consensus and keep the annotations
+    Fragment fragment;
+    fragment.mzValues = {100.0f, 200.0f};
+    fragment.intensityValues = {10.0f, 20.0f};
+    fragment.annotations[0] = "precursor";
+    fragment.consensus = new Fragment(fragment);
+    Fragment fragmentCopy(fragment);
+    Fragment fragmentAssigned;
+    fragmentAssigned = fragment;
+    for (Fragment* f : {&fragmentCopy, &fragmentAssigned}) {
+        QVERIFY(f->mzValues == fragment.mzValues);
+        QVERIFY(f->annotations == fragment.annotations);
+        QVERIFY(f->consensus != nullptr);
+        QVERIFY(f->consensus != fragment.consensus);
+        QVERIFY(f->consensus->mzValues == fragment.consensus->mzValues);
+    }
+}
+
+void TestPeakDetection::benchmarkProcessMassSlices() {
+    SKIP_UNLESS_BENCHMARKING();
+    vector<mzSample*> samplesToLoad;
+    MavenParameters* mavenparameters = new MavenParameters();
+    TestUtils::loadSamplesAndParameters(samplesToLoad, mavenparameters);
+
+    PeakDetector peakDetector;
+    peakDetector.setMavenParameters(mavenparameters);
+
+    // a full untargeted run
+    QBENCHMARK {
+        peakDetector.processMassSlices();
+    }
+    QVERIFY(mavenparameters->allgroups.size() > 0);
+
+    delete_all(samplesToLoad);
+    delete mavenparameters;
+}
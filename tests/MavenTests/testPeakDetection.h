@@ -13,6 +13,7 @@
 #include "mavenparameters.h"
 #include "isotopeDetection.h"
 #include "classifierNeuralNet.h"
+#include "datastructures/groupindex.h"
 
 class TestPeakDetection : public QObject {
     Q_OBJECT
@@ -24,6 +25,17 @@ class TestPeakDetection : public QObject {
         const char* loadCompoundDB1;
         QStringList files;
 
+        struct GroupExtent {
+            float mz;
+            float rtmin;
+            float rtmax;
+        };
+        vector<GroupExtent> makeGroupExtents(int count, unsigned int seed);
+        vector<EIC*> pullTestEICs(MavenParameters* mavenparameters);
+        bool linearOverlap(const vector<GroupExtent>& groups,
+                           const GroupExtent& query,
+                           MassCutoff* massCutoff);
+
     private Q_SLOTS:
         // functions executed by QtTest before and after tuest suite
         void initTestCase();
@@ -38,6 +50,15 @@ class TestPeakDetection : public QObject {
         void testProcessCompound();
         void testPullEICs();
         void testprocessSlices();
+        void testProcessSlicesParallel();
+        void testGroupIndex();
+        void benchmarkGroupOverlap_data();
+        void benchmarkGroupOverlap();
+        void testScorePeaksBatch();
+        void benchmarkScorePeaks_data();
+        void benchmarkScorePeaks();
+        void testMovePeakGroup();
+        void benchmarkProcessMassSlices();
 };
 
 #endif // TESTPEAKDETECTION_H
@@ -0,0 +1,328 @@
+#include "testProjectDB.h"
+
+TestProjectDB::TestProjectDB() {
+
+}
+
+string TestProjectDB::projectFile(int groupCount) {
+    return "testProjectDB_" + to_string(groupCount) + ".emDB";
+}
+
+void TestProjectDB::writeProject(int groupCount, bool bulk) {
+    string filename = projectFile(groupCount);
+    remove(filename.c_str());
+
+    ProjectDatabase project(filename, "v0.10.0");
+    if (bulk)
+        project.beginBulkSave();
+    project.saveSamples(samples);
+
+    // every group is linked to its own compound and has one peak per
+    // sample, every tenth group also has a child group
+    set<Compound*> compounds;
+    vector<PeakGroup*> groups;
+    for (int i = 0; i < groupCount; i++) {
+        Compound* compound = new Compound("C" + to_string(i),
+                                          "compound" + to_string(i),
+                                          i % 2 ? "C6H12O6" : "",
+                                          0);
+        compound->db = "testdb";
+        compound->expectedRt = i * 0.01f;
+        compound->category.push_back("test");
+        compounds.insert(compound);
+
+        PeakGroup* group = new PeakGroup();
+        group->compound = compound;
+        group->tagString = "group" + to_string(i);
+        group->expectedMz = 100 + i * 0.1f;
+        group->label = i % 2 ? 'g' : 'b';
+        group->fragMatchScore.mergedScore = i * 0.5;
+        for (auto sample : samples) {
+            Peak peak;
+            peak.setSample(sample);
+            peak.pos = i;
+            peak.rt = i * 0.01f;
+            peak.peakMz = 100 + i * 0.1f;
+            peak.peakIntensity = 1000 + i;
+            group->addPeak(peak);
+        }
+        if (i % 10 == 0) {
+            PeakGroup child;
+            child.tagString = "child" + to_string(i);
+            Peak peak;
+            peak.setSample(samples[0]);
+            child.addPeak(peak);
+            group->addChild(child);
+        }
+        groups.push_back(group);
+    }
+    project.saveCompounds(compounds);
+    project.saveGroups(groups, "test table");
+    if (bulk)
+        project.endBulkSave();
+
+    for (auto group : groups)
+        delete group;
+    for (auto compound : compounds)
+        delete compound;
+}
+
+void TestProjectDB::initTestCase() {
+    // This function is being executed at the beginning of each test suite
+    // That is - before other tests from this class run
+    for (int i = 0; i < 4; i++) {
+        mzSample* sample = new mzSample();
+        sample->sampleName = "sample" + to_string(i);
+        sample->fileName = "bin/methods/sample" + to_string(i) + ".mzXML";
+        samples.push_back(sample);
+    }
+    writeProject(10);
+}
+
+void TestProjectDB::cleanupTestCase() {
+    // Similarly to initTestCase(), this function is executed at the end of test suite
+    remove(projectFile(10).c_str());
+    for (auto sample : samples)
+        delete sample;
+    samples.clear();
+}
+
+void TestProjectDB::init() {
+    // This function is executed before each test
+}
+
+void TestProjectDB::cleanup() {
+    // This function is executed after each test
+}
+
+void TestProjectDB::testLoadGroups() {
+    ProjectDatabase project(projectFile(10), "v0.10.0");
+    vector<PeakGroup*> groups = project.loadGroups(samples);
+
+    QVERIFY(groups.size() == 10);
+    for (int i = 0; i < 10; i++) {
+        PeakGroup* group = groups[i];
+        QVERIFY(group->tagString == "group" + to_string(i));
+        QVERIFY(TestUtils::floatCompare(group->expectedMz, 100 + i * 0.1f));
+        QVERIFY(group->label == (i % 2 ? 'g' : 'b'));
+        QVERIFY(TestUtils::floatCompare(group->fragMatchScore.mergedScore,
+                                        i * 0.5));
+        QVERIFY(group->searchTableName == "test table");
+        QVERIFY(group->getCompound() != nullptr);
+        QVERIFY(group->getCompound()->id == "C" + to_string(i));
+
+        QVERIFY(group->peaks.size() == samples.size());
+        for (unsigned int s = 0; s < samples.size(); s++) {
+            Peak& peak = group->peaks[s];
+            QVERIFY(peak.getSample() == samples[s]);
+            QVERIFY(peak.pos == static_cast<unsigned int>(i));
+            QVERIFY(TestUtils::floatCompare(peak.peakIntensity, 1000 + i));
+        }
+
+        QVERIFY(group->children.size() == (i % 10 == 0 ? 1u : 0u));
+        for (auto& child : group->children) {
+            QVERIFY(child.tagString == "child" + to_string(i));
+            QVERIFY(child.peaks.size() == 1);
+        }
+    }
+
+    for (auto group : groups)
+        delete group;
+}
+
+void TestProjectDB::testLoadCompounds() {
+    ProjectDatabase project(projectFile(10), "v0.10.0");
+    vector<Compound*> compounds = project.loadCompounds("testdb");
+
+    QVERIFY(compounds.size() == 10);
+    for (auto compound : compounds) {
+        QVERIFY(compound->name == "compound" + compound->id.substr(1));
+        QVERIFY(compound->db == "testdb");
+        QVERIFY(compound->category.size() == 1);
+        QVERIFY(compound->category[0] == "test");
+    }
+
+    // compounds of a database are loaded only once
+    QVERIFY(project.loadCompounds("testdb").empty());
+
+    for (auto compound : compounds)
+        delete compound;
+}
+
+void TestProjectDB::benchmarkLoadProject_data() {
+    QTest::addColumn<int>("groupCount");
+
+    QList<int> counts = QList<int>() << 100 << 1000 << 5000;
+    for (int count : counts)
+        QTest::newRow(qPrintable(QString("%1 groups").arg(count))) << count;
+}
+
+void TestProjectDB::benchmarkLoadProject() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, groupCount);
+
+    writeProject(groupCount);
+
+    // compounds and groups are read the same way opening a project does
+    int loaded = 0;
+    QBENCHMARK {
+        ProjectDatabase project(projectFile(groupCount), "v0.10.0");
+        vector<Compound*> compounds = project.loadCompounds();
+        vector<PeakGroup*> groups = project.loadGroups(samples);
+        loaded = groups.size();
+        for (auto group : groups)
+            delete group;
+        for (auto compound : compounds)
+            delete compound;
+    }
+    QVERIFY(loaded == groupCount);
+
+    remove(projectFile(groupCount).c_str());
+}
+
+void TestProjectDB::testBulkSave() {
+    writeProject(20, true);
+
+    ProjectDatabase project(projectFile(20), "v0.10.0");
+    vector<PeakGroup*> groups = project.loadGroups(samples);
+    QVERIFY(groups.size() == 20);
+    for (int i = 0; i < 20; i++) {
+        QVERIFY(groups[i]->tagString == "group" + to_string(i));
+        QVERIFY(groups[i]->peaks.size() == samples.size());
+        QVERIFY(groups[i]->getCompound() != nullptr);
+    }
+
+    for (auto group : groups)
+        delete group;
+    remove(projectFile(20).c_str());
+}
+
+void TestProjectDB::testDeleteInBulkSave() {
+    writeProject(20, true);
+
+    // saved again the way an open project is, deleting everything in the
+    // same transaction the groups are written in
+    {
+        ProjectDatabase project(projectFile(20), "v0.10.0");
+        vector<PeakGroup*> groups = project.loadGroups(samples);
+        QVERIFY(groups.size() == 20);
+        set<Compound*> compounds;
+        for (auto group : groups)
+            compounds.insert(group->getCompound());
+
+        project.beginBulkSave();
+        project.deleteTableGroups("test table");
+        project.deleteAll();
+        project.saveSamples(samples);
+        project.saveCompounds(compounds);
+        project.saveGroups(groups, "test table");
+        project.deletePeakGroup(groups[0]);
+        project.endBulkSave();
+
+        for (auto group : groups)
+            delete group;
+    }
+
+    ProjectDatabase project(projectFile(20), "v0.10.0");
+    vector<PeakGroup*> groups = project.loadGroups(samples);
+    QVERIFY(groups.size() == 19);
+    for (int i = 1; i < 20; i++) {
+        PeakGroup* group = groups[i - 1];
+        QVERIFY(group->tagString == "group" + to_string(i));
+        QVERIFY(group->peaks.size() == samples.size());
+        QVERIFY(group->getCompound() != nullptr);
+        QVERIFY(group->getCompound()->id == "C" + to_string(i));
+        QVERIFY(group->children.size() == (i % 10 == 0 ? 1u : 0u));
+    }
+
+    for (auto group : groups)
+        delete group;
+    remove(projectFile(20).c_str());
+
+    // a deletion that fails inside a bulk save, here because there are no
+    // groups yet, only undoes its own changes
+    remove(projectFile(0).c_str());
+    {
+        ProjectDatabase newProject(projectFile(0), "v0.10.0");
+        Compound compound("C0", "compound0", "C6H12O6", 0);
+        compound.db = "testdb";
+        newProject.beginBulkSave();
+        newProject.saveCompounds(set<Compound*>({&compound}));
+        newProject.deleteTableGroups("test table");
+        newProject.endBulkSave();
+    }
+    ProjectDatabase newProject(projectFile(0), "v0.10.0");
+    vector<Compound*> compounds = newProject.loadCompounds("testdb");
+    QVERIFY(compounds.size() == 1);
+    for (auto compound : compounds)
+        delete compound;
+    remove(projectFile(0).c_str());
+}
+
+void TestProjectDB::testScanSignatureLocale() {
+    // signatures are written with a decimal point even if the application
+    // runs in a locale using a decimal comma, for C and C++ formatting
+    struct CommaDecimal : numpunct<char> {
+        char do_decimal_point() const { return ','; }
+    };
+    string previousLocale = setlocale(LC_ALL, nullptr);
+    for (auto name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8"}) {
+        if (setlocale(LC_NUMERIC, name) != nullptr)
+            break;
+    }
+    locale previousGlobal = locale::global(locale(locale::classic(),
+                                                  new CommaDecimal));
+
+    mzSample sample;
+    sample.sampleName = "signature";
+    Scan* scan = new Scan(&sample, 0, 2, 1.5f, 250.5f, 1);
+    scan->mz = {100.25f, 200.5f};
+    scan->intensity = {50.5f, 1000.25f};
+    sample.scans.push_back(scan);
+
+    remove(projectFile(1).c_str());
+    {
+        ProjectDatabase project(projectFile(1), "v0.10.0");
+        project.saveScans(vector<mzSample*>({&sample}));
+    }
+    locale::global(previousGlobal);
+    setlocale(LC_ALL, previousLocale.c_str());
+
+    Connection connection(projectFile(1));
+    Cursor* scansQuery = connection.prepare("SELECT data FROM scans");
+    QVERIFY(scansQuery->next());
+    QVERIFY(scansQuery->stringValue("data")
+            == "[200.5,1000.25][100.25,50.5]");
+    remove(projectFile(1).c_str());
+}
+
+void TestProjectDB::benchmarkSaveProject_data() {
+    QTest::addColumn<int>("groupCount");
+    QTest::addColumn<bool>("bulk");
+
+    QList<int> counts = QList<int>() << 1000 << 10000;
+    for (int count : counts) {
+        QTest::newRow(qPrintable(QString("%1 groups").arg(count)))
+            << count << false;
+        QTest::newRow(qPrintable(QString("bulk %1 groups").arg(count)))
+            << count << true;
+    }
+}
+
+void TestProjectDB::benchmarkSaveProject() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, groupCount);
+    QFETCH(bool, bulk);
+
+    QBENCHMARK {
+        writeProject(groupCount, bulk);
+    }
+
+    ProjectDatabase project(projectFile(groupCount), "v0.10.0");
+    vector<PeakGroup*> groups = project.loadGroups(samples);
+    QVERIFY(groups.size() == static_cast<size_t>(groupCount));
+    for (auto group : groups)
+        delete group;
+
+    remove(projectFile(groupCount).c_str());
+}
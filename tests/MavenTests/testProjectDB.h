@@ -0,0 +1,49 @@
+#ifndef TESTPROJECTDB_H
+#define TESTPROJECTDB_H
+#include <iostream>
+#include <QtTest>
+#include <string>
+#include <sstream>
+#include <clocale>
+#include "utilities.h"
+#include "Compound.h"
+#include "PeakGroup.h"
+#include "mzSample.h"
+#include "projectdatabase.h"
+#include "connection.h"
+#include "cursor.h"
+
+class TestProjectDB : public QObject {
+    Q_OBJECT
+
+    public:
+        TestProjectDB();
+
+    private:
+        vector<mzSample*> samples;
+        string projectFile(int groupCount);
+        void writeProject(int groupCount, bool bulk=false);
+
+    private Q_SLOTS:
+        // functions executed by QtTest before and after test suite
+        void initTestCase();
+        void cleanupTestCase();
+
+        // functions executed by QtTest before and after each test
+        void init();
+        void cleanup();
+
+        // test functions - all functions prefixed with "test" will be ran as tests
+        // this is automatically detected thanks to Qt's meta-information about QObjects
+        void testLoadGroups();
+        void testLoadCompounds();
+        void benchmarkLoadProject_data();
+        void benchmarkLoadProject();
+        void testBulkSave();
+        void testDeleteInBulkSave();
+        void testScanSignatureLocale();
+        void benchmarkSaveProject_data();
+        void benchmarkSaveProject();
+};
+
+#endif // TESTPROJECTDB_H
@@ -50,3 +50,142 @@ void TestSRMList::testGetProductOfSrm() {
     QVERIFY(productMz2 == 140);
     QVERIFY(productMz3 == 435);
 }
+
+deque<Compound*> TestSRMList::makeTransitionLibrary(int count, unsigned int seed) {
+    srand(seed);
+    deque<Compound*> compounds;
+    for (int i = 0; i < count; i++) {
+        int charge = (i % 3) - 1;
+        Compound* compound = new Compound(to_string(i), to_string(i), "", charge);
+        // transitions at a 0.01 Da grid, so that ties in distance occur
+        compound->precursorMz = 50.0f + (rand() % 95000) / 100.0f;
+        compound->productMz = 20.0f + (rand() % 50000) / 100.0f;
+        compound->expectedRt = (rand() % 20);
+        if (i % 50 == 0) compound->precursorMz = 0;
+        compounds.push_back(compound);
+    }
+    return compounds;
+}
+
+Compound* TestSRMList::linearNearest(const deque<Compound*>& compounds,
+                                     float precursorMz,
+                                     float productMz,
+                                     float rt,
+                                     int polarity,
+                                     double amuQ1,
+                                     double amuQ3) {
+    Compound* x = NULL;
+    float distMz = FLT_MAX;
+    float distRt = FLT_MAX;
+    for (auto compound : compounds) {
+        if (compound->precursorMz == 0) continue;
+        if (compound->charge != polarity && compound->charge != 0) continue;
+        float a = abs(compound->precursorMz - precursorMz);
+        if (a > amuQ1) continue;
+        float b = abs(compound->productMz - productMz);
+        if (b > amuQ3) continue;
+        float dMz = sqrt(a * a + b * b);
+        float dRt = abs(compound->expectedRt - rt);
+        if (dMz < distMz || (dMz == distMz && dRt < distRt)) {
+            x = compound;
+            distMz = dMz;
+            distRt = dRt;
+        }
+    }
+    return x;
+}
+
+void TestSRMList::testTransitionIndex() {
+    deque<Compound*> compounds = makeTransitionLibrary(20000, 1);
+    vector<mzSample*> samples;
+    SRMList srmList(samples, compounds);
+
+    srand(2);
+    for (int i = 0; i < 2000; i++) {
+        // half of the queries are transitions of the library itself
+        Compound* known = compounds[rand() % compounds.size()];
+        float precursorMz = i % 2 ? known->precursorMz : 50.0f + (rand() % 95000) / 100.0f;
+        float productMz = i % 2 ? known->productMz : 20.0f + (rand() % 50000) / 100.0f;
+        float rt = rand() % 20;
+        int polarity = (i % 3) - 1;
+
+        QVERIFY(srmList.findSpeciesByPrecursor(precursorMz, productMz, rt, polarity, 0.5, 0.5)
+                == linearNearest(compounds, precursorMz, productMz, rt, polarity, 0.5, 0.5));
+    }
+
+    string srmId = "- SRM SIC Q1=124 Q3=80 sample=157 period=1 experiment=1 transition=0";
+    deque<Compound*> matched = srmList.getMatchedCompounds(srmId, 2, 2, -1);
+    deque<Compound*> expected;
+    for (auto compound : compounds) {
+        if (compound->precursorMz == 0) continue;
+        if (compound->charge != -1 && compound->charge != 0) continue;
+        if (abs(compound->precursorMz - 124.0f) > 2) continue;
+        if (abs(compound->productMz - 80.0f) > 2) continue;
+        expected.push_back(compound);
+    }
+    QVERIFY(matched == expected);
+
+    delete_all(compounds);
+}
+
+void TestSRMList::benchmarkFindSpecies_data() {
+    QTest::addColumn<int>("librarySize");
+    QTest::addColumn<bool>("indexed");
+
+    QList<int> sizes = QList<int>() << 1000 << 50000 << 500000;
+    for (int size : sizes) {
+        QTest::newRow(qPrintable(QString("linear %1").arg(size)))
+            << size << false;
+        QTest::newRow(qPrintable(QString("indexed %1").arg(size)))
+            << size << true;
+    }
+}
+
+void TestSRMList::benchmarkFindSpecies() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(int, librarySize);
+    QFETCH(bool, indexed);
+
+    deque<Compound*> compounds = makeTransitionLibrary(librarySize, 1);
+    vector<mzSample*> samples;
+    SRMList srmList(samples, compounds);
+
+    // a fixed panel of transitions is annotated against the library
+    deque<Compound*> panel = makeTransitionLibrary(200, 2);
+    vector<Compound*> annotated(panel.size(), NULL);
+    QBENCHMARK {
+        for (unsigned int i = 0; i < panel.size(); i++) {
+            Compound* transition = panel[i];
+            if (indexed) {
+                annotated[i] = srmList.findSpeciesByPrecursor(transition->precursorMz,
+                                                              transition->productMz,
+                                                              transition->expectedRt,
+                                                              -1,
+                                                              0.5,
+                                                              0.5);
+            } else {
+                annotated[i] = linearNearest(compounds,
+                                             transition->precursorMz,
+                                             transition->productMz,
+                                             transition->expectedRt,
+                                             -1,
+                                             0.5,
+                                             0.5);
+            }
+        }
+    }
+
+    // both lookups annotate the panel with the same compounds
+    for (unsigned int i = 0; i < panel.size(); i++) {
+        QVERIFY(annotated[i] == linearNearest(compounds,
+                                              panel[i]->precursorMz,
+                                              panel[i]->productMz,
+                                              panel[i]->expectedRt,
+                                              -1,
+                                              0.5,
+                                              0.5));
+    }
+
+    delete_all(panel);
+    delete_all(compounds);
+}
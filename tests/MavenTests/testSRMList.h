@@ -31,7 +31,23 @@ class TestSRMList : public QObject {
          */
         void testGetProductOfSrm();
 
+        /**
+         * @see TransitionIndex
+         */
+        void testTransitionIndex();
+        void benchmarkFindSpecies_data();
+        void benchmarkFindSpecies();
+
     private:
+        deque<Compound*> makeTransitionLibrary(int count, unsigned int seed);
+        Compound* linearNearest(const deque<Compound*>& compounds,
+                                float precursorMz,
+                                float productMz,
+                                float rt,
+                                int polarity,
+                                double amuQ1,
+                                double amuQ3);
+
         string filterline1;
         string filterline2;
         string filterline3;
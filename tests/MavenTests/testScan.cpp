@@ -307,3 +307,166 @@ void TestScan::testgetTopPeaks() {
     QVERIFY(TestUtils::floatCompare(selected[0].second,(float) 2.06999993));
     QVERIFY(TestUtils::floatCompare(selected[1].second,(float) 8.8000001));
 }
+
+void TestScan::testSpectralSearch() {
+    vector<mzSample*> samples = maventests::samples.ms2TestSamples;
+
+    //query with the three most intense fragments of a fragmentation scan
+    Scan* query = samples[0]->fragmentationScans()[0];
+    vector<pair<float, int> > peaks;
+    for (unsigned int i = 0; i < query->nobs(); i++)
+        peaks.push_back(make_pair(query->intensity[i], i));
+    sort(peaks.rbegin(), peaks.rend());
+    vector<double> mzs;
+    for (unsigned int i = 0; i < 3 && i < peaks.size(); i++)
+        mzs.push_back(query->mz[peaks[i].second]);
+
+    MassCutoff precursorCutoff;
+    precursorCutoff.setMassCutoffAndType(20, "ppm");
+    MassCutoff productCutoff;
+    productCutoff.setMassCutoffAndType(20, "ppm");
+
+    SpectralSearch search;
+    search.setSamples(samples);
+    search.setSearchType(SpectralSearch::FragmentSearch);
+    search.setMsLevel(2);
+    search.setPrecursorMz(query->precursorMz);
+    search.setPrecursorMassCutoff(precursorCutoff);
+    search.setProductMassCutoff(productCutoff);
+    search.setMinMatches(0);
+    search.setQuery(mzs, vector<double>(), vector<double>(), vector<double>(), false);
+    search.setBatchSize(2);
+
+    unsigned int streamed = 0;
+    search.hitsFound.connect([&streamed](const vector<SpectralSearchHit>& hits) {
+        streamed += hits.size();
+    });
+    vector<SpectralSearchHit> hits = search.run();
+    QVERIFY(!search.stopped());
+    QVERIFY(streamed == hits.size());
+
+    //indexed search must find the same scans, in the same order, as
+    //scoring every scan of every sample
+    vector<Scan*> expected;
+    for (mzSample* sample : samples) {
+        for (Scan* scan : sample->scans) {
+            if (scan->mslevel != 2) continue;
+            if (mzUtils::massCutoffDist((double)query->precursorMz,
+                                        (double)scan->precursorMz,
+                                        &precursorCutoff)
+                > precursorCutoff.getMassCutoff())
+                continue;
+            float score = 0;
+            int matchCount = 0;
+            for (double mz : mzs) {
+                int pos = scan->findHighestIntensityPos(mz, &productCutoff);
+                if (pos >= 0) {
+                    matchCount++;
+                    score += log(scan->intensity[pos]);
+                } else {
+                    score--;
+                }
+            }
+            if (score > 0 && matchCount > 0) expected.push_back(scan);
+        }
+    }
+    QVERIFY(!expected.empty());
+    QVERIFY(hits.size() == expected.size());
+    for (unsigned int i = 0; i < hits.size(); i++)
+        QVERIFY(hits[i].scan == expected[i]);
+    QVERIFY(search.candidateCount() < samples[0]->scans.size() + samples[1]->scans.size());
+
+    //stopping after the first batch leaves the remaining candidates unscored
+    SpectralSearch patternSearch;
+    patternSearch.setSamples(samples);
+    patternSearch.setSearchType(SpectralSearch::PatternSearch);
+    patternSearch.setMsLevel(2);
+    patternSearch.setProductMassCutoff(productCutoff);
+    patternSearch.setQuery(mzs, vector<double>(3, 100), vector<double>(), vector<double>(), false);
+    patternSearch.setBatchSize(1);
+    unsigned int batches = 0;
+    patternSearch.progress.connect([&patternSearch, &batches](unsigned int, unsigned int) {
+        batches++;
+        patternSearch.stop();
+    });
+    patternSearch.run();
+    QVERIFY(patternSearch.stopped());
+    QVERIFY(batches == 1);
+    QVERIFY(patternSearch.candidateCount() > 1);
+
+    //a stop requested before the search runs is kept until it is cleared
+    SpectralSearch stoppedSearch;
+    stoppedSearch.setSamples(samples);
+    stoppedSearch.setSearchType(SpectralSearch::FragmentSearch);
+    stoppedSearch.setMsLevel(2);
+    stoppedSearch.setPrecursorMz(query->precursorMz);
+    stoppedSearch.setPrecursorMassCutoff(precursorCutoff);
+    stoppedSearch.setProductMassCutoff(productCutoff);
+    stoppedSearch.setMinMatches(0);
+    stoppedSearch.setQuery(mzs, vector<double>(), vector<double>(), vector<double>(), false);
+    stoppedSearch.stop();
+    QVERIFY(stoppedSearch.run().empty());
+    QVERIFY(stoppedSearch.stopped());
+    stoppedSearch.clearStop();
+    QVERIFY(!stoppedSearch.run().empty());
+    QVERIFY(!stoppedSearch.stopped());
+}
+
+void TestScan::testSpectralLibrary() {
+    //library of the top fragments of every fragmentation scan
+    vector<Scan*> ms2Scans = maventests::samples.ms2TestSamples[0]->fragmentationScans();
+    deque<Compound*> compounds;
+    vector<Fragment*> queries;
+    for (Scan* scan : ms2Scans) {
+        Fragment* fragment = new Fragment(scan, 0.01, 1, 20);
+        fragment->sortByIntensity();
+        queries.push_back(fragment);
+
+        Compound* compound = new Compound(to_string(scan->scannum), "", "", 0);
+        compound->precursorMz = scan->precursorMz;
+        compound->fragmentMzValues = fragment->mzValues;
+        compound->fragmentIntensities = fragment->intensityValues;
+        compounds.push_back(compound);
+    }
+
+    for (bool searchProton : {false, true}) {
+        SpectralLibrary library;
+        library.build(compounds, searchProton);
+        vector<vector<SpectralLibrary::Match> > allMatches =
+            library.search(queries, 20, "MVH", 2);
+
+        for (unsigned int i = 0; i < queries.size(); i++) {
+            const vector<SpectralLibrary::Match>& matches = allMatches[i];
+            for (unsigned int j = 1; j < matches.size(); j++)
+                QVERIFY(matches[j - 1].score.mergedScore >= matches[j].score.mergedScore);
+
+            //every compound matched by scoring it directly is found, with
+            //identical scores
+            unsigned int expected = 0;
+            for (Compound* compound : compounds) {
+                if (compound->fragmentMzValues.size() < 2) continue;
+                Fragment query(queries[i]);
+                FragmentationMatchScore s =
+                    compound->scoreCompoundHit(&query, 20, searchProton);
+                if (s.numMatches < 2) continue;
+                expected++;
+
+                auto match = find_if(matches.begin(),
+                                     matches.end(),
+                                     [compound](const SpectralLibrary::Match& m) {
+                                         return m.compound == compound;
+                                     });
+                QVERIFY(match != matches.end());
+                QVERIFY(match->score.numMatches == s.numMatches);
+                QVERIFY(match->score.mvhScore == s.mvhScore);
+                QVERIFY(match->score.dotProduct == s.dotProduct);
+                QVERIFY(match->score.weightedDotProduct == s.weightedDotProduct);
+                QVERIFY(match->score.hypergeomScore == s.hypergeomScore);
+            }
+            QVERIFY(matches.size() == expected);
+        }
+    }
+
+    mzUtils::delete_all(queries);
+    mzUtils::delete_all(compounds);
+}
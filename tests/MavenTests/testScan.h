@@ -9,6 +9,11 @@
 #include <string.h>
 #include "utilities.h"
 #include "mzSample.h"
+#include "mzUtils.h"
+#include "spectralsearch.h"
+#include "spectrallibrary.h"
+#include "Compound.h"
+#include "Fragment.h"
 
 
 class TestScan : public QObject {
@@ -40,6 +45,8 @@ class TestScan : public QObject {
         void testchargeSeries();
         void testdeconvolute();
         void testgetTopPeaks();
+        void testSpectralSearch();
+        void testSpectralLibrary();
 
 };
 
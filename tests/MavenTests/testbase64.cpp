@@ -121,3 +121,148 @@ void Testbase64::testencodeString() {
     QVERIFY((unsigned char)dest[21]=='Q');
 
 }
+
+void Testbase64::testdecodeBinaryArray() {
+
+    // 64-bit little endian values, split over two lines
+    string b64String = "////Pz+EUU\n  D1//+fAg6iQAEAAMDAhFFA";
+    base64::BinaryFormat format;
+    format.float_size = 8;
+    base64::DecodeBuffer buffer;
+
+    vector<double> doubles;
+    QVERIFY(base64::decodeBinaryArray(b64String.data(), b64String.size(),
+                                      format, doubles, buffer));
+    QVERIFY(doubles.size() == 3);
+    QVERIFY(doubles[0] == 70.0663604736328);
+    QVERIFY(doubles[1] == 2311.00512695312);
+    QVERIFY(doubles[2] == 70.0742645263672);
+
+    vector<float> floats;
+    QVERIFY(base64::decodeBinaryArray(b64String.data(), b64String.size(),
+                                      format, floats, buffer));
+    QVERIFY(floats.size() == 3);
+    QVERIFY(TestUtils::floatCompare(floats[1], 2311.00512695312));
+
+    // 32-bit big endian values
+    string networkString = "Qowh+kUQcBVCjCYG";
+    format.float_size = 4;
+    format.networkorder = true;
+    QVERIFY(base64::decodeBinaryArray(networkString.data(),
+                                      networkString.size(),
+                                      format, floats, buffer));
+    QVERIFY(floats.size() == 3);
+    QVERIFY(TestUtils::floatCompare(floats[0], 70.0663604736328));
+    QVERIFY(TestUtils::floatCompare(floats[2], 70.0742645263672));
+}
+
+void Testbase64::testdecodeZlib() {
+
+    base64::BinaryFormat format;
+    format.zlib = true;
+    format.count = 3;
+    base64::DecodeBuffer buffer;
+
+    string b64String = "eJz7pdjjJFog4Mqm1uMEABxOA74=";
+    vector<float> floats;
+    QVERIFY(base64::decodeBinaryArray(b64String.data(), b64String.size(),
+                                      format, floats, buffer));
+    QVERIFY(floats.size() == 3);
+    QVERIFY(TestUtils::floatCompare(floats[0], 70.0663604736328));
+    QVERIFY(TestUtils::floatCompare(floats[1], 2311.00512695312));
+    QVERIFY(TestUtils::floatCompare(floats[2], 70.0742645263672));
+
+    vector<float> decodedArray = base64::decode_base64(b64String, 4, false, true);
+    QVERIFY(decodedArray == floats);
+
+    string b64String64 = "eJz7//+/vX1LoMPX///nM/EtcmBkYDhwAMgHAKlqC6s=";
+    format.float_size = 8;
+    vector<double> doubles;
+    QVERIFY(base64::decodeBinaryArray(b64String64.data(), b64String64.size(),
+                                      format, doubles, buffer));
+    QVERIFY(doubles.size() == 3);
+    QVERIFY(doubles[1] == 2311.00512695312);
+}
+
+void Testbase64::testdecodeNumpress() {
+
+    base64::BinaryFormat format;
+    base64::DecodeBuffer buffer;
+    vector<double> values;
+
+    string linear = "QI9AAAAAAACghgEAQA0DAFTx0h24TX6347s=";
+    format.numpress = base64::Numpress::Linear;
+    QVERIFY(base64::decodeBinaryArray(linear.data(), linear.size(),
+                                      format, values, buffer));
+    QVERIFY(values.size() == 6);
+    QVERIFY(values[0] == 100.0);
+    QVERIFY(values[2] == 300.5);
+    QVERIFY(values[3] == 400.25);
+    QVERIFY(values[5] == 120.125);
+
+    // linear prediction followed by zlib compression
+    string linearZlib = "eJxz6HdgAIEFbYwMDrzMDCEfL8nu8K3b/ng3AFKfCJM=";
+    format.zlib = true;
+    vector<float> floats;
+    QVERIFY(base64::decodeBinaryArray(linearZlib.data(), linearZlib.size(),
+                                      format, floats, buffer));
+    QVERIFY(floats.size() == 6);
+    QVERIFY(floats[4] == 401.0f);
+
+    string pic = "h/QAATBC4Xc=";
+    format.zlib = false;
+    format.numpress = base64::Numpress::Pic;
+    QVERIFY(base64::decodeBinaryArray(pic.data(), pic.size(),
+                                      format, values, buffer));
+    QVERIFY(values.size() == 5);
+    QVERIFY(values[0] == 0.0);
+    QVERIFY(values[1] == 15.0);
+    QVERIFY(values[2] == 4096.0);
+    QVERIFY(values[3] == 123456.0);
+    QVERIFY(values[4] == 7.0);
+
+    // slof is lossy, values are within a fraction of a percent
+    string slof = "QLOIAAAAAADVLvCGwvI=";
+    format.numpress = base64::Numpress::Slof;
+    QVERIFY(base64::decodeBinaryArray(slof.data(), slof.size(),
+                                      format, values, buffer));
+    QVERIFY(values.size() == 3);
+    QVERIFY(fabs(values[0] - 10.0) < 0.01);
+    QVERIFY(fabs(values[1] - 1000.0) < 1.0);
+    QVERIFY(fabs(values[2] - 2.5e5) < 250.0);
+
+    // the first values of the TIC of ms2test1.mzML (converted by msconvert),
+    // encoded the way msconvert does with -numpressLinear and -numpressSlof:
+    // reference encoder, fixed points from optimalLinearFixedPoint and
+    // optimalSlofFixedPoint
+    double times[10] = {3.3333333333333335e-05, 0.00375, 0.00795,
+                        0.010216666666666667, 0.011116666666666667,
+                        0.012916666666666667, 0.013516666666666666,
+                        0.014116666666666666, 0.015116666666666667,
+                        0.016416666666666666};
+    double intensities[10] = {20.0, 5870.0, 123540.0, 8000.0, 2151000.0,
+                              2231000.0, 0.0, 25200.0, 5200.0, 3133.0};
+
+    string timeArray = "Qc////+AAADPiwAApHA9AD4756QDUOqcuZ4/3r6m1lzoOb2GO0rk";
+    format.numpress = base64::Numpress::Linear;
+    QVERIFY(base64::decodeBinaryArray(timeArray.data(), timeArray.size(),
+                                      format, values, buffer));
+    QVERIFY(values.size() == 10);
+    for (int i = 0; i < 10; i++)
+        QVERIFY(fabs(values[i] - times[i]) < 1.0 / 1073741823);
+
+    string intensityArray = "QLGDAAAAAABRNfaXUM1inVn//P8AAHqx15X4jA==";
+    format.numpress = base64::Numpress::Slof;
+    QVERIFY(base64::decodeBinaryArray(intensityArray.data(),
+                                      intensityArray.size(),
+                                      format, values, buffer));
+    QVERIFY(values.size() == 10);
+    for (int i = 0; i < 10; i++)
+        QVERIFY(fabs(values[i] - intensities[i])
+                <= (intensities[i] + 1) * 0.001);
+
+    // truncated data
+    unsigned char truncated[4] = {0, 0, 0, 0};
+    QVERIFY(!base64::decodeNumpress(truncated, 4, base64::Numpress::Slof,
+                                    values));
+}
@@ -33,6 +33,9 @@ class Testbase64 : public QObject {
         void testdecodeString();
         void testencode_base64();
         void testencodeString();
+        void testdecodeBinaryArray();
+        void testdecodeZlib();
+        void testdecodeNumpress();
 
 };
 
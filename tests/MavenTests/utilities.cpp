@@ -13,6 +13,11 @@ bool TestUtils::floatCompare(float a, float b)
     return fabs(a - b) < EPSILON;
 }
 
+bool TestUtils::benchmarksEnabled()
+{
+    return qEnvironmentVariableIsSet("MAVEN_BENCHMARKS");
+}
+
 bool TestUtils::compareMaps(const map<string, int>& l,
                             const map<string, int>& k)
 {
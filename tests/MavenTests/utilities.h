@@ -74,8 +74,16 @@ class TestUtils {
         static vector<PeakGroup> getGroupsFromProcessCompounds();
         static void loadSamplesAndParameters(vector<mzSample*>& samplesToLoad,
                                              MavenParameters* mavenparameters);
+        static bool benchmarksEnabled();
 };
 
+// benchmarks are slow, they only run when MAVEN_BENCHMARKS is set
+#define SKIP_UNLESS_BENCHMARKING()                                    \
+    do {                                                              \
+        if (!TestUtils::benchmarksEnabled())                          \
+            QSKIP("benchmarks only run when MAVEN_BENCHMARKS is set"); \
+    } while (0)
+
 namespace maventests {
     extern Databases database;
     extern TestSamples samples;